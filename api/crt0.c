@@ -1,3 +1,6 @@
+#include <common/system_page.h>
+#include <threads.h>
+
 extern void exit(int status);
 extern int main(int argc, char** argv);
 extern void _init();
@@ -19,8 +22,37 @@ void handle_fini_array(void)
 		(*func)();
 }
 
+//the kernel returns straight to our caller, see handle_sysenter
+extern void _syscall_sysenter(void);
+
+__asm__(
+	".global _syscall_sysenter\n"
+	".type _syscall_sysenter, @function\n"
+	"_syscall_sysenter:\n"
+	"	pushl %ebp\n"
+	"	movl %esp, %ebp\n"
+	"	sysenter\n"
+);
+
+//int 0x80 always works, sysenter is used if the kernel set it up
+static void select_syscall_entry(void)
+{
+	if(SYSTEM_PAGE->features & SYSTEM_FEATURE_SYSENTER)
+	{
+		SYSTEM_PAGE->syscall_entry = (void*)_syscall_sysenter;
+	}
+}
+
+//thrd_create gives the other threads theirs
+static struct __thread_block main_thread_block = {&main_thread_block, 0};
+
 void _start()
 {
+	select_syscall_entry();
+
+	//malloc looks for the thread's heap cache through gs before anything else can run
+	set_tls_base(&main_thread_block);
+
 	_init();
 
 	handle_init_array();
@@ -34,6 +66,24 @@ void _start()
     exit(r);
 }
 
+//PLT0 jumps here the first time a function in a shared library is called,
+//with the object id and the offset of the relocation pushed on the stack
+//the kernel fills in the GOT entry and we jump straight to the function
+__asm__(
+	".global _dl_runtime_resolve\n"
+	".type _dl_runtime_resolve, @function\n"
+	"_dl_runtime_resolve:\n"
+	"	pushal\n"
+	"	movl 32(%esp), %eax\n"	//object id
+	"	movl 36(%esp), %ecx\n"	//relocation offset
+	"	movl $35, %ebx\n"			//SYSCALL_RESOLVE_PLT
+	"	int $0x80\n"
+	"	movl %eax, 36(%esp)\n"	//replace the relocation offset with the function address
+	"	popal\n"
+	"	addl $4, %esp\n"
+	"	ret\n"
+);
+
 void __cxa_pure_virtual() {
     // Do Nothing
 }
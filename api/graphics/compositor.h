@@ -0,0 +1,82 @@
+#ifndef COMPOSITOR_H
+#define COMPOSITOR_H
+
+#include <stdint.h>
+#include <common/input_ring.h>
+#include <graphics/graphics.h>
+
+//what the display server and its clients share
+//the server makes one buffer with a slot for every window, the pixels of each window
+//are in a buffer of their own that the client makes and names in its slot
+
+#define COMPOSITOR_BUFFER_NAME "compositor"
+#define COMPOSITOR_MAX_WINDOWS 16
+#define WINDOW_BUFFER_NAME_SIZE 24
+
+//no window is wider or taller than this, so the server can multiply a client's sizes without overflowing
+#define COMPOSITOR_MAX_WINDOW_SIZE 4096
+
+enum window_state : uint32_t
+{
+	WINDOW_FREE,		//nobody is using the slot
+	WINDOW_CLAIMED,		//a client is setting it up, the server leaves it alone
+	WINDOW_OPEN,		//the server shows it once it has been damaged the first time
+	WINDOW_CLOSED		//the client is done with it, the server takes it off the screen and frees the slot
+};
+
+enum window_flags : uint32_t
+{
+	WINDOW_TRANSLUCENT = 0x01	//the pixels are ARGB8888 and get blended instead of copied
+};
+
+struct window_slot
+{
+	volatile uint32_t state;
+	uint32_t flags;
+	uint32_t generation;	//goes up every time the slot is claimed, so buffer names aren't reused too soon
+
+	//set by the client before the window is open, the server owns the position after that
+	int32_t x;
+	int32_t y;
+	uint32_t width;
+	uint32_t height;
+	uint32_t pitch;
+	display_format format;
+	char buffer_name[WINDOW_BUFFER_NAME_SIZE];
+
+	//what the client changed since the server last looked, in window coordinates
+	volatile uint8_t damage_lock;
+	rect damage;
+
+	//the server routes input here, it moves head and the client tail, like the kernel's ring for a process
+	input_ring input;
+};
+
+struct compositor_control
+{
+	volatile uint8_t lock;		//held while claiming a slot
+	volatile uint32_t running;	//cleared when the server exits, the clients should close their windows
+	uint32_t screen_width;
+	uint32_t screen_height;
+	display_format screen_format;	//opaque windows use it, so compositing them is a copy
+	window_slot windows[COMPOSITOR_MAX_WINDOWS];
+};
+
+//the locks are only held for a few instructions, but the other side might be on another cpu
+static inline void compositor_lock(volatile uint8_t* lock)
+{
+	while(__sync_lock_test_and_set(lock, 1))
+	{
+		while(__atomic_load_n(lock, __ATOMIC_RELAXED))
+		{
+			__asm__ volatile("rep; nop");
+		}
+	}
+}
+
+static inline void compositor_unlock(volatile uint8_t* lock)
+{
+	__sync_lock_release(lock);
+}
+
+#endif
\ No newline at end of file
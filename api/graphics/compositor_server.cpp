@@ -0,0 +1,392 @@
+#include <string.h>
+#include <sys/syscalls.h>
+#include <graphics/compositor_server.h>
+
+#define DESKTOP_COLOR 0xFF306080
+#define CURSOR_SIZE 10
+
+static size_t pages_for(size_t bytes)
+{
+	return (bytes + PAGE_SIZE - 1) / PAGE_SIZE;
+}
+
+static bool contains(const rect& outer, const rect& inner)
+{
+	return inner.x >= outer.x && inner.y >= outer.y &&
+		   inner.x + inner.w <= outer.x + outer.w && inner.y + inner.h <= outer.y + outer.h;
+}
+
+compositor_server::compositor_server(const display_mode& requested)
+	: m_screen(requested),
+	  m_control_buffer(0),
+	  m_control(nullptr),
+	  m_windows{},
+	  m_num_windows(0),
+	  m_order{},
+	  m_cursor_x(0),
+	  m_cursor_y(0)
+{
+	if(!m_screen.valid())
+	{
+		return;
+	}
+
+	//fails if the name is taken, so there's only ever one compositor
+	m_control_buffer = create_shared_buffer(COMPOSITOR_BUFFER_NAME, strlen(COMPOSITOR_BUFFER_NAME),
+											sizeof(compositor_control));
+
+	if(!m_control_buffer)
+	{
+		return;
+	}
+
+	m_control = (compositor_control*)map_shared_buffer(m_control_buffer, sizeof(compositor_control), PAGE_RW);
+
+	if(!m_control)
+	{
+		return;
+	}
+
+	memset(m_control, 0, sizeof(compositor_control));
+
+	const display_mode& mode = m_screen.mode();
+	m_control->screen_width = mode.width;
+	m_control->screen_height = mode.height;
+	m_control->screen_format = mode.format;
+
+	m_cursor_x = mode.width / 2;
+	m_cursor_y = mode.height / 2;
+
+	m_screen.damage_all();
+
+	__atomic_store_n(&m_control->running, 1, __ATOMIC_RELEASE);
+}
+
+compositor_server::~compositor_server()
+{
+	if(m_control)
+	{
+		__atomic_store_n(&m_control->running, 0, __ATOMIC_RELEASE);
+
+		for(size_t i = 0; i < COMPOSITOR_MAX_WINDOWS; i++)
+		{
+			if(m_windows[i].open)
+			{
+				close_window(i);
+			}
+		}
+
+		unmap_pages(m_control, pages_for(sizeof(compositor_control)));
+	}
+
+	//the clients hold on to the buffer until they've noticed we're gone
+	if(m_control_buffer)
+	{
+		close_shared_buffer(m_control_buffer);
+	}
+}
+
+void compositor_server::open_window(size_t index)
+{
+	window_slot& slot = m_control->windows[index];
+
+	//the slot is the client's, so nothing in it is trusted
+	char name[WINDOW_BUFFER_NAME_SIZE];
+	memcpy(name, slot.buffer_name, sizeof(name));
+	name[sizeof(name) - 1] = '\0';
+
+	//read once, the client could change them after they're checked
+	const int32_t x = slot.x;
+	const int32_t y = slot.y;
+	const uint32_t width = slot.width;
+	const uint32_t height = slot.height;
+	const uint32_t pitch = slot.pitch;
+	const display_format format = slot.format;
+	const uint32_t flags = slot.flags;
+
+	const size_t bpp = display_format_bytes(format);
+
+	//with both sizes bounded width * bpp can't overflow, and the position keeps x + width in an int
+	if(bpp == 0 || width == 0 || height == 0 ||
+	   width > COMPOSITOR_MAX_WINDOW_SIZE || height > COMPOSITOR_MAX_WINDOW_SIZE ||
+	   x < -COMPOSITOR_MAX_WINDOW_SIZE || x > COMPOSITOR_MAX_WINDOW_SIZE ||
+	   y < -COMPOSITOR_MAX_WINDOW_SIZE || y > COMPOSITOR_MAX_WINDOW_SIZE)
+	{
+		return;
+	}
+
+	if(pitch < width * bpp || pitch > UINT32_MAX / height)
+	{
+		return;
+	}
+
+	const size_t size = (size_t)pitch * height;
+
+	//it might already be gone if the client closed it right away, then the slot says so next time
+	uintptr_t buffer = open_shared_buffer(name, strlen(name));
+
+	if(!buffer)
+	{
+		return;
+	}
+
+	//the buffer has to be at least this big or the mapping fails, we only ever read it
+	void* pixels = map_shared_buffer(buffer, size, 0);
+
+	if(!pixels)
+	{
+		close_shared_buffer(buffer);
+		return;
+	}
+
+	m_windows[index] = {
+		true,
+		false,
+		buffer,
+		pixels,
+		{x, y, (int)width, (int)height},
+		pitch,
+		format,
+		flags
+	};
+
+	//new windows go on top and get the focus
+	m_order[m_num_windows++] = index;
+}
+
+void compositor_server::close_window(size_t index)
+{
+	window_state& w = m_windows[index];
+
+	if(w.shown)
+	{
+		m_screen.damage(w.frame);
+	}
+
+	unmap_pages(w.pixels, pages_for(w.pitch * w.frame.h));
+	close_shared_buffer(w.buffer);
+
+	for(size_t k = 0; k < m_num_windows; k++)
+	{
+		if(m_order[k] == index)
+		{
+			memmove(&m_order[k], &m_order[k + 1], (m_num_windows - k - 1) * sizeof(size_t));
+			m_num_windows--;
+			break;
+		}
+	}
+
+	w = {};
+}
+
+void compositor_server::update_windows()
+{
+	for(size_t i = 0; i < COMPOSITOR_MAX_WINDOWS; i++)
+	{
+		window_slot& slot = m_control->windows[i];
+		window_state& w = m_windows[i];
+
+		const uint32_t state = __atomic_load_n(&slot.state, __ATOMIC_ACQUIRE);
+
+		if(state == WINDOW_CLOSED)
+		{
+			if(w.open)
+			{
+				close_window(i);
+			}
+
+			__atomic_store_n(&slot.state, WINDOW_FREE, __ATOMIC_RELEASE);
+			continue;
+		}
+
+		if(state == WINDOW_OPEN && !w.open)
+		{
+			open_window(i);
+		}
+
+		if(!w.open)
+		{
+			continue;
+		}
+
+		compositor_lock(&slot.damage_lock);
+		rect damage = slot.damage;
+		slot.damage = {};
+		compositor_unlock(&slot.damage_lock);
+
+		if(damage.empty())
+		{
+			continue;
+		}
+
+		//nothing of it is on the screen yet
+		if(!w.shown)
+		{
+			w.shown = true;
+			damage = {0, 0, w.frame.w, w.frame.h};
+		}
+
+		damage = damage.intersect({0, 0, w.frame.w, w.frame.h});
+		m_screen.damage({w.frame.x + damage.x, w.frame.y + damage.y, damage.w, damage.h});
+	}
+}
+
+void compositor_server::raise(size_t index)
+{
+	if(m_num_windows == 0 || m_order[m_num_windows - 1] == index)
+	{
+		return;
+	}
+
+	for(size_t k = 0; k < m_num_windows; k++)
+	{
+		if(m_order[k] == index)
+		{
+			memmove(&m_order[k], &m_order[k + 1], (m_num_windows - k - 1) * sizeof(size_t));
+			m_order[m_num_windows - 1] = index;
+			break;
+		}
+	}
+
+	if(m_windows[index].shown)
+	{
+		m_screen.damage(m_windows[index].frame);
+	}
+}
+
+size_t compositor_server::window_at(int x, int y) const
+{
+	for(size_t k = m_num_windows; k-- > 0;)
+	{
+		const window_state& w = m_windows[m_order[k]];
+
+		if(w.shown && contains(w.frame, {x, y, 1, 1}))
+		{
+			return m_order[k];
+		}
+	}
+
+	return COMPOSITOR_MAX_WINDOWS;
+}
+
+rect compositor_server::cursor_rect() const
+{
+	return {m_cursor_x, m_cursor_y, CURSOR_SIZE, CURSOR_SIZE};
+}
+
+//the same as the kernel does for a process's ring, if the client isn't reading the event is lost
+void compositor_server::send_input(size_t index, const input_event& e)
+{
+	input_ring& ring = m_control->windows[index].input;
+
+	const uint32_t head = ring.head;
+
+	if(head - __atomic_load_n(&ring.tail, __ATOMIC_ACQUIRE) >= INPUT_RING_SIZE)
+	{
+		ring.dropped = ring.dropped + 1;
+		return;
+	}
+
+	ring.events[head % INPUT_RING_SIZE] = e;
+	__atomic_store_n(&ring.head, head + 1, __ATOMIC_RELEASE);
+}
+
+void compositor_server::route_input(const input_event& e)
+{
+	if(e.device_index == 0 && e.type == AXIS_MOTION && e.control_index < 2)
+	{
+		const rect old_cursor = cursor_rect();
+		const display_mode& mode = m_screen.mode();
+
+		if(e.control_index == 0)
+		{
+			m_cursor_x += e.data;
+			m_cursor_x = (m_cursor_x < 0) ? 0 : (m_cursor_x >= (int)mode.width) ? (int)mode.width - 1 : m_cursor_x;
+		}
+		else
+		{
+			m_cursor_y += e.data;
+			m_cursor_y = (m_cursor_y < 0) ? 0 : (m_cursor_y >= (int)mode.height) ? (int)mode.height - 1 : m_cursor_y;
+		}
+
+		m_screen.damage(old_cursor);
+		m_screen.damage(cursor_rect());
+	}
+	else if(e.type == BUTTON_DOWN)
+	{
+		const size_t index = window_at(m_cursor_x, m_cursor_y);
+
+		if(index != COMPOSITOR_MAX_WINDOWS)
+		{
+			raise(index);
+		}
+	}
+
+	if(m_num_windows)
+	{
+		send_input(m_order[m_num_windows - 1], e);
+	}
+}
+
+void compositor_server::draw_region(const rect& r)
+{
+	surface& back = m_screen.back();
+
+	//whatever is under an opaque window that covers all of r can't be seen
+	size_t first = 0;
+	bool covered = false;
+
+	for(size_t k = m_num_windows; k-- > 0;)
+	{
+		const window_state& w = m_windows[m_order[k]];
+
+		if(w.shown && !(w.flags & WINDOW_TRANSLUCENT) && contains(w.frame, r))
+		{
+			first = k;
+			covered = true;
+			break;
+		}
+	}
+
+	if(!covered)
+	{
+		back.fill(r, DESKTOP_COLOR);
+	}
+
+	for(size_t k = first; k < m_num_windows; k++)
+	{
+		const window_state& w = m_windows[m_order[k]];
+		const rect visible = w.frame.intersect(r);
+
+		if(!w.shown || visible.empty())
+		{
+			continue;
+		}
+
+		const surface pixels{w.pixels, (size_t)w.frame.w, (size_t)w.frame.h, w.pitch, w.format};
+		const rect src = {visible.x - w.frame.x, visible.y - w.frame.y, visible.w, visible.h};
+
+		if(w.flags & WINDOW_TRANSLUCENT)
+		{
+			back.blend(pixels, src, visible.x, visible.y);
+		}
+		else
+		{
+			back.blit(pixels, src, visible.x, visible.y);
+		}
+	}
+
+	const rect cursor = cursor_rect();
+	back.fill(cursor.intersect(r), 0xFF000000);
+	back.fill(rect{cursor.x + 1, cursor.y + 1, cursor.w - 2, cursor.h - 2}.intersect(r), 0xFFFFFFFF);
+}
+
+size_t compositor_server::composite()
+{
+	for(size_t i = 0; i < m_screen.num_damaged(); i++)
+	{
+		draw_region(m_screen.damaged(i));
+	}
+
+	return m_screen.present();
+}
\ No newline at end of file
@@ -0,0 +1,76 @@
+#ifndef COMPOSITOR_SERVER_H
+#define COMPOSITOR_SERVER_H
+
+#include <common/input_event.h>
+#include <graphics/display_surface.h>
+#include <graphics/compositor.h>
+
+//the display server's side of the windows
+//it owns the screen and the shared slots, puts the client windows together in the back buffer
+//only where something changed, and passes input on to the window with the focus
+class compositor_server
+{
+public:
+	//sets the mode and makes the shared buffer the clients look for
+	//valid() is false if either fails, which it does when another compositor is running
+	explicit compositor_server(const display_mode& requested);
+
+	compositor_server(const compositor_server&) = delete;
+	compositor_server& operator=(const compositor_server&) = delete;
+
+	//tells the clients to close and lets go of their windows
+	~compositor_server();
+
+	bool valid() const { return m_control != nullptr && m_screen.valid(); }
+
+	const display_mode& mode() const { return m_screen.mode(); }
+	size_t num_windows() const { return m_num_windows; }
+
+	//picks up windows that were opened or closed and what the clients damaged
+	void update_windows();
+
+	//an event from the server's own input ring, the mouse moves the cursor
+	//and a click focuses and raises the window under it
+	void route_input(const input_event& e);
+
+	//redraws everything damaged since the last frame and presents it
+	//returns how many pixels went to the screen
+	size_t composite();
+
+private:
+	struct window_state
+	{
+		bool open;
+		bool shown;		//it's been damaged at least once
+		uintptr_t buffer;
+		void* pixels;
+		rect frame;		//where it is on the screen
+		size_t pitch;
+		display_format format;
+		uint32_t flags;
+	};
+
+	void open_window(size_t index);
+	void close_window(size_t index);
+	void raise(size_t index);
+	void send_input(size_t index, const input_event& e);
+	size_t window_at(int x, int y) const;
+	rect cursor_rect() const;
+	void draw_region(const rect& r);
+
+	display_surface m_screen;
+
+	uintptr_t m_control_buffer;
+	compositor_control* m_control;
+
+	window_state m_windows[COMPOSITOR_MAX_WINDOWS];
+	size_t m_num_windows;
+
+	//back to front, the last one has the focus
+	size_t m_order[COMPOSITOR_MAX_WINDOWS];
+
+	int m_cursor_x;
+	int m_cursor_y;
+};
+
+#endif
\ No newline at end of file
@@ -0,0 +1,89 @@
+#include <sys/syscalls.h>
+#include <graphics/display_surface.h>
+
+//merging two damaged rects is worth copying this many pixels that didn't change,
+//each separate rect costs a loop over its rows and a call for each one
+#define DAMAGE_MERGE_SLACK 4096
+
+static display_mode set_mode(const display_mode& requested)
+{
+	display_mode actual{};
+
+	//the mode that was already set comes back on failure, which isn't the one asked for
+	if(set_display_mode(&requested, &actual) != 0)
+	{
+		actual.format = DISPLAY_MODE_INVALID;
+	}
+
+	return actual;
+}
+
+static void* map_framebuffer(const display_mode& mode)
+{
+	return display_format_bytes(mode.format) ? map_display_memory() : nullptr;
+}
+
+display_surface::display_surface(const display_mode& requested)
+	: m_mode(set_mode(requested)),
+	  m_front(map_framebuffer(m_mode), m_mode),
+	  m_back(m_mode.width, m_mode.height, m_mode.format),
+	  m_num_damage(0)
+{
+}
+
+void display_surface::damage(rect r)
+{
+	r = r.intersect(bounds());
+
+	if(r.empty())
+	{
+		return;
+	}
+
+	//whatever r merges with grows it, so it might reach ones it didn't before
+	for(size_t i = 0; i < m_num_damage;)
+	{
+		const rect merged = r.bounding(m_damage[i]);
+
+		if(merged.area() <= r.area() + m_damage[i].area() + DAMAGE_MERGE_SLACK)
+		{
+			r = merged;
+			m_damage[i] = m_damage[--m_num_damage];
+			i = 0;
+		}
+		else
+		{
+			i++;
+		}
+	}
+
+	//out of room, so it all becomes one
+	if(m_num_damage == max_damage)
+	{
+		for(size_t i = 0; i < m_num_damage; i++)
+		{
+			r = r.bounding(m_damage[i]);
+		}
+
+		m_num_damage = 0;
+	}
+
+	m_damage[m_num_damage++] = r;
+}
+
+size_t display_surface::present()
+{
+	size_t pixels = 0;
+
+	for(size_t i = 0; i < m_num_damage; i++)
+	{
+		const rect& r = m_damage[i];
+
+		m_front.blit(m_back, r, r.x, r.y);
+		pixels += r.area();
+	}
+
+	m_num_damage = 0;
+
+	return pixels;
+}
\ No newline at end of file
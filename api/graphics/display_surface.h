@@ -0,0 +1,49 @@
+#ifndef DISPLAY_SURFACE_H
+#define DISPLAY_SURFACE_H
+
+#include <graphics/graphics.h>
+
+//the screen with a back buffer in system memory
+//drawing goes to back(), damage() marks what changed and present() copies only that to the framebuffer
+//reading video memory is very slow and writing it is slow, so it's touched as little as possible
+class display_surface
+{
+public:
+	static const size_t max_damage = 16;
+
+	//sets the mode and maps the framebuffer, valid() is false if either doesn't work out
+	explicit display_surface(const display_mode& requested);
+
+	display_surface(const display_surface&) = delete;
+	display_surface& operator=(const display_surface&) = delete;
+
+	bool valid() const { return m_front.valid() && m_back.valid(); }
+	const display_mode& mode() const { return m_mode; }
+	rect bounds() const { return m_back.bounds(); }
+
+	surface& back() { return m_back; }
+
+	//the framebuffer itself, for drawing that skips the back buffer
+	surface& front() { return m_front; }
+
+	void damage(rect r);
+	void damage_all() { damage(bounds()); }
+
+	//what's been damaged since the last present, for redrawing the back buffer only there
+	size_t num_damaged() const { return m_num_damage; }
+	const rect& damaged(size_t index) const { return m_damage[index]; }
+
+	//copies everything damaged since the last present to the screen
+	//returns the number of pixels that took
+	size_t present();
+
+private:
+	display_mode m_mode;
+	surface m_front;
+	surface m_back;
+
+	rect m_damage[max_damage];
+	size_t m_num_damage;
+};
+
+#endif
\ No newline at end of file
@@ -0,0 +1,526 @@
+#include <stdlib.h>
+#include <string.h>
+#include <ctype.h>
+#include <sys/syscalls.h>
+#include <graphics/fb_console.h>
+
+//no cell ever has this key, so a cell marked with it is always drawn
+#define INVALID_KEY 0xFFFFFFFF
+
+//the VGA text mode palette, attributes are the same as in text mode
+static const uint32_t vga_palette[16] =
+{
+	0xFF000000, 0xFF0000AA, 0xFF00AA00, 0xFF00AAAA, 0xFFAA0000, 0xFFAA00AA, 0xFFAA5500, 0xFFAAAAAA,
+	0xFF555555, 0xFF5555FF, 0xFF55FF55, 0xFF55FFFF, 0xFFFF5555, 0xFFFF55FF, 0xFFFFFF55, 0xFFFFFFFF
+};
+
+static constexpr uint8_t vt100_colors[8] =
+{
+	0x00, 0x04, 0x02, 0x06, 0x01, 0x05, 0x03, 0x07
+};
+
+static display_mode set_mode(const display_mode& requested)
+{
+	display_mode actual{};
+
+	if(set_display_mode(&requested, &actual) != 0)
+	{
+		actual.format = DISPLAY_MODE_INVALID;
+	}
+
+	return actual;
+}
+
+//all of video memory in whole rows, not just the part on the screen
+static size_t rows_of_memory(const display_mode& mode)
+{
+	const size_t rows = mode.pitch ? mode.buffer_size / mode.pitch : 0;
+	return (rows > mode.height) ? rows : mode.height;
+}
+
+fb_console::fb_console(const display_mode& requested, const psf_font& font)
+	: m_mode(set_mode(requested)),
+	  m_framebuffer(display_format_bytes(m_mode.format) ? map_display_memory() : nullptr),
+	  m_screen(m_framebuffer, m_mode.width, rows_of_memory(m_mode), m_mode.pitch, m_mode.format),
+	  m_top(0),
+	  m_shown_top(0),
+	  m_offset_scroll(false),
+	  m_margin_dirty(true),
+	  m_font(font),
+	  m_columns(font.valid() ? m_mode.width / font.width() : 0),
+	  m_rows(font.valid() ? m_mode.height / font.height() : 0),
+	  m_cells(nullptr),
+	  m_shown(nullptr),
+	  m_row_dirty(nullptr),
+	  m_pending_scroll(0),
+	  m_cursor(0),
+	  m_saved_cursor(0),
+	  m_attr(0x07),
+	  m_fgr(0x07),
+	  m_bgr(0x00),
+	  m_bright(0),
+	  m_cache(font.width(), font.height() * cache_slots, m_mode.format)
+{
+	if(!m_screen.valid() || m_columns == 0 || m_rows == 0)
+	{
+		return;
+	}
+
+	const size_t total = m_columns * m_rows;
+
+	m_cells = (cell*)malloc(total * sizeof(cell));
+	m_shown = (uint32_t*)malloc(total * sizeof(uint32_t));
+	m_row_dirty = (bool*)malloc(m_rows * sizeof(bool));
+
+	if(!m_cells || !m_shown || !m_row_dirty)
+	{
+		free(m_cells);
+		m_cells = nullptr;
+		return;
+	}
+
+	for(size_t i = 0; i < 16; i++)
+	{
+		m_palette[i] = m_screen.map_color(vga_palette[i]);
+	}
+
+	memset(m_cache_keys, 0xFF, sizeof(m_cache_keys));
+
+	//a screen's worth of spare video memory means a wrap back to the top at most once a screen
+	m_offset_scroll = m_screen.height() >= m_mode.height * 2;
+
+	//somebody else might have left the display further down
+	set_display_offset(0, 0);
+
+	invalidate_all();
+	clear();
+	flush();
+}
+
+fb_console::~fb_console()
+{
+	free(m_cells);
+	free(m_shown);
+	free(m_row_dirty);
+}
+
+uint32_t fb_console::cell_key(size_t index) const
+{
+	uint8_t attr = m_cells[index].attr;
+
+	if(index == m_cursor)
+	{
+		attr = (uint8_t)((attr << 4) | (attr >> 4));
+	}
+
+	return m_cells[index].ch | ((uint32_t)attr << 8);
+}
+
+size_t fb_console::cache_glyph(uint8_t ch, uint8_t attr)
+{
+	const uint32_t key = ch | ((uint32_t)attr << 8);
+
+	//multiplicative hash, the top bits of the product pick one of the 1024 slots
+	const size_t slot = (key * 2654435761u) >> 22;
+
+	if(m_cache_keys[slot] == key)
+	{
+		return slot;
+	}
+
+	const size_t bpp = m_cache.bytes_per_pixel();
+	const uint32_t fgr = m_palette[attr & 0x0f];
+	const uint32_t bgr = m_palette[attr >> 4];
+	const uint8_t* bits = m_font.glyph(ch);
+
+	for(size_t y = 0; y < m_font.height(); y++, bits += m_font.bytes_per_row())
+	{
+		uint8_t* dst = m_cache.row(slot * m_font.height() + y);
+
+		for(size_t x = 0; x < m_font.width(); x++, dst += bpp)
+		{
+			const bool set = bits[x / 8] & (0x80 >> (x % 8));
+
+			//pixels are little endian whatever their size
+			memcpy(dst, set ? &fgr : &bgr, bpp);
+		}
+	}
+
+	m_cache_keys[slot] = key;
+	return slot;
+}
+
+void fb_console::draw_cell(size_t index, uint32_t key)
+{
+	const size_t slot = cache_glyph(key & 0xff, (key >> 8) & 0xff);
+	const int w = (int)m_font.width(), h = (int)m_font.height();
+
+	m_screen.blit(m_cache, {0, (int)slot * h, w, h},
+				  (int)(index % m_columns) * w, (int)(m_top + (index / m_columns) * h));
+}
+
+void fb_console::invalidate_all()
+{
+	memset(m_shown, 0xFF, m_columns * m_rows * sizeof(uint32_t));
+
+	for(size_t row = 0; row < m_rows; row++)
+	{
+		m_row_dirty[row] = true;
+	}
+
+	m_margin_dirty = true;
+}
+
+//whatever's past the last whole column and row of characters
+void fb_console::fill_margin()
+{
+	const int text_w = (int)(m_columns * m_font.width());
+	const int text_h = (int)(m_rows * m_font.height());
+	const int w = (int)m_mode.width, h = (int)m_mode.height;
+
+	m_screen.fill({text_w, (int)m_top, w - text_w, h}, vga_palette[0]);
+	m_screen.fill({0, (int)m_top + text_h, w, h - text_h}, vga_palette[0]);
+
+	m_margin_dirty = false;
+}
+
+void fb_console::scroll_screen(size_t lines)
+{
+	if(lines >= m_rows)
+	{
+		invalidate_all();
+		return;
+	}
+
+	const size_t total = m_columns * m_rows;
+	const size_t moved = total - lines * m_columns;
+
+	if(m_offset_scroll)
+	{
+		const size_t pixels = lines * m_font.height();
+
+		//out of room below, so it starts again at the top of video memory
+		//everything's drawn there before the offset moves, so nobody sees it half done
+		if(m_top + pixels + m_mode.height > m_screen.height())
+		{
+			m_top = 0;
+			invalidate_all();
+			return;
+		}
+
+		m_top += pixels;
+		m_margin_dirty = true;
+	}
+	else
+	{
+		uint8_t* dst = m_screen.row(m_top);
+		const uint8_t* src = m_screen.row(m_top + lines * m_font.height());
+
+		memmove(dst, src, (m_rows - lines) * m_font.height() * m_screen.pitch());
+	}
+
+	//the rows that are still on the screen are where they were drawn, only the new ones are unknown
+	memmove(m_shown, m_shown + lines * m_columns, moved * sizeof(uint32_t));
+	memset(m_shown + moved, 0xFF, (total - moved) * sizeof(uint32_t));
+}
+
+size_t fb_console::flush()
+{
+	if(!valid())
+	{
+		return 0;
+	}
+
+	//however many times it scrolled since the last flush, the screen only moves once
+	if(m_pending_scroll)
+	{
+		scroll_screen(m_pending_scroll);
+		m_pending_scroll = 0;
+	}
+
+	size_t drawn = 0;
+
+	for(size_t row = 0; row < m_rows; row++)
+	{
+		if(!m_row_dirty[row])
+		{
+			continue;
+		}
+
+		const size_t end = (row + 1) * m_columns;
+
+		for(size_t i = row * m_columns; i < end; i++)
+		{
+			const uint32_t key = cell_key(i);
+
+			if(key != m_shown[i])
+			{
+				draw_cell(i, key);
+				m_shown[i] = key;
+				drawn++;
+			}
+		}
+
+		m_row_dirty[row] = false;
+	}
+
+	if(m_margin_dirty)
+	{
+		fill_margin();
+	}
+
+	if(m_top != m_shown_top)
+	{
+		set_display_offset(m_top * m_screen.pitch(), 0);
+		m_shown_top = m_top;
+	}
+
+	return drawn;
+}
+
+bool fb_console::use_display_offset(bool use)
+{
+	if(!valid() || (use && m_screen.height() < m_mode.height * 2) || use == m_offset_scroll)
+	{
+		return use == m_offset_scroll;
+	}
+
+	flush();
+
+	m_offset_scroll = use;
+	m_top = 0;
+	invalidate_all();
+	flush();
+
+	return true;
+}
+
+void fb_console::move_cursor(size_t pos)
+{
+	const size_t total = m_columns * m_rows;
+
+	//the cell the cursor leaves has to be drawn again as well as the one it goes to
+	if(m_cursor < total)
+	{
+		m_row_dirty[m_cursor / m_columns] = true;
+	}
+
+	m_cursor = pos;
+
+	if(m_cursor < total)
+	{
+		m_row_dirty[m_cursor / m_columns] = true;
+	}
+}
+
+void fb_console::set_cursor_pos(size_t x, size_t y)
+{
+	if(valid() && x < m_columns && y < m_rows)
+	{
+		move_cursor(y * m_columns + x);
+	}
+}
+
+void fb_console::set_color(uint8_t bgr, uint8_t fgr, uint8_t bright)
+{
+	m_fgr = fgr;
+	m_bgr = bgr;
+	m_bright = bright;
+
+	m_attr = ((bgr & 0x0f) << 4) | ((fgr + (bright & 0x01) * 8) & 0x0f);
+}
+
+void fb_console::clear()
+{
+	if(!valid())
+	{
+		return;
+	}
+
+	for(size_t i = 0; i < m_columns * m_rows; i++)
+	{
+		m_cells[i] = {' ', m_attr};
+	}
+
+	for(size_t row = 0; row < m_rows; row++)
+	{
+		m_row_dirty[row] = true;
+	}
+
+	move_cursor(0);
+}
+
+void fb_console::scroll_up(size_t lines)
+{
+	if(!valid() || lines == 0)
+	{
+		return;
+	}
+
+	const size_t total = m_columns * m_rows;
+	const size_t moved = (lines < m_rows) ? total - lines * m_columns : 0;
+
+	memmove(m_cells, m_cells + (total - moved), moved * sizeof(cell));
+
+	for(size_t i = moved; i < total; i++)
+	{
+		m_cells[i] = {' ', m_attr};
+	}
+
+	for(size_t row = 0; row < m_rows; row++)
+	{
+		m_row_dirty[row] = true;
+	}
+
+	m_pending_scroll = (m_pending_scroll + lines < m_rows) ? m_pending_scroll + lines : m_rows;
+}
+
+void fb_console::handle_escape_sequence(const char*& seq, const char* end)
+{
+	//seq is on the escape, it's left on the last character of the sequence
+	if(seq + 1 >= end || seq[1] != '[')
+	{
+		return;
+	}
+
+	seq++;
+
+	size_t argnum = 0;
+	unsigned int args[4] = {0, 0, 0, 0};
+
+	do
+	{
+		seq++;
+
+		while(seq < end && isdigit(*seq))
+		{
+			if(argnum < 4)
+			{
+				args[argnum] = args[argnum] * 10 + *seq - '0';
+			}
+			seq++;
+		}
+
+		argnum++;
+	} while(seq < end && *seq == ';');
+
+	if(seq >= end)
+	{
+		seq = end - 1;
+		return;
+	}
+
+	switch(*seq)
+	{
+	case 'J': //clear screen
+		if(args[0] == 2)
+		{
+			clear();
+		}
+		break;
+	case 'H': //move cursor, the row comes first and both count from 1
+		set_cursor_pos(args[1] ? args[1] - 1 : 0, args[0] ? args[0] - 1 : 0);
+		break;
+	case 'm': //SGR
+		for(size_t i = 0; i < argnum && i < 4; i++)
+		{
+			const unsigned int comm = args[i];
+
+			if(comm == 0)
+			{
+				set_color(0, 0x07, 0);
+			}
+			else if(comm == 1)
+			{
+				set_color(m_bgr, m_fgr, 1);
+			}
+			else if(comm == 22)
+			{
+				set_color(m_bgr, m_fgr, 0);
+			}
+			else if(comm >= 30 && comm <= 37) //change text color
+			{
+				set_color(m_bgr, vt100_colors[comm - 30], m_bright);
+			}
+			else if(comm >= 40 && comm <= 47) //change background color
+			{
+				set_color(vt100_colors[comm - 40], m_fgr, m_bright);
+			}
+		}
+		break;
+	case 's':
+		m_saved_cursor = m_cursor;
+		break;
+	case 'u':
+		move_cursor(m_saved_cursor);
+		break;
+	default:
+		break;
+	}
+}
+
+void fb_console::put_char(char c)
+{
+	const size_t column = m_cursor % m_columns;
+
+	switch(c)
+	{
+	case '\r':
+		move_cursor(m_cursor - column);
+		break;
+	case '\n':
+		move_cursor(m_cursor - column + m_columns);
+		break;
+	case '\t':
+		move_cursor(m_cursor + tab_size - (column % tab_size));
+		break;
+	case '\b':
+		if(m_cursor > 0)
+		{
+			move_cursor(m_cursor - 1);
+			m_cells[m_cursor] = {' ', m_attr};
+		}
+		break;
+	default:
+		m_cells[m_cursor] = {(uint8_t)c, m_attr};
+		move_cursor(m_cursor + 1);
+		break;
+	}
+
+	const size_t total = m_columns * m_rows;
+
+	if(m_cursor >= total)
+	{
+		scroll_up(1);
+		move_cursor(m_cursor - m_columns);
+	}
+}
+
+void fb_console::print(const char* str, size_t length)
+{
+	if(!valid())
+	{
+		return;
+	}
+
+	const char* end = str + length;
+
+	for(const char* c = str; c < end; c++)
+	{
+		if(*c == '\x1b') //ANSI escape sequence
+		{
+			handle_escape_sequence(c, end);
+		}
+		else
+		{
+			put_char(*c);
+		}
+	}
+
+	flush();
+}
+
+void fb_console::print(const char* str)
+{
+	print(str, strlen(str));
+}
\ No newline at end of file
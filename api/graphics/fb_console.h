@@ -0,0 +1,105 @@
+#ifndef FB_CONSOLE_H
+#define FB_CONSOLE_H
+
+#include <graphics/graphics.h>
+#include <graphics/psf_font.h>
+
+//text output in a graphics mode, a grid of characters with VGA text attributes drawn with a PSF font
+//print() only changes the grid, flush() draws the cells that differ from what's on the screen
+//glyphs are rasterized in the screen's pixel format the first time each character and colour is drawn,
+//after that drawing a cell is a copy of a few bytes per row into video memory, which is never read back
+//scrolling moves the display offset down through spare video memory when there is any,
+//otherwise it moves the rows that are already on the screen up with one memmove
+class fb_console
+{
+public:
+	static const int tab_size = 4;
+
+	//sets the mode and maps the framebuffer, valid() is false if either doesn't work out
+	//the font has to outlive the console
+	fb_console(const display_mode& requested, const psf_font& font);
+
+	fb_console(const fb_console&) = delete;
+	fb_console& operator=(const fb_console&) = delete;
+	~fb_console();
+
+	bool valid() const { return m_screen.valid() && m_cells && m_cache.valid(); }
+	const display_mode& mode() const { return m_mode; }
+
+	size_t width() const { return m_columns; }
+	size_t height() const { return m_rows; }
+
+	//handles \n, \r, \t, \b and the same escape sequences as the text mode terminal, then flushes
+	void print(const char* str, size_t length);
+	void print(const char* str);
+
+	void set_color(uint8_t bgr, uint8_t fgr, uint8_t bright);
+	void set_cursor_pos(size_t x, size_t y);
+	size_t cursor_pos() const { return m_cursor; }
+
+	void clear();
+	void scroll_up(size_t lines = 1);
+
+	//draws whatever changed since the last flush, returns the number of cells that took
+	size_t flush();
+
+	//whether scrolling moves the display offset, for the benchmark
+	//returns false if there isn't room in video memory for it
+	bool use_display_offset(bool use);
+	bool using_display_offset() const { return m_offset_scroll; }
+
+private:
+	struct cell
+	{
+		uint8_t ch;
+		uint8_t attr;
+	};
+
+	static const size_t cache_slots = 1024;
+
+	//what a cell looks like on the screen, the cursor is drawn with the colours swapped
+	uint32_t cell_key(size_t index) const;
+	size_t cache_glyph(uint8_t ch, uint8_t attr);
+	void draw_cell(size_t index, uint32_t key);
+	void scroll_screen(size_t lines);
+	void fill_margin();
+	void invalidate_all();
+	void move_cursor(size_t pos);
+
+	void handle_escape_sequence(const char*& seq, const char* end);
+	void put_char(char c);
+
+	display_mode m_mode;
+	uint8_t* m_framebuffer;
+
+	//spans all of video memory, the top of the screen is at row m_top
+	surface m_screen;
+	size_t m_top;
+	size_t m_shown_top;
+	bool m_offset_scroll;
+	bool m_margin_dirty;
+
+	const psf_font& m_font;
+	size_t m_columns;
+	size_t m_rows;
+
+	//what should be on the screen and what is, a cell only gets drawn when the two keys differ
+	cell* m_cells;
+	uint32_t* m_shown;
+	bool* m_row_dirty;
+	size_t m_pending_scroll;
+
+	size_t m_cursor;
+	size_t m_saved_cursor;
+	uint8_t m_attr;
+	uint8_t m_fgr;
+	uint8_t m_bgr;
+	uint8_t m_bright;
+
+	//each slot holds one rasterized glyph, found by hashing the character and attribute
+	surface m_cache;
+	uint32_t m_cache_keys[cache_slots];
+	uint32_t m_palette[16];
+};
+
+#endif
\ No newline at end of file
@@ -0,0 +1,138 @@
+#include <graphics/flip_chain.h>
+
+static display_mode set_mode(const display_mode& requested)
+{
+	display_mode actual{};
+
+	if(set_display_mode(&requested, &actual) != 0)
+	{
+		actual.format = DISPLAY_MODE_INVALID;
+	}
+
+	return actual;
+}
+
+static size_t buffers_that_fit(const display_mode& mode, size_t wanted)
+{
+	const size_t size = mode.pitch * mode.height;
+
+	if(!display_format_bytes(mode.format) || size == 0)
+	{
+		return 0;
+	}
+
+	const size_t fit = mode.buffer_size / size;
+	const size_t count = (wanted < fit) ? wanted : fit;
+
+	return (count < flip_chain::max_buffers) ? count : flip_chain::max_buffers;
+}
+
+flip_chain::flip_chain(const display_mode& requested, size_t num_buffers)
+	: m_mode(set_mode(requested)),
+	  m_framebuffer(display_format_bytes(m_mode.format) ? map_display_memory() : nullptr),
+	  m_buffer_size(m_mode.pitch * m_mode.height),
+	  m_num_buffers(m_framebuffer ? buffers_that_fit(m_mode, num_buffers) : 0),
+	  m_buffers{{buffer_pixels(0), m_mode}, {buffer_pixels(1), m_mode}, {buffer_pixels(2), m_mode}},
+	  m_back(0),
+	  m_status{},
+	  m_latency(0),
+	  m_sequences{},
+	  m_presented{}
+{
+	if(!valid())
+	{
+		return;
+	}
+
+	//the mode might have been set already with somebody else's buffer on the screen
+	const int sequence = queue_display_flip(0, 0);
+
+	if(sequence >= 0)
+	{
+		read_status(sequence);
+	}
+
+	m_back = 1;
+}
+
+void* flip_chain::buffer_pixels(size_t index) const
+{
+	return (index < m_num_buffers) ? m_framebuffer + index * m_buffer_size : nullptr;
+}
+
+bool flip_chain::buffer_busy(size_t index) const
+{
+	const size_t offset = index * m_buffer_size;
+
+	if(offset == m_status.shown_offset)
+	{
+		return true;
+	}
+
+	for(size_t i = 0; i < m_status.num_pending && i < DISPLAY_FLIP_QUEUE_SIZE; i++)
+	{
+		if(m_status.pending_offsets[i] == offset)
+		{
+			return true;
+		}
+	}
+
+	return false;
+}
+
+void flip_chain::read_status(uint32_t wait_for)
+{
+	get_display_flip_status(&m_status, wait_for);
+
+	for(size_t i = 0; i < num_timestamps; i++)
+	{
+		if(m_sequences[i] == m_status.shown && m_status.shown != 0)
+		{
+			m_latency = m_status.shown_time - m_presented[i];
+			break;
+		}
+	}
+}
+
+void flip_chain::update_status()
+{
+	read_status(0);
+}
+
+bool flip_chain::present()
+{
+	if(!valid())
+	{
+		return false;
+	}
+
+	//with a spare buffer the waiting frame can be replaced, with two there's nowhere else to draw anyway
+	const int sequence = queue_display_flip(m_back * m_buffer_size, (m_num_buffers > 2) ? DISPLAY_FLIP_REPLACE : 0);
+
+	if(sequence < 0)
+	{
+		return false;
+	}
+
+	m_sequences[sequence % num_timestamps] = sequence;
+	m_presented[sequence % num_timestamps] = clock();
+
+	read_status(0);
+
+	//buffers only ever go from busy to free behind our back, so what the status says is free stays free
+	for(;;)
+	{
+		for(size_t i = 1; i < m_num_buffers; i++)
+		{
+			const size_t index = (m_back + i) % m_num_buffers;
+
+			if(!buffer_busy(index))
+			{
+				m_back = index;
+				return true;
+			}
+		}
+
+		read_status(sequence);
+	}
+}
\ No newline at end of file
@@ -0,0 +1,65 @@
+#ifndef FLIP_CHAIN_H
+#define FLIP_CHAIN_H
+
+#include <time.h>
+#include <sys/syscalls.h>
+#include <graphics/graphics.h>
+
+//several screens' worth of video memory, with the display flipped between them at the vertical retrace
+//back() is always a buffer that isn't on the screen and isn't waiting to be, so drawing into it can't tear
+//with three buffers present() never waits, a frame that's still waiting when the next one comes is replaced
+//with two it waits for the last flip before handing out the other buffer
+class flip_chain
+{
+public:
+	static const size_t max_buffers = 3;
+
+	//sets the mode and maps the framebuffer, valid() is false if there isn't room for at least two buffers
+	explicit flip_chain(const display_mode& requested, size_t num_buffers = max_buffers);
+
+	flip_chain(const flip_chain&) = delete;
+	flip_chain& operator=(const flip_chain&) = delete;
+
+	bool valid() const { return m_num_buffers >= 2 && m_buffers[0].valid(); }
+	const display_mode& mode() const { return m_mode; }
+	rect bounds() const { return m_buffers[0].bounds(); }
+	size_t num_buffers() const { return m_num_buffers; }
+
+	//has to be drawn all over every time, it holds whatever was in it a few frames ago
+	surface& back() { return m_buffers[m_back]; }
+
+	//queues back() to be shown and moves on to a buffer that's free
+	//returns false if the flip couldn't be queued
+	bool present();
+
+	//asks the kernel how the flips are going, status() and latency() are from the last time this was called
+	void update_status();
+
+	const display_flip_status& status() const { return m_status; }
+
+	//from present() to the retrace that showed it, for the last frame that was shown, in clock() ticks
+	clock_t latency() const { return m_latency; }
+
+private:
+	static const size_t num_timestamps = 4;
+
+	void* buffer_pixels(size_t index) const;
+	bool buffer_busy(size_t index) const;
+	void read_status(uint32_t wait_for);
+
+	display_mode m_mode;
+	uint8_t* m_framebuffer;
+	size_t m_buffer_size;
+	size_t m_num_buffers;
+	surface m_buffers[max_buffers];
+	size_t m_back;
+
+	display_flip_status m_status;
+	clock_t m_latency;
+
+	//when the last few frames were presented, by sequence number
+	uint32_t m_sequences[num_timestamps];
+	clock_t m_presented[num_timestamps];
+};
+
+#endif
\ No newline at end of file
@@ -0,0 +1,633 @@
+#include <string.h>
+#include <stdlib.h>
+
+#include <common/system_page.h>
+#include <graphics/graphics.h>
+#include <graphics/pixel_ops.h>
+
+//where each channel sits in a pixel once it's read as a little endian integer
+struct format_layout
+{
+	uint8_t bytes;
+	bool gray;
+	uint8_t r_shift, r_bits;
+	uint8_t g_shift, g_bits;
+	uint8_t b_shift, b_bits;
+	uint8_t a_shift, a_bits;
+};
+
+//the masks are the same ones vesa_format_from_masks picks each format from
+static const format_layout* layout_of(display_format format)
+{
+	static const format_layout grayscale	= {1, true,  0, 8,  0, 8,  0, 8,  0, 0};
+	static const format_layout bgr444		= {2, false, 0, 4,  4, 4,  8, 4,  0, 0};
+	static const format_layout rgb332		= {1, false, 5, 3,  2, 3,  0, 2,  0, 0};
+	static const format_layout rgb444		= {2, false, 8, 4,  4, 4,  0, 4,  0, 0};
+	static const format_layout rgb555		= {2, false, 10, 5, 5, 5,  0, 5,  0, 0};
+	static const format_layout bgr555		= {2, false, 0, 5,  5, 5,  10, 5, 0, 0};
+	static const format_layout argb4444		= {2, false, 8, 4,  4, 4,  0, 4,  12, 4};
+	static const format_layout rgba4444		= {2, false, 12, 4, 8, 4,  4, 4,  0, 4};
+	static const format_layout abgr4444		= {2, false, 0, 4,  4, 4,  8, 4,  12, 4};
+	static const format_layout bgra4444		= {2, false, 4, 4,  8, 4,  12, 4, 0, 4};
+	static const format_layout argb1555		= {2, false, 10, 5, 5, 5,  0, 5,  15, 1};
+	static const format_layout rgba5551		= {2, false, 11, 5, 6, 5,  1, 5,  0, 1};
+	static const format_layout abgr1555		= {2, false, 0, 5,  5, 5,  10, 5, 15, 1};
+	static const format_layout bgra5551		= {2, false, 1, 5,  6, 5,  11, 5, 0, 1};
+	static const format_layout rgb565		= {2, false, 11, 5, 5, 6,  0, 5,  0, 0};
+	static const format_layout bgr565		= {2, false, 0, 5,  5, 6,  11, 5, 0, 0};
+	static const format_layout rgb24		= {3, false, 0, 8,  8, 8,  16, 8, 0, 0};
+	static const format_layout bgr24		= {3, false, 16, 8, 8, 8,  0, 8,  0, 0};
+	static const format_layout rgb888		= {4, false, 16, 8, 8, 8,  0, 8,  0, 0};
+	static const format_layout rgbx8888		= {4, false, 24, 8, 16, 8, 8, 8,  0, 0};
+	static const format_layout bgr888		= {4, false, 0, 8,  8, 8,  16, 8, 0, 0};
+	static const format_layout bgrx8888		= {4, false, 8, 8,  16, 8, 24, 8, 0, 0};
+	static const format_layout argb8888		= {4, false, 16, 8, 8, 8,  0, 8,  24, 8};
+	static const format_layout rgba8888		= {4, false, 24, 8, 16, 8, 8, 8,  0, 8};
+	static const format_layout abgr8888		= {4, false, 0, 8,  8, 8,  16, 8, 24, 8};
+	static const format_layout bgra8888		= {4, false, 8, 8,  16, 8, 24, 8, 0, 8};
+	static const format_layout argb2101010	= {4, false, 20, 10, 10, 10, 0, 10, 30, 2};
+
+	switch(format)
+	{
+	case FORMAT_GRAYSCALE: return &grayscale;
+	case FORMAT_BGR444: return &bgr444;
+	case FORMAT_RGB332: return &rgb332;
+	case FORMAT_RGB444: return &rgb444;
+	case FORMAT_RGB555: return &rgb555;
+	case FORMAT_BGR555: return &bgr555;
+	case FORMAT_ARGB4444: return &argb4444;
+	case FORMAT_RGBA4444: return &rgba4444;
+	case FORMAT_ABGR4444: return &abgr4444;
+	case FORMAT_BGRA4444: return &bgra4444;
+	case FORMAT_ARGB1555: return &argb1555;
+	case FORMAT_RGBA5551: return &rgba5551;
+	case FORMAT_ABGR1555: return &abgr1555;
+	case FORMAT_BGRA5551: return &bgra5551;
+	case FORMAT_RGB565: return &rgb565;
+	case FORMAT_BGR565: return &bgr565;
+	case FORMAT_RGB24: return &rgb24;
+	case FORMAT_BGR24: return &bgr24;
+	case FORMAT_RGB888: return &rgb888;
+	case FORMAT_RGBX8888: return &rgbx8888;
+	case FORMAT_BGR888: return &bgr888;
+	case FORMAT_BGRX8888: return &bgrx8888;
+	case FORMAT_ARGB8888: return &argb8888;
+	case FORMAT_RGBA8888: return &rgba8888;
+	case FORMAT_ABGR8888: return &abgr8888;
+	case FORMAT_BGRA8888: return &bgra8888;
+	case FORMAT_ARGB2101010: return &argb2101010;
+	default: return nullptr;
+	}
+}
+
+//the 32 bit formats the pixel_ops tables work on: 1 for red in the third byte, 2 for red in the first
+static int rgb_order(display_format format)
+{
+	switch(format)
+	{
+	case FORMAT_RGB888:
+	case FORMAT_ARGB8888:
+		return 1;
+	case FORMAT_BGR888:
+	case FORMAT_ABGR8888:
+		return 2;
+	default:
+		return 0;
+	}
+}
+
+static inline uint32_t pack_channel(uint32_t value, uint8_t shift, uint8_t bits)
+{
+	if(bits == 0)
+	{
+		return 0;
+	}
+
+	if(bits > 8)
+	{
+		value = (value << (bits - 8)) | (value >> (16 - bits));
+	}
+	else
+	{
+		value >>= 8 - bits;
+	}
+
+	return value << shift;
+}
+
+static inline uint32_t unpack_channel(uint32_t pixel, uint8_t shift, uint8_t bits)
+{
+	if(bits == 0)
+	{
+		return 0xFF;
+	}
+
+	const uint32_t value = (pixel >> shift) & ((1u << bits) - 1);
+
+	if(bits >= 8)
+	{
+		return value >> (bits - 8);
+	}
+
+	//repeat the bits all the way down, so the largest value comes out as 0xFF
+	uint32_t out = 0;
+
+	for(int s = 8 - bits; s > -bits; s -= bits)
+	{
+		out |= (s >= 0) ? (value << s) : (value >> -s);
+	}
+
+	return out;
+}
+
+static uint32_t encode(uint32_t argb, const format_layout* layout)
+{
+	const uint32_t r = (argb >> 16) & 0xFF;
+	const uint32_t g = (argb >> 8) & 0xFF;
+	const uint32_t b = argb & 0xFF;
+
+	if(layout->gray)
+	{
+		return (r * 77 + g * 150 + b * 29) >> 8;
+	}
+
+	return pack_channel(r, layout->r_shift, layout->r_bits) |
+		   pack_channel(g, layout->g_shift, layout->g_bits) |
+		   pack_channel(b, layout->b_shift, layout->b_bits) |
+		   pack_channel(argb >> 24, layout->a_shift, layout->a_bits);
+}
+
+static uint32_t decode(uint32_t pixel, const format_layout* layout)
+{
+	if(layout->gray)
+	{
+		return 0xFF000000 | (pixel << 16) | (pixel << 8) | pixel;
+	}
+
+	return (unpack_channel(pixel, layout->a_shift, layout->a_bits) << 24) |
+		   (unpack_channel(pixel, layout->r_shift, layout->r_bits) << 16) |
+		   (unpack_channel(pixel, layout->g_shift, layout->g_bits) << 8) |
+		   unpack_channel(pixel, layout->b_shift, layout->b_bits);
+}
+
+static inline uint32_t read_pixel(const uint8_t* p, size_t bytes)
+{
+	switch(bytes)
+	{
+	case 1: return p[0];
+	case 2: return *(const uint16_t*)p;
+	case 3: return p[0] | (p[1] << 8) | (p[2] << 16);
+	default: return *(const uint32_t*)p;
+	}
+}
+
+static inline void write_pixel(uint8_t* p, size_t bytes, uint32_t value)
+{
+	switch(bytes)
+	{
+	case 1: p[0] = (uint8_t)value; break;
+	case 2: *(uint16_t*)p = (uint16_t)value; break;
+	case 3: p[0] = (uint8_t)value; p[1] = (uint8_t)(value >> 8); p[2] = (uint8_t)(value >> 16); break;
+	default: *(uint32_t*)p = value; break;
+	}
+}
+
+static const pixel_ops* ops = nullptr;
+static graphics_simd detected_level = GRAPHICS_SCALAR;
+static graphics_simd current_level = GRAPHICS_SCALAR;
+
+static void use_level(graphics_simd level)
+{
+	current_level = level;
+
+	switch(level)
+	{
+	case GRAPHICS_SSE2: ops = &sse2_pixel_ops; break;
+	case GRAPHICS_MMX: ops = &mmx_pixel_ops; break;
+	default: ops = &scalar_pixel_ops; break;
+	}
+}
+
+//the kernel only sets these bits when the cpu has the instructions and it saves the registers for us
+static const pixel_ops* current_ops()
+{
+	if(!ops)
+	{
+		const uint32_t features = SYSTEM_PAGE->features;
+
+		if(features & SYSTEM_FEATURE_SSE2)
+		{
+			detected_level = GRAPHICS_SSE2;
+		}
+		else if(features & SYSTEM_FEATURE_MMX)
+		{
+			detected_level = GRAPHICS_MMX;
+		}
+
+		use_level(detected_level);
+	}
+
+	return ops;
+}
+
+graphics_simd graphics_simd_level()
+{
+	current_ops();
+	return current_level;
+}
+
+const char* graphics_simd_name(graphics_simd level)
+{
+	switch(level)
+	{
+	case GRAPHICS_SSE2: return "SSE2";
+	case GRAPHICS_MMX: return "MMX";
+	default: return "scalar";
+	}
+}
+
+void graphics_force_simd_level(graphics_simd level)
+{
+	current_ops();
+	use_level(level < detected_level ? level : detected_level);
+}
+
+size_t display_format_bytes(display_format format)
+{
+	const format_layout* layout = layout_of(format);
+	return layout ? layout->bytes : 0;
+}
+
+static void convert_generic(uint8_t* dst, const format_layout* dst_layout,
+							const uint8_t* src, const format_layout* src_layout, size_t count)
+{
+	for(size_t i = 0; i < count; i++)
+	{
+		const uint32_t argb = decode(read_pixel(src, src_layout->bytes), src_layout);
+		write_pixel(dst, dst_layout->bytes, encode(argb, dst_layout));
+
+		src += src_layout->bytes;
+		dst += dst_layout->bytes;
+	}
+}
+
+bool convert_pixels(void* dst, display_format dst_format, const void* src, display_format src_format, size_t count)
+{
+	const format_layout* dst_layout = layout_of(dst_format);
+	const format_layout* src_layout = layout_of(src_format);
+
+	if(!dst_layout || !src_layout)
+	{
+		return false;
+	}
+
+	if(dst_format == src_format)
+	{
+		memmove(dst, src, count * dst_layout->bytes);
+		return true;
+	}
+
+	const int src_order = rgb_order(src_format);
+	const int dst_order = rgb_order(dst_format);
+
+	//alpha can be dropped or kept, but a missing one has to be made up by the generic path
+	if(src_order && dst_order && (src_layout->a_bits || !dst_layout->a_bits))
+	{
+		if(src_order == dst_order)
+		{
+			current_ops()->copy((uint8_t*)dst, (const uint8_t*)src, count * 4);
+		}
+		else
+		{
+			current_ops()->swap_red_blue((uint32_t*)dst, (const uint32_t*)src, count);
+		}
+
+		return true;
+	}
+
+	if((src_order == 1 && dst_format == FORMAT_RGB565) || (src_order == 2 && dst_format == FORMAT_BGR565))
+	{
+		current_ops()->xrgb_to_rgb565((uint16_t*)dst, (const uint32_t*)src, count);
+		return true;
+	}
+
+	convert_generic((uint8_t*)dst, dst_layout, (const uint8_t*)src, src_layout, count);
+	return true;
+}
+
+rect rect::intersect(const rect& other) const
+{
+	const int x0 = (x > other.x) ? x : other.x;
+	const int y0 = (y > other.y) ? y : other.y;
+	const int x1 = (x + w < other.x + other.w) ? x + w : other.x + other.w;
+	const int y1 = (y + h < other.y + other.h) ? y + h : other.y + other.h;
+
+	return {x0, y0, x1 - x0, y1 - y0};
+}
+
+rect rect::bounding(const rect& other) const
+{
+	if(empty())
+	{
+		return other;
+	}
+
+	if(other.empty())
+	{
+		return *this;
+	}
+
+	const int x0 = (x < other.x) ? x : other.x;
+	const int y0 = (y < other.y) ? y : other.y;
+	const int x1 = (x + w > other.x + other.w) ? x + w : other.x + other.w;
+	const int y1 = (y + h > other.y + other.h) ? y + h : other.y + other.h;
+
+	return {x0, y0, x1 - x0, y1 - y0};
+}
+
+//clips src_rect to the source and where it lands to the destination, keeping the two lined up
+static bool clip_copy(const rect& src_bounds, const rect& dst_bounds, rect& src_rect, int& x, int& y)
+{
+	rect s = src_rect.intersect(src_bounds);
+	x += s.x - src_rect.x;
+	y += s.y - src_rect.y;
+
+	const rect d = rect{x, y, s.w, s.h}.intersect(dst_bounds);
+	s.x += d.x - x;
+	s.y += d.y - y;
+	s.w = d.w;
+	s.h = d.h;
+
+	src_rect = s;
+	x = d.x;
+	y = d.y;
+
+	return !s.empty();
+}
+
+surface::surface(size_t width, size_t height, display_format format)
+	: m_pixels(nullptr), m_width(width), m_height(height), m_pitch(0),
+	  m_format(format), m_bpp(display_format_bytes(format)), m_allocation(nullptr)
+{
+	if(m_bpp == 0)
+	{
+		return;
+	}
+
+	//every row starts on 16 bytes, so the SSE2 stores are aligned for whole rows
+	m_pitch = (width * m_bpp + 15) & ~(size_t)15;
+	m_allocation = malloc(m_pitch * height + 15);
+
+	if(m_allocation)
+	{
+		m_pixels = (void*)(((uintptr_t)m_allocation + 15) & ~(uintptr_t)15);
+	}
+}
+
+surface::surface(void* pixels, size_t width, size_t height, size_t pitch, display_format format)
+	: m_pixels(pixels), m_width(width), m_height(height), m_pitch(pitch),
+	  m_format(format), m_bpp(display_format_bytes(format)), m_allocation(nullptr)
+{
+}
+
+surface::~surface()
+{
+	free(m_allocation);
+}
+
+uint32_t surface::map_color(uint32_t argb) const
+{
+	const format_layout* layout = layout_of(m_format);
+	return layout ? encode(argb, layout) : 0;
+}
+
+static void fill16(uint16_t* dst, uint16_t value, size_t count, const pixel_ops* ops)
+{
+	if(count && ((uintptr_t)dst & 2))
+	{
+		*dst++ = value;
+		count--;
+	}
+
+	ops->fill32((uint32_t*)dst, value | ((uint32_t)value << 16), count / 2);
+
+	if(count & 1)
+	{
+		dst[count - 1] = value;
+	}
+}
+
+void surface::fill(rect r, uint32_t argb)
+{
+	r = r.intersect(bounds());
+
+	if(!valid() || r.empty())
+	{
+		return;
+	}
+
+	const uint32_t value = map_color(argb);
+	const pixel_ops* ops = current_ops();
+
+	for(int y = r.y; y < r.y + r.h; y++)
+	{
+		uint8_t* p = row(y) + r.x * m_bpp;
+
+		switch(m_bpp)
+		{
+		case 4:
+			ops->fill32((uint32_t*)p, value, r.w);
+			break;
+		case 2:
+			fill16((uint16_t*)p, (uint16_t)value, r.w, ops);
+			break;
+		case 1:
+			memset(p, value, r.w);
+			break;
+		default:
+			for(int x = 0; x < r.w; x++, p += 3)
+			{
+				write_pixel(p, 3, value);
+			}
+			break;
+		}
+	}
+}
+
+void surface::blit(const surface& src, rect src_rect, int x, int y)
+{
+	if(!valid() || !src.valid() || !clip_copy(src.bounds(), bounds(), src_rect, x, y))
+	{
+		return;
+	}
+
+	if(m_format != src.m_format)
+	{
+		for(int i = 0; i < src_rect.h; i++)
+		{
+			convert_pixels(row(y + i) + x * m_bpp, m_format,
+						   src.row(src_rect.y + i) + src_rect.x * src.m_bpp, src.m_format, src_rect.w);
+		}
+
+		return;
+	}
+
+	const pixel_ops* ops = current_ops();
+	const size_t bytes = src_rect.w * m_bpp;
+
+	//scrolling within one surface, rows have to be read before they're written over
+	const bool overlap = (src.m_pixels == m_pixels);
+	const bool bottom_up = overlap && y > src_rect.y;
+
+	for(int i = 0; i < src_rect.h; i++)
+	{
+		const int r = bottom_up ? (src_rect.h - 1 - i) : i;
+
+		uint8_t* d = row(y + r) + x * m_bpp;
+		const uint8_t* s = src.row(src_rect.y + r) + src_rect.x * m_bpp;
+
+		if(overlap)
+		{
+			memmove(d, s, bytes);
+		}
+		else
+		{
+			ops->copy(d, s, bytes);
+		}
+	}
+}
+
+static void blend_generic(uint8_t* dst, const format_layout* dst_layout,
+						  const uint8_t* src, const format_layout* src_layout, size_t count)
+{
+	for(size_t i = 0; i < count; i++, dst += dst_layout->bytes, src += src_layout->bytes)
+	{
+		const uint32_t s = decode(read_pixel(src, src_layout->bytes), src_layout);
+		const uint32_t a = s >> 24;
+
+		if(a == 0)
+		{
+			continue;
+		}
+
+		const uint32_t out = (a == 0xFF) ? s : blend_pixel(decode(read_pixel(dst, dst_layout->bytes), dst_layout), s);
+		write_pixel(dst, dst_layout->bytes, encode(out, dst_layout));
+	}
+}
+
+void surface::blend(const surface& src, rect src_rect, int x, int y)
+{
+	const format_layout* src_layout = layout_of(src.m_format);
+
+	if(src_layout && src_layout->a_bits == 0)
+	{
+		blit(src, src_rect, x, y);
+		return;
+	}
+
+	if(!valid() || !src.valid() || !clip_copy(src.bounds(), bounds(), src_rect, x, y))
+	{
+		return;
+	}
+
+	const format_layout* dst_layout = layout_of(m_format);
+	const bool fast = rgb_order(src.m_format) == rgb_order(m_format) && rgb_order(m_format) != 0;
+	const pixel_ops* ops = current_ops();
+
+	for(int i = 0; i < src_rect.h; i++)
+	{
+		uint8_t* d = row(y + i) + x * m_bpp;
+		const uint8_t* s = src.row(src_rect.y + i) + src_rect.x * src.m_bpp;
+
+		if(fast)
+		{
+			ops->blend_argb((uint32_t*)d, (const uint32_t*)s, src_rect.w);
+		}
+		else
+		{
+			blend_generic(d, dst_layout, s, src_layout, src_rect.w);
+		}
+	}
+}
+
+template<typename T>
+static void scale_row_as(void* dst, const void* src, uint32_t fx, uint32_t step, size_t count)
+{
+	T* d = (T*)dst;
+	const T* s = (const T*)src;
+
+	for(size_t i = 0; i < count; i++, fx += step)
+	{
+		d[i] = s[fx >> 16];
+	}
+}
+
+static void scale_row(uint8_t* dst, const uint8_t* src, size_t bpp, uint32_t fx, uint32_t step, size_t count)
+{
+	switch(bpp)
+	{
+	case 4: scale_row_as<uint32_t>(dst, src, fx, step, count); break;
+	case 2: scale_row_as<uint16_t>(dst, src, fx, step, count); break;
+	case 1: scale_row_as<uint8_t>(dst, src, fx, step, count); break;
+	default:
+		for(size_t i = 0; i < count; i++, fx += step, dst += 3)
+		{
+			memcpy(dst, src + (fx >> 16) * 3, 3);
+		}
+		break;
+	}
+}
+
+void surface::blit_scaled(const surface& src, rect src_rect, rect dst_rect)
+{
+	src_rect = src_rect.intersect(src.bounds());
+
+	if(!valid() || !src.valid() || src_rect.empty() || dst_rect.empty())
+	{
+		return;
+	}
+
+	const rect d = dst_rect.intersect(bounds());
+
+	if(d.empty())
+	{
+		return;
+	}
+
+	//16.16 fixed point steps through src, sampling the middle of each destination pixel
+	const uint32_t step_x = ((uint32_t)src_rect.w << 16) / dst_rect.w;
+	const uint32_t step_y = ((uint32_t)src_rect.h << 16) / dst_rect.h;
+	const uint32_t start_x = (uint32_t)((uint64_t)(d.x - dst_rect.x) * step_x) + step_x / 2;
+	uint32_t fy = (uint32_t)((uint64_t)(d.y - dst_rect.y) * step_y) + step_y / 2;
+
+	//rows are scaled in src's format, then converted if ours is different
+	uint8_t* temp = nullptr;
+
+	if(m_format != src.m_format)
+	{
+		temp = (uint8_t*)malloc(d.w * src.m_bpp);
+
+		if(!temp)
+		{
+			return;
+		}
+	}
+
+	for(int y = d.y; y < d.y + d.h; y++, fy += step_y)
+	{
+		const uint8_t* s = src.row(src_rect.y + (fy >> 16)) + src_rect.x * src.m_bpp;
+		uint8_t* out = row(y) + d.x * m_bpp;
+
+		if(temp)
+		{
+			scale_row(temp, s, src.m_bpp, start_x, step_x, d.w);
+			convert_pixels(out, m_format, temp, src.m_format, d.w);
+		}
+		else
+		{
+			scale_row(out, s, m_bpp, start_x, step_x, d.w);
+		}
+	}
+
+	free(temp);
+}
\ No newline at end of file
@@ -0,0 +1,109 @@
+#ifndef GRAPHICS_H
+#define GRAPHICS_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <common/display_mode.h>
+
+//colors are always given as 0xAARRGGBB and converted to the surface's format
+//an alpha of 0 is see-through, so opaque colors need 0xFF in the top byte for blending
+//map_color does the conversion once for code that draws the same color a lot
+
+struct rect
+{
+	int x;
+	int y;
+	int w;
+	int h;
+
+	bool empty() const { return w <= 0 || h <= 0; }
+
+	rect intersect(const rect& other) const;
+
+	//the smallest rect holding both
+	rect bounding(const rect& other) const;
+
+	size_t area() const { return empty() ? 0 : (size_t)w * h; }
+};
+
+//which versions of the inner loops are used, the fastest one the kernel allows unless forced lower
+enum graphics_simd
+{
+	GRAPHICS_SCALAR,
+	GRAPHICS_MMX,
+	GRAPHICS_SSE2
+};
+
+graphics_simd graphics_simd_level();
+const char* graphics_simd_name(graphics_simd level);
+
+//for the benchmark, forces a slower level than the one that was detected
+void graphics_force_simd_level(graphics_simd level);
+
+//bytes per pixel, 0 for the text, indexed and bit plane formats which can't be drawn on
+size_t display_format_bytes(display_format format);
+
+//converts count pixels, src and dst can't overlap unless they're the same format
+//returns false if either format can't be drawn on
+bool convert_pixels(void* dst, display_format dst_format, const void* src, display_format src_format, size_t count);
+
+class surface
+{
+public:
+	//allocates its own pixels in system memory
+	surface(size_t width, size_t height, display_format format);
+
+	//draws into memory somebody else owns, like the framebuffer or a shared buffer
+	surface(void* pixels, size_t width, size_t height, size_t pitch, display_format format);
+
+	//the framebuffer, from map_display_memory and the mode it was set to
+	surface(void* pixels, const display_mode& mode)
+		: surface{pixels, mode.width, mode.height, mode.pitch, mode.format}
+	{}
+
+	surface(const surface&) = delete;
+	surface& operator=(const surface&) = delete;
+	~surface();
+
+	//false if the format can't be drawn on or there wasn't memory for the pixels
+	bool valid() const { return m_pixels != nullptr && m_bpp != 0; }
+
+	size_t width() const { return m_width; }
+	size_t height() const { return m_height; }
+	size_t pitch() const { return m_pitch; }
+	display_format format() const { return m_format; }
+	size_t bytes_per_pixel() const { return m_bpp; }
+	rect bounds() const { return {0, 0, (int)m_width, (int)m_height}; }
+
+	void* pixels() { return m_pixels; }
+	const void* pixels() const { return m_pixels; }
+
+	uint8_t* row(size_t y) { return (uint8_t*)m_pixels + y * m_pitch; }
+	const uint8_t* row(size_t y) const { return (const uint8_t*)m_pixels + y * m_pitch; }
+
+	uint32_t map_color(uint32_t argb) const;
+
+	//everything below is clipped to both surfaces
+
+	void fill(rect r, uint32_t argb);
+
+	//copies, converting if the formats are different
+	void blit(const surface& src, rect src_rect, int x, int y);
+
+	//draws src over this surface using src's alpha, src needs a format with alpha
+	void blend(const surface& src, rect src_rect, int x, int y);
+
+	//stretches or shrinks src_rect to dst_rect, picking the nearest pixel
+	void blit_scaled(const surface& src, rect src_rect, rect dst_rect);
+
+private:
+	void* m_pixels;
+	size_t m_width;
+	size_t m_height;
+	size_t m_pitch;
+	display_format m_format;
+	size_t m_bpp;
+	void* m_allocation; //null when the pixels belong to someone else
+};
+
+#endif
\ No newline at end of file
@@ -0,0 +1,305 @@
+#include <string.h>
+
+#include <graphics/pixel_ops.h>
+
+//everything else is built for the 386, the SIMD versions get their instructions from target attributes
+//and are only called once graphics.cpp has checked the kernel saves those registers for us
+
+typedef uint32_t v4u32 __attribute__((vector_size(16)));
+typedef uint16_t v8u16 __attribute__((vector_size(16)));
+typedef uint8_t v16u8 __attribute__((vector_size(16)));
+typedef uint16_t v4u16 __attribute__((vector_size(8)));
+typedef uint8_t v8u8 __attribute__((vector_size(8)));
+
+//for loads and stores that might not be aligned
+typedef v4u32 v4u32_u __attribute__((aligned(1)));
+typedef v4u16 v4u16_u __attribute__((aligned(1)));
+
+static void fill32_scalar(uint32_t* dst, uint32_t value, size_t count)
+{
+	for(size_t i = 0; i < count; i++)
+	{
+		dst[i] = value;
+	}
+}
+
+static void copy_scalar(uint8_t* dst, const uint8_t* src, size_t bytes)
+{
+	memcpy(dst, src, bytes);
+}
+
+static void blend_argb_scalar(uint32_t* dst, const uint32_t* src, size_t count)
+{
+	for(size_t i = 0; i < count; i++)
+	{
+		const uint32_t s = src[i];
+		const uint32_t a = s >> 24;
+
+		if(a == 0xFF)
+		{
+			dst[i] = s;
+		}
+		else if(a != 0)
+		{
+			dst[i] = blend_pixel(dst[i], s);
+		}
+	}
+}
+
+static inline uint16_t to_rgb565(uint32_t p)
+{
+	return (uint16_t)(((p >> 8) & 0xF800) | ((p >> 5) & 0x07E0) | ((p >> 3) & 0x001F));
+}
+
+static void xrgb_to_rgb565_scalar(uint16_t* dst, const uint32_t* src, size_t count)
+{
+	for(size_t i = 0; i < count; i++)
+	{
+		dst[i] = to_rgb565(src[i]);
+	}
+}
+
+static inline uint32_t swap_red_blue(uint32_t p)
+{
+	return (p & 0xFF00FF00) | ((p >> 16) & 0xFF) | ((p & 0xFF) << 16);
+}
+
+static void swap_red_blue_scalar(uint32_t* dst, const uint32_t* src, size_t count)
+{
+	for(size_t i = 0; i < count; i++)
+	{
+		dst[i] = swap_red_blue(src[i]);
+	}
+}
+
+const pixel_ops scalar_pixel_ops = {
+	fill32_scalar,
+	copy_scalar,
+	blend_argb_scalar,
+	xrgb_to_rgb565_scalar,
+	swap_red_blue_scalar
+};
+
+//the compiler never uses the MMX registers by itself, so they can be used across asm statements
+//8 bytes at a time is twice what the 386 instructions can store, which is what matters for video memory
+
+static void fill32_mmx(uint32_t* dst, uint32_t value, size_t count)
+{
+	if(count < 8)
+	{
+		fill32_scalar(dst, value, count);
+		return;
+	}
+
+	if((uintptr_t)dst & 7)
+	{
+		*dst++ = value;
+		count--;
+	}
+
+	__asm__ volatile("movd %0, %%mm0\n"
+					 "punpckldq %%mm0, %%mm0"
+					 :: "r"(value));
+
+	for(; count >= 8; count -= 8, dst += 8)
+	{
+		__asm__ volatile("movq %%mm0, (%0)\n"
+						 "movq %%mm0, 8(%0)\n"
+						 "movq %%mm0, 16(%0)\n"
+						 "movq %%mm0, 24(%0)"
+						 :: "r"(dst) : "memory");
+	}
+
+	__asm__ volatile("emms");
+
+	fill32_scalar(dst, value, count);
+}
+
+static void copy_mmx(uint8_t* dst, const uint8_t* src, size_t bytes)
+{
+	if(bytes < 64)
+	{
+		memcpy(dst, src, bytes);
+		return;
+	}
+
+	const size_t head = (8 - ((uintptr_t)dst & 7)) & 7;
+	memcpy(dst, src, head);
+	dst += head;
+	src += head;
+	bytes -= head;
+
+	for(; bytes >= 32; bytes -= 32, dst += 32, src += 32)
+	{
+		__asm__ volatile("movq (%1), %%mm0\n"
+						 "movq 8(%1), %%mm1\n"
+						 "movq 16(%1), %%mm2\n"
+						 "movq 24(%1), %%mm3\n"
+						 "movq %%mm0, (%0)\n"
+						 "movq %%mm1, 8(%0)\n"
+						 "movq %%mm2, 16(%0)\n"
+						 "movq %%mm3, 24(%0)"
+						 :: "r"(dst), "r"(src) : "memory");
+	}
+
+	__asm__ volatile("emms");
+
+	memcpy(dst, src, bytes);
+}
+
+const pixel_ops mmx_pixel_ops = {
+	fill32_mmx,
+	copy_mmx,
+	blend_argb_scalar,
+	xrgb_to_rgb565_scalar,
+	swap_red_blue_scalar
+};
+
+#define SSE2 __attribute__((target("sse2")))
+
+SSE2 static void fill32_sse2(uint32_t* dst, uint32_t value, size_t count)
+{
+	//aligned stores from here on
+	for(; count && ((uintptr_t)dst & 15); count--)
+	{
+		*dst++ = value;
+	}
+
+	const v4u32 v = {value, value, value, value};
+
+	for(; count >= 16; count -= 16, dst += 16)
+	{
+		((v4u32*)dst)[0] = v;
+		((v4u32*)dst)[1] = v;
+		((v4u32*)dst)[2] = v;
+		((v4u32*)dst)[3] = v;
+	}
+
+	for(; count >= 4; count -= 4, dst += 4)
+	{
+		*(v4u32*)dst = v;
+	}
+
+	fill32_scalar(dst, value, count);
+}
+
+SSE2 static void copy_sse2(uint8_t* dst, const uint8_t* src, size_t bytes)
+{
+	if(bytes < 64)
+	{
+		memcpy(dst, src, bytes);
+		return;
+	}
+
+	const size_t head = (16 - ((uintptr_t)dst & 15)) & 15;
+	memcpy(dst, src, head);
+	dst += head;
+	src += head;
+	bytes -= head;
+
+	for(; bytes >= 64; bytes -= 64, dst += 64, src += 64)
+	{
+		const v4u32 a = ((const v4u32_u*)src)[0];
+		const v4u32 b = ((const v4u32_u*)src)[1];
+		const v4u32 c = ((const v4u32_u*)src)[2];
+		const v4u32 d = ((const v4u32_u*)src)[3];
+		((v4u32*)dst)[0] = a;
+		((v4u32*)dst)[1] = b;
+		((v4u32*)dst)[2] = c;
+		((v4u32*)dst)[3] = d;
+	}
+
+	memcpy(dst, src, bytes);
+}
+
+//the same arithmetic as blend_pixel, on 16 bit lanes
+SSE2 static inline v8u16 blend_lanes(v8u16 s, v8u16 d, v8u16 a)
+{
+	v8u16 t = s * a + d * (255 - a) + 128;
+	return (t + (t >> 8)) >> 8;
+}
+
+SSE2 static void blend_argb_sse2(uint32_t* dst, const uint32_t* src, size_t count)
+{
+	for(; count >= 4; count -= 4, dst += 4, src += 4)
+	{
+		const v4u32 s = *(const v4u32_u*)src;
+
+		//a lot of what gets blended is all solid or all clear
+		const uint32_t all = s[0] & s[1] & s[2] & s[3];
+		const uint32_t any = s[0] | s[1] | s[2] | s[3];
+
+		if((all >> 24) == 0xFF)
+		{
+			*(v4u32_u*)dst = s;
+			continue;
+		}
+
+		if((any >> 24) == 0)
+		{
+			continue;
+		}
+
+		const v4u32 d = *(const v4u32_u*)dst;
+
+		//every byte of a pixel gets its alpha
+		v4u32 a = s >> 24;
+		a |= a << 8;
+		a |= a << 16;
+
+		const v16u8 sb = (v16u8)(s | 0xFF000000);
+		const v16u8 db = (v16u8)d;
+		const v16u8 ab = (v16u8)a;
+
+		const v8u16 lo = blend_lanes(
+			__builtin_convertvector(__builtin_shufflevector(sb, sb, 0, 1, 2, 3, 4, 5, 6, 7), v8u16),
+			__builtin_convertvector(__builtin_shufflevector(db, db, 0, 1, 2, 3, 4, 5, 6, 7), v8u16),
+			__builtin_convertvector(__builtin_shufflevector(ab, ab, 0, 1, 2, 3, 4, 5, 6, 7), v8u16));
+
+		const v8u16 hi = blend_lanes(
+			__builtin_convertvector(__builtin_shufflevector(sb, sb, 8, 9, 10, 11, 12, 13, 14, 15), v8u16),
+			__builtin_convertvector(__builtin_shufflevector(db, db, 8, 9, 10, 11, 12, 13, 14, 15), v8u16),
+			__builtin_convertvector(__builtin_shufflevector(ab, ab, 8, 9, 10, 11, 12, 13, 14, 15), v8u16));
+
+		const v8u8 lo8 = __builtin_convertvector(lo, v8u8);
+		const v8u8 hi8 = __builtin_convertvector(hi, v8u8);
+
+		*(v4u32_u*)dst = (v4u32)__builtin_shufflevector(lo8, hi8, 0, 1, 2, 3, 4, 5, 6, 7,
+																  8, 9, 10, 11, 12, 13, 14, 15);
+	}
+
+	blend_argb_scalar(dst, src, count);
+}
+
+SSE2 static void xrgb_to_rgb565_sse2(uint16_t* dst, const uint32_t* src, size_t count)
+{
+	for(; count >= 4; count -= 4, dst += 4, src += 4)
+	{
+		const v4u32 p = *(const v4u32_u*)src;
+		const v4u32 v = ((p >> 8) & 0xF800) | ((p >> 5) & 0x07E0) | ((p >> 3) & 0x001F);
+
+		*(v4u16_u*)dst = __builtin_convertvector(v, v4u16);
+	}
+
+	xrgb_to_rgb565_scalar(dst, src, count);
+}
+
+SSE2 static void swap_red_blue_sse2(uint32_t* dst, const uint32_t* src, size_t count)
+{
+	for(; count >= 4; count -= 4, dst += 4, src += 4)
+	{
+		const v4u32 p = *(const v4u32_u*)src;
+
+		*(v4u32_u*)dst = (p & 0xFF00FF00) | ((p >> 16) & 0xFF) | ((p & 0xFF) << 16);
+	}
+
+	swap_red_blue_scalar(dst, src, count);
+}
+
+const pixel_ops sse2_pixel_ops = {
+	fill32_sse2,
+	copy_sse2,
+	blend_argb_sse2,
+	xrgb_to_rgb565_sse2,
+	swap_red_blue_sse2
+};
\ No newline at end of file
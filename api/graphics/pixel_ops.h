@@ -0,0 +1,47 @@
+#ifndef GRAPHICS_PIXEL_OPS_H
+#define GRAPHICS_PIXEL_OPS_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+//the inner loops that are worth a SIMD version, one table for each graphics_simd level
+//every function works on a single row, dst and src never overlap
+struct __attribute__((visibility("hidden"))) pixel_ops
+{
+	void (*fill32)(uint32_t* dst, uint32_t value, size_t count);
+	void (*copy)(uint8_t* dst, const uint8_t* src, size_t bytes);
+
+	//src is ARGB8888, dst has the same layout with or without alpha
+	void (*blend_argb)(uint32_t* dst, const uint32_t* src, size_t count);
+
+	//XRGB8888 to RGB565, the top byte is ignored
+	void (*xrgb_to_rgb565)(uint16_t* dst, const uint32_t* src, size_t count);
+
+	//ARGB8888 to ABGR8888 and back, or the same without alpha
+	void (*swap_red_blue)(uint32_t* dst, const uint32_t* src, size_t count);
+};
+
+extern const pixel_ops scalar_pixel_ops __attribute__((visibility("hidden")));
+extern const pixel_ops mmx_pixel_ops __attribute__((visibility("hidden")));
+extern const pixel_ops sse2_pixel_ops __attribute__((visibility("hidden")));
+
+//a src pixel over a dst pixel, with the alpha of the result coming out right for ARGB8888
+static inline uint32_t blend_pixel(uint32_t dst, uint32_t src)
+{
+	const uint32_t a = src >> 24;
+	const uint32_t na = 255 - a;
+
+	src |= 0xFF000000;
+
+	//two channels at a time, each gets 16 bits so the products don't run into each other
+	//x / 255 is (x + 128 + ((x + 128) >> 8)) >> 8 for everything a product of two bytes can be
+	uint32_t rb = (src & 0x00FF00FF) * a + (dst & 0x00FF00FF) * na + 0x00800080;
+	uint32_t ag = ((src >> 8) & 0x00FF00FF) * a + ((dst >> 8) & 0x00FF00FF) * na + 0x00800080;
+
+	rb = ((rb + ((rb >> 8) & 0x00FF00FF)) >> 8) & 0x00FF00FF;
+	ag = (ag + ((ag >> 8) & 0x00FF00FF)) & 0xFF00FF00;
+
+	return rb | ag;
+}
+
+#endif
\ No newline at end of file
@@ -0,0 +1,183 @@
+#include <stdlib.h>
+#include <string.h>
+#include <graphics/psf_font.h>
+
+#define PSF1_MAGIC 0x0436
+#define PSF1_MODE512 0x01
+
+#define PSF2_MAGIC 0x864AB572
+
+//no real font comes close to these, they keep the sizes from a bad file from overflowing
+#define PSF_MAX_GLYPH_SIZE 64
+#define PSF_MAX_GLYPHS 65536
+
+struct psf1_header
+{
+	uint16_t magic;
+	uint8_t mode;
+	uint8_t charsize;
+} __attribute__((packed));
+
+struct psf2_header
+{
+	uint32_t magic;
+	uint32_t version;
+	uint32_t header_size;
+	uint32_t flags;
+	uint32_t length;
+	uint32_t charsize;
+	uint32_t height;
+	uint32_t width;
+};
+
+static bool read_all(void* dst, size_t len, file_stream* f)
+{
+	return read(dst, len, f) == (int)len;
+}
+
+psf_font::psf_font()
+	: m_glyphs(nullptr), m_width(0), m_height(0), m_num_glyphs(0), m_glyph_size(0)
+{
+}
+
+psf_font::~psf_font()
+{
+	free(m_glyphs);
+}
+
+bool psf_font::load(file_stream* f)
+{
+	free(m_glyphs);
+	m_glyphs = nullptr;
+
+	//the version 1 header is a prefix of the version 2 one, so it's read first and the rest if it's needed
+	psf2_header header;
+
+	if(!read_all(&header, sizeof(psf1_header), f))
+	{
+		return false;
+	}
+
+	const psf1_header* v1 = (const psf1_header*)&header;
+
+	if(v1->magic == PSF1_MAGIC)
+	{
+		m_width = 8;
+		m_height = v1->charsize;
+		m_num_glyphs = (v1->mode & PSF1_MODE512) ? 512 : 256;
+		m_glyph_size = v1->charsize;
+	}
+	else if(header.magic == PSF2_MAGIC)
+	{
+		if(!read_all((uint8_t*)&header + sizeof(psf1_header), sizeof(header) - sizeof(psf1_header), f))
+		{
+			return false;
+		}
+
+		//anything between the header and the glyphs isn't ours to understand
+		for(size_t skip = header.header_size; skip > sizeof(header); skip--)
+		{
+			uint8_t c;
+
+			if(!read_all(&c, 1, f))
+			{
+				return false;
+			}
+		}
+
+		if(header.width > PSF_MAX_GLYPH_SIZE || header.height > PSF_MAX_GLYPH_SIZE || header.length > PSF_MAX_GLYPHS)
+		{
+			return false;
+		}
+
+		m_width = header.width;
+		m_height = header.height;
+		m_num_glyphs = header.length;
+		m_glyph_size = header.charsize;
+
+		//padding after each glyph is allowed, but not more than a whole glyph of the biggest size
+		if(m_glyph_size < bytes_per_row() * m_height ||
+		   m_glyph_size > (PSF_MAX_GLYPH_SIZE / 8) * PSF_MAX_GLYPH_SIZE)
+		{
+			return false;
+		}
+	}
+	else
+	{
+		return false;
+	}
+
+	if(m_width == 0 || m_height == 0 || m_num_glyphs == 0 || m_glyph_size == 0)
+	{
+		return false;
+	}
+
+	if(m_num_glyphs > (size_t)-1 / m_glyph_size)
+	{
+		return false;
+	}
+
+	const size_t size = m_num_glyphs * m_glyph_size;
+	uint8_t* glyphs = (uint8_t*)malloc(size);
+
+	if(!glyphs)
+	{
+		return false;
+	}
+
+	if(!read_all(glyphs, size, f))
+	{
+		free(glyphs);
+		return false;
+	}
+
+	m_glyphs = glyphs;
+	return true;
+}
+
+static file_stream* open_in(directory_stream* dir, const char* name)
+{
+	return dir ? open(dir, name, strlen(name), FILE_READ) : nullptr;
+}
+
+bool psf_font::load(const char* name)
+{
+	for(size_t drive = 0; drive < 4; drive++)
+	{
+		const file_handle* root = get_root_directory(drive);
+
+		if(!root) { continue; }
+
+		directory_stream* dir = open_dir_handle(root, 0);
+		dispose_file_handle(root);
+
+		if(!dir) { continue; }
+
+		directory_stream* drivers = open_dir(dir, "drivers", 7, 0);
+
+		file_stream* f = open_in(dir, name);
+
+		if(!f)
+		{
+			f = open_in(drivers, name);
+		}
+
+		bool loaded = false;
+
+		if(f)
+		{
+			loaded = load(f);
+			close(f);
+		}
+
+		if(drivers) { close_dir(drivers); }
+		close_dir(dir);
+
+		if(loaded)
+		{
+			return true;
+		}
+	}
+
+	return false;
+}
\ No newline at end of file
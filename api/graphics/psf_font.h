@@ -0,0 +1,46 @@
+#ifndef PSF_FONT_H
+#define PSF_FONT_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <sys/syscalls.h>
+
+//a bitmap font in the PC Screen Font format, version 1 like the ones in fonts/ or version 2
+//each glyph is height rows of bytes_per_row bytes, with the leftmost pixel in the top bit
+class psf_font
+{
+public:
+	psf_font();
+
+	psf_font(const psf_font&) = delete;
+	psf_font& operator=(const psf_font&) = delete;
+	~psf_font();
+
+	//reads the whole font from f, the unicode table at the end is skipped
+	bool load(file_stream* f);
+
+	//looks for name in the root and the drivers directory of each drive, where the VGA driver's fonts are
+	bool load(const char* name);
+
+	bool valid() const { return m_glyphs != nullptr; }
+
+	size_t width() const { return m_width; }
+	size_t height() const { return m_height; }
+	size_t num_glyphs() const { return m_num_glyphs; }
+	size_t bytes_per_row() const { return (m_width + 7) / 8; }
+
+	//characters past the end of the font get the first glyph
+	const uint8_t* glyph(size_t c) const
+	{
+		return m_glyphs + ((c < m_num_glyphs) ? c : 0) * m_glyph_size;
+	}
+
+private:
+	uint8_t* m_glyphs;
+	size_t m_width;
+	size_t m_height;
+	size_t m_num_glyphs;
+	size_t m_glyph_size;
+};
+
+#endif
\ No newline at end of file
@@ -0,0 +1,148 @@
+#include <stdio.h>
+#include <string.h>
+#include <sys/syscalls.h>
+#include <graphics/window.h>
+
+window::connection window::connect(int x, int y, size_t width, size_t height, uint32_t flags)
+{
+	connection c{};
+
+	//the compositor won't show anything bigger
+	if(width == 0 || height == 0 || width > COMPOSITOR_MAX_WINDOW_SIZE || height > COMPOSITOR_MAX_WINDOW_SIZE)
+	{
+		return c;
+	}
+
+	c.control_buffer = open_shared_buffer(COMPOSITOR_BUFFER_NAME, strlen(COMPOSITOR_BUFFER_NAME));
+
+	if(!c.control_buffer)
+	{
+		return c;
+	}
+
+	c.control = (compositor_control*)map_shared_buffer(c.control_buffer, sizeof(compositor_control), PAGE_RW);
+
+	if(!c.control || !c.control->running)
+	{
+		return c;
+	}
+
+	compositor_lock(&c.control->lock);
+
+	for(size_t i = 0; i < COMPOSITOR_MAX_WINDOWS; i++)
+	{
+		window_slot& slot = c.control->windows[i];
+
+		if(slot.state == WINDOW_FREE)
+		{
+			slot.state = WINDOW_CLAIMED;
+			slot.generation++;
+			c.slot = &slot;
+			break;
+		}
+	}
+
+	compositor_unlock(&c.control->lock);
+
+	if(!c.slot)
+	{
+		return c;
+	}
+
+	window_slot& slot = *c.slot;
+
+	c.format = (flags & WINDOW_TRANSLUCENT) ? FORMAT_ARGB8888 : c.control->screen_format;
+	c.pitch = (width * display_format_bytes(c.format) + 15) & ~(size_t)15;
+
+	snprintf(slot.buffer_name, sizeof(slot.buffer_name), "window%d.%d",
+			 (int)(c.slot - c.control->windows), (int)slot.generation);
+
+	c.pixel_buffer = create_shared_buffer(slot.buffer_name, strlen(slot.buffer_name), c.pitch * height);
+
+	if(c.pixel_buffer)
+	{
+		c.pixels = map_shared_buffer(c.pixel_buffer, c.pitch * height, PAGE_RW);
+	}
+
+	if(!c.pixels)
+	{
+		if(c.pixel_buffer)
+		{
+			close_shared_buffer(c.pixel_buffer);
+			c.pixel_buffer = 0;
+		}
+
+		__atomic_store_n(&slot.state, WINDOW_FREE, __ATOMIC_RELEASE);
+		c.slot = nullptr;
+		return c;
+	}
+
+	slot.flags = flags;
+	slot.x = x;
+	slot.y = y;
+	slot.width = width;
+	slot.height = height;
+	slot.pitch = c.pitch;
+	slot.format = c.format;
+	slot.damage_lock = 0;
+	slot.damage = {};
+	memset(&slot.input, 0, sizeof(slot.input));
+
+	//everything above has to be seen by the server before it sees the slot is open
+	__atomic_store_n(&slot.state, WINDOW_OPEN, __ATOMIC_RELEASE);
+
+	return c;
+}
+
+window::window(int x, int y, size_t width, size_t height, uint32_t flags)
+	: m_connection(connect(x, y, width, height, flags)),
+	  m_canvas(m_connection.pixels, width, height, m_connection.pitch, m_connection.format)
+{
+}
+
+window::~window()
+{
+	if(m_connection.slot)
+	{
+		unmap_pages(m_connection.pixels, (m_connection.pitch * m_canvas.height() + PAGE_SIZE - 1) / PAGE_SIZE);
+		close_shared_buffer(m_connection.pixel_buffer);
+
+		__atomic_store_n(&m_connection.slot->state, WINDOW_CLOSED, __ATOMIC_RELEASE);
+	}
+
+	if(m_connection.control)
+	{
+		unmap_pages(m_connection.control, (sizeof(compositor_control) + PAGE_SIZE - 1) / PAGE_SIZE);
+	}
+
+	if(m_connection.control_buffer)
+	{
+		close_shared_buffer(m_connection.control_buffer);
+	}
+}
+
+void window::damage(rect r)
+{
+	r = r.intersect(bounds());
+
+	if(!m_connection.slot || r.empty())
+	{
+		return;
+	}
+
+	window_slot& slot = *m_connection.slot;
+
+	compositor_lock(&slot.damage_lock);
+	slot.damage = slot.damage.bounding(r);
+	compositor_unlock(&slot.damage_lock);
+}
+
+size_t window::get_input(input_event* events, size_t max)
+{
+	if(!m_connection.slot)
+	{
+		return 0;
+	}
+
+	return input_ring_read(&m_connection.slot->input, events, max);
+}
\ No newline at end of file
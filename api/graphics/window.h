@@ -0,0 +1,53 @@
+#ifndef WINDOW_H
+#define WINDOW_H
+
+#include <common/input_event.h>
+#include <graphics/graphics.h>
+#include <graphics/compositor.h>
+
+//a window on the compositor's screen
+//draw into canvas(), then damage() what changed so the compositor copies it to the screen
+//the window shows up the first time it's damaged, so it can be drawn before anybody sees it
+class window
+{
+public:
+	//valid() is false if the compositor isn't running or has no room
+	window(int x, int y, size_t width, size_t height, uint32_t flags = 0);
+
+	window(const window&) = delete;
+	window& operator=(const window&) = delete;
+	~window();
+
+	bool valid() const { return m_canvas.valid(); }
+
+	//false once the compositor has exited
+	bool server_running() const { return m_connection.control && m_connection.control->running; }
+
+	surface& canvas() { return m_canvas; }
+	rect bounds() const { return m_canvas.bounds(); }
+
+	void damage(rect r);
+	void damage_all() { damage(bounds()); }
+
+	//input the compositor sent us because we have the focus, doesn't wait
+	size_t get_input(input_event* events, size_t max);
+
+private:
+	struct connection
+	{
+		uintptr_t control_buffer;
+		compositor_control* control;
+		window_slot* slot;
+		uintptr_t pixel_buffer;
+		void* pixels;
+		size_t pitch;
+		display_format format;
+	};
+
+	static connection connect(int x, int y, size_t width, size_t height, uint32_t flags);
+
+	connection m_connection;
+	surface m_canvas;
+};
+
+#endif
\ No newline at end of file
@@ -7,7 +7,12 @@
 #include <files.h>
 #include <virtual_keys.h>
 #include <common/display_mode.h>
+#include <common/display_flip.h>
 #include <common/input_event.h>
+#include <common/input_ring.h>
+#include <common/trace_event.h>
+#include <common/profile_sample.h>
+#include <common/system_page.h>
 
 #ifdef __cplusplus
 extern "C" {
@@ -52,7 +57,21 @@ enum syscall_indices
 	SYSCALL_CREATE_SHARED_BUFFER = 30,
 	SYSCALL_OPEN_SHARED_BUFFER = 31,
 	SYSCALL_CLOSE_SHARED_BUFFER = 32,
-	SYSCALL_MAP_SHARED_BUFFER = 33
+	SYSCALL_MAP_SHARED_BUFFER = 33,
+	SYSCALL_DISCARD_PAGES = 34,
+	SYSCALL_RESOLVE_PLT = 35,
+	SYSCALL_EMPTY = 36,
+	SYSCALL_SLEEP = 37,
+	SYSCALL_CREATE_THREAD = 38,
+	SYSCALL_JOIN_THREAD = 39,
+	SYSCALL_EXIT_THREAD = 40,
+	SYSCALL_SET_TLS_BASE = 41,
+	SYSCALL_OPEN_INPUT_RING = 42,
+	SYSCALL_WAIT_INPUT_RING = 43,
+	SYSCALL_TRACE = 44,
+	SYSCALL_PROFILE = 45,
+	SYSCALL_QUEUE_DISPLAY_FLIP = 46,
+	SYSCALL_GET_DISPLAY_FLIP_STATUS = 47
 };
 
 struct file_handle;
@@ -62,12 +81,17 @@ typedef struct directory_stream directory_stream;
 struct file_stream;
 typedef struct file_stream file_stream;
 
+//every call goes through the system page, to int 0x80 or sysenter depending on what the cpu has
+//the address is a constant, so this works the same in programs and shared libraries
+#define SYSCALL_INSTRUCTION "call *%c[entry]"
+#define SYSCALL_ENTRY [entry] "i"(SYSTEM_PAGE_ADDRESS + offsetof(system_page, syscall_entry))
+
 static inline uint32_t do_syscall_5(size_t syscall_index, uint32_t arg0, uint32_t arg1, uint32_t arg2, uint32_t arg3, uint32_t arg4)
 {
 	uint32_t retval;
-	__asm__ volatile("int $0x80"
+	__asm__ volatile(SYSCALL_INSTRUCTION
 					 :"=a"(retval), "+c"(arg1), "+d"(arg2), "+D"(arg3), "+S"(arg4)
-					 : "b"(syscall_index), "a"(arg0)
+					 : "b"(syscall_index), "a"(arg0), SYSCALL_ENTRY
 					 : "memory");
 	return retval;
 }
@@ -75,9 +99,9 @@ static inline uint32_t do_syscall_5(size_t syscall_index, uint32_t arg0, uint32_
 static inline uint32_t do_syscall_4(size_t syscall_index, uint32_t arg0, uint32_t arg1, uint32_t arg2, uint32_t arg3)
 {
 	uint32_t retval;
-	__asm__ volatile("int $0x80"
+	__asm__ volatile(SYSCALL_INSTRUCTION
 					 :"=a"(retval), "+c"(arg1), "+d"(arg2), "+D"(arg3)
-					 : "b"(syscall_index), "a"(arg0)
+					 : "b"(syscall_index), "a"(arg0), SYSCALL_ENTRY
 					 : "memory");
 	return retval;
 }
@@ -85,9 +109,9 @@ static inline uint32_t do_syscall_4(size_t syscall_index, uint32_t arg0, uint32_
 static inline uint32_t do_syscall_3(size_t syscall_index, uint32_t arg0, uint32_t arg1, uint32_t arg2)
 {
 	uint32_t retval;
-	__asm__ volatile(	"int $0x80"
+	__asm__ volatile(	SYSCALL_INSTRUCTION
 						:"=a"(retval), "+c"(arg1), "+d"(arg2)
-						:"b"(syscall_index), "a"(arg0)
+						:"b"(syscall_index), "a"(arg0), SYSCALL_ENTRY
 						:"memory");
 	return retval;
 }
@@ -95,9 +119,9 @@ static inline uint32_t do_syscall_3(size_t syscall_index, uint32_t arg0, uint32_
 static inline uint32_t do_syscall_2(size_t syscall_index, uint32_t arg0, uint32_t arg1)
 {
 	uint32_t retval;
-	__asm__ volatile(	"int $0x80"
+	__asm__ volatile(	SYSCALL_INSTRUCTION
 						:"=a"(retval), "+c"(arg1)
-						:"b"(syscall_index), "a"(arg0)
+						:"b"(syscall_index), "a"(arg0), SYSCALL_ENTRY
 						:"%edx", "memory");
 	return retval;
 }
@@ -106,9 +130,9 @@ static inline uint32_t do_syscall_2(size_t syscall_index, uint32_t arg0, uint32_
 static inline uint32_t do_syscall_1(size_t syscall_index, const uint32_t arg)
 {
 	uint32_t retval;
-	__asm__ volatile(	"int $0x80"
+	__asm__ volatile(	SYSCALL_INSTRUCTION
 						:"=a"(retval)
-						:"b"(syscall_index), "a"(arg)
+						:"b"(syscall_index), "a"(arg), SYSCALL_ENTRY
 						:"%ecx", "%edx", "memory");
 	return retval;
 }
@@ -116,16 +140,71 @@ static inline uint32_t do_syscall_1(size_t syscall_index, const uint32_t arg)
 static inline uint32_t do_syscall_0(size_t syscall_index)
 {
 	uint32_t retval;
-	__asm__ volatile(	"int $0x80"
+	__asm__ volatile(	SYSCALL_INSTRUCTION
 						:"=a"(retval)
-						:"b"(syscall_index)
+						:"b"(syscall_index), SYSCALL_ENTRY
 						:"%ecx", "%edx", "memory");
 	return retval;
 }
 
+//this one changes the flags that int 0x80 returns with, so it can't use sysenter
 static inline void iopl(int a)
 {
-	do_syscall_1(SYSCALL_IOPL, (uint32_t)a);
+	__asm__ volatile("int $0x80"
+					 :
+					 : "b"(SYSCALL_IOPL), "a"((uint32_t)a)
+					 : "%ecx", "%edx", "memory");
+}
+
+//does nothing, for measuring how long getting in and out of the kernel takes
+static inline int empty_syscall()
+{
+	return (int)do_syscall_0(SYSCALL_EMPTY);
+}
+
+//other processes get the cpu until the time is up
+static inline int sys_sleep(uint32_t seconds, uint32_t nanoseconds)
+{
+	return (int)do_syscall_2(SYSCALL_SLEEP, seconds, nanoseconds);
+}
+
+//the thread starts at entry(func, arg), entry has to call exit_thread instead of returning
+//returns the thread's id, or 0 if it couldn't be created
+static inline size_t create_thread(void* entry, void* func, void* arg, void* tls)
+{
+	return (size_t)do_syscall_4(SYSCALL_CREATE_THREAD, (uint32_t)entry, (uint32_t)func, (uint32_t)arg, (uint32_t)tls);
+}
+
+//waits for the thread to exit, every thread has to be joined once to free it
+static inline int join_thread(size_t id, int* exit_value)
+{
+	return (int)do_syscall_2(SYSCALL_JOIN_THREAD, (uint32_t)id, (uint32_t)exit_value);
+}
+
+//from the first thread this is the same as exiting the process
+static inline void exit_thread(int exit_value)
+{
+	do_syscall_1(SYSCALL_EXIT_THREAD, (uint32_t)exit_value);
+}
+
+//starts, stops or reads the kernel's event trace, see trace_command
+//returns -1 if the kernel was built without tracepoints
+static inline int trace_control(int command, trace_record* records, size_t max_records)
+{
+	return (int)do_syscall_3(SYSCALL_TRACE, (uint32_t)command, (uint32_t)records, (uint32_t)max_records);
+}
+
+//starts, stops or reads the sampling profiler, see profile_command
+//buffer is an array of count profile_sample, or of profile_symbol for PROFILE_CMD_SYMBOLIZE
+static inline int profile_control(int command, void* buffer, size_t count)
+{
+	return (int)do_syscall_3(SYSCALL_PROFILE, (uint32_t)command, (uint32_t)buffer, (uint32_t)count);
+}
+
+//sets the base of the gs segment for the calling thread
+static inline int set_tls_base(void* base)
+{
+	return (int)do_syscall_1(SYSCALL_SET_TLS_BASE, (uint32_t)base);
 }
 
 static inline void sys_exit(int a)
@@ -199,6 +278,12 @@ static inline int unmap_pages(void* p, size_t n)
 	return (int)do_syscall_2(SYSCALL_FREE_PAGES, (uint32_t)p, (uint32_t)n);
 }
 
+//gives the memory behind the pages back to the system, they read as zero afterwards
+static inline int discard_pages(void* p, size_t n)
+{
+	return (int)do_syscall_2(SYSCALL_DISCARD_PAGES, (uint32_t)p, (uint32_t)n);
+}
+
 static inline const file_handle* get_file_in_dir(const directory_stream* d, size_t index)
 {
 	return (const file_handle*)do_syscall_2(SYSCALL_GET_FILE_IN_DIR, (uint32_t)d, (uint32_t)index);
@@ -260,6 +345,19 @@ static inline int set_display_offset(size_t offset, int on_retrace)
 	return (int)do_syscall_2(SYSCALL_SET_DISPLAY_OFFSET, (uint32_t)offset, (uint32_t)on_retrace);
 }
 
+//queues a flip to offset for the next vertical retrace and returns right away
+//returns the flip's sequence number, or -1 if there are DISPLAY_FLIP_QUEUE_SIZE flips waiting already
+static inline int queue_display_flip(size_t offset, int flags)
+{
+	return (int)do_syscall_2(SYSCALL_QUEUE_DISPLAY_FLIP, (uint32_t)offset, (uint32_t)flags);
+}
+
+//with wait_for set to a sequence number it blocks until that flip has been shown, 0 doesn't wait
+static inline int get_display_flip_status(display_flip_status* status, uint32_t wait_for)
+{
+	return (int)do_syscall_2(SYSCALL_GET_DISPLAY_FLIP_STATUS, (uint32_t)status, (uint32_t)wait_for);
+}
+
 static inline directory_stream* open_dir_handle(const file_handle* f, int flags)
 {
 	return (directory_stream*)do_syscall_2(SYSCALL_OPEN_DIR_HANDLE, (uint32_t)f, (uint32_t)flags);
@@ -288,6 +386,32 @@ static inline int get_input_event(input_event* e, bool wait)
 	return (int)do_syscall_2(SYSCALL_GET_INPUT_EVENT, (uint32_t)e, (uint32_t)wait);
 }
 
+//the process's own ring of input events, they can be read straight out of it without a system call
+static inline input_ring* open_input_ring(void)
+{
+	return (input_ring*)do_syscall_0(SYSCALL_OPEN_INPUT_RING);
+}
+
+//returns how many events are in the ring, with wait set it blocks until there's at least one
+//the kernel holds back mouse motion when the ring is nearly full, this lets it go
+static inline int wait_input_ring(bool wait)
+{
+	return (int)do_syscall_1(SYSCALL_WAIT_INPUT_RING, (uint32_t)wait);
+}
+
+//reads up to max events from the ring, only making a system call when it's empty
+static inline size_t get_input_events(input_ring* ring, input_event* events, size_t max, bool wait)
+{
+	size_t n = input_ring_read(ring, events, max);
+
+	if(n == 0 && wait_input_ring(wait) > 0)
+	{
+		n = input_ring_read(ring, events, max);
+	}
+
+	return n;
+}
+
 static inline uintptr_t create_shared_buffer(const char* name, size_t name_len, size_t size)
 {
 	return (int)do_syscall_3(SYSCALL_CREATE_SHARED_BUFFER,
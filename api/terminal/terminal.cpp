@@ -6,6 +6,7 @@
 #include <stdbool.h>
 #include <new>
 #include <string>
+#include <algorithm>
 
 #include <terminal/terminal.h>
 
@@ -25,6 +26,15 @@ struct buf_handle_data
 	bool needs_init;
 };
 
+//the biggest text mode the back buffer holds, bigger ones only use this much of the screen
+static const size_t max_columns = 132;
+static const size_t max_rows = 60;
+
+//everything printed goes to the back buffer, flush() copies the rows that changed to video memory
+//and moves the hardware cursor, so a print costs one system call at most instead of one per scroll
+//the screen is a window starting at first_cell, scrolling moves the window down one row
+//and only when it reaches the end is it all moved back to the start, in one memmove however many lines that was
+//it all lives in the shared buffer, so every program printing to the terminal sees the same text
 struct shared_terminal_state
 {
 	display_mode current_mode;
@@ -40,6 +50,14 @@ struct shared_terminal_state
 
 	uint8_t color = 0x0f;
 	text_char clear_val = {'\0', color};
+
+	size_t first_cell = 0;
+	bool row_dirty[max_rows] = {};
+
+	//where the hardware cursor was last put, -1 when it isn't known
+	size_t shown_cursor = (size_t)-1;
+
+	text_char cells[max_columns * max_rows * 2];
 };
 
 static int set_display_mode(size_t width, size_t height, shared_terminal_state& state)
@@ -55,8 +73,8 @@ static int set_display_mode(size_t width, size_t height, shared_terminal_state&
 
 	if(state.current_mode.flags & DISPLAY_TEXT_MODE)
 	{
-		state.width = state.current_mode.width;
-		state.height = state.current_mode.height;
+		state.width = std::min<size_t>(state.current_mode.width, max_columns);
+		state.height = std::min<size_t>(state.current_mode.height, max_rows);
 		state.total_size = state.width * state.height;
 		state.last_row_start = state.width * (state.height - 1);
 	}
@@ -99,7 +117,18 @@ public:
 		: buf_handle{h.handle}
 		, m_state{get_shared_state(h.handle, width, height, h.needs_init)}
 		, m_screen_ptr{(text_char*)map_display_memory()}
-	{}
+		, m_auto_flush{true}
+	{
+		//the first one to open the terminal starts from what the kernel left on the screen
+		if(h.needs_init && (m_state.current_mode.flags & DISPLAY_TEXT_MODE))
+		{
+			for(size_t row = 0; row < m_state.height; row++)
+			{
+				memcpy(m_state.cells + row * m_state.width, m_screen_ptr + screen_offset(row * m_state.width),
+					   m_state.width * sizeof(text_char));
+			}
+		}
+	}
 
 	~impl()
 	{
@@ -111,6 +140,88 @@ public:
 	shared_terminal_state& m_state;
 
 	text_char* m_screen_ptr;
+	bool m_auto_flush;
+
+	//the screen's worth of the back buffer that's showing
+	text_char* cells()
+	{
+		return m_state.cells + m_state.first_cell;
+	}
+
+	//where a cell is in video memory, which is wider than the back buffer in modes too big for it
+	size_t screen_offset(size_t offset) const
+	{
+		return (offset / m_state.width) * m_state.current_mode.width + offset % m_state.width;
+	}
+
+	void mark_dirty(size_t offset)
+	{
+		if(offset < m_state.total_size)
+		{
+			m_state.row_dirty[offset / m_state.width] = true;
+		}
+	}
+
+	void mark_all_dirty()
+	{
+		std::fill(m_state.row_dirty, m_state.row_dirty + m_state.height, true);
+	}
+
+	void scroll_up()
+	{
+		const size_t width = m_state.width;
+		const size_t capacity = sizeof(m_state.cells) / sizeof(text_char);
+
+		if(m_state.first_cell + m_state.total_size + width <= capacity)
+		{
+			m_state.first_cell += width;
+		}
+		else
+		{
+			memmove(m_state.cells, cells() + width, (m_state.total_size - width) * sizeof(text_char));
+			m_state.first_cell = 0;
+		}
+
+		auto last_row = cells() + m_state.last_row_start;
+		std::fill(last_row, last_row + width, m_state.clear_val);
+
+		//every row moved, a single copy of the screen at the next flush covers any number of scrolls
+		mark_all_dirty();
+	}
+
+	void flush()
+	{
+		//the rows stay dirty until there's a text mode to show them in
+		if(!(m_state.current_mode.flags & DISPLAY_TEXT_MODE))
+		{
+			return;
+		}
+
+		const size_t width = m_state.width;
+
+		for(size_t row = 0; row < m_state.height; row++)
+		{
+			if(m_state.row_dirty[row])
+			{
+				memcpy(m_screen_ptr + screen_offset(row * width), cells() + row * width, width * sizeof(text_char));
+				m_state.row_dirty[row] = false;
+			}
+		}
+
+		if(m_state.cursor_pos != m_state.shown_cursor)
+		{
+			set_display_cursor(screen_offset(m_state.cursor_pos));
+			m_state.shown_cursor = m_state.cursor_pos;
+		}
+	}
+
+	void auto_flush()
+	{
+		if(m_auto_flush)
+		{
+			flush();
+		}
+	}
 
 	int handle_escape_sequence(const char* sequence);
 	int handle_char(char source, text_char* dest, size_t pos);
@@ -125,10 +236,10 @@ public:
 		m_state.clear_val = {'\0', m_state.color};
 	}
 
+	//the hardware cursor catches up at the next flush
 	void set_cursor_pos(size_t offset)
 	{
 		m_state.cursor_pos = offset;
-		set_display_cursor(offset);
 	}
 
 	void set_cursor_pos(size_t x, size_t y)
@@ -138,10 +249,11 @@ public:
 
 	void clear()
 	{
-		auto begin = m_screen_ptr;
+		auto begin = cells();
 		auto end = begin + m_state.total_size;
 
 		std::fill(begin, end, m_state.clear_val);
+		mark_all_dirty();
 
 		set_cursor_pos(0);
 	}
@@ -169,11 +281,13 @@ void terminal::print(unsigned int number)
 void terminal::set_cursor_pos(size_t x, size_t y)
 {
 	m_impl->set_cursor_pos(x, y);
+	m_impl->auto_flush();
 }
 
 void terminal::set_cursor_pos(size_t offset)
 {
 	m_impl->set_cursor_pos(offset);
+	m_impl->auto_flush();
 }
 
 void terminal::set_color(uint8_t bgr, uint8_t fgr, uint8_t bright)
@@ -188,6 +302,7 @@ size_t terminal::cursor_pos() const
 
 uint8_t* terminal::get_underlying_buffer() const
 {
+	m_impl->flush();
 	return (uint8_t*)m_impl->m_screen_ptr;
 }
 
@@ -195,11 +310,17 @@ void terminal::delete_chars(size_t num)
 {
 	auto cursor = cursor_pos();
 
-	auto end = m_impl->m_screen_ptr + cursor;
+	auto end = m_impl->cells() + cursor;
 	auto begin = end - num;
 
 	std::fill(begin, end, m_impl->m_state.clear_val);
 
+	for(size_t pos = cursor - num; pos < cursor; pos += m_impl->m_state.width)
+	{
+		m_impl->mark_dirty(pos);
+	}
+	m_impl->mark_dirty(cursor - 1);
+
 	set_cursor_pos(cursor - num);
 }
 
@@ -218,8 +339,7 @@ void terminal::print(const char* str, size_t length)
 {
 	size_t output_position = cursor_pos();
 
-	auto buffer = m_impl->m_screen_ptr;
-	auto ptr = buffer + output_position;
+	auto ptr = m_impl->cells() + output_position;
 
 	const char* currentchar = str;
 	const char* lastchar = str + length;
@@ -232,48 +352,82 @@ void terminal::print(const char* str, size_t length)
 		}
 		else
 		{
+			m_impl->mark_dirty(output_position);
 			output_position += m_impl->handle_char(*currentchar, ptr, output_position);
 		}
 
 		if(output_position >= m_impl->m_state.total_size)
 		{
-			scroll_up();
+			m_impl->scroll_up();
 			output_position = m_impl->m_state.last_row_start;
 		}
-		ptr = buffer + output_position;
+		ptr = m_impl->cells() + output_position;
 	}
 
-	set_cursor_pos(output_position);
+	m_impl->set_cursor_pos(output_position);
+	m_impl->auto_flush();
 }
 
 void terminal::clear()
 {
 	m_impl->clear();
+	m_impl->auto_flush();
 }
 
 void terminal::clear_row(size_t row)
 {
-	auto begin = m_impl->m_screen_ptr + row * m_impl->m_state.width;
+	auto begin = m_impl->cells() + row * m_impl->m_state.width;
 	auto end = begin + m_impl->m_state.width;
 	std::fill(begin, end, m_impl->m_state.clear_val);
+
+	m_impl->mark_dirty(row * m_impl->m_state.width);
+	m_impl->auto_flush();
 }
 
 void terminal::scroll_up()
 {
-	auto dst = m_impl->m_screen_ptr;
-	auto src = dst + m_impl->m_state.width;
+	m_impl->scroll_up();
+	m_impl->set_cursor_pos(m_impl->m_state.last_row_start);
+	m_impl->auto_flush();
+}
 
-	memcpy(dst, src, (m_impl->m_state.total_size - m_impl->m_state.width) * sizeof(text_char));
-	set_cursor_pos(m_impl->m_state.height - 1, 0);
-	clear_row(m_impl->m_state.height - 1);
+void terminal::flush()
+{
+	m_impl->flush();
+}
+
+void terminal::set_auto_flush(bool on)
+{
+	m_impl->m_auto_flush = on;
+
+	if(on)
+	{
+		m_impl->flush();
+	}
 }
 
 int terminal::set_mode(size_t width, size_t height)
 {
-	auto err = set_display_mode(width, height, m_impl->m_state);
+	auto& state = m_impl->m_state;
+	const size_t old_width = state.width, old_height = state.height;
+
+	auto err = set_display_mode(width, height, state);
 
 	m_impl->m_screen_ptr = (text_char*)map_display_memory();
 
+	//text that doesn't fit the new size is gone, otherwise what was there before comes back
+	if(state.width != old_width || state.height != old_height)
+	{
+		std::fill(state.cells, state.cells + sizeof(state.cells) / sizeof(text_char), state.clear_val);
+		state.first_cell = 0;
+		state.cursor_pos = 0;
+	}
+
+	//whatever the mode switch did to the screen, the back buffer is what should be there
+	m_impl->mark_all_dirty();
+	state.shown_cursor = (size_t)-1;
+	m_impl->flush();
+
 	return err;
 }
 
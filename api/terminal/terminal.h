@@ -52,12 +52,20 @@ public:
 
 	void print(char c, size_t num);
 
+	//the screen itself, anything drawn on it is gone when the terminal next writes that row
 	uint8_t* get_underlying_buffer() const;
 
 	void clear();
 	void clear_row(size_t row);
 	void scroll_up();
 
+	//copies the rows that changed to the screen and moves the cursor there
+	//every call that changes the terminal does this at the end, unless auto flush is off
+	void flush();
+
+	//with it off, lots of small prints cost one copy to the screen when flush() is called
+	void set_auto_flush(bool on);
+
 	int set_mode(size_t width, size_t height);
 
 	size_t width() const;
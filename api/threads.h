@@ -0,0 +1,138 @@
+#ifndef THREADS_H
+#define THREADS_H
+
+#include <stddef.h>
+#include <sys/syscalls.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+//the parts of C11 threads the kernel can do, every thread shares the process's memory and runs on any cpu
+
+typedef size_t thrd_t;
+typedef int (*thrd_start_t)(void*);
+
+enum
+{
+	thrd_success = 0,
+	thrd_error = 1,
+	thrd_nomem = 2
+};
+
+//gs points at one of these in every thread crt0 or thrd_create started
+//the first word is its own address, so a thread finds its block with one load
+struct __thread_block
+{
+	struct __thread_block* self;
+	void* heap_cache;	//small objects malloc keeps for this thread alone, see slab_thread_cache
+};
+
+static inline struct __thread_block* __thrd_block(void)
+{
+	struct __thread_block* block;
+	__asm__("movl %%gs:0, %0" : "=r"(block));
+	return block;
+}
+
+//gives what's in the thread's heap cache back to everyone, clib's malloc defines it
+//threads that end with exit_thread instead of returning or thrd_exit keep theirs forever
+void __thrd_release_heap(struct __thread_block* block);
+
+//the kernel starts new threads here with func and arg on the stack
+static void __thrd_entry(thrd_start_t func, void* arg)
+{
+	//the block is on the thread's own stack, which is there until exit_thread
+	struct __thread_block block = {&block, NULL};
+	set_tls_base(&block);
+
+	int res = func(arg);
+
+	__thrd_release_heap(&block);
+	exit_thread(res);
+}
+
+static inline int thrd_create(thrd_t* thr, thrd_start_t func, void* arg)
+{
+	size_t id = create_thread((void*)__thrd_entry, (void*)func, arg, NULL);
+
+	if(!id)
+	{
+		return thrd_nomem;
+	}
+
+	*thr = id;
+	return thrd_success;
+}
+
+static inline int thrd_join(thrd_t thr, int* res)
+{
+	return join_thread(thr, res) == 0 ? thrd_success : thrd_error;
+}
+
+__attribute__((noreturn)) static inline void thrd_exit(int res)
+{
+	__thrd_release_heap(__thrd_block());
+	exit_thread(res);
+	__builtin_unreachable();
+}
+
+//there's no futex, so a mutex spins for a bit and then sleeps a tick at a time
+//a zeroed mtx_t is unlocked, so static ones can be used before mtx_init
+typedef struct
+{
+	volatile int locked;
+} mtx_t;
+
+enum
+{
+	mtx_plain = 0
+};
+
+#define MTX_SPIN_LIMIT 1000
+
+static inline int mtx_init(mtx_t* mtx, int type)
+{
+	(void)type;
+	mtx->locked = 0;
+	return thrd_success;
+}
+
+static inline int mtx_trylock(mtx_t* mtx)
+{
+	return __atomic_exchange_n(&mtx->locked, 1, __ATOMIC_ACQUIRE) ? thrd_error : thrd_success;
+}
+
+static inline int mtx_lock(mtx_t* mtx)
+{
+	for(size_t spins = 0; mtx_trylock(mtx) != thrd_success; spins++)
+	{
+		//the owner might be waiting for our cpu, stop spinning and let it run
+		if(spins >= MTX_SPIN_LIMIT)
+		{
+			sys_sleep(0, 1);
+		}
+		else
+		{
+			__asm__ volatile("rep; nop" ::: "memory");
+		}
+	}
+
+	return thrd_success;
+}
+
+static inline int mtx_unlock(mtx_t* mtx)
+{
+	__atomic_store_n(&mtx->locked, 0, __ATOMIC_RELEASE);
+	return thrd_success;
+}
+
+static inline void mtx_destroy(mtx_t* mtx)
+{
+	(void)mtx;
+}
+
+#ifdef __cplusplus
+}
+#endif
+#endif
\ No newline at end of file
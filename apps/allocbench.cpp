@@ -0,0 +1,108 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <malloc.h>
+#include <time.h>
+#include <terminal/terminal.h>
+
+//measures small allocation throughput and how much memory the heap holds on to
+
+terminal s_term{"terminal_1"};
+
+static const size_t num_live = 512;
+static const size_t num_rounds = 200;
+
+static void* live[num_live];
+
+static uint32_t rng_state = 12345;
+
+static uint32_t next_random()
+{
+	rng_state = rng_state * 1103515245 + 12345;
+	return rng_state >> 16;
+}
+
+//sizes of typical kernel objects, strings and hash nodes
+static size_t random_size()
+{
+	static const size_t common_sizes[] = {12, 16, 24, 28, 32, 40, 64, 72, 100, 128};
+
+	if(next_random() % 8 == 0)
+	{
+		return 1 + next_random() % 512;
+	}
+
+	return common_sizes[next_random() % (sizeof(common_sizes) / sizeof(common_sizes[0]))];
+}
+
+static int elapsed_ms(clock_t start)
+{
+	return (int)((clock() - start) * 1000 / CLOCKS_PER_SEC);
+}
+
+static void print_usage(const char* label)
+{
+	struct mallinfo info = mallinfo();
+
+	int percent = info.arena ? (int)((uint64_t)info.uordblks * 100 / info.arena) : 100;
+
+	printf("%-12s heap %7d bytes, in use %7d bytes (%d%%)\n", label, info.arena, info.uordblks, percent);
+}
+
+int main(int argc, char** argv)
+{
+	set_stdout([](const char* buf, size_t size, void* impl) {
+					s_term.print(buf, size);
+			   });
+
+	print_usage("start");
+
+	//same size malloc/free pairs, the best case for a free list
+	clock_t start = clock();
+	for(size_t i = 0; i < num_rounds * num_live; i++)
+	{
+		free(malloc(32));
+	}
+	printf("pairs:       %d allocations in %d ms\n", num_rounds * num_live, elapsed_ms(start));
+
+	//keep a window of live objects and replace random ones
+	start = clock();
+	for(size_t i = 0; i < num_live; i++)
+	{
+		live[i] = malloc(random_size());
+	}
+
+	for(size_t i = 0; i < num_rounds * num_live; i++)
+	{
+		size_t slot = next_random() % num_live;
+		free(live[slot]);
+		live[slot] = malloc(random_size());
+	}
+	printf("churn:       %d allocations in %d ms\n", num_rounds * num_live, elapsed_ms(start));
+
+	print_usage("churned");
+
+	//free every other object, then see how well the holes get reused
+	for(size_t i = 0; i < num_live; i += 2)
+	{
+		free(live[i]);
+		live[i] = nullptr;
+	}
+
+	print_usage("half freed");
+
+	for(size_t i = 0; i < num_live; i += 2)
+	{
+		live[i] = malloc(random_size());
+	}
+
+	print_usage("refilled");
+
+	for(size_t i = 0; i < num_live; i++)
+	{
+		free(live[i]);
+	}
+
+	print_usage("all freed");
+
+	return 0;
+}
\ No newline at end of file
@@ -0,0 +1,62 @@
+#include <stdio.h>
+#include <time.h>
+#include <sys/syscalls.h>
+#include <terminal/terminal.h>
+
+//compares reading the clock through a system call with reading it from the system page
+//and checks that the time never goes backward while doing it
+
+terminal s_term{"terminal_1"};
+
+static const size_t num_reads = 200000;
+
+template<typename Func>
+static void run(const char* label, Func&& read_clock)
+{
+	size_t backward = 0;
+	clock_t last = read_clock();
+
+	clock_t start = clock();
+
+	for(size_t i = 0; i < num_reads; i++)
+	{
+		clock_t now = read_clock();
+		if(now < last) { backward++; }
+		last = now;
+	}
+
+	clock_t elapsed = clock() - start;
+
+	int ns = (int)((uint64_t)elapsed * 1000000000 / CLOCKS_PER_SEC / num_reads);
+
+	printf("%-12s %d reads, %d ns per read", label, num_reads, ns);
+
+	if(backward)
+	{
+		printf(", went backward %d times!\n", backward);
+	}
+	else
+	{
+		printf("\n");
+	}
+}
+
+int main(int argc, char** argv)
+{
+	set_stdout([](const char* buf, size_t size, void* impl) {
+					s_term.print(buf, size);
+			   });
+
+	run("system call", []{ return clock_ticks(nullptr); });
+
+	if(SYSTEM_PAGE->features & SYSTEM_FEATURE_TSC_CLOCK)
+	{
+		run("system page", []{ return clock(); });
+	}
+	else
+	{
+		printf("the time stamp counter isn't used on this cpu\n");
+	}
+
+	return 0;
+}
\ No newline at end of file
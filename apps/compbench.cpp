@@ -0,0 +1,234 @@
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+#include <sys/syscalls.h>
+#include <graphics/compositor_server.h>
+#include <graphics/window.h>
+#include <terminal/terminal.h>
+
+//how long compositing takes with 1, 2, 4, 8 and 16 animated windows on an 800x600x32 screen
+//the same program is the client, it knows it is one when the shared board already exists
+//every other window is see-through so blending gets measured too, and neighbours overlap a little
+
+terminal s_term{"terminal_1"};
+
+static const char board_name[] = "compbench";
+static const char program_name[] = "compbench.elf";
+
+static const size_t frames = 100;
+static const size_t window_counts[] = {1, 2, 4, 8, 16};
+static const size_t num_rounds = sizeof(window_counts) / sizeof(window_counts[0]);
+
+static const size_t window_width = 220;
+static const size_t window_height = 160;
+
+struct board
+{
+	uint32_t next_index;
+};
+
+struct round_result
+{
+	size_t windows;
+	int us_per_frame;
+	size_t pixels_per_frame;
+};
+
+static int run_client(uintptr_t buf)
+{
+	board& b = *(board*)map_shared_buffer(buf, sizeof(board), PAGE_RW);
+	const uint32_t index = __atomic_fetch_add(&b.next_index, 1, __ATOMIC_RELAXED);
+
+	const int x = (int)(index % 4) * 190;
+	const int y = (int)(index / 4) * 140;
+
+	window win{x, y, window_width, window_height, (index & 1) ? WINDOW_TRANSLUCENT : 0u};
+
+	if(!win.valid())
+	{
+		close_shared_buffer(buf);
+		return 1;
+	}
+
+	surface& s = win.canvas();
+	const rect all = win.bounds();
+
+	for(size_t frame = 0; win.server_running(); frame++)
+	{
+		const int bar_x = (int)(frame * 4) % all.w;
+
+		s.fill(all, 0x80000000 | (index * 0x00102030 + 0x00404040));
+		s.fill({bar_x, 0, 16, all.h}, 0xFFFFFFFF);
+		win.damage_all();
+
+		sys_sleep(0, 10000000);
+	}
+
+	close_shared_buffer(buf);
+	return 0;
+}
+
+static const file_handle* find_program(directory_stream** dir_out)
+{
+	for(size_t drive = 0; drive < 4; drive++)
+	{
+		const file_handle* root = get_root_directory(drive);
+
+		if(!root) { continue; }
+
+		directory_stream* dir = open_dir_handle(root, 0);
+		dispose_file_handle(root);
+
+		const file_handle* file = find_path(dir, program_name, strlen(program_name), 0, 0);
+
+		if(file)
+		{
+			*dir_out = dir;
+			return file;
+		}
+
+		close_dir(dir);
+	}
+
+	return nullptr;
+}
+
+//the clients take a while to start, gives up if they don't all show up in a few seconds
+static bool wait_for_windows(compositor_server& server, size_t count)
+{
+	for(size_t tries = 0; tries < 500; tries++)
+	{
+		server.update_windows();
+		server.composite();
+
+		if(server.num_windows() >= count)
+		{
+			return true;
+		}
+
+		sys_sleep(0, 10000000);
+	}
+
+	return false;
+}
+
+static round_result run_round(compositor_server& server)
+{
+	clock_t ticks = 0;
+	size_t pixels = 0;
+
+	for(size_t i = 0; i < frames; i++)
+	{
+		//leaves the clients time to draw something new
+		sys_sleep(0, 10000000);
+
+		clock_t start = clock();
+		server.update_windows();
+		pixels += server.composite();
+		ticks += clock() - start;
+	}
+
+	return {server.num_windows(), (int)(ticks * 1000000 / CLOCKS_PER_SEC / frames), pixels / frames};
+}
+
+int main(int argc, char** argv)
+{
+	uintptr_t board_buf = open_shared_buffer(board_name, strlen(board_name));
+
+	if(board_buf)
+	{
+		return run_client(board_buf);
+	}
+
+	set_stdout([](const char* buf, size_t size, void* impl) {
+					s_term.print(buf, size);
+			   });
+
+	board_buf = create_shared_buffer(board_name, strlen(board_name), sizeof(board));
+
+	if(!board_buf)
+	{
+		printf("could not create the %s buffer\n", board_name);
+		return 1;
+	}
+
+	directory_stream* dir = nullptr;
+	const file_handle* file = find_program(&dir);
+
+	if(!file)
+	{
+		printf("could not find %s\n", program_name);
+		close_shared_buffer(board_buf);
+		return 1;
+	}
+
+	display_mode requested = {
+		800, 600,
+		0,
+		0,
+		32,
+		FORMAT_ARGB32,
+		0,
+		0
+	};
+
+	round_result results[num_rounds];
+	size_t rounds_done = 0;
+	bool started = false;
+
+	{
+		compositor_server server{requested};
+
+		if(server.valid())
+		{
+			started = true;
+			size_t spawned = 0;
+
+			for(; rounds_done < num_rounds; rounds_done++)
+			{
+				//the windows from the last round stay open, this only adds the new ones
+				for(; spawned < window_counts[rounds_done]; spawned++)
+				{
+					spawn_process(file, dir, 0);
+				}
+
+				if(!wait_for_windows(server, window_counts[rounds_done]))
+				{
+					break;
+				}
+
+				results[rounds_done] = run_round(server);
+			}
+		}
+
+		//the server going away tells the clients to exit
+	}
+
+	dispose_file_handle(file);
+	close_dir(dir);
+	close_shared_buffer(board_buf);
+
+	s_term.set_mode(80, 25);
+	s_term.clear();
+
+	if(!started)
+	{
+		printf("could not start the compositor\n");
+		return 1;
+	}
+
+	printf("800x600x32, %d frames each, %dx%d windows\n", frames, window_width, window_height);
+
+	for(size_t r = 0; r < rounds_done; r++)
+	{
+		printf("  %2d windows %6d us per frame, %7d pixels copied to the screen\n",
+			   results[r].windows, results[r].us_per_frame, results[r].pixels_per_frame);
+	}
+
+	if(rounds_done < num_rounds)
+	{
+		printf("gave up waiting for %d windows\n", window_counts[rounds_done]);
+	}
+
+	return 0;
+}
\ No newline at end of file
@@ -0,0 +1,112 @@
+#include <stdio.h>
+#include <string.h>
+#include <sys/syscalls.h>
+#include <graphics/compositor_server.h>
+#include <terminal/terminal.h>
+
+//the display server, starts a few animated windows to have something to show
+//click a window to give it the focus, F12 exits and the windows close themselves
+
+terminal s_term{"terminal_1"};
+
+static const char client_name[] = "winanim.elf";
+static const size_t num_clients = 3;
+
+static const file_handle* find_program(directory_stream** dir_out)
+{
+	for(size_t drive = 0; drive < 4; drive++)
+	{
+		const file_handle* root = get_root_directory(drive);
+
+		if(!root) { continue; }
+
+		directory_stream* dir = open_dir_handle(root, 0);
+		dispose_file_handle(root);
+
+		const file_handle* file = find_path(dir, client_name, strlen(client_name), 0, 0);
+
+		if(file)
+		{
+			*dir_out = dir;
+			return file;
+		}
+
+		close_dir(dir);
+	}
+
+	return nullptr;
+}
+
+int main(int argc, char** argv)
+{
+	set_stdout([](const char* buf, size_t size, void* impl) {
+					s_term.print(buf, size);
+			   });
+
+	display_mode requested = {
+		800, 600,
+		0,
+		0,
+		32,
+		FORMAT_ARGB32,
+		0,
+		0
+	};
+
+	{
+		compositor_server server{requested};
+
+		if(!server.valid())
+		{
+			s_term.set_mode(80, 25);
+			printf("could not start the compositor\n");
+			return 1;
+		}
+
+		directory_stream* dir = nullptr;
+		const file_handle* file = find_program(&dir);
+
+		//the clients run in the background so the input keeps coming to us
+		if(file)
+		{
+			for(size_t i = 0; i < num_clients; i++)
+			{
+				spawn_process(file, dir, 0);
+			}
+
+			dispose_file_handle(file);
+			close_dir(dir);
+		}
+
+		input_ring* ring = open_input_ring();
+		input_event events[32];
+		bool done = false;
+
+		while(!done)
+		{
+			const size_t num_events = get_input_events(ring, events, 32, false);
+
+			for(size_t i = 0; i < num_events; i++)
+			{
+				if(events[i].type == KEY_DOWN && events[i].data == VK_F12)
+				{
+					done = true;
+					break;
+				}
+
+				server.route_input(events[i]);
+			}
+
+			server.update_windows();
+			server.composite();
+
+			//nothing can wake us when a client draws, so look about as often as they do
+			sys_sleep(0, 5000000);
+		}
+	}
+
+	s_term.set_mode(80, 25);
+	s_term.clear();
+
+	return 0;
+}
\ No newline at end of file
@@ -0,0 +1,139 @@
+#include <stdio.h>
+#include <time.h>
+#include <sys/syscalls.h>
+#include <graphics/fb_console.h>
+#include <terminal/terminal.h>
+
+//the framebuffer console at 800x600x32 with the 8x16 font the VGA driver uses,
+//printing a few thousand coloured lines scrolling by the display offset and then by moving the rows,
+//the console is left on the screen with the results until escape is pressed
+
+terminal s_term{"terminal_1"};
+fb_console* s_console = nullptr;
+
+static const size_t lines = 2000;
+
+struct scroll_result
+{
+	bool ran;
+	int lines_per_second;
+};
+
+static scroll_result run_test(fb_console& con, bool use_offset)
+{
+	if(con.use_display_offset(use_offset) != use_offset)
+	{
+		return {false, 0};
+	}
+
+	con.print("\x1b[2J");
+
+	clock_t start = clock();
+
+	for(size_t i = 0; i < lines; i++)
+	{
+		printf("\x1b[3%dm%5d\x1b[37m the quick brown fox jumps over the lazy dog %08x\n", (int)(i % 7) + 1, i, i * 2654435761u);
+	}
+
+	clock_t ticks = clock() - start;
+
+	if(ticks == 0) { ticks = 1; }
+
+	return {true, (int)(lines * CLOCKS_PER_SEC / ticks)};
+}
+
+static void wait_for_escape()
+{
+	input_ring* ring = open_input_ring();
+
+	for(;;)
+	{
+		input_event events[16];
+		size_t num_events = get_input_events(ring, events, 16, true);
+
+		for(size_t i = 0; i < num_events; i++)
+		{
+			if(events[i].type == KEY_DOWN && events[i].data == VK_ESCAPE)
+			{
+				return;
+			}
+		}
+	}
+}
+
+int main(int argc, char** argv)
+{
+	set_stdout([](const char* buf, size_t size, void* impl) {
+					if(s_console)
+						s_console->print(buf, size);
+					else
+						s_term.print(buf, size);
+			   });
+
+	psf_font font;
+
+	if(!font.load("font16.psf") && !font.load("font08.psf"))
+	{
+		printf("could not find a font\n");
+		return 1;
+	}
+
+	display_mode requested = {
+		800, 600,
+		0,
+		0,
+		32,
+		FORMAT_ARGB32,
+		0,
+		0
+	};
+
+	scroll_result results[2];
+
+	{
+		fb_console con{requested, font};
+
+		if(!con.valid())
+		{
+			s_term.set_mode(80, 25);
+			printf("could not set 800x600x32\n");
+			return 1;
+		}
+
+		s_console = &con;
+
+		results[0] = run_test(con, true);
+		results[1] = run_test(con, false);
+
+		printf("\x1b[2J\x1b[1;37m%dx%d characters in %dx%d, %d lines each\x1b[22m\n",
+			   con.width(), con.height(), con.mode().width, con.mode().height, lines);
+
+		const char* names[2] = {"display offset", "memmove"};
+
+		for(int t = 0; t < 2; t++)
+		{
+			if(results[t].ran)
+				printf("  %-15s %6d lines per second\n", names[t], results[t].lines_per_second);
+			else
+				printf("  %-15s not enough video memory\n", names[t]);
+		}
+
+		printf("\npress escape to exit");
+		fflush(stdout);
+
+		wait_for_escape();
+
+		s_console = nullptr;
+	}
+
+	s_term.set_mode(80, 25);
+	s_term.clear();
+
+	for(int t = 0; t < 2; t++)
+	{
+		if(results[t].ran)
+			printf("%s: %d lines per second\n", t ? "memmove" : "display offset", results[t].lines_per_second);
+	}
+
+	return 0;
+}
\ No newline at end of file
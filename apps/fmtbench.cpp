@@ -0,0 +1,124 @@
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+#include <format>
+#include <terminal/terminal.h>
+
+//the same text made by snprintf and by std::format_to_n, ns per call for each
+//snprintf reads the format string every call, std::format checked it when this was compiled
+//and each call site is its own function, so all that's left at run time is the conversions
+
+terminal s_term{"terminal_1"};
+
+static const size_t iterations = 100000;
+
+//a format with nothing but constants in it is done by the compiler
+struct fixed_text
+{
+	char str[48];
+	size_t len;
+};
+
+static constexpr fixed_text header = [] {
+	fixed_text text{};
+	text.len = std::format_to_n(text.str, sizeof(text.str) - 1, "{} calls each, ns per call", iterations).size;
+	return text;
+}();
+
+static_assert(header.len < sizeof(header.str));
+
+static const char* const names[] = {"alpha", "beta", "gamma", "delta"};
+
+//both return the length they would have written, like snprintf
+struct format_case
+{
+	const char* name;
+	size_t (*c)(char* buf, size_t size, uint32_t i);
+	size_t (*cpp)(char* buf, size_t size, uint32_t i);
+};
+
+static const format_case cases[] = {
+	{"%d",
+	 [](char* buf, size_t size, uint32_t i) { return (size_t)snprintf(buf, size, "%d", (int)(i * 2654435761u)); },
+	 [](char* buf, size_t size, uint32_t i) { return std::format_to_n(buf, size, "{}", (int)(i * 2654435761u)).size; }},
+	{"%08x",
+	 [](char* buf, size_t size, uint32_t i) { return (size_t)snprintf(buf, size, "%08x", i * 40503u); },
+	 [](char* buf, size_t size, uint32_t i) { return std::format_to_n(buf, size, "{:08x}", i * 40503u).size; }},
+	{"%lld",
+	 [](char* buf, size_t size, uint32_t i) { return (size_t)snprintf(buf, size, "%lld", (long long)(i * 0x9E3779B97F4A7C15ull)); },
+	 [](char* buf, size_t size, uint32_t i) { return std::format_to_n(buf, size, "{}", (long long)(i * 0x9E3779B97F4A7C15ull)).size; }},
+	{"%-8s=%5u %#x",
+	 [](char* buf, size_t size, uint32_t i) { return (size_t)snprintf(buf, size, "%-8s=%5u %#x", names[i & 3], i, i); },
+	 [](char* buf, size_t size, uint32_t i) { return std::format_to_n(buf, size, "{:8}={:5} {:#x}", names[i & 3], i, i).size; }},
+};
+
+static const size_t num_cases = sizeof(cases) / sizeof(cases[0]);
+
+static int ns_per_call(clock_t ticks)
+{
+	return (int)((uint64_t)ticks * 1000000000 / CLOCKS_PER_SEC / iterations);
+}
+
+//the lengths are added up so nothing can be left out
+static clock_t time_calls(size_t (*fn)(char*, size_t, uint32_t), size_t& total)
+{
+	char buf[64];
+	clock_t start = clock();
+
+	for(uint32_t i = 0; i < iterations; i++)
+	{
+		total += fn(buf, sizeof(buf), i);
+	}
+
+	return clock() - start;
+}
+
+int main(int argc, char** argv)
+{
+	set_stdout([](const char* buf, size_t size, void* impl) {
+					s_term.print(buf, size);
+			   });
+
+	size_t mismatches = 0;
+
+	printf("%s\n", header.str);
+	printf("  %-16s %9s %9s\n", "", "snprintf", "format");
+
+	for(size_t c = 0; c < num_cases; c++)
+	{
+		const format_case& test = cases[c];
+
+		//snprintf terminates and format_to_n doesn't, both buffers start clear so they compare the same
+		for(uint32_t i = 0; i < iterations; i++)
+		{
+			char expected[64] = {};
+			char actual[64] = {};
+
+			const size_t expected_len = test.c(expected, sizeof(expected), i);
+			const size_t actual_len = test.cpp(actual, sizeof(actual) - 1, i);
+
+			if(expected_len != actual_len || strcmp(expected, actual) != 0)
+			{
+				if(!mismatches)
+				{
+					printf("  %s: \"%s\" and \"%s\"\n", test.name, expected, actual);
+				}
+				mismatches++;
+			}
+		}
+
+		size_t c_total = 0, cpp_total = 0;
+		const clock_t c_ticks = time_calls(test.c, c_total);
+		const clock_t cpp_ticks = time_calls(test.cpp, cpp_total);
+
+		printf("  %-16s %9d %9d%s\n", test.name, ns_per_call(c_ticks), ns_per_call(cpp_ticks),
+			   (c_total == cpp_total) ? "" : "  different lengths!");
+	}
+
+	if(mismatches)
+	{
+		printf("%d calls made different text\n", mismatches);
+	}
+
+	return mismatches ? 1 : 0;
+}
\ No newline at end of file
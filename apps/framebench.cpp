@@ -0,0 +1,152 @@
+#include <stdio.h>
+#include <time.h>
+#include <graphics/display_surface.h>
+#include <terminal/terminal.h>
+
+//frame times at 800x600x32 for a 32x32 sprite moving over a picture, drawn three ways:
+//straight into video memory, into the back buffer with the whole screen presented,
+//and into the back buffer presenting only where the sprite was and is
+
+terminal s_term{"terminal_1"};
+
+static const size_t frames = 200;
+static const int sprite_size = 32;
+
+enum frame_test
+{
+	TEST_DIRECT,
+	TEST_FULL,
+	TEST_DAMAGE,
+	NUM_TESTS
+};
+
+static const char* test_names[NUM_TESTS] = {
+	"video memory",
+	"full present",
+	"damage only"
+};
+
+struct frame_result
+{
+	int us_per_frame;
+	size_t pixels_per_frame;
+};
+
+static void draw_picture(surface& s)
+{
+	for(size_t y = 0; y < s.height(); y++)
+	{
+		for(size_t x = 0; x < s.width(); x += 16)
+		{
+			uint32_t c = (x * 255 / s.width()) << 16 | (y * 255 / s.height()) << 8 | 0x80;
+			s.fill({(int)x, (int)y, 16, 1}, 0xFF000000 | c);
+		}
+	}
+}
+
+static rect sprite_at(size_t frame, const rect& bounds)
+{
+	return {(int)(frame * 7) % (bounds.w - sprite_size), (int)(frame * 5) % (bounds.h - sprite_size),
+			sprite_size, sprite_size};
+}
+
+static frame_result run_test(display_surface& screen, const surface& picture, frame_test test)
+{
+	const rect all = screen.bounds();
+	size_t pixels = 0;
+
+	//every test starts from the picture on the screen
+	screen.back().blit(picture, all, 0, 0);
+	screen.damage_all();
+	screen.present();
+
+	rect last = sprite_at(0, all);
+
+	clock_t start = clock();
+
+	for(size_t i = 0; i < frames; i++)
+	{
+		const rect sprite = sprite_at(i, all);
+
+		switch(test)
+		{
+		case TEST_DIRECT:
+			screen.front().blit(picture, all, 0, 0);
+			screen.front().fill(sprite, 0xFFFFFFFF);
+			pixels += all.area();
+			break;
+		case TEST_FULL:
+			screen.back().blit(picture, all, 0, 0);
+			screen.back().fill(sprite, 0xFFFFFFFF);
+			screen.damage_all();
+			pixels += screen.present();
+			break;
+		case TEST_DAMAGE:
+			screen.back().blit(picture, last, last.x, last.y);
+			screen.back().fill(sprite, 0xFFFFFFFF);
+			screen.damage(last);
+			screen.damage(sprite);
+			pixels += screen.present();
+			break;
+		default:
+			break;
+		}
+
+		last = sprite;
+	}
+
+	clock_t ticks = clock() - start;
+
+	return {(int)(ticks * 1000000 / CLOCKS_PER_SEC / frames), pixels / frames};
+}
+
+int main(int argc, char** argv)
+{
+	set_stdout([](const char* buf, size_t size, void* impl) {
+					s_term.print(buf, size);
+			   });
+
+	display_mode requested = {
+		800, 600,
+		0,
+		0,
+		32,
+		FORMAT_ARGB32,
+		0,
+		0
+	};
+
+	frame_result results[NUM_TESTS];
+
+	{
+		display_surface screen{requested};
+
+		if(!screen.valid())
+		{
+			s_term.set_mode(80, 25);
+			printf("could not set 800x600x32\n");
+			return 1;
+		}
+
+		surface picture{screen.mode().width, screen.mode().height, screen.mode().format};
+		draw_picture(picture);
+
+		for(int t = 0; t < NUM_TESTS; t++)
+		{
+			results[t] = run_test(screen, picture, (frame_test)t);
+		}
+	}
+
+	s_term.set_mode(80, 25);
+	s_term.clear();
+
+	printf("800x600x32, %d frames each\n", frames);
+
+	for(int t = 0; t < NUM_TESTS; t++)
+	{
+		printf("  %-14s %6d us per frame, %6d pixels copied to the screen\n",
+			   test_names[t], results[t].us_per_frame, results[t].pixels_per_frame);
+	}
+
+	return 0;
+}
\ No newline at end of file
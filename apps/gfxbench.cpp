@@ -0,0 +1,172 @@
+#include <stdio.h>
+#include <time.h>
+#include <graphics/graphics.h>
+#include <terminal/terminal.h>
+
+//fill, blit, blend, conversion and scaling rates on 800x600x32 surfaces in system memory,
+//once for every SIMD level the library can use, checking each one draws what the scalar code does
+
+terminal s_term{"terminal_1"};
+
+static const size_t width = 800;
+static const size_t height = 600;
+static const size_t frames = 60;
+
+static uint32_t checksum(const surface& s)
+{
+	uint32_t sum = 0;
+
+	for(size_t y = 0; y < s.height(); y++)
+	{
+		const uint8_t* row = s.row(y);
+
+		for(size_t x = 0; x < s.width() * s.bytes_per_pixel(); x++)
+		{
+			sum = sum * 31 + row[x];
+		}
+	}
+
+	return sum;
+}
+
+struct bench_surfaces
+{
+	surface xrgb{width, height, FORMAT_RGB888};
+	surface argb{width, height, FORMAT_ARGB8888};
+	surface half{width / 2, height / 2, FORMAT_RGB888};
+	surface dst{width, height, FORMAT_RGB888};
+	surface dst565{width, height, FORMAT_RGB565};
+};
+
+//a gradient, and the same with alpha going from clear on the left to solid on the right
+static void draw_sources(bench_surfaces& s)
+{
+	for(size_t y = 0; y < height; y++)
+	{
+		uint32_t* xrgb = (uint32_t*)s.xrgb.row(y);
+		uint32_t* argb = (uint32_t*)s.argb.row(y);
+
+		for(size_t x = 0; x < width; x++)
+		{
+			const uint32_t r = x * 255 / width;
+			const uint32_t g = y * 255 / height;
+			const uint32_t color = (r << 16) | (g << 8) | (255 - r);
+
+			xrgb[x] = color;
+			argb[x] = ((uint32_t)(x * 255 / (width - 1)) << 24) | color;
+		}
+	}
+
+	s.half.blit_scaled(s.xrgb, s.xrgb.bounds(), s.half.bounds());
+}
+
+enum bench_test
+{
+	TEST_FILL,
+	TEST_BLIT,
+	TEST_BLEND,
+	TEST_CONVERT,
+	TEST_SCALED,
+	NUM_TESTS
+};
+
+static const char* test_names[NUM_TESTS] = {
+	"fill",
+	"blit",
+	"blend",
+	"to RGB565",
+	"scaled x2"
+};
+
+static const surface& run_test(bench_surfaces& s, bench_test test)
+{
+	const rect all = s.dst.bounds();
+
+	for(size_t i = 0; i < frames; i++)
+	{
+		switch(test)
+		{
+		case TEST_FILL:
+			s.dst.fill(all, 0xFF000000 | (i * 0x010203));
+			break;
+		case TEST_BLIT:
+			s.dst.blit(s.xrgb, all, 0, 0);
+			break;
+		case TEST_BLEND:
+			//starts from the same picture every time so the checksums can be compared
+			if(i == frames - 1)
+			{
+				s.dst.fill(all, 0xFF203040);
+			}
+			s.dst.blend(s.argb, all, 0, 0);
+			break;
+		case TEST_CONVERT:
+			s.dst565.blit(s.xrgb, all, 0, 0);
+			break;
+		case TEST_SCALED:
+			s.dst.blit_scaled(s.half, s.half.bounds(), all);
+			break;
+		default:
+			break;
+		}
+	}
+
+	return (test == TEST_CONVERT) ? s.dst565 : s.dst;
+}
+
+int main(int argc, char** argv)
+{
+	set_stdout([](const char* buf, size_t size, void* impl) {
+					s_term.print(buf, size);
+			   });
+
+	bench_surfaces s;
+
+	if(!s.xrgb.valid() || !s.argb.valid() || !s.half.valid() || !s.dst.valid() || !s.dst565.valid())
+	{
+		printf("not enough memory for the surfaces\n");
+		return 1;
+	}
+
+	draw_sources(s);
+
+	const graphics_simd best = graphics_simd_level();
+	uint32_t expected[NUM_TESTS] = {};
+	size_t mismatches = 0;
+
+	printf("%dx%dx32, %d frames each, Mpixels per second\n", width, height, frames);
+
+	//scalar first, so there's something to check the others against
+	for(int level = GRAPHICS_SCALAR; level <= best; level++)
+	{
+		graphics_force_simd_level((graphics_simd)level);
+		printf("%s\n", graphics_simd_name((graphics_simd)level));
+
+		for(int t = 0; t < NUM_TESTS; t++)
+		{
+			clock_t start = clock();
+			const surface& result = run_test(s, (bench_test)t);
+			clock_t ticks = clock() - start;
+
+			if(ticks == 0) { ticks = 1; }
+
+			const int mpixels = (int)((uint64_t)width * height * frames * CLOCKS_PER_SEC / ticks / 1000000);
+			const uint32_t sum = checksum(result);
+
+			if(level == GRAPHICS_SCALAR)
+			{
+				expected[t] = sum;
+			}
+
+			const bool same = (sum == expected[t]);
+			if(!same) { mismatches++; }
+
+			printf("  %-10s %5d ms %5d%s\n", test_names[t], (int)(ticks * 1000 / CLOCKS_PER_SEC), mpixels,
+				   same ? "" : "  different from scalar!");
+		}
+	}
+
+	graphics_force_simd_level(best);
+
+	return mismatches ? 1 : 0;
+}
\ No newline at end of file
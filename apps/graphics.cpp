@@ -2,53 +2,270 @@
 #include <terminal/terminal.h>
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <graphics/display_surface.h>
+#include <graphics/flip_chain.h>
 
-uint32_t from_rgb(uint8_t r, uint8_t g, uint8_t b)
+//the gradient only has to be worked out once, each frame is a blit of it and the cursor on top
+//s has to be 32 bits per pixel
+void draw_gradient(surface& s)
 {
-	return	((uint32_t)r << 16)|
-			((uint32_t)g << 8) |
-			((uint32_t)b);
+	for(size_t y = 0; y < s.height(); y++)
+	{
+		auto row = (uint32_t*)s.row(y);
+		auto cy = y * 255 / s.height();
+
+		for(size_t x = 0; x < s.width(); x++)
+		{
+			auto c = x * 255 / s.width();
+
+			row[x] = s.map_color(0xFF000000 | (c << 16) | (cy << 8) | (255 - c));
+		}
+	}
 }
 
-void draw_gradient(size_t begin, size_t end, display_mode& actual, uint32_t* mem)
+//just enough of a 3x5 font for the readout, each row is 3 bits with the left pixel on top
+struct glyph
 {
-	size_t ddpl = (actual.pitch / 4);
-	size_t offset = 0;
+	char c;
+	uint16_t rows;
+};
+
+#define GLYPH(c, r0, r1, r2, r3, r4) {c, (r0 << 12) | (r1 << 9) | (r2 << 6) | (r3 << 3) | r4}
+
+static const glyph font[] = {
+	GLYPH('0', 07, 05, 05, 05, 07), GLYPH('1', 02, 06, 02, 02, 07),
+	GLYPH('2', 07, 01, 07, 04, 07), GLYPH('3', 07, 01, 07, 01, 07),
+	GLYPH('4', 05, 05, 07, 01, 01), GLYPH('5', 07, 04, 07, 01, 07),
+	GLYPH('6', 07, 04, 07, 05, 07), GLYPH('7', 07, 01, 01, 01, 01),
+	GLYPH('8', 07, 05, 07, 05, 07), GLYPH('9', 07, 05, 07, 01, 07),
+	GLYPH('.', 00, 00, 00, 00, 02), GLYPH('a', 02, 05, 07, 05, 05),
+	GLYPH('c', 03, 04, 04, 04, 03), GLYPH('f', 03, 02, 07, 02, 02),
+	GLYPH('h', 05, 05, 07, 05, 05), GLYPH('l', 04, 04, 04, 04, 07),
+	GLYPH('m', 05, 07, 07, 05, 05), GLYPH('n', 06, 05, 05, 05, 05),
+	GLYPH('o', 02, 05, 05, 05, 02), GLYPH('p', 07, 05, 07, 04, 04),
+	GLYPH('s', 03, 04, 02, 01, 06), GLYPH('t', 07, 02, 02, 02, 02),
+	GLYPH('v', 05, 05, 05, 05, 02), GLYPH('w', 05, 05, 07, 07, 05),
+	GLYPH('y', 05, 05, 02, 02, 02)
+};
 
-	for(size_t y = begin; y < end; y++)
+static const int font_scale = 2;
+
+static void draw_text(surface& s, int x, int y, const char* text, uint32_t color)
+{
+	for(; *text; text++, x += 4 * font_scale)
 	{
-		auto cy = y * 255 / (end - begin);
+		for(const glyph& g : font)
+		{
+			if(g.c != *text)
+			{
+				continue;
+			}
+
+			for(int row = 0; row < 5; row++)
+			{
+				for(int col = 0; col < 3; col++)
+				{
+					if(g.rows & (1 << ((4 - row) * 3 + (2 - col))))
+					{
+						s.fill({x + col * font_scale, y + row * font_scale, font_scale, font_scale}, color);
+					}
+				}
+			}
+		}
+	}
+}
+
+static int to_tenths_of_ms(clock_t ticks)
+{
+	return (int)(ticks * 10000 / CLOCKS_PER_SEC);
+}
+
+terminal s_term{"terminal_1"};
+
+struct cursor_state
+{
+	int x = 0;
+	int y = 0;
+	bool quit = false;
+};
 
-		for(size_t x = 0; x < actual.width; x++)
+//returns true if the cursor moved
+static bool handle_input(input_ring* ring, cursor_state& cursor, const display_mode& mode, bool wait)
+{
+	input_event events[32];
+	size_t num_events = get_input_events(ring, events, 32, wait);
+
+	const int old_x = cursor.x, old_y = cursor.y;
+
+	for(size_t i = 0; i < num_events && !cursor.quit; i++)
+	{
+		const input_event& e = events[i];
+
+		if(e.type == KEY_DOWN && e.data == VK_ESCAPE)
+		{
+			cursor.quit = true;
+		}
+		else if(e.device_index == 0 && e.type == AXIS_MOTION)
 		{
-			auto c = x * 255 / actual.width;
+			if(e.control_index == 0) // x axis
+			{
+				cursor.x = (cursor.x + e.data);
 
-			mem[offset++] = from_rgb(c, cy, 255 - c);
+				if(cursor.x < 0)
+					cursor.x = 0;
+				else if(cursor.x >= (int)(mode.width - 32))
+					cursor.x = mode.width - 32;
+			}
+			else if(e.control_index == 1) // y axis
+			{
+				cursor.y = (cursor.y + e.data);
+
+				if(cursor.y < 0)
+					cursor.y = 0;
+				else if(cursor.y >= (int)(mode.height - 32))
+					cursor.y = mode.height - 32;
+			}
 		}
-		offset += ddpl - actual.width;
 	}
+
+	return cursor.x != old_x || cursor.y != old_y;
 }
 
-void draw_fill(size_t x0, size_t y0, size_t w, size_t h, display_mode& actual, uint32_t* mem)
+//every frame is drawn whole into a buffer that isn't on the screen and queued for the next retrace
+//it never waits for the retrace, so it keeps drawing and the frames that don't make it are skipped
+static void run_flipped(flip_chain& screen, const surface& background)
 {
-	size_t ddpl = (actual.pitch / 4);
-	size_t offset = y0 * ddpl + x0;
-	uint32_t value = from_rgb(255, 255, 255);
+	input_ring* ring = open_input_ring();
+	cursor_state cursor;
+	char readout[64] = "";
+
+	size_t frames = 0, total_frames = 0;
+	clock_t total_latency = 0;
+	size_t latency_samples = 0;
+
+	screen.update_status();
+	uint32_t last_shown = screen.status().shown;
+	uint32_t last_skipped = screen.status().skipped;
 
-	for(size_t y = 0; y < h; y++)
+	const clock_t start = clock();
+	clock_t second_start = start;
+
+	while(!cursor.quit)
 	{
-		for(size_t x = 0; x < w; x++)
+		handle_input(ring, cursor, screen.mode(), false);
+
+		surface& back = screen.back();
+
+		back.blit(background, background.bounds(), 0, 0);
+		back.fill({cursor.x, cursor.y, 32, 32}, 0xFFFFFFFF);
+		back.fill({4, 4, (int)strlen(readout) * 4 * font_scale + 8, 5 * font_scale + 8}, 0xFF000000);
+		draw_text(back, 8, 8, readout, 0xFFFFFFFF);
+
+		if(!screen.present())
+		{
+			break;
+		}
+
+		frames++;
+		total_latency += screen.latency();
+		latency_samples++;
+
+		const clock_t now = clock();
+
+		if(now - second_start >= CLOCKS_PER_SEC)
 		{
-			mem[offset++] = value;
+			const display_flip_status& status = screen.status();
+
+			//replaced frames move shown along too, but never reached the screen
+			const uint32_t shown = (status.shown - last_shown) - (status.skipped - last_skipped);
+			const clock_t elapsed = now - second_start;
+
+			snprintf(readout, sizeof(readout), "fps %d shown %d lat %d.%dms vsync %d.%dms%s",
+					 (int)(frames * CLOCKS_PER_SEC / elapsed),
+					 (int)(shown * CLOCKS_PER_SEC / elapsed),
+					 to_tenths_of_ms(screen.latency()) / 10, to_tenths_of_ms(screen.latency()) % 10,
+					 to_tenths_of_ms(status.refresh_period) / 10, to_tenths_of_ms(status.refresh_period) % 10,
+					 (status.flags & DISPLAY_FLIP_SYNCED) ? "" : " no sync");
+
+			total_frames += frames;
+			frames = 0;
+			last_shown = status.shown;
+			last_skipped = status.skipped;
+			second_start = now;
 		}
-		offset += ddpl - w;
 	}
+
+	total_frames += frames;
+	screen.update_status();
+
+	const display_flip_status& status = screen.status();
+	const clock_t elapsed = clock() - start;
+
+	s_term.set_mode(80, 25);
+	s_term.clear();
+
+	printf("%d buffers, %d frames drawn, %d skipped\n", screen.num_buffers(), total_frames, status.skipped);
+
+	if(elapsed)
+	{
+		printf("%d frames per second\n", (int)(total_frames * CLOCKS_PER_SEC / elapsed));
+	}
+
+	if(latency_samples)
+	{
+		const int latency = to_tenths_of_ms(total_latency / latency_samples);
+		printf("%d.%d ms from present to the screen on average\n", latency / 10, latency % 10);
+	}
+
+	const int period = to_tenths_of_ms(status.refresh_period);
+	printf("%d.%d ms between retraces%s\n", period / 10, period % 10,
+		   (status.flags & DISPLAY_FLIP_SYNCED) ? "" : ", going by the timer");
 }
 
-terminal s_term{"terminal_1"};
+//without room for more than one screen in video memory, it draws into a back buffer and copies what changed
+static void run_damaged(display_surface& screen, const surface& background)
+{
+	input_ring* ring = open_input_ring();
+	cursor_state cursor;
+
+	screen.back().blit(background, background.bounds(), 0, 0);
+	screen.back().fill({cursor.x, cursor.y, 32, 32}, 0xFFFFFFFF);
+	screen.damage_all();
+	screen.present();
+
+	while(!cursor.quit)
+	{
+		const rect old_cursor = {cursor.x, cursor.y, 32, 32};
+
+		//nothing moves on its own, so there's nothing to draw until there's input
+		if(!handle_input(ring, cursor, screen.mode(), true))
+		{
+			continue;
+		}
+
+		const rect new_cursor = {cursor.x, cursor.y, 32, 32};
+
+		//only where the cursor was and where it is now changed
+		screen.back().blit(background, old_cursor, old_cursor.x, old_cursor.y);
+		screen.back().fill(new_cursor, 0xFFFFFFFF);
+
+		screen.damage(old_cursor);
+		screen.damage(new_cursor);
+		screen.present();
+	}
+
+	s_term.set_mode(80, 25);
+	s_term.clear();
+}
 
 int main(int argc, char** argv)
 {
+	set_stdout([](const char* buf, size_t size, void* impl) {
+					s_term.print(buf, size);
+			   });
+
 	display_mode requested = {
 		800, 600,
 		0,
@@ -58,70 +275,35 @@ int main(int argc, char** argv)
 		0,
 		0
 	};
-	display_mode actual;
-	if(set_display_mode(&requested, &actual) != 0)
-	{
-		s_term.set_mode(80, 25);
-		s_term.print("Could not set graphics mode\n");
-		return 0;
-	}
-
-	auto mem = (uint32_t*)map_display_memory();
 
-	int cursor_x = 0, cursor_y = 0;
-
-	size_t page_begin = 0;
-	set_display_offset(page_begin, true);
-
-	input_event e{};
-	while(!(e.type == KEY_DOWN && e.data == VK_ESCAPE))
 	{
-		while(get_input_event(&e, false) == 0)
-		{
-			if(e.device_index == 0)
-			{
-				if(e.type == AXIS_MOTION)
-				{
-					if(e.control_index == 0) // x axis
-					{
-						cursor_x = (cursor_x + e.data);
+		flip_chain screen{requested};
 
-						if(cursor_x < 0)
-							cursor_x = 0;
-						else if(cursor_x >= (actual.width - 32))
-							cursor_x = actual.width - 32;
-					}
-					else if(e.control_index == 1) // y axis
-					{
-						cursor_y = (cursor_y + e.data);
+		if(screen.valid())
+		{
+			surface background{screen.mode().width, screen.mode().height, FORMAT_RGB888};
+			draw_gradient(background);
 
-						if(cursor_y < 0)
-							cursor_y = 0;
-						else if(cursor_y >= (actual.height - 32))
-							cursor_y = actual.height - 32;
-					}
-				}
-			}
+			run_flipped(screen, background);
+			return 0;
 		}
+	}
 
-		if(page_begin == 0)
-		{
-			page_begin = (actual.height * actual.pitch);
-		}
-		else
-		{
-			page_begin = 0;
-		}
+	display_surface screen{requested};
 
-		draw_gradient(0, actual.height, actual, mem + page_begin / 4);
+	if(!screen.valid())
+	{
+		s_term.set_mode(80, 25);
+		s_term.print("Could not set graphics mode\n");
+		return 0;
+	}
 
-		draw_fill(cursor_x, cursor_y, 32, 32, actual, mem + page_begin / 4);
+	const display_mode& actual = screen.mode();
 
-		set_display_offset(page_begin, true);
-	}
+	surface background{actual.width, actual.height, FORMAT_RGB888};
+	draw_gradient(background);
 
-	s_term.set_mode(80, 25);
-	s_term.clear();
+	run_damaged(screen, background);
 
 	return 0;
 }
\ No newline at end of file
@@ -0,0 +1,119 @@
+#include <stdio.h>
+#include <time.h>
+#include <threads.h>
+#include <sys/syscalls.h>
+#include <terminal/terminal.h>
+
+//a histogram of how late a sleeping task wakes up after its timer interrupt
+//first with the system quiet, then with threads keeping the kernel busy with system calls
+//the wake up happens in the timer's softirq, so it shouldn't have to wait for the kernel to be free
+
+terminal s_term{"terminal_1"};
+
+static const long sleep_us = 1000;
+static const size_t num_sleeps = 500;
+static const size_t max_load_threads = 4;
+
+//upper bound of each bucket in microseconds, the last one catches the rest
+static const int64_t bucket_limits[] = {50, 100, 200, 500, 1000, 2000, 5000};
+static const size_t num_buckets = sizeof(bucket_limits) / sizeof(bucket_limits[0]) + 1;
+
+static volatile bool stop_load = false;
+
+static int64_t elapsed_us(clock_t start)
+{
+	return (int64_t)(clock() - start) * 1000000 / CLOCKS_PER_SEC;
+}
+
+static int load_thread(void*)
+{
+	while(!stop_load)
+	{
+		clock_ticks(nullptr);
+	}
+	return 0;
+}
+
+static void run(const char* label)
+{
+	struct timespec request = {sleep_us / 1000000, (sleep_us % 1000000) * 1000};
+
+	size_t counts[num_buckets] = {};
+	int64_t total = 0;
+	int64_t worst = 0;
+
+	for(size_t i = 0; i < num_sleeps; i++)
+	{
+		clock_t start = clock();
+		nanosleep(&request, nullptr);
+		int64_t late = elapsed_us(start) - sleep_us;
+
+		if(late < 0) { late = 0; }
+
+		size_t bucket = 0;
+		while(bucket < num_buckets - 1 && late >= bucket_limits[bucket]) { bucket++; }
+
+		counts[bucket]++;
+		total += late;
+		if(late > worst) { worst = late; }
+	}
+
+	printf("%s: average %d us late, worst %d us\n", label, (int)(total / num_sleeps), (int)worst);
+
+	for(size_t i = 0; i < num_buckets; i++)
+	{
+		if(i < num_buckets - 1)
+		{
+			printf("  < %5d us %4d ", (int)bucket_limits[i], counts[i]);
+		}
+		else
+		{
+			printf("  more       %4d ", counts[i]);
+		}
+
+		for(size_t j = 0; j < counts[i] * 50 / num_sleeps; j++)
+		{
+			printf("#");
+		}
+
+		printf("\n");
+	}
+}
+
+int main(int argc, char** argv)
+{
+	set_stdout([](const char* buf, size_t size, void* impl) {
+					s_term.print(buf, size);
+			   });
+
+	run("idle");
+
+	size_t num_load = SYSTEM_PAGE->num_cpus;
+	if(num_load > max_load_threads) { num_load = max_load_threads; }
+
+	thrd_t load[max_load_threads];
+	size_t started = 0;
+
+	for(; started < num_load; started++)
+	{
+		if(thrd_create(&load[started], load_thread, nullptr) != thrd_success)
+		{
+			break;
+		}
+	}
+
+	printf("\n");
+
+	char label[48];
+	snprintf(label, sizeof(label), "%d threads in system calls", started);
+	run(label);
+
+	stop_load = true;
+
+	for(size_t i = 0; i < started; i++)
+	{
+		thrd_join(load[i], nullptr);
+	}
+
+	return 0;
+}
\ No newline at end of file
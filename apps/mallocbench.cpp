@@ -0,0 +1,233 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <malloc.h>
+#include <time.h>
+#include <threads.h>
+#include <terminal/terminal.h>
+
+//replays an allocation trace against malloc, realloc and free, in one thread and then in several at once
+//the trace is recorded up front so generating it isn't part of the timing
+
+terminal s_term{"terminal_1"};
+
+enum trace_op_type : uint8_t
+{
+	TRACE_MALLOC,
+	TRACE_REALLOC,
+	TRACE_FREE
+};
+
+struct trace_op
+{
+	trace_op_type type;
+	uint16_t slot;
+	uint32_t size;
+};
+
+static const size_t num_slots = 1024;
+static const size_t max_ops = 32768;
+
+static const size_t max_threads = 4;
+
+static trace_op trace[max_ops];
+static size_t trace_length = 0;
+
+//every thread replays the whole trace into its own slots
+struct replay
+{
+	void* slots[num_slots];
+	uint32_t slot_sizes[num_slots];
+	size_t counts[3];
+	size_t in_place;
+	size_t corrupted;
+	size_t peak_heap;
+};
+
+static replay replays[max_threads];
+
+static uint32_t rng_state = 2021;
+
+static uint32_t next_random()
+{
+	rng_state = rng_state * 1103515245 + 12345;
+	return rng_state >> 16;
+}
+
+static void record(trace_op_type type, size_t slot, size_t size)
+{
+	if(trace_length < max_ops)
+	{
+		trace[trace_length++] = {type, (uint16_t)slot, (uint32_t)size};
+	}
+}
+
+//the shape of a typical program: lots of small objects that live for a while,
+//buffers that grow one realloc at a time, and big temporary buffers
+static void generate_trace()
+{
+	bool live[num_slots] = {};
+	static uint32_t slot_sizes[num_slots];
+
+	while(trace_length < max_ops - 2)
+	{
+		size_t slot = next_random() % num_slots;
+		uint32_t kind = next_random() % 16;
+
+		if(live[slot])
+		{
+			if(kind < 10)
+			{
+				record(TRACE_FREE, slot, 0);
+				live[slot] = false;
+			}
+			else
+			{
+				//grow by roughly half, like a vector or a string builder
+				uint32_t size = slot_sizes[slot];
+				size += size / 2 + 16;
+				if(size > 256 * 1024) { size = 256 * 1024; }
+
+				record(TRACE_REALLOC, slot, size);
+				slot_sizes[slot] = size;
+			}
+		}
+		else
+		{
+			uint32_t size;
+
+			if(kind < 11) { size = 8 + next_random() % 120; }
+			else if(kind < 14) { size = 128 + next_random() % 4096; }
+			else { size = 16 * 1024 + next_random() % (192 * 1024); }
+
+			record(TRACE_MALLOC, slot, size);
+			slot_sizes[slot] = size;
+			live[slot] = true;
+		}
+	}
+
+	for(size_t i = 0; i < num_slots; i++)
+	{
+		if(live[i]) { record(TRACE_FREE, i, 0); }
+	}
+}
+
+static int elapsed_ms(clock_t start)
+{
+	return (int)((clock() - start) * 1000 / CLOCKS_PER_SEC);
+}
+
+static int replay_trace(void* arg)
+{
+	replay& r = *(replay*)arg;
+
+	for(size_t i = 0; i < trace_length; i++)
+	{
+		const trace_op& op = trace[i];
+		r.counts[op.type]++;
+
+		switch(op.type)
+		{
+		case TRACE_MALLOC:
+			r.slots[op.slot] = malloc(op.size);
+			//mark the first and last byte so we can check nothing was lost
+			((uint8_t*)r.slots[op.slot])[0] = (uint8_t)op.slot;
+			((uint8_t*)r.slots[op.slot])[op.size - 1] = (uint8_t)op.slot;
+			r.slot_sizes[op.slot] = op.size;
+			break;
+		case TRACE_REALLOC:
+		{
+			void* p = realloc(r.slots[op.slot], op.size);
+			if(p == r.slots[op.slot]) { r.in_place++; }
+			if(((uint8_t*)p)[0] != (uint8_t)op.slot) { r.corrupted++; }
+			((uint8_t*)p)[op.size - 1] = (uint8_t)op.slot;
+			r.slots[op.slot] = p;
+			r.slot_sizes[op.slot] = op.size;
+			break;
+		}
+		case TRACE_FREE:
+			if(((uint8_t*)r.slots[op.slot])[r.slot_sizes[op.slot] - 1] != (uint8_t)op.slot) { r.corrupted++; }
+			free(r.slots[op.slot]);
+			r.slots[op.slot] = nullptr;
+			break;
+		}
+
+		if((i & 1023) == 0)
+		{
+			struct mallinfo info = mallinfo();
+			if(info.arena > r.peak_heap) { r.peak_heap = info.arena; }
+		}
+	}
+
+	return 0;
+}
+
+int main(int argc, char** argv)
+{
+	set_stdout([](const char* buf, size_t size, void* impl) {
+					s_term.print(buf, size);
+			   });
+
+	generate_trace();
+
+	size_t corrupted = 0;
+
+	for(size_t threads = 1; threads <= max_threads; threads *= 2)
+	{
+		thrd_t workers[max_threads];
+		size_t started = 0;
+
+		clock_t start = clock();
+
+		for(; started < threads; started++)
+		{
+			replays[started] = {};
+
+			if(thrd_create(&workers[started], replay_trace, &replays[started]) != thrd_success)
+			{
+				break;
+			}
+		}
+
+		for(size_t i = 0; i < started; i++)
+		{
+			thrd_join(workers[i], nullptr);
+		}
+
+		int ms = elapsed_ms(start);
+
+		size_t in_place = 0;
+		size_t peak_heap = 0;
+
+		for(size_t i = 0; i < started; i++)
+		{
+			in_place += replays[i].in_place;
+			corrupted += replays[i].corrupted;
+			if(replays[i].peak_heap > peak_heap) { peak_heap = replays[i].peak_heap; }
+		}
+
+		const size_t* counts = replays[0].counts;
+
+		printf("%d threads replayed %d operations each in %d ms\n", started, trace_length, ms);
+		printf("  malloc %d, realloc %d (%d in place), free %d\n",
+			   counts[TRACE_MALLOC] * started, counts[TRACE_REALLOC] * started, in_place, counts[TRACE_FREE] * started);
+		printf("  peak heap %d KiB\n", peak_heap / 1024);
+
+		if(started < threads)
+		{
+			printf("  couldn't start more than %d threads\n", started);
+			break;
+		}
+	}
+
+	//the threads gave back what they kept for themselves when they finished
+	struct mallinfo info = mallinfo();
+	printf("heap after %d KiB, %d bytes still in use\n", info.arena / 1024, info.uordblks);
+
+	if(corrupted)
+	{
+		printf("%d allocations lost their contents!\n", corrupted);
+		return 1;
+	}
+
+	return 0;
+}
\ No newline at end of file
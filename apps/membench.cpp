@@ -0,0 +1,323 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#ifdef MEMBENCH_HOST
+//build.pl --host-tests links this against clib's memcpy.c and string.c built for the machine doing the building
+#include <clib/include/string_features.h>
+#else
+#include <terminal/terminal.h>
+#endif
+
+//checks memcpy, memmove and memset against what they should have written at every size up to past where the SIMD
+//loops start and every alignment of both pointers, then either side of where the non-temporal stores start, then at
+//random sizes up to 1 MiB, and times memcpy and memset, once for each combination of features string_force_features allows
+//strlen, memchr and memcmp don't change with the features, they're checked once the same way
+
+#ifndef MEMBENCH_HOST
+terminal s_term{"terminal_1"};
+#endif
+
+static const size_t max_size = 1024 * 1024;
+static const size_t guard = 64;
+static const size_t small_sizes = 320;
+static const size_t random_tests = 32;
+//memcpy.c switches to non-temporal stores from here, each side of it is checked at every destination alignment
+static const size_t non_temporal_size = 256 * 1024;
+static const size_t non_temporal_sizes[] = {non_temporal_size - 1, non_temporal_size, non_temporal_size + 1, non_temporal_size + 15};
+
+static const size_t timed_sizes[] = {64, 1024, 16 * 1024, 1024 * 1024};
+//each timed size is copied until this much has gone by
+static const size_t timed_bytes = 32 * 1024 * 1024;
+
+static uint32_t random_state = 2463534242u;
+
+static uint32_t random_number()
+{
+	random_state ^= random_state << 13;
+	random_state ^= random_state >> 17;
+	random_state ^= random_state << 5;
+	return random_state;
+}
+
+//what's expected is worked out from where a byte came from, so nothing here is checked with the code it's checking
+static uint8_t pattern(size_t i)
+{
+	return (uint8_t)(i * 7 + (i >> 8) * 13 + 1);
+}
+
+static void fill_pattern(uint8_t* buf, size_t size)
+{
+	for(size_t i = 0; i < size; i++)
+	{
+		buf[i] = pattern(i);
+	}
+}
+
+struct mem_buffers
+{
+	uint8_t* src;
+	uint8_t* dst;
+	size_t size;
+};
+
+//copying from src at s to dst at d, or inside of dst when src is dst
+static bool check_copy(mem_buffers& b, uint8_t* src, size_t s, size_t d, size_t num, bool move)
+{
+	fill_pattern(b.dst, b.size);
+
+	if(src != b.dst)
+	{
+		fill_pattern(src, b.size);
+	}
+
+	move ? memmove(b.dst + d, src + s, num) : memcpy(b.dst + d, src + s, num);
+
+	for(size_t i = 0; i < b.size; i++)
+	{
+		const uint8_t expected = (i >= d && i < d + num) ? pattern(s + i - d) : pattern(i);
+
+		if(b.dst[i] != expected)
+		{
+			printf("  %s of %d bytes from +%d to +%d is wrong at %d\n", move ? "memmove" : "memcpy", num, s, d, i);
+			return false;
+		}
+	}
+
+	return true;
+}
+
+static bool check_set(mem_buffers& b, size_t d, size_t num, int value)
+{
+	fill_pattern(b.dst, b.size);
+	memset(b.dst + d, value, num);
+
+	for(size_t i = 0; i < b.size; i++)
+	{
+		const uint8_t expected = (i >= d && i < d + num) ? (uint8_t)value : pattern(i);
+
+		if(b.dst[i] != expected)
+		{
+			printf("  memset of %d bytes at +%d is wrong at %d\n", num, d, i);
+			return false;
+		}
+	}
+
+	return true;
+}
+
+//every size and alignment only looks at the bytes near the copy, the whole buffer is for the random ones
+static size_t check_copies(mem_buffers& all)
+{
+	size_t failures = 0;
+
+	for(size_t num = 0; num <= small_sizes; num++)
+	{
+		mem_buffers near = {all.src, all.dst, num + guard * 2};
+
+		for(size_t d = 0; d < 16; d++)
+		{
+			for(size_t s = 0; s < 16; s++)
+			{
+				failures += !check_copy(near, near.src, s, d, num, false);
+				//both ways over itself
+				failures += !check_copy(near, near.dst, s, d + guard / 2, num, true);
+				failures += !check_copy(near, near.dst, s + guard / 2, d, num, true);
+			}
+
+			failures += !check_set(near, d, num, (int)num);
+		}
+
+		if(failures)
+		{
+			return failures;
+		}
+	}
+
+	for(size_t num : non_temporal_sizes)
+	{
+		mem_buffers near = {all.src, all.dst, num + guard * 2};
+
+		for(size_t d = 0; d < 16 && !failures; d++)
+		{
+			const size_t s = random_number() % 16;
+
+			failures += !check_copy(near, near.src, s, d, num, false);
+			failures += !check_copy(near, near.dst, s, d + guard / 2, num, true);
+			failures += !check_set(near, d, num, (int)num);
+		}
+	}
+
+	for(size_t i = 0; i < random_tests && !failures; i++)
+	{
+		const size_t num = random_number() % (all.size - guard * 2);
+		const size_t d = random_number() % (all.size - num);
+		const size_t s = random_number() % (all.size - num);
+
+		failures += !check_copy(all, all.src, s, d, num, false);
+		failures += !check_copy(all, all.dst, s, d, num, true);
+		failures += !check_set(all, d, num, (int)random_number());
+	}
+
+	return failures;
+}
+
+//these don't change with the features, and they only ever read
+static size_t check_searches(mem_buffers& b)
+{
+	size_t failures = 0;
+
+	for(size_t num = 0; num <= small_sizes; num++)
+	{
+		for(size_t s = 0; s < 16; s++)
+		{
+			uint8_t* str = b.src + s;
+
+			for(size_t i = 0; i < num; i++)
+			{
+				str[i] = (uint8_t)(1 + random_number() % 255);
+			}
+
+			str[num] = 0;
+
+			if(strlen((const char*)str) != num)
+			{
+				printf("  strlen of %d at +%d said %d\n", num, s, strlen((const char*)str));
+				failures++;
+			}
+
+			const uint8_t c = (uint8_t)(1 + random_number() % 255);
+			const uint8_t* expected = nullptr;
+
+			for(size_t i = 0; i < num && !expected; i++)
+			{
+				if(str[i] == c)
+				{
+					expected = &str[i];
+				}
+			}
+
+			if(memchr(str, c, num) != expected)
+			{
+				printf("  memchr of %d at +%d is wrong\n", num, s);
+				failures++;
+			}
+
+			uint8_t* other = b.dst + (15 - s);
+
+			for(size_t i = 0; i < num; i++)
+			{
+				other[i] = str[i];
+			}
+
+			if(memcmp(str, other, num) != 0)
+			{
+				printf("  memcmp of %d the same bytes at +%d wasn't 0\n", num, s);
+				failures++;
+			}
+
+			if(num)
+			{
+				const size_t at = random_number() % num;
+				other[at] ^= 0x80;
+
+				const int result = memcmp(str, other, num);
+
+				if(result == 0 || (result < 0) != (str[at] < other[at]))
+				{
+					printf("  memcmp of %d different at %d said %d\n", num, at, result);
+					failures++;
+				}
+			}
+		}
+	}
+
+	return failures;
+}
+
+static int mb_per_second(size_t bytes, clock_t ticks)
+{
+	if(ticks == 0) { ticks = 1; }
+	return (int)((uint64_t)bytes * CLOCKS_PER_SEC / ticks / (1024 * 1024));
+}
+
+static void time_features(mem_buffers& b)
+{
+	for(size_t size : timed_sizes)
+	{
+		const size_t count = timed_bytes / size;
+
+		clock_t start = clock();
+
+		for(size_t i = 0; i < count; i++)
+		{
+			memcpy(b.dst, b.src, size);
+		}
+
+		const clock_t copy_ticks = clock() - start;
+
+		start = clock();
+
+		for(size_t i = 0; i < count; i++)
+		{
+			memset(b.dst, (int)i, size);
+		}
+
+		const clock_t set_ticks = clock() - start;
+
+		printf("  %8d bytes %6d MiB/s memcpy %6d MiB/s memset\n", size,
+			   mb_per_second(timed_bytes, copy_ticks), mb_per_second(timed_bytes, set_ticks));
+	}
+}
+
+static void print_features(uint32_t features)
+{
+	printf("%s%s%s%s\n", features ? "" : "386",
+		   (features & STRING_ERMS) ? "ERMS " : "",
+		   (features & STRING_MMX) ? "MMX " : "",
+		   (features & STRING_SSE2) ? "SSE2" : "");
+}
+
+int main(int argc, char** argv)
+{
+#ifndef MEMBENCH_HOST
+	set_stdout([](const char* buf, size_t size, void* impl) {
+					s_term.print(buf, size);
+			   });
+#endif
+
+	mem_buffers b = {(uint8_t*)malloc(max_size), (uint8_t*)malloc(max_size), max_size};
+
+	if(!b.src || !b.dst)
+	{
+		printf("not enough memory for the buffers\n");
+		return 1;
+	}
+
+	const uint32_t detected = string_features();
+	size_t failures = check_searches(b);
+
+	//every combination of what the cpu has, starting from the plain 386 code
+	for(uint32_t features = 0; features <= detected; features++)
+	{
+		if(features & ~detected)
+		{
+			continue;
+		}
+
+		string_force_features(features);
+		print_features(features);
+
+		failures += check_copies(b);
+		time_features(b);
+	}
+
+	string_force_features(detected);
+
+	if(failures)
+	{
+		printf("%d checks failed\n", failures);
+	}
+
+	return failures ? 1 : 0;
+}
\ No newline at end of file
@@ -0,0 +1,202 @@
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+#include <sys/syscalls.h>
+#include <terminal/terminal.h>
+
+//counts primes with 1 process, then 2 and so on up to one for every cpu, to see how well it scales
+//the same program is the worker, it knows it is one when the shared board already exists
+
+terminal s_term{"terminal_1"};
+
+static const char board_name[] = "pprimes";
+static const char program_name[] = "pprimes.elf";
+
+static const uint32_t range_end = 200000;
+static const uint32_t chunk_size = 2000;
+static const uint32_t num_chunks = range_end / chunk_size;
+
+struct board
+{
+	uint8_t lock;
+	uint32_t next_chunk;
+	uint32_t primes_found;
+	uint32_t workers_done;
+};
+
+//the counters are shared between processes on different cpus, so they're only touched with the lock held
+static void board_lock(board& b)
+{
+	while(__sync_lock_test_and_set(&b.lock, 1))
+	{
+		while(__atomic_load_n(&b.lock, __ATOMIC_RELAXED))
+		{
+			__asm__ volatile("rep; nop");
+		}
+	}
+}
+
+static void board_unlock(board& b)
+{
+	__sync_lock_release(&b.lock);
+}
+
+static bool is_prime(uint32_t number)
+{
+	if(number < 2) { return false; }
+
+	for(uint32_t i = 2; i * i <= number; i++)
+	{
+		if(number % i == 0)
+		{
+			return false;
+		}
+	}
+	return true;
+}
+
+static void do_work(board& b)
+{
+	for(;;)
+	{
+		board_lock(b);
+		uint32_t chunk = b.next_chunk++;
+		board_unlock(b);
+
+		if(chunk >= num_chunks) { return; }
+
+		uint32_t found = 0;
+
+		for(uint32_t n = chunk * chunk_size; n < (chunk + 1) * chunk_size; n++)
+		{
+			if(is_prime(n)) { found++; }
+		}
+
+		board_lock(b);
+		b.primes_found += found;
+		board_unlock(b);
+	}
+}
+
+static int run_worker(uintptr_t buf)
+{
+	board& b = *(board*)map_shared_buffer(buf, sizeof(board), PAGE_RW);
+
+	do_work(b);
+
+	board_lock(b);
+	b.workers_done++;
+	board_unlock(b);
+
+	close_shared_buffer(buf);
+	return 0;
+}
+
+static const file_handle* find_program(directory_stream** dir_out)
+{
+	for(size_t drive = 0; drive < 4; drive++)
+	{
+		const file_handle* root = get_root_directory(drive);
+
+		if(!root) { continue; }
+
+		directory_stream* dir = open_dir_handle(root, 0);
+		dispose_file_handle(root);
+
+		const file_handle* file = find_path(dir, program_name, strlen(program_name), 0, 0);
+
+		if(file)
+		{
+			*dir_out = dir;
+			return file;
+		}
+
+		close_dir(dir);
+	}
+
+	return nullptr;
+}
+
+static int elapsed_ms(clock_t start)
+{
+	return (int)((clock() - start) * 1000 / CLOCKS_PER_SEC);
+}
+
+int main(int argc, char** argv)
+{
+	uintptr_t board_buf = open_shared_buffer(board_name, strlen(board_name));
+
+	if(board_buf)
+	{
+		return run_worker(board_buf);
+	}
+
+	set_stdout([](const char* buf, size_t size, void* impl) {
+					s_term.print(buf, size);
+			   });
+
+	board_buf = create_shared_buffer(board_name, strlen(board_name), sizeof(board));
+
+	if(!board_buf)
+	{
+		printf("could not create the %s buffer\n", board_name);
+		return 1;
+	}
+
+	board& b = *(board*)map_shared_buffer(board_buf, sizeof(board), PAGE_RW);
+
+	directory_stream* dir = nullptr;
+	const file_handle* file = find_program(&dir);
+
+	if(!file)
+	{
+		printf("could not find %s\n", program_name);
+		close_shared_buffer(board_buf);
+		return 1;
+	}
+
+	size_t num_cpus = SYSTEM_PAGE->num_cpus;
+	int single_ms = 0;
+
+	printf("counting primes below %d on %d cpus\n", range_end, num_cpus);
+
+	for(size_t processes = 1; processes <= num_cpus; processes++)
+	{
+		b = board{};
+
+		clock_t start = clock();
+
+		//the workers aren't waited on, so they can go to the other cpus
+		for(size_t i = 1; i < processes; i++)
+		{
+			spawn_process(file, dir, 0);
+		}
+
+		do_work(b);
+
+		while(__atomic_load_n(&b.workers_done, __ATOMIC_ACQUIRE) < processes - 1)
+		{
+			__asm__ volatile("rep; nop");
+		}
+
+		int ms = elapsed_ms(start);
+
+		if(processes == 1) { single_ms = ms; }
+
+		printf("%d processes: %d primes in %d ms", processes, b.primes_found, ms);
+
+		if(ms)
+		{
+			printf(", %d.%02dx\n", single_ms / ms, single_ms * 100 / ms % 100);
+		}
+		else
+		{
+			printf("\n");
+		}
+	}
+
+	dispose_file_handle(file);
+	close_dir(dir);
+	close_shared_buffer(board_buf);
+	return 0;
+}
\ No newline at end of file
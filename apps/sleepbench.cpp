@@ -0,0 +1,45 @@
+#include <stdio.h>
+#include <time.h>
+#include <terminal/terminal.h>
+
+//checks how close sleeping comes to the time asked for
+//while it sleeps the cpu should be idle, not spinning
+
+terminal s_term{"terminal_1"};
+
+static const long sleep_times_us[] = {100, 1000, 10000, 100000};
+static const size_t num_runs = 20;
+
+static int64_t elapsed_us(clock_t start)
+{
+	return (int64_t)(clock() - start) * 1000000 / CLOCKS_PER_SEC;
+}
+
+int main(int argc, char** argv)
+{
+	set_stdout([](const char* buf, size_t size, void* impl) {
+					s_term.print(buf, size);
+			   });
+
+	for(long us : sleep_times_us)
+	{
+		struct timespec request = {us / 1000000, (us % 1000000) * 1000};
+
+		int64_t total = 0;
+		int64_t worst = 0;
+
+		for(size_t i = 0; i < num_runs; i++)
+		{
+			clock_t start = clock();
+			nanosleep(&request, nullptr);
+			int64_t slept = elapsed_us(start);
+
+			total += slept;
+			if(slept > worst) { worst = slept; }
+		}
+
+		printf("sleep %d us: average %d us, worst %d us\n", (int)us, (int)(total / num_runs), (int)worst);
+	}
+
+	return 0;
+}
\ No newline at end of file
@@ -0,0 +1,62 @@
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+#include <sys/syscalls.h>
+#include <terminal/terminal.h>
+
+//times how long it takes to start a small program linked against the shared libraries
+
+terminal s_term{"terminal_1"};
+
+static const size_t num_runs = 50;
+static const char startup_name[] = "startup.elf";
+
+static int elapsed_us(clock_t start)
+{
+	return (int)((uint64_t)(clock() - start) * 1000000 / CLOCKS_PER_SEC);
+}
+
+int main(int argc, char** argv)
+{
+	set_stdout([](const char* buf, size_t size, void* impl) {
+					s_term.print(buf, size);
+			   });
+
+	for(size_t drive = 0; drive < 4; drive++)
+	{
+		const file_handle* root = get_root_directory(drive);
+
+		if(!root) { continue; }
+
+		directory_stream* dir = open_dir_handle(root, 0);
+		const file_handle* file = find_path(dir, startup_name, strlen(startup_name), 0, 0);
+
+		if(file)
+		{
+			//the first run pulls everything into the block cache
+			spawn_process(file, dir, WAIT_FOR_PROCESS);
+
+			clock_t start = clock();
+
+			for(size_t i = 0; i < num_runs; i++)
+			{
+				spawn_process(file, dir, WAIT_FOR_PROCESS);
+			}
+
+			int us = elapsed_us(start);
+
+			printf("started %s %d times in %d ms, %d us each\n", startup_name, num_runs, us / 1000, us / num_runs);
+
+			dispose_file_handle(file);
+			close_dir(dir);
+			dispose_file_handle(root);
+			return 0;
+		}
+
+		close_dir(dir);
+		dispose_file_handle(root);
+	}
+
+	printf("could not find %s\n", startup_name);
+	return 1;
+}
\ No newline at end of file
@@ -0,0 +1,21 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+//does next to nothing, so spawning it mostly measures loading and linking
+//startbench runs it over and over
+
+int main(int argc, char** argv)
+{
+	char buf[64];
+
+	time_t t = time(nullptr);
+	snprintf(buf, sizeof(buf), "%s", ctime(&t));
+
+	char* copy = (char*)malloc(strlen(buf) + 1);
+	strcpy(copy, buf);
+	free(copy);
+
+	return 0;
+}
\ No newline at end of file
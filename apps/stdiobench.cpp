@@ -0,0 +1,125 @@
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+#include <terminal/terminal.h>
+
+//writes 1 MiB to a file in 16 byte fprintf calls with each setvbuf mode, then reads it back a line at a time
+//with no buffering every call is a system call, with full buffering it's one per BUFSIZ bytes
+
+terminal s_term{"terminal_1"};
+
+static const char* path = "1:/stdio.txt";
+static const size_t line_size = 16;
+static const size_t num_lines = (1024 * 1024) / line_size;
+
+static const int modes[] = {_IONBF, _IOLBF, _IOFBF};
+//indexed by the mode
+static const char* mode_names[] = {"full", "line", "unbuffered"};
+
+static int to_ms(clock_t ticks)
+{
+	return (int)(ticks * 1000 / CLOCKS_PER_SEC);
+}
+
+static int kb_per_second(clock_t ticks)
+{
+	return ticks ? (int)((uint64_t)num_lines * line_size * CLOCKS_PER_SEC / ticks / 1024) : 0;
+}
+
+static bool write_test(int mode)
+{
+	FILE* f = fopen(path, "w");
+
+	if(!f)
+	{
+		printf("could not open %s for writing\n", path);
+		return false;
+	}
+
+	setvbuf(f, nullptr, mode, BUFSIZ);
+
+	clock_t start = clock();
+
+	for(size_t i = 0; i < num_lines; i++)
+	{
+		//8 + 7 + the newline
+		fprintf(f, "%08x%07d\n", i * 2654435761u, i);
+	}
+
+	const bool failed = ferror(f);
+	fclose(f);
+
+	clock_t ticks = clock() - start;
+
+	printf("  write %-10s %6d ms %6d KiB/s%s\n", mode_names[mode], to_ms(ticks), kb_per_second(ticks),
+		   failed ? "  write failed!" : "");
+
+	return !failed;
+}
+
+static void read_test(int mode)
+{
+	FILE* f = fopen(path, "r");
+
+	if(!f)
+	{
+		printf("could not open %s for reading\n", path);
+		return;
+	}
+
+	setvbuf(f, nullptr, mode, BUFSIZ);
+
+	char line[32];
+	char expected[32];
+	size_t lines = 0, wrong = 0;
+
+	clock_t start = clock();
+
+	while(fgets(line, sizeof(line), f))
+	{
+		snprintf(expected, sizeof(expected), "%08x%07d\n", lines * 2654435761u, lines);
+
+		if(strcmp(line, expected) != 0)
+		{
+			wrong++;
+		}
+
+		lines++;
+	}
+
+	clock_t ticks = clock() - start;
+
+	fclose(f);
+
+	printf("  read  %-10s %6d ms %6d KiB/s, %d lines", mode_names[mode], to_ms(ticks), kb_per_second(ticks), lines);
+
+	if(lines != num_lines || wrong)
+	{
+		printf(", expected %d, %d different!", num_lines, wrong);
+	}
+
+	printf("\n");
+}
+
+int main(int argc, char** argv)
+{
+	set_stdout([](const char* buf, size_t size, void* impl) {
+					s_term.print(buf, size);
+			   });
+
+	printf("%d bytes to %s in %d byte lines\n", num_lines * line_size, path, line_size);
+
+	for(int mode : modes)
+	{
+		if(!write_test(mode))
+		{
+			return 1;
+		}
+	}
+
+	//line buffering only matters for writing
+	read_test(_IONBF);
+	read_test(_IOFBF);
+
+	return 0;
+}
\ No newline at end of file
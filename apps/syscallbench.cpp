@@ -0,0 +1,59 @@
+#include <stdio.h>
+#include <time.h>
+#include <sys/syscalls.h>
+#include <terminal/terminal.h>
+
+//measures the round trip into the kernel and back with a system call that does nothing
+
+terminal s_term{"terminal_1"};
+
+static const size_t num_calls = 1000000;
+
+static void run(const char* label)
+{
+	//warm up the caches and the TLB
+	for(size_t i = 0; i < 1000; i++)
+	{
+		empty_syscall();
+	}
+
+	clock_t start = clock();
+
+	for(size_t i = 0; i < num_calls; i++)
+	{
+		empty_syscall();
+	}
+
+	clock_t elapsed = clock() - start;
+
+	int ns = (int)((uint64_t)elapsed * 1000000000 / CLOCKS_PER_SEC / num_calls);
+
+	printf("%-10s %d calls in %d ms, %d ns per call\n", label, num_calls, (int)(elapsed * 1000 / CLOCKS_PER_SEC), ns);
+}
+
+int main(int argc, char** argv)
+{
+	set_stdout([](const char* buf, size_t size, void* impl) {
+					s_term.print(buf, size);
+			   });
+
+	void* selected_entry = SYSTEM_PAGE->syscall_entry;
+
+	//always available, so it's the baseline
+	SYSTEM_PAGE->syscall_entry = SYSTEM_PAGE->int_0x80_stub;
+	run("int 0x80");
+
+	if(SYSTEM_PAGE->features & SYSTEM_FEATURE_SYSENTER)
+	{
+		SYSTEM_PAGE->syscall_entry = selected_entry;
+		run("sysenter");
+	}
+	else
+	{
+		printf("sysenter isn't supported on this cpu\n");
+	}
+
+	SYSTEM_PAGE->syscall_entry = selected_entry;
+
+	return 0;
+}
\ No newline at end of file
@@ -0,0 +1,141 @@
+#include <stdio.h>
+#include <time.h>
+#include <threads.h>
+#include <sys/syscalls.h>
+#include <terminal/terminal.h>
+
+//counts primes with 1 thread, then 2 and so on up to one for every cpu, to see how well it scales
+//the same as pprimes, but with threads in one process instead of a process for each worker
+
+terminal s_term{"terminal_1"};
+
+static const uint32_t range_end = 200000;
+static const uint32_t chunk_size = 2000;
+static const uint32_t num_chunks = range_end / chunk_size;
+
+static const size_t max_threads = 16;
+
+//xchg is the only atomic the 386 has, so the counters are behind a lock
+static uint8_t counter_lock;
+static uint32_t next_chunk;
+static uint32_t primes_found;
+
+static void counters_lock()
+{
+	while(__sync_lock_test_and_set(&counter_lock, 1))
+	{
+		while(__atomic_load_n(&counter_lock, __ATOMIC_RELAXED))
+		{
+			__asm__ volatile("rep; nop");
+		}
+	}
+}
+
+static void counters_unlock()
+{
+	__sync_lock_release(&counter_lock);
+}
+
+static bool is_prime(uint32_t number)
+{
+	if(number < 2) { return false; }
+
+	for(uint32_t i = 2; i * i <= number; i++)
+	{
+		if(number % i == 0)
+		{
+			return false;
+		}
+	}
+	return true;
+}
+
+static int do_work(void*)
+{
+	for(;;)
+	{
+		counters_lock();
+		uint32_t chunk = next_chunk++;
+		counters_unlock();
+
+		if(chunk >= num_chunks) { return 0; }
+
+		uint32_t found = 0;
+
+		for(uint32_t n = chunk * chunk_size; n < (chunk + 1) * chunk_size; n++)
+		{
+			if(is_prime(n)) { found++; }
+		}
+
+		counters_lock();
+		primes_found += found;
+		counters_unlock();
+	}
+}
+
+static int elapsed_ms(clock_t start)
+{
+	return (int)((clock() - start) * 1000 / CLOCKS_PER_SEC);
+}
+
+int main(int argc, char** argv)
+{
+	set_stdout([](const char* buf, size_t size, void* impl) {
+					s_term.print(buf, size);
+			   });
+
+	size_t num_cpus = SYSTEM_PAGE->num_cpus;
+	if(num_cpus > max_threads) { num_cpus = max_threads; }
+
+	int single_ms = 0;
+
+	printf("counting primes below %d on %d cpus\n", range_end, num_cpus);
+
+	for(size_t threads = 1; threads <= num_cpus; threads++)
+	{
+		next_chunk = 0;
+		primes_found = 0;
+
+		clock_t start = clock();
+
+		thrd_t workers[max_threads];
+		size_t started = 0;
+
+		for(size_t i = 1; i < threads; i++)
+		{
+			if(thrd_create(&workers[started], do_work, nullptr) == thrd_success)
+			{
+				started++;
+			}
+		}
+
+		do_work(nullptr);
+
+		for(size_t i = 0; i < started; i++)
+		{
+			thrd_join(workers[i], nullptr);
+		}
+
+		int ms = elapsed_ms(start);
+
+		if(threads == 1) { single_ms = ms; }
+
+		printf("%d threads: %d primes in %d ms", threads, primes_found, ms);
+
+		if(started != threads - 1)
+		{
+			printf(" (only %d threads started)", started + 1);
+		}
+
+		if(ms)
+		{
+			printf(", %d.%02dx\n", single_ms / ms, single_ms * 100 / ms % 100);
+		}
+		else
+		{
+			printf("\n");
+		}
+	}
+
+	return 0;
+}
\ No newline at end of file
@@ -0,0 +1,208 @@
+#include <stdio.h>
+#include <time.h>
+#include <sys/syscalls.h>
+#include <terminal/terminal.h>
+
+//the first run starts the kernel recording events, the next one stops it and sums up what it saw
+//then the last few records are printed as they are
+
+terminal s_term{"terminal_1"};
+
+static const size_t max_records = 16 * 1024;
+static const size_t num_syscalls = 64;
+static const size_t max_pids = 64;
+static const size_t records_to_show = 16;
+
+static trace_record records[max_records];
+
+static const char* event_names[TRACE_NUM_EVENTS] = {
+	"?",
+	"syscall enter",
+	"syscall exit",
+	"task switch",
+	"page fault",
+	"cache hit",
+	"cache miss",
+	"disk submit",
+	"disk complete"
+};
+
+struct latency
+{
+	uint32_t count;
+	uint64_t total;
+	uint64_t worst;
+
+	void add(uint64_t ticks)
+	{
+		count++;
+		total += ticks;
+		if(ticks > worst) { worst = ticks; }
+	}
+};
+
+//what each pid is in the middle of, the records for a pid come in order as long as it stays on one cpu
+struct pid_state
+{
+	uint64_t syscall_start;
+	uint32_t syscall_index;
+	bool in_syscall;
+	uint64_t disk_start;
+	bool in_disk;
+};
+
+static latency syscalls[num_syscalls];
+static latency disk_requests;
+static pid_state pids[max_pids];
+
+static int ticks_to_us(uint64_t ticks)
+{
+	return (int)(ticks * 1000000 / CLOCKS_PER_SEC);
+}
+
+static void sort_by_time(size_t count)
+{
+	//each cpu's records are already in order, so an insertion sort doesn't have far to move anything
+	for(size_t i = 1; i < count; i++)
+	{
+		trace_record r = records[i];
+		size_t j = i;
+
+		for(; j > 0 && records[j - 1].timestamp > r.timestamp; j--)
+		{
+			records[j] = records[j - 1];
+		}
+
+		records[j] = r;
+	}
+}
+
+static void summarize(size_t count)
+{
+	uint32_t event_counts[TRACE_NUM_EVENTS] = {};
+
+	for(size_t i = 0; i < count; i++)
+	{
+		const trace_record& r = records[i];
+
+		if(r.event >= TRACE_NUM_EVENTS) { continue; }
+
+		event_counts[r.event]++;
+
+		if(r.pid >= max_pids) { continue; }
+
+		pid_state& p = pids[r.pid];
+
+		switch(r.event)
+		{
+		case TRACE_SYSCALL_ENTER:
+			p.syscall_start = r.timestamp;
+			p.syscall_index = r.args[0];
+			p.in_syscall = true;
+			break;
+		case TRACE_SYSCALL_EXIT:
+			if(p.in_syscall && p.syscall_index < num_syscalls)
+			{
+				syscalls[p.syscall_index].add(r.timestamp - p.syscall_start);
+			}
+			p.in_syscall = false;
+			break;
+		case TRACE_DISK_SUBMIT:
+			p.disk_start = r.timestamp;
+			p.in_disk = true;
+			break;
+		case TRACE_DISK_COMPLETE:
+			if(p.in_disk)
+			{
+				disk_requests.add(r.timestamp - p.disk_start);
+			}
+			p.in_disk = false;
+			break;
+		}
+	}
+
+	printf("%d records over %d us\n", count, ticks_to_us(records[count - 1].timestamp - records[0].timestamp));
+
+	for(size_t i = 1; i < TRACE_NUM_EVENTS; i++)
+	{
+		printf("  %-14s %d\n", event_names[i], event_counts[i]);
+	}
+
+	uint32_t lookups = event_counts[TRACE_BLOCK_CACHE_HIT] + event_counts[TRACE_BLOCK_CACHE_MISS];
+
+	if(lookups)
+	{
+		printf("block cache hit rate %d%%\n", event_counts[TRACE_BLOCK_CACHE_HIT] * 100 / lookups);
+	}
+
+	if(disk_requests.count)
+	{
+		printf("disk requests: %d, average %d us, worst %d us\n", disk_requests.count,
+			   ticks_to_us(disk_requests.total / disk_requests.count), ticks_to_us(disk_requests.worst));
+	}
+
+	printf("syscall  calls  average us  worst us\n");
+
+	for(size_t i = 0; i < num_syscalls; i++)
+	{
+		const latency& l = syscalls[i];
+
+		if(l.count)
+		{
+			printf("%7d %6d %11d %9d\n", i, l.count, ticks_to_us(l.total / l.count), ticks_to_us(l.worst));
+		}
+	}
+}
+
+static void dump(size_t count)
+{
+	size_t first = (count > records_to_show) ? count - records_to_show : 0;
+
+	printf("the last %d records:\n", count - first);
+
+	for(size_t i = first; i < count; i++)
+	{
+		const trace_record& r = records[i];
+		const char* name = (r.event < TRACE_NUM_EVENTS) ? event_names[r.event] : "?";
+
+		printf("%10d us cpu %d pid %3d %-14s %X %X\n", ticks_to_us(r.timestamp - records[0].timestamp),
+			   r.cpu, r.pid, name, r.args[0], r.args[1]);
+	}
+}
+
+int main(int argc, char** argv)
+{
+	set_stdout([](const char* buf, size_t size, void* impl) {
+					s_term.print(buf, size);
+			   });
+
+	int recording = trace_control(TRACE_CMD_STATUS, nullptr, 0);
+
+	if(recording < 0)
+	{
+		printf("the kernel was built without tracepoints\n");
+		return 1;
+	}
+
+	if(!recording)
+	{
+		trace_control(TRACE_CMD_START, nullptr, 0);
+		printf("tracing started, run trace again to stop it and see what happened\n");
+		return 0;
+	}
+
+	trace_control(TRACE_CMD_STOP, nullptr, 0);
+
+	int count = trace_control(TRACE_CMD_READ, records, max_records);
+
+	if(count <= 0)
+	{
+		printf("nothing was recorded\n");
+		return 0;
+	}
+
+	sort_by_time(count);
+	summarize(count);
+	dump(count);
+	return 0;
+}
\ No newline at end of file
@@ -0,0 +1,92 @@
+#include <stdio.h>
+#include <time.h>
+#include <sys/syscalls.h>
+#include <terminal/terminal.h>
+
+//how long the display driver takes to move the display start and to switch modes
+//without the protected mode interface every one of these is a BIOS call run through the emulator
+
+terminal s_term{"terminal_1"};
+
+static const size_t offset_calls = 500;
+static const size_t mode_switches = 10;
+
+static display_mode graphics_mode(size_t width, size_t height)
+{
+	return {
+		width, height,
+		0,
+		0,
+		32,
+		FORMAT_ARGB32,
+		0,
+		0
+	};
+}
+
+static int us_per_call(clock_t ticks, size_t calls)
+{
+	return (int)(ticks * 1000000 / CLOCKS_PER_SEC / calls);
+}
+
+int main(int argc, char** argv)
+{
+	set_stdout([](const char* buf, size_t size, void* impl) {
+					s_term.print(buf, size);
+			   });
+
+	const display_mode small = graphics_mode(640, 480);
+	const display_mode large = graphics_mode(800, 600);
+	display_mode actual{};
+
+	if(set_display_mode(&large, &actual) != 0)
+	{
+		s_term.set_mode(80, 25);
+		printf("could not set 800x600x32\n");
+		return 1;
+	}
+
+	//one screen down if there's room for it, otherwise one line, either way the start really moves
+	const size_t screen_size = actual.pitch * actual.height;
+	const size_t second = (actual.buffer_size >= screen_size * 2) ? screen_size : actual.pitch;
+
+	clock_t start = clock();
+
+	for(size_t i = 0; i < offset_calls; i++)
+	{
+		set_display_offset((i & 1) ? second : 0, 0);
+	}
+
+	const clock_t offset_ticks = clock() - start;
+
+	set_display_offset(0, 0);
+
+	size_t switches = 0;
+	start = clock();
+
+	for(; switches < mode_switches; switches++)
+	{
+		if(set_display_mode((switches & 1) ? &large : &small, nullptr) != 0)
+		{
+			break;
+		}
+	}
+
+	const clock_t switch_ticks = clock() - start;
+
+	s_term.set_mode(80, 25);
+	s_term.clear();
+
+	printf("set_display_offset: %d us per call, %d calls\n", us_per_call(offset_ticks, offset_calls), offset_calls);
+
+	if(switches)
+	{
+		printf("set_display_mode:   %d us per switch, %d switches\n", us_per_call(switch_ticks, switches), switches);
+	}
+	else
+	{
+		printf("could not switch to 640x480x32\n");
+	}
+
+	return 0;
+}
\ No newline at end of file
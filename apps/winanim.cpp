@@ -0,0 +1,58 @@
+#include <time.h>
+#include <sys/syscalls.h>
+#include <graphics/window.h>
+
+//a compositor client, a see-through window with a bar sweeping across it
+//escape closes it when it has the focus, and it goes away by itself when the compositor exits
+
+static const size_t width = 240;
+static const size_t height = 160;
+static const int bar_width = 24;
+
+static void draw_frame(surface& s, size_t frame, uint32_t color)
+{
+	const rect all = s.bounds();
+	const int bar_x = (int)(frame * 4) % (all.w + bar_width) - bar_width;
+
+	s.fill(all, (color & 0x00FFFFFF) | 0xC0000000);
+	s.fill({bar_x, 0, bar_width, all.h}, 0xFFFFFFFF);
+	s.fill({0, 0, all.w, 4}, 0xFF000000);
+}
+
+int main(int argc, char** argv)
+{
+	//there's no way to pass arguments, so every copy goes somewhere different depending on when it started
+	const clock_t seed = clock();
+	const int x = (int)(seed * 37 % 500);
+	const int y = (int)(seed * 53 % 400);
+	const uint32_t color = (uint32_t)(seed * 0x9E3779B1) | 0x00404040;
+
+	window win{x, y, width, height, WINDOW_TRANSLUCENT};
+
+	if(!win.valid())
+	{
+		return 1;
+	}
+
+	input_event events[16];
+
+	for(size_t frame = 0; win.server_running(); frame++)
+	{
+		const size_t num_events = win.get_input(events, 16);
+
+		for(size_t i = 0; i < num_events; i++)
+		{
+			if(events[i].type == KEY_DOWN && events[i].data == VK_ESCAPE)
+			{
+				return 0;
+			}
+		}
+
+		draw_frame(win.canvas(), frame, color);
+		win.damage_all();
+
+		sys_sleep(0, 10000000);
+	}
+
+	return 0;
+}
\ No newline at end of file
@@ -18,27 +18,54 @@ mkpath($builddir);
 my @common_flags = qw(-target i386-elf -Wuninitialized -Wall -fno-unwind-tables -fno-asynchronous-unwind-tables -march=i386 -O2 -mno-sse -mno-mmx -fomit-frame-pointer -I ./ -Werror=implicit-function-declaration -flto -I clib/include -D__I386_ONLY);
 my @cpp_flags = qw(-std=c++20 -fno-rtti -fno-exceptions -I cpplib/include);
 my @c_flags = qw(-std=c99 -Wc++-compat);
-my @asm_flags = qw(-f elf);
+#the kernel's tracepoints cost a flag test each while nobody is recording, --no-trace leaves them out entirely
+my $tracing = !grep { $_ eq "--no-trace" } @ARGV;
+my @trace_flags = $tracing ? qw(-DKERNEL_TRACE) : ();
+#the profiler can only walk the stack through frame pointers, --profile keeps them everywhere at the cost of a register
+my $profiling = grep { $_ eq "--profile" } @ARGV;
+@common_flags = map { $_ eq "-fomit-frame-pointer" ? "-fno-omit-frame-pointer" : $_ } @common_flags if $profiling;
+my @profile_flags = $profiling ? qw(-DKERNEL_PROFILE) : ();
 
-my @kernel_flags = qw(-D __KERNEL -mno-implicit-float);
+my @asm_flags = (qw(-f elf), @trace_flags);
+
+my @kernel_flags = (qw(-D __KERNEL -mno-implicit-float), @trace_flags, @profile_flags);
 my @driver_flags = (@kernel_flags, qw(-fPIC -fno-function-sections));
 my @shlib_flags = qw(-fPIC);
 my @user_flags = qw(-I api/ -nodefaultlibs);
 
-my @user_ld_flags = qw(-L./ -l:libclang_rt.builtins-i386.a -mllvm -align-all-nofallthru-blocks=2 -O2 --lto-O2 --gc-sections);
-my @shlib_ld_flags = qw(-O2 -shared --lto-O3 --gc-sections);
-my @driver_ld_flags = qw(-L./ -l:libclang_rt.builtins-i386.a -O2 -shared --lto-O2 --gc-sections -T drivers/driver.ld);
+my @user_ld_flags = qw(-L./ -l:libclang_rt.builtins-i386.a -mllvm -align-all-nofallthru-blocks=2 -O2 --lto-O2 --gc-sections --hash-style=both --export-dynamic-symbol=_dl_runtime_resolve);
+my @shlib_ld_flags = qw(-O2 -shared --lto-O3 --gc-sections --hash-style=both);
+my @driver_ld_flags = qw(-L./ -l:libclang_rt.builtins-i386.a -O2 -shared --lto-O2 --gc-sections --hash-style=both -T drivers/driver.ld);
 my @kernel_ld_flags = qw(-L./ -l:libclang_rt.builtins-i386.a --lto-O2 -N -O2 -Ttext=0xF000 -T linker.ld -mllvm -align-all-nofallthru-blocks=2);
 
 mkpath("$builddir/tools");
 system("clang++ tools/rdfs.cpp -o $builddir/tools/rdfs.exe -std=c++20 -O2");
 system("clang -D_CRT_SECURE_NO_WARNINGS tools/limine/limine-install.c -o $builddir/tools/limine-install.exe -O2");
 
+#--host-tests builds memcpy.c and string.c the way they go into clib, but finding the features with cpuid instead of
+#the system page, and runs membench with them on this machine, every size, alignment and feature it has is checked
+if(grep { $_ eq "--host-tests" } @ARGV)
+{
+	mkpath("$builddir/host");
+	my @host_objs;
+
+	foreach my $file (qw(clib/memcpy.c clib/string.c clib/ctype.c))
+	{
+		my $outfile = "$builddir/host/" . basename($file, ".c") . ".o";
+		system("gcc", "-m32", "-c", $file, "-o", $outfile, qw(-std=c99 -O2 -march=i386 -mno-sse -mno-mmx -ffreestanding -fno-builtin -nostdinc -I ./ -I clib/include -D__STRING_CPUID)) == 0 or die "couldn't build $file for the host\n";
+		push @host_objs, $outfile;
+	}
+
+	system("g++", "-m32", "apps/membench.cpp", @host_objs, "-o", "$builddir/host/membench", qw(-std=c++20 -O2 -fno-builtin -I ./ -DMEMBENCH_HOST)) == 0 or die "couldn't build membench for the host\n";
+	system("$builddir/host/membench") == 0 or die "membench failed on the host\n";
+}
+
 my @kernel_src = qw(	
 	kernel/kernel.asm
 	kernel/interrupt.asm
 	kernel/paging.asm
 	kernel/syscall.asm
+	kernel/smp.asm
 
 	kernel/kernel.c
 	kernel/memorymanager.cpp
@@ -60,6 +87,17 @@ my @kernel_src = qw(
 	kernel/input.cpp		
 	kernel/kassert.cpp		
 	kernel/shared_mem.cpp		
+	kernel/acpi.cpp
+	kernel/apic.cpp
+	kernel/smp.cpp
+	kernel/timer.cpp
+	kernel/worker.cpp
+	kernel/softirq.cpp
+	kernel/trace.cpp
+	kernel/profile.cpp
+	kernel/fpu.cpp
+	kernel/memtype.cpp
+	kernel/display_flip.cpp
 
 	drivers/display/basic_text/basic_text.cpp
 	drivers/formats/rdfs.cpp
@@ -70,12 +108,14 @@ my @kernel_src = qw(
 
 my @clib_src = qw(	
 	clib/string.c
+	clib/memcpy.c
 	clib/stdio.c
 	clib/ctype.c
 	clib/time.c
 	clib/stdlib.cpp
 	clib/liballoc.cpp
-	clib/string.asm
+	clib/slab.cpp
+	clib/span.cpp
 );
 
 my $boot_mapper = build(name => "boot_mapper.a", 
@@ -139,6 +179,8 @@ build_static("cppruntime.a", ["api/cppruntime.cpp"]);
 my $terminal = 
 build_shared("terminal.lib", ["api/terminal/terminal.cpp", "api/cppruntime.cpp"], [link_lib($clib)]);
 
+my $graphics = build_shared("graphics.lib", ["api/graphics/graphics.cpp", "api/graphics/pixel_ops.cpp", "api/graphics/display_surface.cpp", "api/graphics/window.cpp", "api/graphics/compositor_server.cpp", "api/graphics/flip_chain.cpp", "api/graphics/psf_font.cpp", "api/graphics/fb_console.cpp"], [link_lib($clib)]);
+
 my $shell = build(name => "shell.elf", src => ["api/crt0.c", "api/crti.asm", "shell/commands.cpp", "shell/shell.cpp", "api/crtn.asm"], flags => [@common_flags, @user_flags], ldflags => [@user_ld_flags, "--image-base=0x8000000", link_lib($clib), link_lib($terminal), $kb, $cppr]);
 
 my $primes = build(name => "primes.elf", src => ["api/crt0.c", "api/crti.asm", "apps/primes.cpp", "api/crtn.asm"], flags => [@common_flags, @user_flags], ldflags => [@user_ld_flags, "--image-base=0x8000000", link_lib($clib), link_lib($terminal), $kb, $cppr]);
@@ -147,16 +189,42 @@ my $bkgrndtest = build(name => "bkgrnd.elf", src => ["api/crt0.c", "api/crti.asm
 
 my $listmode = build(name => "listmode.elf", src => ["api/crt0.c", "api/crti.asm", "apps/listmode.cpp", "api/crtn.asm"], flags => [@common_flags, @user_flags], ldflags => [@user_ld_flags, "--image-base=0x8000000", link_lib($clib), link_lib($terminal), $kb, $cppr]);
 
-my $graphicstest = build(name => "graphics.elf", src => ["api/crt0.c", "api/crti.asm", "apps/graphics.cpp", "api/crtn.asm"], flags => [@common_flags, @user_flags], ldflags => [@user_ld_flags, "--image-base=0x8000000", link_lib($clib), link_lib($terminal), $kb, $cppr]);
+my $graphicstest = build(name => "graphics.elf", src => ["api/crt0.c", "api/crti.asm", "apps/graphics.cpp", "api/crtn.asm"], flags => [@common_flags, @user_flags], ldflags => [@user_ld_flags, "--image-base=0x8000000", link_lib($clib), link_lib($terminal), link_lib($graphics), $kb, $cppr]);
 
 my $fwritetest = build(name => "fwrite.elf", src => ["api/crt0.c", "api/crti.asm", "apps/fwrite.cpp", "api/crtn.asm"], flags => [@common_flags, @user_flags], ldflags => [@user_ld_flags, "--image-base=0x8000000", link_lib($clib), $cppr]);
 
+my $allocbench = build(name => "allocbench.elf", src => ["api/crt0.c", "api/crti.asm", "apps/allocbench.cpp", "api/crtn.asm"], flags => [@common_flags, @user_flags], ldflags => [@user_ld_flags, "--image-base=0x8000000", link_lib($clib), link_lib($terminal), $kb, $cppr]);
+
+my $startup = build(name => "startup.elf", src => ["api/crt0.c", "api/crti.asm", "apps/startup.cpp", "api/crtn.asm"], flags => [@common_flags, @user_flags], ldflags => [@user_ld_flags, "--image-base=0x8000000", link_lib($clib), link_lib($terminal), $kb, $cppr]);
+
+my $startbench = build(name => "startbench.elf", src => ["api/crt0.c", "api/crti.asm", "apps/startbench.cpp", "api/crtn.asm"], flags => [@common_flags, @user_flags], ldflags => [@user_ld_flags, "--image-base=0x8000000", link_lib($clib), link_lib($terminal), $kb, $cppr]);
+my $pprimes = build(name => "pprimes.elf", src => ["api/crt0.c", "api/crti.asm", "apps/pprimes.cpp", "api/crtn.asm"], flags => [@common_flags, @user_flags], ldflags => [@user_ld_flags, "--image-base=0x8000000", link_lib($clib), link_lib($terminal), $kb, $cppr]);
+my $tprimes = build(name => "tprimes.elf", src => ["api/crt0.c", "api/crti.asm", "apps/tprimes.cpp", "api/crtn.asm"], flags => [@common_flags, @user_flags], ldflags => [@user_ld_flags, "--image-base=0x8000000", link_lib($clib), link_lib($terminal), $kb, $cppr]);
+my $sleepbench = build(name => "sleepbench.elf", src => ["api/crt0.c", "api/crti.asm", "apps/sleepbench.cpp", "api/crtn.asm"], flags => [@common_flags, @user_flags], ldflags => [@user_ld_flags, "--image-base=0x8000000", link_lib($clib), link_lib($terminal), $kb, $cppr]);
+
+my $clockbench = build(name => "clockbench.elf", src => ["api/crt0.c", "api/crti.asm", "apps/clockbench.cpp", "api/crtn.asm"], flags => [@common_flags, @user_flags], ldflags => [@user_ld_flags, "--image-base=0x8000000", link_lib($clib), link_lib($terminal), $kb, $cppr]);
+my $irqbench = build(name => "irqbench.elf", src => ["api/crt0.c", "api/crti.asm", "apps/irqbench.cpp", "api/crtn.asm"], flags => [@common_flags, @user_flags], ldflags => [@user_ld_flags, "--image-base=0x8000000", link_lib($clib), link_lib($terminal), $kb, $cppr]);
+my $trace = build(name => "trace.elf", src => ["api/crt0.c", "api/crti.asm", "apps/trace.cpp", "api/crtn.asm"], flags => [@common_flags, @user_flags], ldflags => [@user_ld_flags, "--image-base=0x8000000", link_lib($clib), link_lib($terminal), $kb, $cppr]);
+my $syscallbench = build(name => "syscallbench.elf", src => ["api/crt0.c", "api/crti.asm", "apps/syscallbench.cpp", "api/crtn.asm"], flags => [@common_flags, @user_flags], ldflags => [@user_ld_flags, "--image-base=0x8000000", link_lib($clib), link_lib($terminal), $kb, $cppr]);
+
+my $mallocbench = build(name => "mallocbench.elf", src => ["api/crt0.c", "api/crti.asm", "apps/mallocbench.cpp", "api/crtn.asm"], flags => [@common_flags, @user_flags], ldflags => [@user_ld_flags, "--image-base=0x8000000", link_lib($clib), link_lib($terminal), $kb, $cppr]);
+my $gfxbench = build(name => "gfxbench.elf", src => ["api/crt0.c", "api/crti.asm", "apps/gfxbench.cpp", "api/crtn.asm"], flags => [@common_flags, @user_flags], ldflags => [@user_ld_flags, "--image-base=0x8000000", link_lib($clib), link_lib($terminal), link_lib($graphics), $kb, $cppr]);
+my $framebench = build(name => "framebench.elf", src => ["api/crt0.c", "api/crti.asm", "apps/framebench.cpp", "api/crtn.asm"], flags => [@common_flags, @user_flags], ldflags => [@user_ld_flags, "--image-base=0x8000000", link_lib($clib), link_lib($terminal), link_lib($graphics), $kb, $cppr]);
+my $compositor = build(name => "compositor.elf", src => ["api/crt0.c", "api/crti.asm", "apps/compositor.cpp", "api/crtn.asm"], flags => [@common_flags, @user_flags], ldflags => [@user_ld_flags, "--image-base=0x8000000", link_lib($clib), link_lib($terminal), link_lib($graphics), $kb, $cppr]);
+my $winanim = build(name => "winanim.elf", src => ["api/crt0.c", "api/crti.asm", "apps/winanim.cpp", "api/crtn.asm"], flags => [@common_flags, @user_flags], ldflags => [@user_ld_flags, "--image-base=0x8000000", link_lib($clib), link_lib($terminal), link_lib($graphics), $kb, $cppr]);
+my $compbench = build(name => "compbench.elf", src => ["api/crt0.c", "api/crti.asm", "apps/compbench.cpp", "api/crtn.asm"], flags => [@common_flags, @user_flags], ldflags => [@user_ld_flags, "--image-base=0x8000000", link_lib($clib), link_lib($terminal), link_lib($graphics), $kb, $cppr]);
+my $vesabench = build(name => "vesabench.elf", src => ["api/crt0.c", "api/crti.asm", "apps/vesabench.cpp", "api/crtn.asm"], flags => [@common_flags, @user_flags], ldflags => [@user_ld_flags, "--image-base=0x8000000", link_lib($clib), link_lib($terminal), $kb, $cppr]);
+my $fbconsole = build(name => "fbconsole.elf", src => ["api/crt0.c", "api/crti.asm", "apps/fbconsole.cpp", "api/crtn.asm"], flags => [@common_flags, @user_flags], ldflags => [@user_ld_flags, "--image-base=0x8000000", link_lib($clib), link_lib($terminal), link_lib($graphics), $kb, $cppr]);
+my $stdiobench = build(name => "stdiobench.elf", src => ["api/crt0.c", "api/crti.asm", "apps/stdiobench.cpp", "api/crtn.asm"], flags => [@common_flags, @user_flags], ldflags => [@user_ld_flags, "--image-base=0x8000000", link_lib($clib), link_lib($terminal), $kb, $cppr]);
+my $fmtbench = build(name => "fmtbench.elf", src => ["api/crt0.c", "api/crti.asm", "apps/fmtbench.cpp", "api/crtn.asm"], flags => [@common_flags, @user_flags], ldflags => [@user_ld_flags, "--image-base=0x8000000", link_lib($clib), link_lib($terminal), $kb, $cppr]);
+my $membench = build(name => "membench.elf", src => ["api/crt0.c", "api/crti.asm", "apps/membench.cpp", "api/crtn.asm"], flags => [@common_flags, @user_flags], ldflags => [@user_ld_flags, "--image-base=0x8000000", link_lib($clib), link_lib($terminal), $kb, $cppr]);
+
 mkpath("$builddir/fdboot");
 system("$builddir/tools/rdfs", "configs/cdboot/init.sys", $drv_lib, $iso_drv, $ata_drv, $kb_drv, $pci_drv, "-o", "$builddir/cdboot/init.rfs");
 mkpath("$builddir/cdboot");
 system("$builddir/tools/rdfs", "configs/fdboot/init.sys", $drv_lib, $ext2_drv, $fat_drv, $floppy_drv, $kb_drv, $isa_dma, "-o", "$builddir/fdboot/init.rfs");
 mkpath("$builddir/netboot");
-system("$builddir/tools/rdfs", "configs/netboot/init.sys", $ps2mouse_drv, $i8042_drv, $listmode, $vesa_drv, $drv_lib, $kb_drv, $shell, $graphicstest, $clib, $terminal, "-o", "$builddir/netboot/init.rfs");
+system("$builddir/tools/rdfs", "configs/netboot/init.sys", $ps2mouse_drv, $i8042_drv, $listmode, $vesa_drv, $drv_lib, $kb_drv, $shell, $graphicstest, $clib, $terminal, $graphics, "-o", "$builddir/netboot/init.rfs");
 
 system("nasm boot/boot_sect.asm -i boot -f bin -o $builddir/boot_sect.bin");
 
@@ -195,11 +263,33 @@ my @iso_files = (
 		$graphicstest,
 		$clib,
 		$terminal,
+		$graphics,
 		$shell,
 		$primes,
 		$listmode,
 		$fwritetest,
 		$bkgrndtest,
+		$allocbench,
+		$mallocbench,
+		$startup,
+		$startbench,
+		$pprimes,
+		$tprimes,
+		$sleepbench,
+		$syscallbench,
+		$clockbench,
+		$irqbench,
+		$trace,
+		$gfxbench,
+		$framebench,
+		$compositor,
+		$winanim,
+		$compbench,
+		$vesabench,
+		$fbconsole,
+		$stdiobench,
+		$fmtbench,
+		$membench,
 	],
 	"/drivers" => [
 		$fat_drv, 		
@@ -11,6 +11,16 @@ public:
 	void* calloc_bytes(size_t nobj, size_t size);
 	void* realloc_bytes(void* p, size_t size);
 
+	//the size that was requested for p, 0 if p is not a valid allocation
+	size_t usable_size(void* p);
+
+	//bytes requested from the system and bytes handed out
+	void get_usage(size_t* allocated, size_t* in_use) const
+	{
+		*allocated = (size_t)l_allocated;
+		*in_use = (size_t)l_inuse;
+	}
+
 	constexpr heap_allocator(int (*lock_func)(),
 				   int (*unlock_func)(),
 				   void* (*alloc_func)(size_t),
@@ -0,0 +1,21 @@
+#ifndef MALLOC_H
+#define MALLOC_H
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stddef.h>
+
+struct mallinfo
+{
+	size_t arena;		//bytes of pages the heap got from the system
+	size_t uordblks;	//bytes handed out to the program
+	size_t fordblks;	//bytes held by the heap but not handed out
+};
+
+struct mallinfo mallinfo(void);
+
+#ifdef __cplusplus
+}
+#endif
+#endif
\ No newline at end of file
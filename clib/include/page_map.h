@@ -0,0 +1,64 @@
+#ifndef _PAGE_MAP_H
+#define _PAGE_MAP_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+//one bit per page of the 32 bit address space, used by the allocators to
+//find out which of them a pointer came from
+//the bitmap pages are only allocated for the parts of memory that get used
+class __attribute__((visibility("hidden"))) page_map
+{
+public:
+	constexpr page_map() = default;
+	page_map(const page_map&) = delete;
+
+	bool test(const void* p) const
+	{
+		const uint8_t* bitmap = m_bitmaps[(uintptr_t)p >> top_level_shift];
+
+		if(!bitmap) { return false; }
+
+		uintptr_t page = page_index((uintptr_t)p);
+		return bitmap[page / 8] & (1 << (page % 8));
+	}
+
+	//returns false if there was no memory for the bitmap
+	//alloc_page is called to get a page for a new part of the bitmap
+	template<typename Func>
+	bool set(const void* p, bool value, Func&& alloc_page)
+	{
+		uint8_t*& bitmap = m_bitmaps[(uintptr_t)p >> top_level_shift];
+
+		if(!bitmap)
+		{
+			if(!value) { return true; }
+
+			bitmap = (uint8_t*)alloc_page();
+			if(!bitmap) { return false; }
+
+			memset(bitmap, 0, page_size);
+		}
+
+		uintptr_t page = page_index((uintptr_t)p);
+
+		if(value) { bitmap[page / 8] |= (1 << (page % 8)); }
+		else { bitmap[page / 8] &= ~(1 << (page % 8)); }
+
+		return true;
+	}
+
+private:
+	static constexpr size_t page_size = 4096;
+	static constexpr size_t top_level_shift = 27; //one page of bitmap covers 128MiB
+
+	static uintptr_t page_index(uintptr_t address)
+	{
+		return (address / page_size) & ((1 << (top_level_shift - 12)) - 1);
+	}
+
+	uint8_t* m_bitmaps[((uint64_t)1 << 32) >> top_level_shift] = {};
+};
+
+#endif
\ No newline at end of file
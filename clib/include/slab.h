@@ -0,0 +1,144 @@
+#ifndef _SLAB_H
+#define _SLAB_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <page_map.h>
+
+// JSD/OS slab allocator
+//
+// Small allocations are served from single pages carved into equally sized
+// objects. Each size class (and each dedicated object cache) keeps its own
+// list of partially used slabs, so allocating and freeing is O(1) and never
+// walks the liballoc block lists. Anything bigger than slab_allocator::max_size
+// goes to liballoc, or straight to whole pages for big user allocations (see span.h).
+
+struct slab_header;
+struct slab_thread_cache;
+
+//a cache of equally sized objects
+class __attribute__((visibility("hidden"))) slab_cache
+{
+	friend class slab_allocator;
+public:
+	constexpr slab_cache(size_t object_size)
+		: m_object_size((object_size + (granularity - 1)) & ~(granularity - 1))
+	{}
+
+	slab_cache(const slab_cache&) = delete;
+
+	size_t object_size() const { return m_object_size; }
+	size_t pages() const { return m_pages; }
+	size_t objects_in_use() const { return m_in_use; }
+
+	static constexpr size_t granularity = 8;
+
+private:
+	slab_header* m_partial = nullptr;	//slabs with at least one free object
+	slab_header* m_empty = nullptr;		//one completely free slab kept around to avoid thrashing
+	const size_t m_object_size;
+	size_t m_pages = 0;
+	size_t m_in_use = 0;
+};
+
+class __attribute__((visibility("hidden"))) slab_allocator
+{
+public:
+	static constexpr size_t page_size = 4096;
+	static constexpr size_t max_size = 512;
+
+	constexpr slab_allocator(int (*lock_func)(),
+							 int (*unlock_func)(),
+							 void* (*alloc_func)(size_t),
+							 int (*free_func)(void*, size_t))
+		: lock(lock_func),
+		unlock(unlock_func),
+		sys_alloc_pages(alloc_func),
+		sys_free_pages(free_func)
+	{}
+
+	slab_allocator(const slab_allocator&) = delete;
+
+	//returns nullptr if size is bigger than max_size or we are out of memory
+	void* alloc_bytes(size_t size);
+
+	//allocates one object from a dedicated cache
+	void* alloc_object(slab_cache& cache);
+
+	//returns true if p was handed out by this allocator
+	bool owns(const void* p) const;
+
+	//p must be owned by this allocator
+	void free_bytes(void* p);
+	size_t usable_size(const void* p) const;
+
+	//the same, but only taking the lock when the thread's cache has to be refilled or has too much
+	void* alloc_bytes(size_t size, slab_thread_cache& cache);
+	void free_bytes(void* p, slab_thread_cache& cache);
+
+	//gives everything in the cache back, before the thread that owns it goes away
+	void drain(slab_thread_cache& cache);
+
+	//bytes of pages held by slabs and bytes of objects handed out from the size classes
+	//objects waiting in thread caches count as handed out
+	void get_usage(size_t* allocated, size_t* in_use) const;
+
+	static constexpr size_t num_classes = 12;
+
+private:
+
+	slab_cache m_classes[num_classes] = {
+		{8}, {16}, {24}, {32}, {48}, {64}, {96}, {128}, {192}, {256}, {384}, {512}
+	};
+
+	//set for pages that hold a slab
+	page_map m_page_map;
+
+	slab_header* new_slab(slab_cache& cache);
+	void release_slab(slab_header* slab);
+
+	//these expect the lock to be held
+	void* alloc_locked(slab_cache& cache);
+	void free_locked(void* p);
+
+	void refill(slab_thread_cache& cache, size_t c);
+	void give_back(slab_thread_cache& cache, size_t c, size_t count);
+
+	int (* const lock)();
+	int (* const unlock)();
+	void* (* const sys_alloc_pages)(size_t);
+	int (* const sys_free_pages)(void*, size_t);
+};
+
+//free objects of each size class kept by one thread, linked through their first word
+//they come from the slabs and go back to them a batch at a time, so most of the thread's
+//small allocations and frees don't wait for the other threads
+//a zeroed one is empty
+struct slab_thread_cache
+{
+	void* objects[slab_allocator::num_classes];
+	uint16_t count[slab_allocator::num_classes];
+};
+
+#ifdef __KERNEL
+//allocates from a dedicated kernel object cache, objects are released with free()
+void* kernel_cache_alloc(slab_cache& cache);
+
+template<typename T>
+inline constinit slab_cache kernel_object_cache{sizeof(T)};
+
+//put this inside a struct to give it its own object cache
+//it doesn't change the layout, so it's fine for structs shared with assembly
+#define SLAB_CACHED(type) \
+	static void* operator new(size_t size) \
+	{ \
+		return size == sizeof(type) ? kernel_cache_alloc(kernel_object_cache<type>) : malloc(size); \
+	} \
+	static void operator delete(void* p) \
+	{ \
+		free(p); \
+	}
+#endif
+
+#endif
@@ -0,0 +1,77 @@
+#ifndef _SPAN_H
+#define _SPAN_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <page_map.h>
+
+// JSD/OS span allocator
+//
+// Big allocations get their own run of pages straight from the system.
+// Freed spans have their memory handed back with the discard hook, but the
+// addresses are kept in a small table so the next big allocation, or a
+// realloc growing into its neighbour, can reuse them without a new mapping.
+
+class __attribute__((visibility("hidden"))) span_allocator
+{
+public:
+	static constexpr size_t page_size = 4096;
+	static constexpr size_t min_size = 16 * 1024; //smaller requests are not worth whole pages
+
+	constexpr span_allocator(int (*lock_func)(),
+							 int (*unlock_func)(),
+							 void* (*alloc_func)(void*, size_t),
+							 int (*free_func)(void*, size_t),
+							 int (*discard_func)(void*, size_t))
+		: lock(lock_func),
+		unlock(unlock_func),
+		sys_alloc_pages(alloc_func),
+		sys_free_pages(free_func),
+		sys_discard_pages(discard_func)
+	{}
+
+	span_allocator(const span_allocator&) = delete;
+
+	void* alloc_bytes(size_t size);
+	void free_bytes(void* p);
+
+	//grows or shrinks the allocation without moving it, returns false if it has to move
+	bool resize_bytes(void* p, size_t size);
+
+	bool owns(const void* p) const;
+	size_t usable_size(const void* p) const;
+
+	//bytes of pages held by live spans and bytes handed out in them
+	void get_usage(size_t* allocated, size_t* in_use) const;
+
+private:
+	struct free_span
+	{
+		uintptr_t address;
+		size_t pages;
+	};
+
+	static constexpr size_t max_free_spans = 32;
+
+	free_span m_free_spans[max_free_spans] = {};
+	size_t m_num_free_spans = 0;
+
+	//set for the first page of every live span
+	page_map m_page_map;
+
+	size_t m_pages = 0;
+	size_t m_in_use = 0;
+
+	uintptr_t take_free_span(size_t pages);
+	bool take_free_span_at(uintptr_t address, size_t pages);
+	void give_free_span(uintptr_t address, size_t pages);
+	void remove_free_span(size_t index);
+
+	int (* const lock)();
+	int (* const unlock)();
+	void* (* const sys_alloc_pages)(void*, size_t);
+	int (* const sys_free_pages)(void*, size_t);
+	int (* const sys_discard_pages)(void*, size_t);
+};
+
+#endif
\ No newline at end of file
@@ -19,6 +19,11 @@ typedef uint64_t uintmax_t;
 typedef int32_t intptr_t;
 typedef uint32_t uintptr_t;
 
+#define INT32_MAX	2147483647
+#define UINT32_MAX	4294967295u
+#define INT64_MAX	9223372036854775807ll
+#define UINT64_MAX	18446744073709551615ull
+
 #ifdef __cplusplus
 }
 #endif
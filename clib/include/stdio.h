@@ -7,7 +7,7 @@ extern "C" {
 #include <stdarg.h>
 #include <string.h>
 
-#define EOF 0x04 //ascii EOT character
+#define EOF (-1)
 
 #ifndef NULL
 #define NULL (void*)0
@@ -15,19 +15,44 @@ extern "C" {
 
 #define FILENAME_MAX 256
 
+//how big a buffer a FILE gets unless setvbuf says otherwise
+#define BUFSIZ 4096
+
+//setvbuf modes, fully buffered, flushed at every newline, and not buffered at all
+#define _IOFBF 0
+#define _IOLBF 1
+#define _IONBF 2
+
 typedef size_t fpos_t;
 typedef struct FILE FILE;
 
 //extern FILE* stdin;
 
+#ifndef __KERNEL
+//stdout is line buffered and stderr isn't buffered, both go to whatever set_stdout installed
+extern FILE* stdout;
+extern FILE* stderr;
+#endif
+
 void clearerr(FILE* stream);
 FILE* fopen(const char* filename, const char* mode);
 int fclose(FILE* stream);
 int feof(FILE* stream);
 int ferror(FILE* stream);
-//int fputc(int character, FILE* stream);
+int fputc(int character, FILE* stream);
+int putc(int character, FILE* stream);
 int fputs(const char* str, FILE* stream);
+int fgetc(FILE* stream);
+int getc(FILE* stream);
+char* fgets(char* str, int num, FILE* stream);
+size_t fread(void* ptr, size_t size, size_t count, FILE* stream);
+size_t fwrite(const void* ptr, size_t size, size_t count, FILE* stream);
+int fflush(FILE* stream); //with NULL every open FILE is flushed, exit() does this
+int setvbuf(FILE* stream, char* buffer, int mode, size_t size);
+void setbuf(FILE* stream, char* buffer);
 int fprintf(FILE* stream, const char* format, ...);
+int vfprintf(FILE* stream, const char* format, va_list args);
+int vprintf(const char* format, va_list args);
 int sprintf(char* s, const char * format, ...);
 int snprintf(char* s, size_t n, const char* format, ...);
 char *gets(char *str); //!blatantly unsafe function please do not use: BUFFER OVERFLOW!!!
@@ -37,10 +62,8 @@ int vsnprintf(char *buffer, size_t n, const char* fmt, va_list args);
 int printf(const char* format, ...);
 int putchar(int character);
 int getchar();
-//int getc(FILE* stream);
 int puts(const char* str);
 void perror(const char* str);
-//int fflush(FILE* stream);
 
 void set_stdout(void (*write)(const char* buf, size_t size, void* impl));
 
@@ -7,11 +7,12 @@ extern "C" {
 #include <stddef.h>
 #include <stdint.h>
 
-//extern void* memcpy(void* dest, const void* src, size_t num);
-//extern void* memset(void* ptr, int value, size_t num);
+#include <string_features.h>
+
 extern void* memmove(void* dest, const void* src, size_t num);
 
 int memcmp ( const void * ptr1, const void * ptr2, size_t num );
+void* memchr(const void* ptr, int value, size_t num);
 
 size_t strlen(const char* str);
 int strcmp(const char* str1, const char* str2);
@@ -22,10 +23,17 @@ char* strchr(const char* str, int character);
 char* strcat(char* destination, const char* source);
 char* strcpy(char* destination, const char* source);
 
+//memcpy.c defines the real ones, everywhere else sizes known while compiling are done inline
+#ifdef __STRING_NO_INLINE
+void* memcpy(void* dest, const void* src, size_t num);
+void* memset(void* ptr, int value, size_t num);
+#else
+#include <string386.inl>
+#endif
+
 #ifdef __cplusplus
 }
 #endif
 
-#include <string386.inl>
 
 #endif
\ No newline at end of file
@@ -1,22 +1,7 @@
 
-static inline void* __do_memcpy(void* dest, const void* src, size_t num)
-{
-    void* od = dest;
-    uint32_t temp;
-    __asm__ volatile(
-        "   mov %%ecx, %[tmp]\n"
-        "   shr $0x2, %%ecx\n"
-        "   and $0x3, %[tmp]\n"
-        "   cld\n"
-        "   rep movsl\n"
-        "   mov %[tmp], %%ecx\n"
-        "   rep movsb\n"
-        : "+D"(dest), "+S" (src), "+c" (num), [tmp]"=&r"(temp) // output
-        :  // input
-        : "cc", "memory" // clobbered register
-        );
-    return od;
-}
+//memcpy.c, these pick the fastest way the cpu has for sizes only known at run time
+void* __memcpy(void* dest, const void* src, size_t num);
+void* __memset(void* dest, int value, size_t num);
 
 static inline void* __do_memcpy4(void* dest, const void* src, size_t num)
 {
@@ -48,12 +33,7 @@ static inline void* memcpy(void* dst, const void* src, size_t size)
         }
     }
 
-    if(__builtin_constant_p(size & 3) && (size & 3) == 0)
-    {
-		return __do_memcpy4(dst, src, size);
-    }
-
-    return __do_memcpy(dst, src, size);
+    return __memcpy(dst, src, size);
 }
 
 static inline void* __do_memset4(void* dest, int value, size_t num)
@@ -74,27 +54,6 @@ static inline void* __do_memset4(void* dest, int value, size_t num)
     return od;
 }
 
-static inline void* __do_memset(void* dest, int value, size_t num)
-{
-    const uint32_t v = (value << 24) | (value << 16) | (value << 8) | value;
-
-    void* od = dest;
-    uint32_t temp;
-    __asm__ volatile(
-        "   mov %%ecx, %[tmp]\n"
-        "   shr $0x2, %%ecx\n"
-        "   and $0x3, %[tmp]\n"
-        "   cld\n"
-        "   rep stosl\n"
-        "   mov %[tmp], %%ecx\n"
-        "   rep stosb\n"
-        : "+D"(dest), "+c" (num), [tmp]"=&r"(temp) // output
-        : "a" (v)// input
-        : "cc", "memory" // clobbered register
-        );
-    return od;
-}
-
 static inline void* memset(void* a, int value, size_t size)
 {
     if(__builtin_constant_p(size))
@@ -109,10 +68,5 @@ static inline void* memset(void* a, int value, size_t size)
         }
     }
 
-    if(__builtin_constant_p(size & 3) && (size & 3) == 0)
-    {
-        return __do_memset4(a, value, size);
-    }
-
-    return __do_memset(a, value, size);
+    return __memset(a, value, size);
 }
\ No newline at end of file
@@ -0,0 +1,25 @@
+#ifndef STRING_FEATURES_H
+#define STRING_FEATURES_H
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stdint.h>
+
+//what memcpy, memset and memmove use besides the 386 instructions, worked out the first time one is called
+//kept apart from string.h so membench can be built against another OS's string.h
+enum string_features
+{
+	STRING_ERMS = 0x01, //rep movsb and rep stosb
+	STRING_MMX = 0x02,
+	STRING_SSE2 = 0x04, //with non-temporal stores for anything bigger than the caches
+};
+
+uint32_t string_features(void);
+//for checking and timing each way, only what the cpu has can be turned on
+void string_force_features(uint32_t features);
+
+#ifdef __cplusplus
+}
+#endif
+#endif
\ No newline at end of file
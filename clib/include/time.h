@@ -27,12 +27,25 @@ struct tm
 	int tm_isdst; 	// Daylight Saving Time flag
 };
 
+struct timespec
+{
+	time_t tv_sec;
+	long tv_nsec;
+};
+
 clock_t __c_get_clock_tick_rate();
 
 #define CLOCKS_PER_SEC (__c_get_clock_tick_rate())
 
 clock_t clock(void);
 
+typedef int clockid_t;
+
+#define CLOCK_MONOTONIC 1
+
+//time since boot, without a system call when the cpu has a time stamp counter
+int clock_gettime(clockid_t clock_id, struct timespec* tp);
+
 time_t mktime(struct tm* timeptr);
 
 time_t time(time_t* timer);
@@ -44,6 +57,9 @@ char* ctime (const time_t * timer);
 
 struct tm* localtime(const time_t* timer);
 
+//nothing can interrupt a sleep, so rem is always set to 0
+int nanosleep(const struct timespec* req, struct timespec* rem);
+
 #ifdef __cplusplus
 }
 #endif
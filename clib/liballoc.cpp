@@ -733,4 +733,19 @@ void* heap_allocator::realloc_bytes(void* p, size_t size)
 	free_bytes(p);
 
 	return (void*)new_block;
+}
+
+size_t heap_allocator::usable_size(void* p)
+{
+	uintptr_t ptr = UNALIGN((uintptr_t)p, m_alignment);
+
+	lock();
+
+	minor_block* min = (minor_block*)((uintptr_t)ptr - sizeof(minor_block));
+
+	size_t size = (min->magic == LIBALLOC_MAGIC) ? min->req_size : 0;
+
+	unlock();
+
+	return size;
 }
\ No newline at end of file
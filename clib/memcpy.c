@@ -0,0 +1,426 @@
+#define __STRING_NO_INLINE
+#include <string.h>
+#include <stdbool.h>
+#include <common/cpuid.h>
+#if !defined(__KERNEL) && !defined(__STRING_CPUID)
+#include <common/system_page.h>
+#endif
+
+//memcpy and memset pick how to do it from the size and what the cpu has
+//up to 16 bytes is a few loads and stores without a loop, past that it's rep movsd, which every x86 has,
+//or rep movsb on cpus with enhanced rep movsb (ERMS) where the microcode does better than any loop of ours
+//without ERMS, programs get SSE2 non-temporal stores for copies bigger than the caches, which is most of what
+//goes to a framebuffer, and MMX on the cpus old enough to have it without SSE2, where rep movsd is slow
+//in between rep movsd is as fast as an SSE2 loop on everything that has SSE2
+//the kernel doesn't save its own MMX and SSE registers, so it never uses them
+//every loop that touches memory is inline assembly, a loop the compiler can see into could be turned back into a call to memcpy
+
+//below this rep movsb is still getting going
+#define ERMS_SIZE 128
+#define MMX_SIZE 256
+//about as big as the L2 cache of the cpus that have SSE2
+#define NON_TEMPORAL_SIZE (256 * 1024)
+
+#define SSE2 __attribute__((target("sse2")))
+
+#define FEATURES_UNKNOWN 0x80000000
+
+typedef uint32_t unaligned_u32 __attribute__((may_alias, aligned(1)));
+
+static uint32_t detected_features = FEATURES_UNKNOWN;
+static uint32_t current_features = 0;
+
+//on more than one cpu it can be worked out twice, which does no harm
+static uint32_t features(void)
+{
+	if(detected_features == FEATURES_UNKNOWN)
+	{
+		uint32_t found = 0;
+
+#if defined(__KERNEL)
+		if(cpu_detect_features() & CPU_FEATURE_ERMS)
+		{
+			found |= STRING_ERMS;
+		}
+#elif defined(__STRING_CPUID)
+		//built to run on another OS, which saves the MMX and SSE registers itself, so cpuid is enough
+		const uint32_t cpu = cpu_detect_features();
+
+		if(cpu & CPU_FEATURE_ERMS) { found |= STRING_ERMS; }
+		if(cpu & CPU_FEATURE_MMX) { found |= STRING_MMX; }
+		if(cpu & CPU_FEATURE_SSE2) { found |= STRING_SSE2; }
+#else
+		//the kernel only sets the MMX and SSE2 bits when it saves those registers for us
+		const uint32_t system = SYSTEM_PAGE->features;
+
+		if(system & SYSTEM_FEATURE_ERMS) { found |= STRING_ERMS; }
+		if(system & SYSTEM_FEATURE_MMX) { found |= STRING_MMX; }
+		if(system & SYSTEM_FEATURE_SSE2) { found |= STRING_SSE2; }
+#endif
+
+		current_features = found;
+		detected_features = found;
+	}
+
+	return current_features;
+}
+
+uint32_t string_features(void)
+{
+	return features();
+}
+
+void string_force_features(uint32_t mask)
+{
+	features();
+	current_features = detected_features & mask;
+}
+
+//everything is loaded before anything is stored, so it doesn't matter if they overlap
+static inline void copy_small(uint8_t* dst, const uint8_t* src, size_t num)
+{
+	if(num >= 8)
+	{
+		const uint32_t a = *(const unaligned_u32*)src;
+		const uint32_t b = *(const unaligned_u32*)(src + 4);
+		const uint32_t c = *(const unaligned_u32*)(src + num - 8);
+		const uint32_t d = *(const unaligned_u32*)(src + num - 4);
+		*(unaligned_u32*)dst = a;
+		*(unaligned_u32*)(dst + 4) = b;
+		*(unaligned_u32*)(dst + num - 8) = c;
+		*(unaligned_u32*)(dst + num - 4) = d;
+	}
+	else if(num >= 4)
+	{
+		const uint32_t a = *(const unaligned_u32*)src;
+		const uint32_t d = *(const unaligned_u32*)(src + num - 4);
+		*(unaligned_u32*)dst = a;
+		*(unaligned_u32*)(dst + num - 4) = d;
+	}
+	else if(num)
+	{
+		const uint8_t a = src[0];
+		const uint8_t b = src[num / 2];
+		const uint8_t c = src[num - 1];
+		dst[0] = a;
+		dst[num / 2] = b;
+		dst[num - 1] = c;
+	}
+}
+
+//misaligned stores cost more than misaligned loads, so the destination is lined up first
+static inline void copy_dwords(uint8_t* dst, const uint8_t* src, size_t num)
+{
+	size_t head = (0 - (uintptr_t)dst) & 3;
+
+	if(head > num)
+	{
+		head = num;
+	}
+
+	__asm__ volatile("cld\n"
+					 "rep movsb\n"
+					 "mov %[rest], %%ecx\n"
+					 "shr $2, %%ecx\n"
+					 "rep movsl\n"
+					 "mov %[rest], %%ecx\n"
+					 "and $3, %%ecx\n"
+					 "rep movsb"
+					 : "+D"(dst), "+S"(src), "+c"(head)
+					 : [rest]"r"(num - head)
+					 : "cc", "memory");
+}
+
+static inline void copy_erms(uint8_t* dst, const uint8_t* src, size_t num)
+{
+	__asm__ volatile("cld\n"
+					 "rep movsb"
+					 : "+D"(dst), "+S"(src), "+c"(num)
+					 :: "cc", "memory");
+}
+
+#ifndef __KERNEL
+static void copy_mmx(uint8_t* dst, const uint8_t* src, size_t num)
+{
+	const size_t head = (0 - (uintptr_t)dst) & 7;
+	copy_dwords(dst, src, head);
+	dst += head;
+	src += head;
+	num -= head;
+
+	for(; num >= 64; num -= 64, dst += 64, src += 64)
+	{
+		__asm__ volatile("movq (%1), %%mm0\n"
+						 "movq 8(%1), %%mm1\n"
+						 "movq 16(%1), %%mm2\n"
+						 "movq 24(%1), %%mm3\n"
+						 "movq 32(%1), %%mm4\n"
+						 "movq 40(%1), %%mm5\n"
+						 "movq 48(%1), %%mm6\n"
+						 "movq 56(%1), %%mm7\n"
+						 "movq %%mm0, (%0)\n"
+						 "movq %%mm1, 8(%0)\n"
+						 "movq %%mm2, 16(%0)\n"
+						 "movq %%mm3, 24(%0)\n"
+						 "movq %%mm4, 32(%0)\n"
+						 "movq %%mm5, 40(%0)\n"
+						 "movq %%mm6, 48(%0)\n"
+						 "movq %%mm7, 56(%0)"
+						 :: "r"(dst), "r"(src) : "memory");
+	}
+
+	__asm__ volatile("emms");
+
+	copy_dwords(dst, src, num);
+}
+
+//only for copies too big for the caches, so the stores go around them
+SSE2 static void copy_sse2(uint8_t* dst, const uint8_t* src, size_t num)
+{
+	const size_t head = (0 - (uintptr_t)dst) & 15;
+	copy_dwords(dst, src, head);
+	dst += head;
+	src += head;
+	num -= head;
+
+	for(; num >= 64; num -= 64, dst += 64, src += 64)
+	{
+		__asm__ volatile("prefetchnta 256(%1)\n"
+						 "movdqu (%1), %%xmm0\n"
+						 "movdqu 16(%1), %%xmm1\n"
+						 "movdqu 32(%1), %%xmm2\n"
+						 "movdqu 48(%1), %%xmm3\n"
+						 "movntdq %%xmm0, (%0)\n"
+						 "movntdq %%xmm1, 16(%0)\n"
+						 "movntdq %%xmm2, 32(%0)\n"
+						 "movntdq %%xmm3, 48(%0)"
+						 :: "r"(dst), "r"(src) : "memory", "xmm0", "xmm1", "xmm2", "xmm3");
+	}
+
+	//non-temporal stores aren't ordered with the rest
+	__asm__ volatile("sfence" ::: "memory");
+
+	copy_dwords(dst, src, num);
+}
+#endif
+
+//always copies forwards, memmove counts on that when the destination is below the source
+void* memcpy(void* dest, const void* src, size_t num)
+{
+	uint8_t* dst = (uint8_t*)dest;
+	const uint8_t* s = (const uint8_t*)src;
+
+	if(num <= 16)
+	{
+		copy_small(dst, s, num);
+		return dest;
+	}
+
+	const uint32_t use = features();
+
+	if((use & STRING_ERMS) && num >= ERMS_SIZE)
+	{
+		copy_erms(dst, s, num);
+		return dest;
+	}
+
+#ifndef __KERNEL
+	if((use & STRING_SSE2) && num >= NON_TEMPORAL_SIZE)
+	{
+		copy_sse2(dst, s, num);
+		return dest;
+	}
+
+	if((use & STRING_MMX) && !(use & STRING_SSE2) && num >= MMX_SIZE)
+	{
+		copy_mmx(dst, s, num);
+		return dest;
+	}
+#endif
+
+	copy_dwords(dst, s, num);
+	return dest;
+}
+
+void* __memcpy(void* dest, const void* src, size_t num)
+{
+	return memcpy(dest, src, num);
+}
+
+static inline void set_small(uint8_t* dst, uint32_t v, size_t num)
+{
+	if(num >= 8)
+	{
+		*(unaligned_u32*)dst = v;
+		*(unaligned_u32*)(dst + 4) = v;
+		*(unaligned_u32*)(dst + num - 8) = v;
+		*(unaligned_u32*)(dst + num - 4) = v;
+	}
+	else if(num >= 4)
+	{
+		*(unaligned_u32*)dst = v;
+		*(unaligned_u32*)(dst + num - 4) = v;
+	}
+	else if(num)
+	{
+		dst[0] = (uint8_t)v;
+		dst[num / 2] = (uint8_t)v;
+		dst[num - 1] = (uint8_t)v;
+	}
+}
+
+static inline void set_dwords(uint8_t* dst, uint32_t v, size_t num)
+{
+	size_t head = (0 - (uintptr_t)dst) & 3;
+
+	if(head > num)
+	{
+		head = num;
+	}
+
+	__asm__ volatile("cld\n"
+					 "rep stosb\n"
+					 "mov %[rest], %%ecx\n"
+					 "shr $2, %%ecx\n"
+					 "rep stosl\n"
+					 "mov %[rest], %%ecx\n"
+					 "and $3, %%ecx\n"
+					 "rep stosb"
+					 : "+D"(dst), "+c"(head)
+					 : "a"(v), [rest]"r"(num - head)
+					 : "cc", "memory");
+}
+
+static inline void set_erms(uint8_t* dst, uint32_t v, size_t num)
+{
+	__asm__ volatile("cld\n"
+					 "rep stosb"
+					 : "+D"(dst), "+c"(num)
+					 : "a"(v)
+					 : "cc", "memory");
+}
+
+#ifndef __KERNEL
+static void set_mmx(uint8_t* dst, uint32_t v, size_t num)
+{
+	const size_t head = (0 - (uintptr_t)dst) & 7;
+	set_dwords(dst, v, head);
+	dst += head;
+	num -= head;
+
+	__asm__ volatile("movd %0, %%mm0\n"
+					 "punpckldq %%mm0, %%mm0"
+					 :: "r"(v));
+
+	for(; num >= 64; num -= 64, dst += 64)
+	{
+		__asm__ volatile("movq %%mm0, (%0)\n"
+						 "movq %%mm0, 8(%0)\n"
+						 "movq %%mm0, 16(%0)\n"
+						 "movq %%mm0, 24(%0)\n"
+						 "movq %%mm0, 32(%0)\n"
+						 "movq %%mm0, 40(%0)\n"
+						 "movq %%mm0, 48(%0)\n"
+						 "movq %%mm0, 56(%0)"
+						 :: "r"(dst) : "memory");
+	}
+
+	__asm__ volatile("emms");
+
+	set_dwords(dst, v, num);
+}
+
+SSE2 static void set_sse2(uint8_t* dst, uint32_t v, size_t num)
+{
+	const size_t head = (0 - (uintptr_t)dst) & 15;
+	set_dwords(dst, v, head);
+	dst += head;
+	num -= head;
+
+	__asm__ volatile("movd %0, %%xmm0\n"
+					 "pshufd $0, %%xmm0, %%xmm0"
+					 :: "r"(v) : "xmm0");
+
+	for(; num >= 64; num -= 64, dst += 64)
+	{
+		__asm__ volatile("movntdq %%xmm0, (%0)\n"
+						 "movntdq %%xmm0, 16(%0)\n"
+						 "movntdq %%xmm0, 32(%0)\n"
+						 "movntdq %%xmm0, 48(%0)"
+						 :: "r"(dst) : "memory");
+	}
+
+	__asm__ volatile("sfence" ::: "memory");
+
+	set_dwords(dst, v, num);
+}
+#endif
+
+void* memset(void* ptr, int value, size_t num)
+{
+	uint8_t* dst = (uint8_t*)ptr;
+	const uint32_t v = (uint32_t)(uint8_t)value * 0x01010101u;
+
+	if(num <= 16)
+	{
+		set_small(dst, v, num);
+		return ptr;
+	}
+
+	const uint32_t use = features();
+
+	if((use & STRING_ERMS) && num >= ERMS_SIZE)
+	{
+		set_erms(dst, v, num);
+		return ptr;
+	}
+
+#ifndef __KERNEL
+	if((use & STRING_SSE2) && num >= NON_TEMPORAL_SIZE)
+	{
+		set_sse2(dst, v, num);
+		return ptr;
+	}
+
+	if((use & STRING_MMX) && !(use & STRING_SSE2) && num >= MMX_SIZE)
+	{
+		set_mmx(dst, v, num);
+		return ptr;
+	}
+#endif
+
+	set_dwords(dst, v, num);
+	return ptr;
+}
+
+void* __memset(void* ptr, int value, size_t num)
+{
+	return memset(ptr, value, num);
+}
+
+void* memmove(void* dest, const void* src, size_t num)
+{
+	//forwards is fine unless the destination starts inside the source
+	if((uintptr_t)dest - (uintptr_t)src >= num)
+	{
+		return memcpy(dest, src, num);
+	}
+
+	//backwards from the last byte, the odd bytes at the end first and then dwords
+	uint8_t* dst = (uint8_t*)dest + num - 1;
+	const uint8_t* s = (const uint8_t*)src + num - 1;
+	size_t tail = num & 3;
+
+	__asm__ volatile("std\n"
+					 "rep movsb\n"
+					 "sub $3, %%esi\n"
+					 "sub $3, %%edi\n"
+					 "mov %[dwords], %%ecx\n"
+					 "rep movsl\n"
+					 "cld"
+					 : "+D"(dst), "+S"(s), "+c"(tail)
+					 : [dwords]"r"(num >> 2)
+					 : "cc", "memory");
+
+	return dest;
+}
\ No newline at end of file
@@ -0,0 +1,321 @@
+#include <slab.h>
+
+//found at the start of every slab page, objects follow it
+struct __attribute__((visibility("hidden"))) slab_header
+{
+	slab_cache* cache;
+	slab_header* prev;
+	slab_header* next;
+	void* free_list;		//objects that were freed, linked through their first word
+	uint16_t in_use;
+	uint16_t capacity;
+	uint16_t next_unused;	//objects past this were never handed out, so the page isn't touched till needed
+};
+
+static constexpr size_t slab_data_offset = (sizeof(slab_header) + 15) & ~15;
+
+static_assert(slab_data_offset + slab_allocator::max_size <= slab_allocator::page_size);
+
+[[nodiscard]] static inline slab_header* get_slab(const void* p)
+{
+	return (slab_header*)((uintptr_t)p & ~(slab_allocator::page_size - 1));
+}
+
+static inline bool slab_full(const slab_header* s)
+{
+	return s->free_list == nullptr && s->next_unused == s->capacity;
+}
+
+static void slab_unlink(slab_header*& list, slab_header* s)
+{
+	if(s->prev) { s->prev->next = s->next; }
+	else { list = s->next; }
+
+	if(s->next) { s->next->prev = s->prev; }
+
+	s->prev = s->next = nullptr;
+}
+
+static void slab_push(slab_header*& list, slab_header* s)
+{
+	s->prev = nullptr;
+	s->next = list;
+
+	if(list) { list->prev = s; }
+
+	list = s;
+}
+
+//maps a request size to its size class in O(1)
+static constexpr auto size_class_table = []() {
+	constexpr size_t sizes[] = {8, 16, 24, 32, 48, 64, 96, 128, 192, 256, 384, 512};
+
+	struct { uint8_t index[slab_allocator::max_size / slab_cache::granularity + 1]; } table{};
+
+	size_t c = 0;
+	for(size_t i = 0; i < sizeof(table.index); i++)
+	{
+		while(sizes[c] < i * slab_cache::granularity) { c++; }
+		table.index[i] = (uint8_t)c;
+	}
+	return table;
+}();
+
+bool slab_allocator::owns(const void* p) const
+{
+	return m_page_map.test(p);
+}
+
+slab_header* slab_allocator::new_slab(slab_cache& cache)
+{
+	slab_header* s = (slab_header*)sys_alloc_pages(1);
+
+	if(!s) { return nullptr; }
+
+	if(!m_page_map.set(s, true, [this]() { return sys_alloc_pages(1); }))
+	{
+		sys_free_pages(s, 1);
+		return nullptr;
+	}
+
+	s->cache = &cache;
+	s->prev = s->next = nullptr;
+	s->free_list = nullptr;
+	s->in_use = 0;
+	s->capacity = (uint16_t)((page_size - slab_data_offset) / cache.m_object_size);
+	s->next_unused = 0;
+
+	cache.m_pages++;
+	return s;
+}
+
+void slab_allocator::release_slab(slab_header* s)
+{
+	s->cache->m_pages--;
+	m_page_map.set(s, false, [this]() { return sys_alloc_pages(1); });
+	sys_free_pages(s, 1);
+}
+
+//how many objects a thread cache takes or gives back at once, about 1 KiB of them
+static size_t batch_size(const slab_cache& cache)
+{
+	const size_t n = 1024 / cache.object_size();
+	return n < 4 ? 4 : (n > 32 ? 32 : n);
+}
+
+static inline size_t class_index(size_t size)
+{
+	return size_class_table.index[(size + slab_cache::granularity - 1) / slab_cache::granularity];
+}
+
+void* slab_allocator::alloc_locked(slab_cache& cache)
+{
+	slab_header* s = cache.m_partial;
+
+	if(!s)
+	{
+		if(cache.m_empty)
+		{
+			s = cache.m_empty;
+			cache.m_empty = nullptr;
+		}
+		else if(!(s = new_slab(cache)))
+		{
+			return nullptr;
+		}
+
+		slab_push(cache.m_partial, s);
+	}
+
+	void* obj;
+
+	if(s->free_list)
+	{
+		obj = s->free_list;
+		s->free_list = *(void**)obj;
+	}
+	else
+	{
+		obj = (uint8_t*)s + slab_data_offset + s->next_unused * cache.m_object_size;
+		s->next_unused++;
+	}
+
+	s->in_use++;
+	cache.m_in_use++;
+
+	if(slab_full(s))
+	{
+		slab_unlink(cache.m_partial, s);
+	}
+
+	return obj;
+}
+
+void* slab_allocator::alloc_object(slab_cache& cache)
+{
+	lock();
+	void* obj = alloc_locked(cache);
+	unlock();
+
+	return obj;
+}
+
+void* slab_allocator::alloc_bytes(size_t size)
+{
+	if(size > max_size) { return nullptr; }
+
+	return alloc_object(m_classes[class_index(size)]);
+}
+
+void slab_allocator::free_locked(void* p)
+{
+	slab_header* s = get_slab(p);
+	slab_cache& cache = *s->cache;
+
+	bool was_full = slab_full(s);
+
+	*(void**)p = s->free_list;
+	s->free_list = p;
+	s->in_use--;
+	cache.m_in_use--;
+
+	if(was_full)
+	{
+		slab_push(cache.m_partial, s);
+	}
+
+	if(s->in_use == 0)
+	{
+		slab_unlink(cache.m_partial, s);
+
+		//start over from a clean page next time it's used
+		s->free_list = nullptr;
+		s->next_unused = 0;
+
+		if(!cache.m_empty)
+		{
+			cache.m_empty = s;
+		}
+		else
+		{
+			release_slab(s);
+		}
+	}
+}
+
+void slab_allocator::free_bytes(void* p)
+{
+	lock();
+	free_locked(p);
+	unlock();
+}
+
+void slab_allocator::refill(slab_thread_cache& tc, size_t c)
+{
+	slab_cache& cache = m_classes[c];
+
+	lock();
+
+	for(size_t i = batch_size(cache); i > 0; i--)
+	{
+		void* obj = alloc_locked(cache);
+
+		if(!obj) { break; }
+
+		*(void**)obj = tc.objects[c];
+		tc.objects[c] = obj;
+		tc.count[c]++;
+	}
+
+	unlock();
+}
+
+void slab_allocator::give_back(slab_thread_cache& tc, size_t c, size_t count)
+{
+	lock();
+
+	for(; count > 0; count--)
+	{
+		void* obj = tc.objects[c];
+		tc.objects[c] = *(void**)obj;
+		tc.count[c]--;
+
+		free_locked(obj);
+	}
+
+	unlock();
+}
+
+void* slab_allocator::alloc_bytes(size_t size, slab_thread_cache& tc)
+{
+	if(size > max_size) { return nullptr; }
+
+	const size_t c = class_index(size);
+
+	if(!tc.objects[c])
+	{
+		refill(tc, c);
+
+		if(!tc.objects[c]) { return nullptr; }
+	}
+
+	void* obj = tc.objects[c];
+	tc.objects[c] = *(void**)obj;
+	tc.count[c]--;
+
+	return obj;
+}
+
+void slab_allocator::free_bytes(void* p, slab_thread_cache& tc)
+{
+	const size_t c = ((uintptr_t)get_slab(p)->cache - (uintptr_t)m_classes) / sizeof(slab_cache);
+
+	//objects from dedicated caches don't have a size class
+	if(c >= num_classes)
+	{
+		return free_bytes(p);
+	}
+
+	*(void**)p = tc.objects[c];
+	tc.objects[c] = p;
+	tc.count[c]++;
+
+	//keep a batch for the next allocations and give the rest back
+	const size_t batch = batch_size(m_classes[c]);
+
+	if(tc.count[c] >= batch * 2)
+	{
+		give_back(tc, c, tc.count[c] - batch);
+	}
+}
+
+void slab_allocator::drain(slab_thread_cache& tc)
+{
+	for(size_t c = 0; c < num_classes; c++)
+	{
+		if(tc.count[c])
+		{
+			give_back(tc, c, tc.count[c]);
+		}
+	}
+}
+
+size_t slab_allocator::usable_size(const void* p) const
+{
+	return get_slab(p)->cache->m_object_size;
+}
+
+void slab_allocator::get_usage(size_t* allocated, size_t* in_use) const
+{
+	size_t pages = 0;
+	size_t used = 0;
+
+	for(const slab_cache& c : m_classes)
+	{
+		pages += c.m_pages;
+		used += c.m_in_use * c.m_object_size;
+	}
+
+	*allocated = pages * page_size;
+	*in_use = used;
+}
\ No newline at end of file
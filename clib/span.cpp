@@ -0,0 +1,229 @@
+#include <span.h>
+
+//found at the start of every span, the allocation follows it
+struct __attribute__((visibility("hidden"))) span_header
+{
+	size_t pages;
+	size_t size;
+	size_t reserved[2]; //keeps the allocation 16 byte aligned
+};
+
+[[nodiscard]] static inline span_header* get_span(const void* p)
+{
+	return (span_header*)((uintptr_t)p - sizeof(span_header));
+}
+
+static inline size_t span_pages(size_t size)
+{
+	return (size + sizeof(span_header) + span_allocator::page_size - 1) / span_allocator::page_size;
+}
+
+void span_allocator::remove_free_span(size_t index)
+{
+	m_free_spans[index] = m_free_spans[--m_num_free_spans];
+}
+
+//best fit from the free spans, splitting off the front of a bigger one
+uintptr_t span_allocator::take_free_span(size_t pages)
+{
+	size_t best = max_free_spans;
+
+	for(size_t i = 0; i < m_num_free_spans; i++)
+	{
+		if(m_free_spans[i].pages >= pages && 
+		   (best == max_free_spans || m_free_spans[i].pages < m_free_spans[best].pages))
+		{
+			best = i;
+		}
+	}
+
+	if(best == max_free_spans) { return 0; }
+
+	free_span& s = m_free_spans[best];
+	uintptr_t address = s.address;
+
+	s.address += pages * page_size;
+	s.pages -= pages;
+
+	if(s.pages == 0) { remove_free_span(best); }
+
+	return address;
+}
+
+bool span_allocator::take_free_span_at(uintptr_t address, size_t pages)
+{
+	for(size_t i = 0; i < m_num_free_spans; i++)
+	{
+		free_span& s = m_free_spans[i];
+
+		if(s.address == address && s.pages >= pages)
+		{
+			s.address += pages * page_size;
+			s.pages -= pages;
+
+			if(s.pages == 0) { remove_free_span(i); }
+
+			return true;
+		}
+	}
+
+	return false;
+}
+
+void span_allocator::give_free_span(uintptr_t address, size_t pages)
+{
+	//the memory goes back to the system now, the addresses stay ours
+	sys_discard_pages((void*)address, pages);
+
+	//merge with the neighbours on both sides
+	for(size_t i = 0; i < m_num_free_spans;)
+	{
+		free_span& s = m_free_spans[i];
+
+		if(s.address + s.pages * page_size == address)
+		{
+			address = s.address;
+			pages += s.pages;
+			remove_free_span(i);
+		}
+		else if(address + pages * page_size == s.address)
+		{
+			pages += s.pages;
+			remove_free_span(i);
+		}
+		else
+		{
+			i++;
+		}
+	}
+
+	if(m_num_free_spans == max_free_spans)
+	{
+		//no room left, unmap whichever span is biggest
+		size_t biggest = 0;
+		for(size_t i = 1; i < m_num_free_spans; i++)
+		{
+			if(m_free_spans[i].pages > m_free_spans[biggest].pages) { biggest = i; }
+		}
+
+		if(m_free_spans[biggest].pages <= pages)
+		{
+			sys_free_pages((void*)address, pages);
+			return;
+		}
+
+		sys_free_pages((void*)m_free_spans[biggest].address, m_free_spans[biggest].pages);
+		remove_free_span(biggest);
+	}
+
+	m_free_spans[m_num_free_spans++] = {address, pages};
+}
+
+void* span_allocator::alloc_bytes(size_t size)
+{
+	if(size > ~(size_t)0 - page_size - sizeof(span_header)) { return nullptr; }
+
+	const size_t pages = span_pages(size);
+
+	lock();
+
+	span_header* span = (span_header*)take_free_span(pages);
+
+	if(!span && !(span = (span_header*)sys_alloc_pages(nullptr, pages)))
+	{
+		unlock();
+		return nullptr;
+	}
+
+	if(!m_page_map.set(span, true, [this]() { return sys_alloc_pages(nullptr, 1); }))
+	{
+		give_free_span((uintptr_t)span, pages);
+		unlock();
+		return nullptr;
+	}
+
+	span->pages = pages;
+	span->size = size;
+
+	m_pages += pages;
+	m_in_use += size;
+
+	unlock();
+	return span + 1;
+}
+
+void span_allocator::free_bytes(void* p)
+{
+	span_header* span = get_span(p);
+
+	lock();
+
+	m_pages -= span->pages;
+	m_in_use -= span->size;
+
+	m_page_map.set(span, false, [this]() { return sys_alloc_pages(nullptr, 1); });
+	give_free_span((uintptr_t)span, span->pages);
+
+	unlock();
+}
+
+bool span_allocator::resize_bytes(void* p, size_t size)
+{
+	if(size > ~(size_t)0 - page_size - sizeof(span_header)) { return false; }
+
+	span_header* span = get_span(p);
+
+	const size_t pages = span_pages(size);
+
+	lock();
+
+	if(pages < span->pages)
+	{
+		give_free_span((uintptr_t)span + pages * page_size, span->pages - pages);
+	}
+	else if(pages > span->pages)
+	{
+		const uintptr_t next = (uintptr_t)span + span->pages * page_size;
+		const size_t extra = pages - span->pages;
+
+		//either the span after us is free, or nothing is mapped there yet
+		if(!take_free_span_at(next, extra))
+		{
+			void* grown = sys_alloc_pages((void*)next, extra);
+
+			if(grown != (void*)next)
+			{
+				if(grown) { sys_free_pages(grown, extra); }
+
+				unlock();
+				return false;
+			}
+		}
+	}
+
+	m_pages += pages - span->pages;
+	m_in_use += size - span->size;
+
+	span->pages = pages;
+	span->size = size;
+
+	unlock();
+	return true;
+}
+
+bool span_allocator::owns(const void* p) const
+{
+	return ((uintptr_t)p & (page_size - 1)) == sizeof(span_header) && m_page_map.test(p);
+}
+
+size_t span_allocator::usable_size(const void* p) const
+{
+	const span_header* span = get_span(p);
+	return span->pages * page_size - sizeof(span_header);
+}
+
+void span_allocator::get_usage(size_t* allocated, size_t* in_use) const
+{
+	*allocated = m_pages * page_size;
+	*in_use = m_in_use;
+}
\ No newline at end of file
@@ -2,314 +2,474 @@
 #include <stdlib.h>
 #include <string.h>
 #include <stdint.h>
+#include <stdbool.h>
 
 #ifndef __KERNEL
 #include <sys/syscalls.h>
+#include <threads.h>
 #else
 #include <kernel/sys/syscalls.h>
 #endif
 
-#define		PR_LJ	0x01	// left justify */
-#define		PR_CA	0x02	// use A-F instead of a-f for hex */
-#define		PR_SG	0x04	// signed numeric conversion (%d vs. %u) */
-#define		PR_32	0x08	// long (32-bit) numeric conversion */
-#define		PR_16	0x10	// short (16-bit) numeric conversion */
-#define		PR_WS	0x20	// PR_SG set and num was < 0 */
-#define		PR_LZ	0x40	// pad left with '0' instead of ' ' */
-#define		PR_FP	0x80	// pointers are far */
+#ifdef __KERNEL
+static FILE* stdout = NULL;
 
-/* largest number handled is 2^32-1, lowest radix handled is 8.
-2^32-1 in base 8 has 11 digits (add 5 for trailing NUL and for slop) */
-#define		PR_BUFLEN	16
+void file_write(const char* buf, size_t size, FILE* f)
+{
+	print_string_len(buf, size);
+}
 
-#ifndef __KERNEL
+int putchar(int character)
+{
+	char c = (char)character;
+	
+	file_write(&c, 1, stdout);
 
-struct FILE
+	return character;
+}
+#endif
+
+//printf formatting is one pass over the format string
+//text between conversions is copied in one go, numbers are converted two digits at a time from a table,
+//and 64 bit numbers are split into 32 bit pieces first since 64 bit division is a library call here
+//nothing is allocated, %n and positional arguments aren't supported
+
+#define FMT_LEFT	0x01 //'-' pad on the right
+#define FMT_ZERO	0x02 //'0' pad with zeros after the sign
+#define FMT_PLUS	0x04 //'+' always give a sign
+#define FMT_SPACE	0x08 //' ' a space where a + would be
+#define FMT_ALT		0x10 //'#' 0x in front of hex, 0 in front of octal
+#define FMT_PREC	0x20 //a precision was given
+
+enum format_length
 {
-	void* impl_ptr;
-	void (*write)(const char* buf, size_t size, void* impl);
-	void (*read)(char* buf, size_t size, void* impl);
-	void (*close)(void* impl);
+	LENGTH_INT,
+	LENGTH_CHAR,
+	LENGTH_SHORT,
+	LENGTH_LONG,
+	LENGTH_LONG_LONG
 };
 
-static FILE m_stdout = {NULL, NULL, NULL};
+//big enough for a 64 bit number in octal
+#define FMT_DIGITS_MAX 24
 
-static FILE* stdout = &m_stdout;
+static const char digit_pairs[201] =
+	"00010203040506070809"
+	"10111213141516171819"
+	"20212223242526272829"
+	"30313233343536373839"
+	"40414243444546474849"
+	"50515253545556575859"
+	"60616263646566676869"
+	"70717273747576777879"
+	"80818283848586878889"
+	"90919293949596979899";
 
-void set_stdout(void (*write)(const char* buf, size_t size, void* impl))
+static const char lower_digits[] = "0123456789abcdef";
+static const char upper_digits[] = "0123456789ABCDEF";
+
+//where the output goes, count keeps going past the end since vsnprintf returns the whole length
+struct format_out
 {
-	stdout->write = write;
+	char* ptr;
+	char* end; //the last byte of the buffer, kept for the terminator
+	size_t count;
+};
+
+static inline void out_chars(struct format_out* out, const char* str, size_t len)
+{
+	const size_t room = out->end - out->ptr;
+	const size_t n = (len < room) ? len : room;
+
+	memcpy(out->ptr, str, n);
+	out->ptr += n;
+	out->count += len;
+}
+
+static inline void out_repeat(struct format_out* out, char c, size_t len)
+{
+	const size_t room = out->end - out->ptr;
+	const size_t n = (len < room) ? len : room;
+
+	memset(out->ptr, c, n);
+	out->ptr += n;
+	out->count += len;
 }
 
-static void file_write(const char* buf, size_t size, FILE* f)
+//the digits are written backwards ending at end, these return where they start
+static char* format_dec32(uint32_t value, char* end)
 {
-	if(f != NULL && f->write != NULL)
+	while(value >= 100)
+	{
+		const uint32_t pair = (value % 100) * 2;
+		value /= 100;
+
+		end -= 2;
+		end[0] = digit_pairs[pair];
+		end[1] = digit_pairs[pair + 1];
+	}
+
+	if(value >= 10)
+	{
+		end -= 2;
+		end[0] = digit_pairs[value * 2];
+		end[1] = digit_pairs[value * 2 + 1];
+	}
+	else
 	{
-		f->write(buf, size, f->impl_ptr);
+		*--end = (char)('0' + value);
 	}
+
+	return end;
 }
-#else
-static FILE* stdout = NULL;
 
-void file_write(const char* buf, size_t size, FILE* f)
+static char* format_dec64(uint64_t value, char* end)
 {
-	print_string_len(buf, size);
+	//the low nine digits at a time, so there's a 64 bit division at most twice
+	while(value > UINT32_MAX)
+	{
+		const uint32_t low = (uint32_t)(value % 1000000000);
+		value /= 1000000000;
+
+		char* start = format_dec32(low, end);
+
+		while(start > end - 9)
+		{
+			*--start = '0';
+		}
+
+		end = start;
+	}
+
+	return format_dec32((uint32_t)value, end);
 }
-#endif
 
-int putchar(int character)
+//hex and octal are shifts, no division needed
+static char* format_pow2(uint64_t value, char* end, unsigned int shift, const char* digits)
 {
-	char c = (char)character;
-	
-	file_write(&c, 1, stdout);
+	const unsigned int mask = (1u << shift) - 1;
 
-	return character;
+	if(value <= UINT32_MAX)
+	{
+		uint32_t v = (uint32_t)value;
+
+		do
+		{
+			*--end = digits[v & mask];
+			v >>= shift;
+		} while(v);
+
+		return end;
+	}
+
+	do
+	{
+		*--end = digits[(uint32_t)value & mask];
+		value >>= shift;
+	} while(value);
+
+	return end;
 }
 
-#define WRITECHAR(c, m) if(count < (m - 1)) { *ptr++ = c; } count++;
+//sign or 0x, then zeros, then the digits, padded out to the width
+static void out_number(struct format_out* out, const char* prefix, size_t prefix_len,
+					   const char* digits, size_t num_digits, unsigned int flags, size_t width, size_t precision)
+{
+	size_t zeros = 0;
 
-int vsnprintf(char *buffer, size_t n, const char *fmt, va_list args)
+	if((flags & FMT_PREC) && precision > num_digits)
+	{
+		zeros = precision - num_digits;
+	}
+
+	size_t len = prefix_len + zeros + num_digits;
+	size_t pad = (width > len) ? width - len : 0;
+
+	//the zero flag is ignored when there's a precision, like everywhere else
+	if((flags & (FMT_ZERO | FMT_LEFT | FMT_PREC)) == FMT_ZERO)
+	{
+		zeros += pad;
+		pad = 0;
+	}
+
+	if(!(flags & FMT_LEFT) && pad)
+	{
+		out_repeat(out, ' ', pad);
+	}
+
+	out_chars(out, prefix, prefix_len);
+	out_repeat(out, '0', zeros);
+	out_chars(out, digits, num_digits);
+
+	if((flags & FMT_LEFT) && pad)
+	{
+		out_repeat(out, ' ', pad);
+	}
+}
+
+static void out_padded(struct format_out* out, const char* str, size_t len, unsigned int flags, size_t width)
 {
-	unsigned state = 0, flags = 0, radix = 0, actual_wd = 0, count = 0, given_wd = 0;
-	unsigned char* where = NULL;
-	unsigned char buf[PR_BUFLEN];
+	const size_t pad = (width > len) ? width - len : 0;
+
+	if(!(flags & FMT_LEFT) && pad)
+	{
+		out_repeat(out, ' ', pad);
+	}
+
+	out_chars(out, str, len);
+
+	if((flags & FMT_LEFT) && pad)
+	{
+		out_repeat(out, ' ', pad);
+	}
+}
 
-	char* ptr = buffer;
+int vsnprintf(char *buffer, size_t n, const char *fmt, va_list args)
+{
+	struct format_out out = {buffer, buffer + (n ? n - 1 : 0), 0};
 
-	for(; *fmt; fmt++) /* begin scanning format specifier list */
+	for(;;)
 	{
-		switch(state)
+		//plain text up to the next conversion
+		const char* text = fmt;
+
+		while(*fmt && *fmt != '%')
+		{
+			fmt++;
+		}
+
+		if(fmt != text)
 		{
-		case 0: /* STATE 0: AWAITING % */
-			if(*fmt != '%')	/* not %... */
+			out_chars(&out, text, fmt - text);
+		}
+
+		if(*fmt == '\0')
+		{
+			break;
+		}
+
+		fmt++;
+
+		unsigned int flags = 0;
+
+		for(;; fmt++)
+		{
+			if(*fmt == '-') { flags |= FMT_LEFT; }
+			else if(*fmt == '0') { flags |= FMT_ZERO; }
+			else if(*fmt == '+') { flags |= FMT_PLUS; }
+			else if(*fmt == ' ') { flags |= FMT_SPACE; }
+			else if(*fmt == '#') { flags |= FMT_ALT; }
+			else { break; }
+		}
+
+		size_t width = 0;
+
+		if(*fmt == '*')
+		{
+			const int w = va_arg(args, int);
+
+			if(w < 0)
+			{
+				flags |= FMT_LEFT;
+			}
+
+			width = (w < 0) ? -(unsigned int)w : (unsigned int)w;
+			fmt++;
+		}
+		else
+		{
+			while(*fmt >= '0' && *fmt <= '9')
 			{
-				WRITECHAR(*fmt, n);
-				break;
+				width = width * 10 + (*fmt++ - '0');
 			}
-			state++; /* found %, get next char and advance state to check if next char is a flag */
+		}
+
+		size_t precision = 0;
+
+		if(*fmt == '.')
+		{
+			flags |= FMT_PREC;
 			fmt++;
-			/* FALL THROUGH */
-		case 1: /* STATE 1: AWAITING FLAGS (%-0) */
-			if(*fmt == '%')	/* %% */
+
+			if(*fmt == '*')
 			{
-				WRITECHAR(*fmt, n);
-				state = flags = given_wd = 0;
-				break;
+				const int p = va_arg(args, int);
+
+				//a negative precision is the same as none
+				if(p < 0) { flags &= ~FMT_PREC; }
+				else { precision = p; }
+
+				fmt++;
 			}
-			else if(*fmt == '-')
+			else
 			{
-				if(flags & PR_LJ)/* %-- is illegal */
+				while(*fmt >= '0' && *fmt <= '9')
 				{
-					state = flags = given_wd = 0;
+					precision = precision * 10 + (*fmt++ - '0');
 				}
-				else
-				{
-					flags |= PR_LJ;
-				}
-				break;
 			}
-			state++; /* not a flag char: advance state to check if it's field width */
+		}
+
+		enum format_length length = LENGTH_INT;
+
+		for(;; fmt++)
+		{
+			if(*fmt == 'h') { length = (length == LENGTH_SHORT) ? LENGTH_CHAR : LENGTH_SHORT; }
+			else if(*fmt == 'l') { length = (length == LENGTH_LONG) ? LENGTH_LONG_LONG : LENGTH_LONG; }
+			else if(*fmt == 'j') { length = LENGTH_LONG_LONG; }
+			else if(*fmt == 'z' || *fmt == 't') { length = LENGTH_LONG; }
+			else if(*fmt == 'F' || *fmt == 'N') { } //far and near pointers, from the real mode days
+			else { break; }
+		}
+
+		char digits[FMT_DIGITS_MAX];
+		char* const digits_end = digits + FMT_DIGITS_MAX;
+		char* start;
+		const char* prefix = "";
+		size_t prefix_len = 0;
+
+		switch(*fmt)
+		{
+		case 'd':
+		case 'i':
+		{
+			int64_t value;
+
+			switch(length)
+			{
+			case LENGTH_LONG_LONG: value = va_arg(args, long long); break;
+			case LENGTH_LONG: value = va_arg(args, long); break;
+			case LENGTH_SHORT: value = (short)va_arg(args, int); break;
+			case LENGTH_CHAR: value = (signed char)va_arg(args, int); break;
+			default: value = va_arg(args, int); break;
+			}
 
-			if(*fmt == '0') /* check now for '%0...' */
+			const uint64_t magnitude = (value < 0) ? -(uint64_t)value : (uint64_t)value;
+
+			if(magnitude == 0 && (flags & FMT_PREC) && precision == 0)
 			{
-				flags |= PR_LZ;
-				fmt++;
+				start = digits_end;
 			}
-			/* FALL THROUGH */
-		case 2: /* STATE 2: AWAITING (NUMERIC) FIELD WIDTH */
-			if(*fmt >= '0' && *fmt <= '9')
+			else
 			{
-				given_wd = 10 * given_wd + (*fmt - '0');
-				break;
+				start = (magnitude <= UINT32_MAX) ? format_dec32((uint32_t)magnitude, digits_end)
+												  : format_dec64(magnitude, digits_end);
 			}
-			state++; /* not field width: advance state to check if it's a modifier */
-			/* FALL THROUGH */
-		case 3: /* STATE 3: AWAITING MODIFIER CHARS (FNlh) */
-			switch(*fmt)
+
+			if(value < 0) { prefix = "-"; prefix_len = 1; }
+			else if(flags & FMT_PLUS) { prefix = "+"; prefix_len = 1; }
+			else if(flags & FMT_SPACE) { prefix = " "; prefix_len = 1; }
+
+			out_number(&out, prefix, prefix_len, start, digits_end - start, flags, width, precision);
+			break;
+		}
+		case 'u':
+		case 'x':
+		case 'X':
+		case 'o':
+		case 'p':
+		{
+			uint64_t value;
+
+			if(*fmt == 'p')
 			{
-			case 'F':
-				flags |= PR_FP;
-				break;
-			case 'N':
-				break;
-			case 'l':
-				flags |= PR_32;
-				break;
-			case 'h':
-				flags |= PR_16;
-				break;
+				value = (uintptr_t)va_arg(args, void*);
 			}
-			state++; /* not modifier: advance state to check if it's a conversion char */
-			/* FALL THROUGH */
-		case 4: /* STATE 4: AWAITING CONVERSION CHARS (Xxpndiuocs) */
-			where = buf + PR_BUFLEN - 1;
-			*where = '\0';
-			switch(*fmt)
+			else
 			{
-			case 'X':
-				flags |= PR_CA;
-				/* FALL THROUGH */
-			case 'x': /* xxx - far pointers (%Fp, %Fn) not yet supported */
-			case 'p':
-			case 'n':
-				radix = 16;
-				goto DO_NUM;
-			case 'd':
-			case 'i':
-				flags |= PR_SG;
-				/* FALL THROUGH */
-			case 'u':
-				radix = 10;
-				goto DO_NUM;
-			case 'o':
-				radix = 8;
-DO_NUM:			/* load the value to be printed. l=long=32 bits: */
-				{
-					long num = 0;
-					if(flags & PR_32)
-					{
-						num = va_arg(args, unsigned long);
-					}
-					else if(flags & PR_16) /* h=short=16 bits (signed or unsigned) */
-					{
-						if(flags & PR_SG)
-						{
-							num = va_arg(args, int);
-						}
-						else
-						{
-							num = va_arg(args, unsigned int);
-						}
-					}
-					else /* no h nor l: sizeof(int) bits (signed or unsigned) */
-					{
-						if(flags & PR_SG)
-						{
-							num = va_arg(args, int);
-						}
-						else
-						{
-							num = va_arg(args, unsigned int);
-						}
-					}
-
-					if(flags & PR_SG) /* take care of sign */
-					{
-						if(num < 0)
-						{
-							flags |= PR_WS;
-							num = -num;
-						}
-					}
-
-					do /* convert binary to octal/decimal/hex ASCII. The math here is _always_ unsigned */
-					{
-						unsigned long temp;
-
-						temp = (unsigned long)num % radix;
-						where--;
-						if(temp < 10)
-						{
-							*where = temp + '0';
-						}
-						else if(flags & PR_CA)
-						{
-							*where = temp - 10 + 'A';
-						}
-						else
-						{
-							*where = temp - 10 + 'a';
-						}
-						num = (unsigned long)num / radix;
-					} while(num != 0);
-				}
-				goto EMIT;
-			case 'c':
-				flags &= ~PR_LZ; /* disallow pad-left-with-zeroes for %c */
-				where--;
-				*where = (unsigned char)va_arg(args, unsigned int);
-				actual_wd = 1;
-				goto EMIT2;
-			case 's':
-				flags &= ~PR_LZ; /* disallow pad-left-with-zeroes for %s */
-				where = va_arg(args, unsigned char *);
-EMIT:
-				actual_wd = strlen((char*)where);
-				if(flags & PR_WS)
+				switch(length)
 				{
-					actual_wd++;
+				case LENGTH_LONG_LONG: value = va_arg(args, unsigned long long); break;
+				case LENGTH_LONG: value = va_arg(args, unsigned long); break;
+				case LENGTH_SHORT: value = (unsigned short)va_arg(args, unsigned int); break;
+				case LENGTH_CHAR: value = (unsigned char)va_arg(args, unsigned int); break;
+				default: value = va_arg(args, unsigned int); break;
 				}
+			}
 
-				if((flags & (PR_WS | PR_LZ)) == (PR_WS | PR_LZ)) /* if we pad left with ZEROES, do the sign now */
-				{
-					WRITECHAR('-', n);
-				}
+			if(value == 0 && (flags & FMT_PREC) && precision == 0)
+			{
+				start = digits_end;
+			}
+			else if(*fmt == 'u')
+			{
+				start = (value <= UINT32_MAX) ? format_dec32((uint32_t)value, digits_end)
+											  : format_dec64(value, digits_end);
+			}
+			else if(*fmt == 'o')
+			{
+				start = format_pow2(value, digits_end, 3, lower_digits);
 
-EMIT2:			/* pad on left with spaces or zeroes (for right justify) */
-				if((flags & PR_LJ) == 0) 
+				if((flags & FMT_ALT) && *start != '0')
 				{
-					while(given_wd > actual_wd)
-					{
-						WRITECHAR(flags & PR_LZ ? '0' : ' ', n);
-						given_wd--;
-					}
+					prefix = "0";
+					prefix_len = 1;
 				}
+			}
+			else
+			{
+				start = format_pow2(value, digits_end, 4, (*fmt == 'X') ? upper_digits : lower_digits);
 
-				if((flags & (PR_WS | PR_LZ)) == PR_WS) /* if we pad left with SPACES, do the sign now */
+				if((flags & FMT_ALT) && value)
 				{
-					WRITECHAR('-', n);
+					prefix = (*fmt == 'X') ? "0X" : "0x";
+					prefix_len = 2;
 				}
+			}
 
-				while(*where != '\0') /* emit string/char/converted number */
-				{
-					WRITECHAR(*where++, n);
-				}
+			out_number(&out, prefix, prefix_len, start, digits_end - start, flags, width, precision);
+			break;
+		}
+		case 'c':
+		{
+			const char c = (char)va_arg(args, int);
+			out_padded(&out, &c, 1, flags, width);
+			break;
+		}
+		case 's':
+		{
+			const char* str = va_arg(args, const char*);
 
-				if(given_wd < actual_wd) /* pad on right with spaces (for left justify) */
-				{
-					given_wd = 0;
-				}
-				else 
-				{
-					given_wd -= actual_wd;
-				}
-					
-				for(; given_wd; given_wd--)
-				{
-					WRITECHAR(' ', n);
-				}
-				break;
-			default:
-				break;
+			if(!str)
+			{
+				str = "(null)";
+			}
+
+			size_t len;
+
+			if(flags & FMT_PREC)
+			{
+				const char* nul = memchr(str, '\0', precision);
+				len = nul ? (size_t)(nul - str) : precision;
+			}
+			else
+			{
+				len = strlen(str);
 			}
+
+			out_padded(&out, str, len, flags, width);
+			break;
+		}
+		case '%':
+			out_chars(&out, "%", 1);
+			break;
+		case '\0':
+			//a % at the very end, there's nothing after it to print
+			fmt--;
+			break;
 		default:
-			state = flags = given_wd = 0;
 			break;
 		}
-	}
-	
-	buffer[count] = '\0';
-	return count;
-}
-
-int puts(const char* str)
-{
-	file_write(str, strlen(str), stdout);
 
-	putchar('\n');
-	return 1;
-}
+		fmt++;
+	}
 
-int fputs(const char * str, FILE * stream)
-{
-	//stream->print_func(stream, str);
-	putchar('\n');
-	return 1;
-}
+	if(n)
+	{
+		*out.ptr = '\0';
+	}
 
-void perror(const char* str)
-{
-	//stderr->print_func(stderr, str);
+	return (int)out.count;
 }
 
 int vsprintf(char *s, const char *format, va_list arg)
@@ -341,6 +501,27 @@ int sprintf(char* s, const char * format, ...)
 	return len;
 }
 
+#ifdef __KERNEL
+int puts(const char* str)
+{
+	file_write(str, strlen(str), stdout);
+
+	putchar('\n');
+	return 1;
+}
+
+int fputs(const char * str, FILE * stream)
+{
+	//stream->print_func(stream, str);
+	putchar('\n');
+	return 1;
+}
+
+void perror(const char* str)
+{
+	//stderr->print_func(stderr, str);
+}
+
 int fprintf(FILE * stream, const char * format, ...)
 {
 	char buffer[128];
@@ -367,4 +548,780 @@ int printf(const char* format, ...)
 	va_end(args);
 	
 	return len;
-}
\ No newline at end of file
+}
+#endif
+
+#ifndef __KERNEL
+
+//everything goes through a buffer in user space, so small reads and writes don't each cost a system call
+//files opened with fopen read and write their file_stream, stdout and stderr call whatever set_stdout installed
+//the buffer holds either output that hasn't been written yet or input that hasn't been read yet, never both
+//threads share the FILEs, so the functions that touch the buffer take the FILE's lock
+//and the _nolock versions are for when it's already held
+
+#define FILE_CAN_READ	0x01
+#define FILE_CAN_WRITE	0x02
+#define FILE_AT_EOF		0x04
+#define FILE_HAD_ERROR	0x08
+#define FILE_OWNS_BUF	0x10
+#define FILE_READING	0x20
+#define FILE_WRITING	0x40
+
+struct FILE
+{
+	void* impl_ptr;
+	void (*write)(const char* buf, size_t size, void* impl);
+
+	file_stream* stream;
+	int flags;
+	int buf_mode;
+
+	char* buf;
+	size_t buf_size;
+	size_t buf_pos; //how much has been written into the buffer, or read out of it
+	size_t buf_end; //how much was read into the buffer
+
+	FILE* next; //every open FILE, for fflush(NULL)
+
+	mtx_t lock; //zeroed is unlocked, so stdout and stderr don't need an initializer for it
+};
+
+static FILE m_stderr = {NULL, NULL, NULL, FILE_CAN_WRITE, _IONBF, NULL, 0, 0, 0, NULL};
+
+//the terminal only gets whole lines, which is where most of the cost of printing was
+static FILE m_stdout = {NULL, NULL, NULL, FILE_CAN_WRITE, _IOLBF, NULL, BUFSIZ, 0, 0, &m_stderr};
+
+FILE* stdout = &m_stdout;
+FILE* stderr = &m_stderr;
+
+static FILE* open_files = &m_stdout;
+
+//guards open_files, it's taken before a FILE's own lock, never after
+static mtx_t open_files_lock;
+
+void set_stdout(void (*write)(const char* buf, size_t size, void* impl))
+{
+	fflush(stdout);
+
+	stdout->write = write;
+	stderr->write = write;
+}
+
+//straight to the file or the callback, returns how much was written
+static size_t raw_write(FILE* f, const char* data, size_t size)
+{
+	if(f->stream)
+	{
+		int written = write(data, size, f->stream);
+
+		if(written < 0 || (size_t)written != size)
+		{
+			f->flags |= FILE_HAD_ERROR;
+			return (written < 0) ? 0 : (size_t)written;
+		}
+	}
+	else if(f->write)
+	{
+		f->write(data, size, f->impl_ptr);
+	}
+
+	return size;
+}
+
+static size_t raw_read(FILE* f, char* data, size_t size)
+{
+	if(!f->stream)
+	{
+		f->flags |= FILE_AT_EOF;
+		return 0;
+	}
+
+	int got = read(data, size, f->stream);
+
+	if(got <= 0)
+	{
+		f->flags |= FILE_AT_EOF;
+		return 0;
+	}
+
+	return (size_t)got;
+}
+
+//the buffer is allocated the first time it's needed, if there's no memory for it the FILE goes unbuffered
+static bool has_buffer(FILE* f)
+{
+	if(f->buf_mode == _IONBF)
+	{
+		return false;
+	}
+
+	if(!f->buf)
+	{
+		f->buf = malloc(f->buf_size);
+
+		if(!f->buf)
+		{
+			f->buf_mode = _IONBF;
+			return false;
+		}
+
+		f->flags |= FILE_OWNS_BUF;
+	}
+
+	return true;
+}
+
+static int flush_one(FILE* f)
+{
+	int result = 0;
+
+	if((f->flags & FILE_WRITING) && f->buf_pos)
+	{
+		if(raw_write(f, f->buf, f->buf_pos) != f->buf_pos)
+		{
+			result = EOF;
+		}
+	}
+
+	//there's no seeking back over input that was read ahead, it's dropped
+	f->buf_pos = f->buf_end = 0;
+	f->flags &= ~(FILE_READING | FILE_WRITING);
+
+	return result;
+}
+
+static int flush_locked(FILE* f)
+{
+	mtx_lock(&f->lock);
+	int result = flush_one(f);
+	mtx_unlock(&f->lock);
+
+	return result;
+}
+
+int fflush(FILE* stream)
+{
+	if(stream)
+	{
+		return flush_locked(stream);
+	}
+
+	int result = 0;
+
+	mtx_lock(&open_files_lock);
+
+	for(FILE* f = open_files; f; f = f->next)
+	{
+		if(flush_locked(f) != 0)
+		{
+			result = EOF;
+		}
+	}
+
+	mtx_unlock(&open_files_lock);
+
+	return result;
+}
+
+int setvbuf(FILE* stream, char* buffer, int mode, size_t size)
+{
+	if(mode != _IOFBF && mode != _IOLBF && mode != _IONBF)
+	{
+		return -1;
+	}
+
+	mtx_lock(&stream->lock);
+
+	flush_one(stream);
+
+	if(stream->flags & FILE_OWNS_BUF)
+	{
+		free(stream->buf);
+		stream->flags &= ~FILE_OWNS_BUF;
+	}
+
+	stream->buf_mode = mode;
+	stream->buf = (mode == _IONBF) ? NULL : buffer;
+	stream->buf_size = (size && mode != _IONBF) ? size : BUFSIZ;
+
+	mtx_unlock(&stream->lock);
+
+	return 0;
+}
+
+void setbuf(FILE* stream, char* buffer)
+{
+	setvbuf(stream, buffer, buffer ? _IOFBF : _IONBF, BUFSIZ);
+}
+
+//"1:/dir/name" is on drive 1, without a drive every drive is tried in turn and a new file goes on drive 0
+static file_stream* open_path(const char* filename, int flags)
+{
+	size_t first_drive = 0, last_drive = (flags & FILE_CREATE) ? 0 : 3;
+
+	if(filename[0] >= '0' && filename[0] <= '9' && filename[1] == ':')
+	{
+		first_drive = last_drive = filename[0] - '0';
+		filename += 2;
+	}
+
+	while(*filename == '/')
+	{
+		filename++;
+	}
+
+	for(size_t drive = first_drive; drive <= last_drive; drive++)
+	{
+		const file_handle* root_handle = get_root_directory(drive);
+
+		if(!root_handle)
+		{
+			continue;
+		}
+
+		directory_stream* root = open_dir_handle(root_handle, 0);
+		dispose_file_handle(root_handle);
+
+		if(!root)
+		{
+			continue;
+		}
+
+		file_stream* stream = open(root, filename, strlen(filename), flags);
+		close_dir(root);
+
+		if(stream)
+		{
+			return stream;
+		}
+	}
+
+	return NULL;
+}
+
+FILE* fopen(const char* filename, const char* mode)
+{
+	int flags = 0, file_flags = 0;
+
+	switch(mode[0])
+	{
+	case 'r':
+		flags = FILE_CAN_READ;
+		file_flags = FILE_READ;
+		break;
+	case 'w':
+		flags = FILE_CAN_WRITE;
+		file_flags = FILE_WRITE | FILE_CREATE;
+		break;
+	case 'a':
+		flags = FILE_CAN_WRITE;
+		file_flags = FILE_WRITE | FILE_CREATE | FILE_APPEND;
+		break;
+	default:
+		return NULL;
+	}
+
+	if(strchr(mode, '+'))
+	{
+		flags |= FILE_CAN_READ | FILE_CAN_WRITE;
+		file_flags |= FILE_READ | FILE_WRITE;
+	}
+
+	FILE* f = malloc(sizeof(FILE));
+
+	if(!f)
+	{
+		return NULL;
+	}
+
+	f->stream = open_path(filename, file_flags);
+
+	if(!f->stream)
+	{
+		free(f);
+		return NULL;
+	}
+
+	f->impl_ptr = NULL;
+	f->write = NULL;
+	f->flags = flags;
+	f->buf_mode = _IOFBF;
+	f->buf = NULL;
+	f->buf_size = BUFSIZ;
+	f->buf_pos = f->buf_end = 0;
+	mtx_init(&f->lock, mtx_plain);
+
+	mtx_lock(&open_files_lock);
+	f->next = open_files;
+	open_files = f;
+	mtx_unlock(&open_files_lock);
+
+	return f;
+}
+
+int fclose(FILE* stream)
+{
+	mtx_lock(&open_files_lock);
+
+	for(FILE** link = &open_files; *link; link = &(*link)->next)
+	{
+		if(*link == stream)
+		{
+			*link = stream->next;
+			break;
+		}
+	}
+
+	mtx_unlock(&open_files_lock);
+
+	int result = flush_locked(stream);
+
+	if(stream->flags & FILE_OWNS_BUF)
+	{
+		free(stream->buf);
+	}
+
+	if(stream->stream && close(stream->stream) != 0)
+	{
+		result = EOF;
+	}
+
+	if(stream != stdout && stream != stderr)
+	{
+		free(stream);
+	}
+
+	return result;
+}
+
+int feof(FILE* stream)
+{
+	return (stream->flags & FILE_AT_EOF) != 0;
+}
+
+int ferror(FILE* stream)
+{
+	return (stream->flags & FILE_HAD_ERROR) != 0;
+}
+
+void clearerr(FILE* stream)
+{
+	stream->flags &= ~(FILE_AT_EOF | FILE_HAD_ERROR);
+}
+
+//gets the buffer ready for output, dropping anything that was read ahead
+static bool start_writing(FILE* f)
+{
+	if(!(f->flags & FILE_CAN_WRITE))
+	{
+		f->flags |= FILE_HAD_ERROR;
+		return false;
+	}
+
+	if(f->flags & FILE_READING)
+	{
+		flush_one(f);
+	}
+
+	f->flags |= FILE_WRITING;
+	return true;
+}
+
+static bool start_reading(FILE* f)
+{
+	if(!(f->flags & FILE_CAN_READ))
+	{
+		f->flags |= FILE_HAD_ERROR;
+		return false;
+	}
+
+	if(f->flags & FILE_WRITING)
+	{
+		flush_one(f);
+	}
+
+	f->flags |= FILE_READING;
+	return true;
+}
+
+static size_t fwrite_nolock(const void* ptr, size_t size, size_t count, FILE* stream)
+{
+	const size_t total = size * count;
+	const char* data = ptr;
+
+	if(total == 0 || !start_writing(stream))
+	{
+		return 0;
+	}
+
+	size_t written;
+
+	if(!has_buffer(stream))
+	{
+		written = raw_write(stream, data, total);
+	}
+	else if(total >= stream->buf_size)
+	{
+		//too big to be worth copying, whatever's buffered has to go first to keep the order
+		written = (flush_one(stream) == 0) ? raw_write(stream, data, total) : 0;
+		stream->flags |= FILE_WRITING;
+	}
+	else
+	{
+		if(stream->buf_pos + total > stream->buf_size)
+		{
+			flush_one(stream);
+			stream->flags |= FILE_WRITING;
+		}
+
+		memcpy(stream->buf + stream->buf_pos, data, total);
+		stream->buf_pos += total;
+		written = total;
+
+		if(stream->buf_mode == _IOLBF && memchr(data, '\n', total))
+		{
+			flush_one(stream);
+		}
+	}
+
+	return written / size;
+}
+
+size_t fwrite(const void* ptr, size_t size, size_t count, FILE* stream)
+{
+	mtx_lock(&stream->lock);
+	const size_t written = fwrite_nolock(ptr, size, count, stream);
+	mtx_unlock(&stream->lock);
+
+	return written;
+}
+
+int fputc(int character, FILE* stream)
+{
+	mtx_lock(&stream->lock);
+
+	int result = (unsigned char)character;
+
+	//most characters just go in the buffer
+	if((stream->flags & FILE_WRITING) && stream->buf && stream->buf_pos < stream->buf_size &&
+	   !(stream->buf_mode == _IOLBF && character == '\n'))
+	{
+		stream->buf[stream->buf_pos++] = (char)character;
+	}
+	else
+	{
+		char c = (char)character;
+
+		if(fwrite_nolock(&c, 1, 1, stream) != 1)
+		{
+			result = EOF;
+		}
+	}
+
+	mtx_unlock(&stream->lock);
+
+	return result;
+}
+
+int putc(int character, FILE* stream)
+{
+	return fputc(character, stream);
+}
+
+int putchar(int character)
+{
+	return fputc(character, stdout);
+}
+
+int fputs(const char* str, FILE* stream)
+{
+	const size_t len = strlen(str);
+	return (fwrite(str, 1, len, stream) == len) ? 1 : EOF;
+}
+
+int puts(const char* str)
+{
+	if(fputs(str, stdout) == EOF)
+	{
+		return EOF;
+	}
+
+	return (fputc('\n', stdout) == EOF) ? EOF : 1;
+}
+
+void perror(const char* str)
+{
+	if(str && *str)
+	{
+		fputs(str, stderr);
+		fputs(": ", stderr);
+	}
+
+	fputs("error\n", stderr);
+}
+
+//reads more into the buffer once everything in it has been used, returns false at the end of the file
+static bool refill(FILE* f)
+{
+	if(f->buf_pos < f->buf_end)
+	{
+		return true;
+	}
+
+	f->buf_pos = 0;
+	f->buf_end = raw_read(f, f->buf, f->buf_size);
+
+	return f->buf_end != 0;
+}
+
+static size_t fread_nolock(void* ptr, size_t size, size_t count, FILE* stream)
+{
+	const size_t total = size * count;
+	char* dst = ptr;
+	size_t got = 0;
+
+	if(total == 0 || !start_reading(stream))
+	{
+		return 0;
+	}
+
+	if(!has_buffer(stream))
+	{
+		while(got < total && !(stream->flags & FILE_AT_EOF))
+		{
+			got += raw_read(stream, dst + got, total - got);
+		}
+
+		return got / size;
+	}
+
+	while(got < total)
+	{
+		const size_t buffered = stream->buf_end - stream->buf_pos;
+
+		if(buffered)
+		{
+			const size_t n = (buffered < total - got) ? buffered : total - got;
+
+			memcpy(dst + got, stream->buf + stream->buf_pos, n);
+			stream->buf_pos += n;
+			got += n;
+		}
+		else if(total - got >= stream->buf_size)
+		{
+			//a whole buffer or more goes straight where it's wanted
+			const size_t n = raw_read(stream, dst + got, total - got);
+
+			if(n == 0) { break; }
+
+			got += n;
+		}
+		else if(!refill(stream))
+		{
+			break;
+		}
+	}
+
+	return got / size;
+}
+
+size_t fread(void* ptr, size_t size, size_t count, FILE* stream)
+{
+	mtx_lock(&stream->lock);
+	const size_t got = fread_nolock(ptr, size, count, stream);
+	mtx_unlock(&stream->lock);
+
+	return got;
+}
+
+static int fgetc_nolock(FILE* stream)
+{
+	if((stream->flags & FILE_READING) && stream->buf_pos < stream->buf_end)
+	{
+		return (unsigned char)stream->buf[stream->buf_pos++];
+	}
+
+	unsigned char c;
+	return (fread_nolock(&c, 1, 1, stream) == 1) ? c : EOF;
+}
+
+int fgetc(FILE* stream)
+{
+	mtx_lock(&stream->lock);
+	const int c = fgetc_nolock(stream);
+	mtx_unlock(&stream->lock);
+
+	return c;
+}
+
+int getc(FILE* stream)
+{
+	return fgetc(stream);
+}
+
+static char* fgets_nolock(char* str, int num, FILE* stream)
+{
+	if(num <= 0 || !start_reading(stream))
+	{
+		return NULL;
+	}
+
+	size_t got = 0;
+	const size_t max = (size_t)num - 1;
+
+	if(!has_buffer(stream))
+	{
+		while(got < max)
+		{
+			const int c = fgetc_nolock(stream);
+
+			if(c == EOF) { break; }
+
+			str[got++] = (char)c;
+
+			if(c == '\n') { break; }
+		}
+	}
+	else
+	{
+		//a whole line at a time out of the buffer, looking for the end of it with memchr
+		while(got < max && refill(stream))
+		{
+			const char* start = stream->buf + stream->buf_pos;
+			size_t n = stream->buf_end - stream->buf_pos;
+
+			if(n > max - got) { n = max - got; }
+
+			const char* newline = memchr(start, '\n', n);
+
+			if(newline) { n = newline - start + 1; }
+
+			memcpy(str + got, start, n);
+			stream->buf_pos += n;
+			got += n;
+
+			if(newline) { break; }
+		}
+	}
+
+	if(got == 0)
+	{
+		return NULL;
+	}
+
+	str[got] = '\0';
+	return str;
+}
+
+char* fgets(char* str, int num, FILE* stream)
+{
+	mtx_lock(&stream->lock);
+	char* result = fgets_nolock(str, num, stream);
+	mtx_unlock(&stream->lock);
+
+	return result;
+}
+
+static int vfprintf_nolock(FILE* stream, const char* format, va_list args)
+{
+	//formatted straight into the buffer when it fits
+	if(start_writing(stream) && has_buffer(stream))
+	{
+		if(stream->buf_pos == stream->buf_size)
+		{
+			flush_one(stream);
+			stream->flags |= FILE_WRITING;
+		}
+
+		const size_t room = stream->buf_size - stream->buf_pos;
+
+		va_list copy;
+		va_copy(copy, args);
+		const int len = vsnprintf(stream->buf + stream->buf_pos, room, format, copy);
+		va_end(copy);
+
+		if(len >= 0 && (size_t)len < room)
+		{
+			const char* start = stream->buf + stream->buf_pos;
+			stream->buf_pos += len;
+
+			if(stream->buf_mode == _IOLBF && memchr(start, '\n', len))
+			{
+				flush_one(stream);
+			}
+
+			return len;
+		}
+	}
+
+	char buffer[256];
+	char* text = buffer;
+
+	va_list copy;
+	va_copy(copy, args);
+	int len = vsnprintf(buffer, sizeof(buffer), format, copy);
+	va_end(copy);
+
+	if(len >= (int)sizeof(buffer))
+	{
+		text = malloc(len + 1);
+
+		if(!text)
+		{
+			text = buffer;
+			len = sizeof(buffer) - 1;
+		}
+		else
+		{
+			vsnprintf(text, len + 1, format, args);
+		}
+	}
+
+	fwrite_nolock(text, 1, len, stream);
+
+	if(text != buffer)
+	{
+		free(text);
+	}
+
+	return len;
+}
+
+int vfprintf(FILE* stream, const char* format, va_list args)
+{
+	mtx_lock(&stream->lock);
+	const int len = vfprintf_nolock(stream, format, args);
+	mtx_unlock(&stream->lock);
+
+	return len;
+}
+
+int fprintf(FILE* stream, const char* format, ...)
+{
+	va_list args;
+	va_start(args, format);
+
+	int len = vfprintf(stream, format, args);
+
+	va_end(args);
+
+	return len;
+}
+
+int vprintf(const char* format, va_list args)
+{
+	return vfprintf(stdout, format, args);
+}
+
+int printf(const char* format, ...)
+{
+	va_list args;
+	va_start(args, format);
+
+	int len = vfprintf(stdout, format, args);
+
+	va_end(args);
+
+	return len;
+}
+#endif
\ No newline at end of file
@@ -1,9 +1,11 @@
 #include <ctype.h>
 #include <stdint.h>
 #include <stdlib.h>
+#include <stdio.h>
 
 #ifndef __KERNEL
 #include <sys/syscalls.h>
+#include <threads.h>
 #else
 #include <kernel/locks.h>
 #include <kernel/sys/syscalls.h>
@@ -13,6 +15,10 @@
 #define _HAVE_UINTPTR_T
 
 #include "liballoc.h"
+#include "slab.h"
+#include "span.h"
+#include <malloc.h>
+#include <string.h>
 
 int atoi(const char * str)
 {
@@ -58,19 +64,51 @@ static int liballoc_unlock()
 	alloc_lock.unlock();
 	return 0;
 }
+
+//the slabs get their own lock so small allocations don't wait on liballoc
+static constinit sync::mutex slab_lock_mtx{};
+static int slab_lock()
+{
+	slab_lock_mtx.lock();
+	return 0;
+}
+
+static int slab_unlock()
+{
+	slab_lock_mtx.unlock();
+	return 0;
+}
 #else
+//threads share the heap, these are zeroed so malloc works before main
+static mtx_t alloc_lock;
 static int liballoc_lock()
 {
+	mtx_lock(&alloc_lock);
 	return 0;
 }
 
 static int liballoc_unlock()
 {
+	mtx_unlock(&alloc_lock);
+	return 0;
+}
+
+static mtx_t slab_lock_mtx;
+static int slab_lock()
+{
+	mtx_lock(&slab_lock_mtx);
+	return 0;
+}
+
+static int slab_unlock()
+{
+	mtx_unlock(&slab_lock_mtx);
 	return 0;
 }
 
 void exit(int status)
 {
+	fflush(nullptr);
 	sys_exit(status);
 }
 #endif
@@ -98,22 +136,225 @@ static heap_allocator library_allocator{
 	liballoc_free
 };
 
+static slab_allocator small_allocator{
+	slab_lock,
+	slab_unlock,
+	liballoc_alloc,
+	liballoc_free
+};
+
+#ifndef __KERNEL
+static void* span_alloc(void* p, size_t n)
+{
+	return alloc_pages(p, n, MALLOC_FLAGS);
+}
+
+static span_allocator large_allocator{
+	liballoc_lock,
+	liballoc_unlock,
+	span_alloc,
+	liballoc_free,
+	discard_pages
+};
+
+//the thread's cache of small objects comes from the slabs the first time it allocates one
+static slab_thread_cache* thread_cache()
+{
+	__thread_block* block = __thrd_block();
+
+	if(!block->heap_cache)
+	{
+		if(void* p = small_allocator.alloc_bytes(sizeof(slab_thread_cache)))
+		{
+			memset(p, 0, sizeof(slab_thread_cache));
+			block->heap_cache = p;
+		}
+	}
+
+	return (slab_thread_cache*)block->heap_cache;
+}
+
+void __thrd_release_heap(__thread_block* block)
+{
+	if(slab_thread_cache* cache = (slab_thread_cache*)block->heap_cache)
+	{
+		block->heap_cache = nullptr;
+		small_allocator.drain(*cache);
+		small_allocator.free_bytes(cache);
+	}
+}
+#endif
+
+static void* small_alloc(size_t n)
+{
+#ifndef __KERNEL
+	if(slab_thread_cache* cache = thread_cache())
+	{
+		return small_allocator.alloc_bytes(n, *cache);
+	}
+#endif
+
+	return small_allocator.alloc_bytes(n);
+}
+
+static void small_free(void* p)
+{
+#ifndef __KERNEL
+	if(slab_thread_cache* cache = thread_cache())
+	{
+		return small_allocator.free_bytes(p, *cache);
+	}
+#endif
+
+	small_allocator.free_bytes(p);
+}
+
 void* malloc(size_t n)
 {
+	if(n <= slab_allocator::max_size)
+	{
+		if(void* p = small_alloc(n)) { return p; }
+	}
+#ifndef __KERNEL
+	else if(n >= span_allocator::min_size)
+	{
+		return large_allocator.alloc_bytes(n);
+	}
+#endif
+
 	return library_allocator.malloc_bytes(n);
 }
 
+static void* move_allocation(void* ptr, size_t old_size, size_t size)
+{
+	void* new_ptr = malloc(size);
+
+	if(new_ptr)
+	{
+		memcpy(new_ptr, ptr, size < old_size ? size : old_size);
+		free(ptr);
+	}
+
+	return new_ptr;
+}
+
 void* realloc(void* ptr, size_t size)
 {
+	if(!ptr) { return malloc(size); }
+
+	if(size == 0)
+	{
+		free(ptr);
+		return NULL;
+	}
+
+	if(small_allocator.owns(ptr))
+	{
+		size_t old_size = small_allocator.usable_size(ptr);
+
+		if(size <= old_size && size > old_size / 2)
+		{
+			return ptr;
+		}
+
+		return move_allocation(ptr, old_size, size);
+	}
+
+#ifndef __KERNEL
+	if(large_allocator.owns(ptr))
+	{
+		if(size >= span_allocator::min_size / 2 && large_allocator.resize_bytes(ptr, size))
+		{
+			return ptr;
+		}
+
+		return move_allocation(ptr, large_allocator.usable_size(ptr), size);
+	}
+
+	if(size >= span_allocator::min_size)
+	{
+		return move_allocation(ptr, library_allocator.usable_size(ptr), size);
+	}
+#endif
+
 	return library_allocator.realloc_bytes(ptr, size);
 }
 
 void* calloc(size_t num, size_t size)
 {
+	size_t n = num * size;
+
+	if(size != 0 && n / size != num) { return NULL; }
+
+	if(n <= slab_allocator::max_size)
+	{
+		if(void* p = small_alloc(n))
+		{
+			memset(p, 0, n);
+			return p;
+		}
+	}
+#ifndef __KERNEL
+	else if(n >= span_allocator::min_size)
+	{
+		//spans are always fresh or discarded pages, so they are already zero
+		return large_allocator.alloc_bytes(n);
+	}
+#endif
+
 	return library_allocator.calloc_bytes(num, size);
 }
 
 void free(void* p)
 {
+	if(!p) { return; }
+
+	if(small_allocator.owns(p))
+	{
+		return small_free(p);
+	}
+
+#ifndef __KERNEL
+	if(large_allocator.owns(p))
+	{
+		return large_allocator.free_bytes(p);
+	}
+#endif
+
 	return library_allocator.free_bytes(p);
-}
\ No newline at end of file
+}
+
+struct mallinfo mallinfo(void)
+{
+	size_t slab_allocated, slab_in_use;
+	size_t heap_allocated, heap_in_use;
+
+	small_allocator.get_usage(&slab_allocated, &slab_in_use);
+	library_allocator.get_usage(&heap_allocated, &heap_in_use);
+
+#ifndef __KERNEL
+	size_t span_allocated, span_in_use;
+	large_allocator.get_usage(&span_allocated, &span_in_use);
+
+	heap_allocated += span_allocated;
+	heap_in_use += span_in_use;
+#endif
+
+	struct mallinfo info;
+	info.arena = slab_allocated + heap_allocated;
+	info.uordblks = slab_in_use + heap_in_use;
+	info.fordblks = info.arena - info.uordblks;
+	return info;
+}
+
+#ifdef __KERNEL
+void* kernel_cache_alloc(slab_cache& cache)
+{
+	if(cache.object_size() > slab_allocator::page_size / 4)
+	{
+		return library_allocator.malloc_bytes(cache.object_size());
+	}
+
+	return small_allocator.alloc_object(cache);
+}
+#endif
\ No newline at end of file
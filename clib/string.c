@@ -2,6 +2,18 @@
 #include <ctype.h>
 #include <stdbool.h>
 
+//strlen, memchr and memcmp go a word at a time, memcpy.c has memcpy, memset and memmove
+//x86 doesn't mind misaligned loads, but the word loops that could run off the end of the string line up first,
+//so they never read into the next page
+
+typedef uint32_t word __attribute__((may_alias, aligned(1)));
+
+//true if any of the 4 bytes is 0
+static inline bool has_zero_byte(uint32_t w)
+{
+	return ((w - 0x01010101u) & ~w & 0x80808080u) != 0;
+}
+
 char* strchr(const char* str, int character)
 {
     while (*str != (char)character)
@@ -15,6 +27,39 @@ char* strchr(const char* str, int character)
     return str;
 }
 
+void* memchr(const void* ptr, int value, size_t num)
+{
+	const unsigned char* p = (const unsigned char*)ptr;
+	const unsigned char c = (unsigned char)value;
+
+	for(; num && ((uintptr_t)p & 3); num--, p++)
+	{
+		if(*p == c)
+		{
+			return (void*)p;
+		}
+	}
+
+	//the words that don't have it are skipped, the bytes of the one that does are looked at below
+	const uint32_t pattern = c * 0x01010101u;
+
+	while(num >= 4 && !has_zero_byte(*(const word*)p ^ pattern))
+	{
+		num -= 4;
+		p += 4;
+	}
+
+	for(; num; num--, p++)
+	{
+		if(*p == c)
+		{
+			return (void*)p;
+		}
+	}
+
+	return NULL;
+}
+
 char* strtok(char* str, const char* delimiters)
 {
     static char* buffer = NULL;
@@ -88,69 +133,51 @@ int strcasecmp(const char* s1, const char* s2)
 
 int memcmp(const void* ptr1, const void* ptr2, size_t num)
 {
-	if(!num) return 0;
-
 	const unsigned char* ptra = (const unsigned char*)ptr1;
 	const unsigned char* ptrb = (const unsigned char*)ptr2;
 
-	while(--num && *ptra == *ptrb)
+	//up to the first word that's different, the byte loop finds where in it
+	while(num >= 4 && *(const word*)ptra == *(const word*)ptrb)
 	{
-		ptra++;
-		ptrb++;
+		num -= 4;
+		ptra += 4;
+		ptrb += 4;
 	}
 
-	return (*((unsigned char*)ptra) - *((unsigned char*)ptrb));
+	for(; num; num--, ptra++, ptrb++)
+	{
+		if(*ptra != *ptrb)
+		{
+			return *ptra - *ptrb;
+		}
+	}
+
+	return 0;
 }
 
-/*
-void* memset(void* ptr, int value, size_t num)
+size_t strlen(const char* str)
 {
-    uint8_t u8  = (uint8_t)value;
-	uint8_t* sp  = (uint8_t*)ptr;
-    
-    while(((uint32_t)sp & (sizeof(uint32_t) - 1)) && num--)
-    {
-		*sp++ = u8;
-    }
-	
-	uint32_t u32 = (uint32_t)value & 0xff;
-	u32 = (u32 << 24) | (u32 << 16) | (u32 << 8) | u32;
-    uint32_t* lp = (uint32_t*)sp;
-    
-    while(num / sizeof(uint32_t))
-    {
-        *lp++ = u32;
-        num -= sizeof(uint32_t);
-    }
-    
-    sp = (uint8_t*)lp;
-    
-    while(num--)
-    {
-        *sp++ = u8;
-    }
-    
-    return ptr;
-}*/
+	const char* p = str;
 
-//void* memset(void* ptr, int value, size_t num)
-//{
-//	unsigned char* ptr8 = (unsigned char*)ptr;
-//
-//    while(num--) 
-//	{
-//		*ptr8++ = (unsigned char)value;
-//    }
-//    return ptr;
-//}
+	for(; (uintptr_t)p & 3; p++)
+	{
+		if(*p == '\0')
+		{
+			return p - str;
+		}
+	}
 
-size_t strlen(const char* str)
-{
-	size_t len = 0;
-	
-	while(*(str++) != '\0') { len++; }
-	
-	return len;
+	while(!has_zero_byte(*(const word*)p))
+	{
+		p += 4;
+	}
+
+	while(*p != '\0')
+	{
+		p++;
+	}
+
+	return p - str;
 }
 
 char* strcat(char* destination, const char* source)
@@ -163,29 +190,4 @@ char* strcpy(char* destination, const char* source)
 {
 	memcpy(destination, source, strlen(source) + 1);
 	return destination;
-}
-
-void* memmove(void* dest, const void* src, size_t num)
-{
-	uint8_t* dst_ptr = dest;
-	const uint8_t* src_ptr = src;
-
-	if(src_ptr < dst_ptr && dst_ptr < src_ptr + num)
-	{
-		src_ptr += num;
-		dst_ptr += num;
-		while(num--)
-		{
-			*--dst_ptr = *--src_ptr;
-		}
-	}
-	else
-	{
-		while(num--)
-		{
-			*dst_ptr++ = *src_ptr++;
-		}
-	}
-
-	return dest;
 }
\ No newline at end of file
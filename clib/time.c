@@ -71,6 +71,12 @@ time_t time(time_t* timer)
 clock_t __c_get_clock_tick_rate()
 {
 #ifndef __KERNEL
+	//the kernel's ticks are nanoseconds too when it hands out the clock
+	if(SYSTEM_PAGE->features & SYSTEM_FEATURE_TSC_CLOCK)
+	{
+		return 1000000000;
+	}
+
 	size_t rate;
 	clock_ticks(&rate);
 	return rate;
@@ -82,12 +88,51 @@ clock_t __c_get_clock_tick_rate()
 clock_t clock(void)
 {
 #ifndef __KERNEL
+	if(SYSTEM_PAGE->features & SYSTEM_FEATURE_TSC_CLOCK)
+	{
+		return (clock_t)tsc_clock_read(&SYSTEM_PAGE->clock);
+	}
+
 	return clock_ticks(NULL);
 #else
 	return sysclock_get_ticks();
 #endif
 }
 
+int clock_gettime(clockid_t clock_id, struct timespec* tp)
+{
+	if(clock_id != CLOCK_MONOTONIC)
+	{
+		return -1;
+	}
+
+	clock_t ticks = clock();
+	clock_t rate = CLOCKS_PER_SEC;
+
+	tp->tv_sec = ticks / rate;
+	tp->tv_nsec = (long)((ticks % rate) * 1000000000 / rate);
+
+	return 0;
+}
+
+int nanosleep(const struct timespec* req, struct timespec* rem)
+{
+	if(req->tv_sec < 0 || req->tv_nsec < 0 || req->tv_nsec >= 1000000000)
+	{
+		return -1;
+	}
+
+	sys_sleep((uint32_t)req->tv_sec, (uint32_t)req->tv_nsec);
+
+	if(rem != NULL)
+	{
+		rem->tv_sec = 0;
+		rem->tv_nsec = 0;
+	}
+
+	return 0;
+}
+
 static const int8_t days_per_month[2][12] = {
 	{31, 28, 31, 30, 31, 30, 31, 31, 30, 31, 30, 31},
 	{31, 29, 31, 30, 31, 30, 31, 31, 30, 31, 30, 31}
@@ -0,0 +1,138 @@
+#ifndef CPUID_H
+#define CPUID_H
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stdint.h>
+#include <stdbool.h>
+
+enum cpu_feature_flags
+{
+	CPU_FEATURE_486		= 0x0001, //AC flag can be toggled, we have invlpg, bswap, cmpxchg etc.
+	CPU_FEATURE_CPUID	= 0x0002, //ID flag can be toggled, cpuid instruction is present
+	CPU_FEATURE_PGE		= 0x0004, //global pages, CR4.PGE
+	CPU_FEATURE_SEP		= 0x0008, //sysenter and sysexit
+	CPU_FEATURE_APIC	= 0x0010, //on chip local APIC
+	CPU_FEATURE_TSC		= 0x0020, //rdtsc, a counter that goes up every clock cycle
+	CPU_FEATURE_FXSR	= 0x0040, //fxsave and fxrstor, which the SSE registers need
+	CPU_FEATURE_MMX		= 0x0080,
+	CPU_FEATURE_SSE		= 0x0100,
+	CPU_FEATURE_SSE2	= 0x0200,
+	CPU_FEATURE_MTRR	= 0x0400, //memory type range registers
+	CPU_FEATURE_PAT		= 0x0800, //page attribute table, the memory type of each page comes from its PAT, PCD and PWT bits
+	CPU_FEATURE_ERMS	= 0x1000, //enhanced rep movsb and rep stosb, as fast as anything else for all but small sizes
+};
+
+#define EFLAGS_AC 0x00040000
+#define EFLAGS_ID 0x00200000
+
+#define CPUID_EDX_TSC (1 << 4)
+#define CPUID_EDX_APIC (1 << 9)
+#define CPUID_EDX_SEP (1 << 11)
+#define CPUID_EDX_MTRR (1 << 12)
+#define CPUID_EDX_PGE (1 << 13)
+#define CPUID_EDX_PAT (1 << 16)
+#define CPUID_EDX_MMX (1 << 23)
+#define CPUID_EDX_FXSR (1 << 24)
+#define CPUID_EDX_SSE (1 << 25)
+#define CPUID_EDX_SSE2 (1 << 26)
+
+#define CPUID_7_EBX_ERMS (1 << 9)
+
+//returns true if the bits in mask can be changed in the EFLAGS register
+static inline bool cpu_eflags_toggleable(uint32_t mask)
+{
+	uint32_t before, after;
+	__asm__ volatile("pushfl\n"
+					 "popl %0\n"
+					 "movl %0, %1\n"
+					 "xorl %2, %1\n"
+					 "pushl %1\n"
+					 "popfl\n"
+					 "pushfl\n"
+					 "popl %1\n"
+					 "pushl %0\n"
+					 "popfl\n"
+					 : "=&r"(before), "=&r"(after)
+					 : "ri"(mask)
+					 : "cc");
+	return ((before ^ after) & mask) != 0;
+}
+
+static inline void cpuid(uint32_t leaf, uint32_t subleaf, uint32_t regs[4])
+{
+	__asm__ volatile("cpuid"
+					 : "=a"(regs[0]), "=b"(regs[1]), "=c"(regs[2]), "=d"(regs[3])
+					 : "a"(leaf), "c"(subleaf));
+}
+
+//detects what the cpu we are running on can do
+//the result should be cached, cpuid is a serializing instruction and it is slow
+static inline uint32_t cpu_detect_features(void)
+{
+	uint32_t features = 0;
+
+	if(!cpu_eflags_toggleable(EFLAGS_AC))
+	{
+		return features; //this is a 386
+	}
+
+	features |= CPU_FEATURE_486;
+
+	if(!cpu_eflags_toggleable(EFLAGS_ID))
+	{
+		return features; //an early 486 without cpuid
+	}
+
+	features |= CPU_FEATURE_CPUID;
+
+	uint32_t regs[4];
+	cpuid(0, 0, regs);
+
+	const uint32_t max_leaf = regs[0];
+
+	if(max_leaf < 1)
+	{
+		return features;
+	}
+
+	cpuid(1, 0, regs);
+
+	if(regs[3] & CPUID_EDX_PGE) { features |= CPU_FEATURE_PGE; }
+	if(regs[3] & CPUID_EDX_APIC) { features |= CPU_FEATURE_APIC; }
+	if(regs[3] & CPUID_EDX_TSC) { features |= CPU_FEATURE_TSC; }
+	if(regs[3] & CPUID_EDX_FXSR) { features |= CPU_FEATURE_FXSR; }
+	if(regs[3] & CPUID_EDX_MMX) { features |= CPU_FEATURE_MMX; }
+	if(regs[3] & CPUID_EDX_SSE) { features |= CPU_FEATURE_SSE; }
+	if(regs[3] & CPUID_EDX_SSE2) { features |= CPU_FEATURE_SSE2; }
+	if(regs[3] & CPUID_EDX_MTRR) { features |= CPU_FEATURE_MTRR; }
+	if(regs[3] & CPUID_EDX_PAT) { features |= CPU_FEATURE_PAT; }
+
+	if(regs[3] & CPUID_EDX_SEP)
+	{
+		const uint32_t family = (regs[0] >> 8) & 0x0F;
+		const uint32_t model = (regs[0] >> 4) & 0x0F;
+		const uint32_t stepping = regs[0] & 0x0F;
+
+		//the first pentium pros report sep but don't support it
+		if(family != 6 || model >= 3 || stepping >= 3)
+		{
+			features |= CPU_FEATURE_SEP;
+		}
+	}
+
+	if(max_leaf >= 7)
+	{
+		cpuid(7, 0, regs);
+
+		if(regs[1] & CPUID_7_EBX_ERMS) { features |= CPU_FEATURE_ERMS; }
+	}
+
+	return features;
+}
+
+#ifdef __cplusplus
+}
+#endif
+#endif
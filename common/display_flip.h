@@ -0,0 +1,39 @@
+#ifndef DISPLAY_FLIP_H
+#define DISPLAY_FLIP_H
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stdint.h>
+#include <stddef.h>
+#include <time.h>
+
+//how many flips can wait for a retrace at once
+#define DISPLAY_FLIP_QUEUE_SIZE 2
+
+//flags for queue_display_flip
+#define DISPLAY_FLIP_REPLACE 0x01	//takes the place of the newest flip that hasn't happened yet, so it never fails for being full
+
+//flags in display_flip_status
+#define DISPLAY_FLIP_SYNCED 0x01	//flips follow the hardware's retrace, without it they're only paced by the timer
+
+//every queued flip gets the next sequence number, they wrap around so compare them by subtracting
+struct display_flip_status
+{
+	uint32_t queued;		//the last sequence number handed out
+	uint32_t shown;			//the last one that reached the screen, ones it replaced count as done too
+	uint32_t skipped;		//replaced before they were shown
+	uint32_t num_pending;
+	uint32_t flags;
+	size_t shown_offset;
+	size_t pending_offsets[DISPLAY_FLIP_QUEUE_SIZE];	//the next one to be shown first
+	clock_t shown_time;		//when shown happened, in the same ticks as clock()
+	clock_t refresh_period;	//the time between retraces as measured so far
+};
+
+typedef struct display_flip_status display_flip_status;
+
+#ifdef __cplusplus
+}
+#endif
+#endif
\ No newline at end of file
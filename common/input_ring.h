@@ -0,0 +1,52 @@
+#ifndef INPUT_RING_H
+#define INPUT_RING_H
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stdint.h>
+#include <stddef.h>
+#include <common/input_event.h>
+
+//input events on their way from the kernel to one process, in a page both of them have mapped
+//the kernel is the only one that moves head and the process the only one that moves tail, so neither needs a lock
+//they count up forever and wrap around, the slot is the count modulo the size
+#define INPUT_RING_SIZE 128
+
+struct input_ring
+{
+	volatile uint32_t head;			//where the kernel writes the next event
+	volatile uint32_t tail;			//where the process reads the next event
+	volatile uint32_t dropped;		//events lost because the ring was full
+	volatile uint32_t coalesced;	//mouse motion added onto an event that hadn't been delivered yet
+	input_event events[INPUT_RING_SIZE];
+};
+
+typedef struct input_ring input_ring;
+
+static inline uint32_t input_ring_count(const input_ring* ring)
+{
+	return __atomic_load_n(&ring->head, __ATOMIC_ACQUIRE) - ring->tail;
+}
+
+//copies up to max events out and frees their slots, returns how many there were
+static inline size_t input_ring_read(input_ring* ring, input_event* events, size_t max)
+{
+	uint32_t tail = ring->tail;
+	uint32_t available = __atomic_load_n(&ring->head, __ATOMIC_ACQUIRE) - tail;
+	size_t n = (available < max) ? available : max;
+
+	for(size_t i = 0; i < n; i++)
+	{
+		events[i] = ring->events[(tail + i) % INPUT_RING_SIZE];
+	}
+
+	//the slots can't be reused until we're done copying them
+	__atomic_store_n(&ring->tail, tail + n, __ATOMIC_RELEASE);
+	return n;
+}
+
+#ifdef __cplusplus
+}
+#endif
+#endif
\ No newline at end of file
@@ -0,0 +1,56 @@
+#ifndef PROFILE_SAMPLE_H
+#define PROFILE_SAMPLE_H
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stdint.h>
+#include <stddef.h>
+
+//the interrupted address and up to 5 return addresses above it
+#define PROFILE_MAX_DEPTH 6
+
+#define PROFILE_SAMPLE_USER 0x01	//the cpu was running user code
+
+struct profile_sample
+{
+	uint32_t pid;
+	uint8_t cpu;
+	uint8_t flags;
+	uint8_t depth;			//how many entries of pc are filled in, the stack is only walked in a profiling build
+	uint8_t reserved;
+	uintptr_t pc[PROFILE_MAX_DEPTH];
+};
+
+typedef struct profile_sample profile_sample;
+
+//the kernel fills in name and symbol_address for the address it's given
+//name is empty if there isn't a kernel or driver symbol below it
+struct profile_symbol
+{
+	uintptr_t address;
+	uintptr_t symbol_address;
+	char name[56];
+};
+
+typedef struct profile_symbol profile_symbol;
+
+enum profile_command
+{
+	PROFILE_CMD_START = 0,	//clears the samples and starts taking them
+	PROFILE_CMD_STOP,
+	PROFILE_CMD_STATUS,		//returns 1 if it's sampling
+	PROFILE_CMD_READ,		//copies out the samples, oldest first
+	PROFILE_CMD_SYMBOLIZE	//looks up an array of profile_symbol
+};
+
+//how often every cpu is sampled while the profiler is running
+#define PROFILE_SAMPLE_RATE 1000
+
+//each cpu keeps its most recent samples, about 4 seconds worth
+#define PROFILE_SAMPLES_PER_CPU 4096
+
+#ifdef __cplusplus
+}
+#endif
+#endif
\ No newline at end of file
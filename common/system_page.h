@@ -0,0 +1,43 @@
+#ifndef SYSTEM_PAGE_H
+#define SYSTEM_PAGE_H
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stdint.h>
+#include <common/tsc_clock.h>
+
+//the kernel maps this page into every process at the same address, just below the kernel
+//it's found without a symbol, so code in shared libraries can use it without relocations
+
+#define SYSTEM_PAGE_ADDRESS 0xDFFFF000
+
+enum system_page_features
+{
+	SYSTEM_FEATURE_SYSENTER = 0x0001, //the kernel accepts system calls through sysenter
+	SYSTEM_FEATURE_TSC_CLOCK = 0x0002, //clock can be read directly, the time stamp counter is calibrated
+	SYSTEM_FEATURE_MMX = 0x0004, //the kernel keeps each task's MMX registers, so programs can use them
+	SYSTEM_FEATURE_SSE2 = 0x0008, //the same for the SSE registers
+	SYSTEM_FEATURE_ERMS = 0x0010, //rep movsb and rep stosb are fast
+};
+
+struct system_page
+{
+	//every system call is a call through this pointer
+	//it starts out pointing at int_0x80_stub, crt0 switches it to the fastest way the kernel supports
+	void* syscall_entry;
+	uint32_t features;
+	uint32_t num_cpus;
+	uint8_t int_0x80_stub[4];
+	//the same clock the kernel uses for its ticks when the feature bit is set
+	tsc_clock clock;
+};
+
+typedef struct system_page system_page;
+
+#define SYSTEM_PAGE ((system_page*)SYSTEM_PAGE_ADDRESS)
+
+#ifdef __cplusplus
+}
+#endif
+#endif
\ No newline at end of file
@@ -0,0 +1,49 @@
+#ifndef TRACE_EVENT_H
+#define TRACE_EVENT_H
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stdint.h>
+#include <stddef.h>
+
+enum trace_event_id
+{
+	TRACE_SYSCALL_ENTER = 1,	//the syscall's index
+	TRACE_SYSCALL_EXIT,			//what it returned
+	TRACE_TASK_SWITCH,			//the pid switched from and the pid switched to
+	TRACE_PAGE_FAULT,			//the address and the error code
+	TRACE_BLOCK_CACHE_HIT,		//the drive index and the block
+	TRACE_BLOCK_CACHE_MISS,		//the drive index and the block
+	TRACE_DISK_SUBMIT,			//the drive index, with TRACE_DISK_WRITE for writes, and the first block
+	TRACE_DISK_COMPLETE,		//the drive index, with TRACE_DISK_WRITE for writes, and the number of blocks
+	TRACE_NUM_EVENTS
+};
+
+#define TRACE_DISK_WRITE 0x80000000
+
+//the records are all the same size, so writing one is a few stores
+struct trace_record
+{
+	uint64_t timestamp;		//in the same ticks as clock()
+	uint16_t event;
+	uint8_t cpu;
+	uint8_t reserved;
+	uint32_t pid;
+	uint32_t args[2];
+};
+
+typedef struct trace_record trace_record;
+
+enum trace_command
+{
+	TRACE_CMD_START = 0,	//clears the buffers and starts recording
+	TRACE_CMD_STOP,
+	TRACE_CMD_STATUS,		//returns 1 if it's recording
+	TRACE_CMD_READ			//copies out what every cpu has recorded, oldest first for each cpu
+};
+
+#ifdef __cplusplus
+}
+#endif
+#endif
\ No newline at end of file
@@ -0,0 +1,43 @@
+#ifndef TSC_CLOCK_H
+#define TSC_CLOCK_H
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stdint.h>
+
+//turns the time stamp counter into nanoseconds since boot without any port I/O or system calls
+//the kernel fills this in once it has measured the counter against the PIT, it doesn't change after that
+struct tsc_clock
+{
+	uint64_t base_tsc;	//the counter at the moment the clock was calibrated
+	uint64_t base_ns;	//and what time it was then
+	uint32_t mult;		//nanoseconds per count, as a fixed point number with shift fractional bits
+	uint32_t shift;
+};
+
+typedef struct tsc_clock tsc_clock;
+
+static inline uint64_t rdtsc(void)
+{
+	uint64_t val;
+	__asm__ volatile("rdtsc" : "=A"(val));
+	return val;
+}
+
+//the multiply is split in two halves so it never needs more than 64 bits
+static inline uint64_t tsc_clock_read(const tsc_clock* clock)
+{
+	uint64_t delta = rdtsc() - clock->base_tsc;
+	uint32_t low = (uint32_t)delta;
+	uint32_t high = (uint32_t)(delta >> 32);
+
+	return clock->base_ns
+		+ (((uint64_t)low * clock->mult) >> clock->shift)
+		+ (((uint64_t)high * clock->mult) << (32 - clock->shift));
+}
+
+#ifdef __cplusplus
+}
+#endif
+#endif
\ No newline at end of file
@@ -3,6 +3,7 @@
 #include <drivers/portio.h>
 #include <kernel/input.h>
 #include <kernel/sysclock.h>
+#include <kernel/softirq.h>
 
 static const virtual_keycode key_translation_table[] = {
 	/*0x00*/ VK_NONE,		/*0x01*/ VK_ESCAPE,		/*0x02*/ VK_1,				/*0x03*/ VK_2,
@@ -74,11 +75,15 @@ static const virtual_keycode key_translation_table[] = {
 
 static uint8_t last_key = 0;
 
-static INTERRUPT_HANDLER void AT_keyboard_handler(interrupt_frame* r)
-{
-	const uint8_t key = inb(0x60);
-	acknowledge_irq(1);
+//scancodes that came in since the softirq last ran
+#define SCANCODE_BUFFER_SIZE 16
+
+static uint8_t scancodes[SCANCODE_BUFFER_SIZE];
+static volatile size_t scancodes_front = 0;
+static volatile size_t scancodes_back = 0;
 
+static void translate_scancode(uint8_t key)
+{
 	uint8_t lookup = 0;
 	bool pressed = false;
 
@@ -102,6 +107,36 @@ static INTERRUPT_HANDLER void AT_keyboard_handler(interrupt_frame* r)
 	last_key = key;
 }
 
+static void AT_keyboard_softirq(void*)
+{
+	while(scancodes_back != scancodes_front)
+	{
+		const uint8_t key = scancodes[scancodes_back];
+		scancodes_back = (scancodes_back + 1) % SCANCODE_BUFFER_SIZE;
+
+		translate_scancode(key);
+	}
+}
+
+static softirq keyboard_softirq{AT_keyboard_softirq, nullptr};
+
+static INTERRUPT_HANDLER void AT_keyboard_handler(interrupt_frame* r)
+{
+	const uint8_t key = inb(0x60);
+	acknowledge_irq(1);
+
+	const size_t next = (scancodes_front + 1) % SCANCODE_BUFFER_SIZE;
+
+	if(next != scancodes_back)
+	{
+		scancodes[scancodes_front] = key;
+		scancodes_front = next;
+	}
+
+	softirq_raise(&keyboard_softirq);
+	softirq_run_pending(r);
+}
+
 extern "C" void AT_kbrd_init()
 {
 	irq_install_handler(1, AT_keyboard_handler);
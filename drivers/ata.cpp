@@ -4,6 +4,7 @@
 #include <kernel/filesystem/fs_driver.h>
 #include <kernel/interrupt.h>
 #include <kernel/sysclock.h>
+#include <kernel/softirq.h>
 #include <kernel/kassert.h>
 
 #include <drivers/portio.h>
@@ -112,7 +113,9 @@ static constinit sync::condition_variable irq_condition[2];
 static void ata_wait_irq(size_t index)
 {
 	sync::unique_lock l{irq_mtx[index]};
-	irq_condition[index].wait(l);
+
+	//if the interrupt got lost, polling the status afterwards finds out what the drive is doing
+	irq_condition[index].wait_until(l, sysclock_get_ticks() + sysclock_get_rate());
 }
 
 static void ata_delay400(uint8_t channel)
@@ -354,26 +357,34 @@ static ata_error ata_do_write(ata_drive& drive, uint8_t num_sectors, uint32_t lb
 	return ata_error::NONE;
 }
 
+//waking the waiting task is left for after the irq is acknowledged and interrupts are back on
+static void ata_irq_softirq(void* data)
+{
+	irq_condition[(size_t)data].notify_one();
+}
+
+static softirq ata_softirqs[2] = {
+	{ata_irq_softirq, (void*)0},
+	{ata_irq_softirq, (void*)1}
+};
+
 static INTERRUPT_HANDLER void ata_irq_handler0(interrupt_frame* r)
 {
 	inb(channels[0].base + ATA_REG_STATUS);
 	acknowledge_irq(14);
-	irq_condition[0].notify_one();
+	softirq_raise(&ata_softirqs[0]);
+	softirq_run_pending(r);
 }
 
 static INTERRUPT_HANDLER void ata_irq_handler1(interrupt_frame* r)
 {
-	outb(0xA0, 0x0B);
-	if(inb(0xA0) & (1 << 7))
-	{
-		inb(channels[1].base + ATA_REG_STATUS);
-		acknowledge_irq(15);
-		irq_condition[1].notify_one();
-	}
-	else
-	{
-		acknowledge_irq(7);
-	}
+	if(irq_is_spurious(15))
+		return;
+
+	inb(channels[1].base + ATA_REG_STATUS);
+	acknowledge_irq(15);
+	softirq_raise(&ata_softirqs[1]);
+	softirq_run_pending(r);
 }
 
 static ata_error ata_atapi_read(ata_drive& drive, uint32_t lba, uint8_t num_sectors, uint8_t* buffer)
@@ -736,12 +747,14 @@ static INTERRUPT_HANDLER void ata_irq_handler(interrupt_frame* r)
 
 	inb(channels[0].base + ATA_REG_STATUS);
 	inb(channels[1].base + ATA_REG_STATUS);
-	irq_condition[0].notify_one();
-	irq_condition[1].notify_one();
 
 	//outb(channels[0].bus_master + 0x2, inb(channels[0].bus_master + 0x2) | 4);
 
 	acknowledge_irq(channels[0].irq);
+
+	softirq_raise(&ata_softirqs[0]);
+	softirq_raise(&ata_softirqs[1]);
+	softirq_run_pending(r);
 }
 
 extern "C" int ata_init()
@@ -808,11 +821,32 @@ extern "C" int ata_init()
 		else
 			bar3 &= ~1;
 
-		auto interrupt_line = pci_read<uint8_t>(device, PCI_INTERRUPT_LINE);
+		size_t interrupt_line = pci_read<uint8_t>(device, PCI_INTERRUPT_LINE);
 
-		if(interrupt_line != 0)
+		uint32_t msi_address, msi_data;
+		int msi_irq = pci_find_capability(device, PCI_CAP_MSI)
+			? irq_allocate_msi(ata_irq_handler, &msi_address, &msi_data) : -1;
+
+		if(msi_irq >= 0 && !pci_enable_msi(device, msi_address, msi_data))
 		{
+			irq_free_msi(msi_irq);
+			msi_irq = -1;
+		}
+
+		if(msi_irq >= 0)
+		{
+			//the controller has its own vector, it doesn't share a line with anything
+			interrupt_line = msi_irq;
+		}
+		else if(interrupt_line != 0)
+		{
+			//in native mode the controller uses a PCI line instead of the ISA irqs
+			if(pci_read<uint8_t>(device, PCI_PROG_IF) & 0x01)
+			{
+				irq_set_level_triggered(interrupt_line);
+			}
 			irq_install_handler(interrupt_line, ata_irq_handler);
+			irq_enable(interrupt_line, true);
 		}
 		if(!ata_initialize_drives(bar0, bar1, bar2, bar3, bar4, interrupt_line, device))
 		{
@@ -67,6 +67,7 @@ static display_driver basic_text =
 	basic_text_get_framebuffer,
 
 	basic_text_set_display_offset,
+	nullptr,
 
 	basic_text_get_cursor_offset,
 	basic_text_set_cursor_offset,
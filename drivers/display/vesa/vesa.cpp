@@ -5,9 +5,10 @@
 #include <kernel/memorymanager.h>
 #include <kernel/physical_manager.h>
 #include <kernel/display.h>
-#include <kernel/util/hash.h>
 #include <kernel/kassert.h>
 
+#include <vector>
+
 //#include <drivers/rs232.h>
 //uint16_t serial_port;
 
@@ -19,9 +20,15 @@ static uintptr_t virtual_stack_end = 0x00080000;
 static uintptr_t virtual_stack_begin = virtual_stack_end - 1024;
 static uint8_t* virtual_stack = nullptr;
 
-static std::vector<uintptr_t>* pages_mapped;
-static std::vector<uintptr_t>* pages_allocated;
-static hash_map<uintptr_t, uintptr_t>* mapping_cache;
+//the real mode address space up to the end of the high memory area
+#define LOW_MEMORY_PAGES (0x110000 / PAGE_SIZE)
+
+//where each page of it is mapped for the emulator, filled in the first time the BIOS touches it
+//and kept from then on, so a BIOS call doesn't map and unmap the same pages every time
+static uintptr_t* low_memory_map = nullptr;
+
+//one emulator for every BIOS call, only its registers are reset in between
+static x86emu_t* vesa_emu = nullptr;
 
 struct __attribute__((packed)) far_ptr
 {
@@ -48,41 +55,33 @@ struct __attribute__((packed)) far_ptr
 	return len;
 }*/
 
-static void* translate_virtual_far_ptr(far_ptr t)
+//the IVT, the BIOS data area, the EBDA, video memory and the ROMs are used where they are
+static bool low_page_used_in_place(uintptr_t page_addr)
 {
-	uint32_t addr = (uint32_t)t.access();
+	return page_addr < 0x1000 || (page_addr >= 0x80000 && page_addr < 0x100000);
+}
 
-	if(addr >= low_page_begin && addr <= low_page_end)
+static uintptr_t map_low_page(uintptr_t page_addr)
+{
+	if(low_page_used_in_place(page_addr))
 	{
-		return virtual_bootsector + (addr - low_page_begin);
-	}
-	if(addr >= virtual_stack_begin && addr <= virtual_stack_end)
-	{
-		return virtual_stack + (addr - virtual_stack_begin);
+		return (uintptr_t)memmanager_map_to_new_pages(page_addr, 1, PAGE_PRESENT | PAGE_RW);
 	}
 
-	if(memmanager_get_physical(addr) == addr)
+	//anything else is only ours if nobody else has it
+	if(physical_memory_allocate_in_range(page_addr, page_addr + PAGE_SIZE,
+										 PAGE_SIZE, PAGE_SIZE))
 	{
-		return (void*)addr;
+		auto vaddr = (uintptr_t)memmanager_map_to_new_pages(page_addr, 1, PAGE_PRESENT | PAGE_RW);
+		k_assert(vaddr);
+		return vaddr;
 	}
 
-	uintptr_t page_addr = addr & ~(PAGE_SIZE - 1);
-	uintptr_t page_offset = addr - page_addr;
-
-	auto vaddr = (uintptr_t)memmanager_map_to_new_pages(page_addr, 1, PAGE_PRESENT | PAGE_RW);
-
-	if(vaddr)
-	{
-		return (void*)(vaddr + page_offset);
-	}
-	else
-	{
-		k_assert(false);
-		return nullptr;
-	}
+	k_assert(false);
+	return 0;
 }
 
-static void* map_address(uint32_t addr, bool write = false)
+static void* map_address(uint32_t addr)
 {
 	if(addr >= low_page_begin && addr <= low_page_end)
 	{
@@ -92,60 +91,46 @@ static void* map_address(uint32_t addr, bool write = false)
 	{
 		return virtual_stack + (addr - virtual_stack_begin);
 	}
-	
-	//allow touching the BDA
-	//if(addr < 0x500)
-	//	return (void*)addr;
-	//allow touching the EBDA
-	//if(addr >= 0x80000 && addr < 0x100000)
-	//	return (void*)addr;
 
-	uintptr_t page_addr = addr & ~(PAGE_SIZE - 1);
-	uintptr_t page_offset = addr - page_addr;
+	const size_t page = addr / PAGE_SIZE;
+	const uintptr_t page_offset = addr % PAGE_SIZE;
+
+	k_assert(page < LOW_MEMORY_PAGES);
 
-	if(uintptr_t vaddr; mapping_cache->lookup(page_addr, &vaddr))
+	if(!low_memory_map[page])
 	{
-		void* ret = (void*)(vaddr + page_offset);
-		return ret;
+		low_memory_map[page] = map_low_page(page * PAGE_SIZE);
 	}
 
-	//if(!write && memmanager_get_physical(page_addr) == page_addr)
-	//{
-	//	return (void*)addr;
-	//}
+	return (void*)(low_memory_map[page] + page_offset);
+}
 
-	//if(write)
-	//	ser_printf("writing %X\r\n", addr);
-	//else
-	//	ser_printf("reading %X\r\n", addr);
+static void* translate_virtual_far_ptr(far_ptr t)
+{
+	return map_address((uint32_t)t.access());
+}
 
-	if(page_addr < 0x1000 || (page_addr >= 0x80000 && page_addr < 0x100000))
+static void release_low_memory()
+{
+	for(size_t page = 0; page < LOW_MEMORY_PAGES; page++)
 	{
-		auto vaddr = (uintptr_t)memmanager_map_to_new_pages(page_addr, 1, PAGE_PRESENT | PAGE_RW);
-		pages_mapped->push_back(vaddr);
-		mapping_cache->insert(page_addr, vaddr);
-		return (void*)(vaddr + page_offset);
-	}
+		if(!low_memory_map[page])
+		{
+			continue;
+		}
 
-	uintptr_t vaddr = (uintptr_t)nullptr;
-	if(mapping_cache && !mapping_cache->lookup(page_addr, &vaddr))
-	{
-		if(physical_memory_allocate_in_range(page_addr, page_addr + PAGE_SIZE,
-											 PAGE_SIZE, PAGE_SIZE))
+		if(low_page_used_in_place(page * PAGE_SIZE))
 		{
-			//ser_printf("mapping %X to %X page\r\n", page_addr, vaddr);
-			vaddr = (uintptr_t)memmanager_map_to_new_pages(page_addr, 1, PAGE_PRESENT | PAGE_RW);
-			k_assert(vaddr);
+			memmanager_unmap_pages((void*)low_memory_map[page], 1);
 		}
 		else
 		{
-			vaddr = (uintptr_t)memmanager_virtual_alloc(nullptr, 1, PAGE_RW);
-			k_assert(false);
+			memmanager_free_pages((void*)low_memory_map[page], 1);
 		}
-		pages_allocated->push_back(vaddr);
-		mapping_cache->insert(page_addr, vaddr);
 	}
-	return (void*)(vaddr + page_offset);
+
+	delete[] low_memory_map;
+	low_memory_map = nullptr;
 }
 
 template<typename T> static uint32_t mem_read(uint32_t addr)
@@ -157,7 +142,7 @@ template<typename T> static uint32_t mem_read(uint32_t addr)
 template<typename T> static void mem_write(uint32_t addr, uint32_t val)
 {
 	T tval = (T)val;
-	*(T*)map_address(addr, true) = tval;
+	*(T*)map_address(addr) = tval;
 }
 
 static unsigned memio_handler(x86emu_t * emu, u32 addr, u32 * val, unsigned type)
@@ -237,17 +222,13 @@ static unsigned memio_handler(x86emu_t * emu, u32 addr, u32 * val, unsigned type
 	return 0;
 }
 
-static x86emu_t* int10h_start(uint16_t ax, uint16_t bx, uint16_t cx, uint16_t dx, uint16_t es, uint16_t di)
+static x86emu_t* int10h_run(uint16_t ax, uint16_t bx, uint16_t cx, uint16_t dx, uint16_t es, uint16_t di)
 {
 	//ser_printf("int 10h; ax = %X\r\n", ax);
 
-	pages_mapped = new std::vector<uintptr_t>();
-	pages_allocated = new std::vector<uintptr_t>();
-	mapping_cache = new hash_map<uintptr_t, uintptr_t>();
+	auto emu = vesa_emu;
 
-	auto emu = x86emu_new(X86EMU_PERM_RWX, X86EMU_PERM_RWX);
-
-	x86emu_set_memio_handler(emu, &memio_handler);
+	x86emu_reset(emu);
 
 	x86emu_set_seg_register(emu, emu->x86.R_CS_SEL, 0);
 	x86emu_set_seg_register(emu, emu->x86.R_SS_SEL, virtual_stack_end / 0x10);
@@ -267,36 +248,9 @@ static x86emu_t* int10h_start(uint16_t ax, uint16_t bx, uint16_t cx, uint16_t dx
 	return emu;
 }
 
-
-static void int10h_cleanup(x86emu_t* emu)
-{
-	x86emu_done(emu);
-
-	for(auto page : *pages_mapped)
-	{
-		memmanager_unmap_pages((void*)page, 1);
-	}
-
-	for(auto page : *pages_allocated)
-	{
-		memmanager_free_pages((void*)page, 1);
-	}
-
-	delete pages_allocated;
-	delete pages_mapped;
-	delete mapping_cache;
-}
-
 static uint16_t int10h(uint16_t ax, uint16_t bx, uint16_t cx, uint16_t dx, uint16_t es, uint16_t di)
 { 
-	//ser_printf("int 10h; ax = %X\r\n", ax);
-
-	auto emu = int10h_start(ax, bx, cx, dx, es, di);
-	auto result_ax = emu->x86.R_AX;
-
-	int10h_cleanup(emu);
-
-	return result_ax;
+	return int10h_run(ax, bx, cx, dx, es, di)->x86.R_AX;
 }
 
 //based on SDL_MasksToPixelFormatEnum from SDL2
@@ -549,6 +503,7 @@ struct vesa_mode
 	uintptr_t fb_addr;
 	size_t index;
 	bool is_vesa;
+	bool vga_compatible;	//the VGA registers still work, like the status register with the retrace bit
 };
 
 template <typename R>
@@ -610,40 +565,69 @@ static void vesa_set_diplay_offset(size_t offset, bool on_retrace)
 					 : "%edi", "memory", "cc");
 }
 
-static bool vesa_get_pm_interface()
+//VBE has nothing for this, but most modes are VGA compatible and keep the VGA status register going
+//for the ones that aren't it never changes, and the flip queue gives up on it
+static bool vesa_in_vertical_retrace()
 {
-	auto emu = int10h_start(0x4f0A, 0, 0, 0, 0, 0);
+	if(current_mode_index == -1 || !(*vesa_modes)[current_mode_index].vga_compatible)
+	{
+		return false;
+	}
 
-	bool success = emu->x86.R_AX == 0x4f;
+	return inb(0x3DA) & 0x08;
+}
+
+//the interface can ask for IO ports, which the kernel has anyway, and for memory through a selector in ES,
+//which we don't set up, so it's only used when the memory list is empty
+static bool vesa_pm_interface_usable(const uint8_t* table, size_t table_size)
+{
+	const vesa_pm_funcs* funcs = (const vesa_pm_funcs*)table;
 
-	if(success)
+	if(table_size < sizeof(vesa_pm_funcs) || funcs->set_display_offset >= table_size)
 	{
-		size_t table_size = emu->x86.R_CX;
+		return false;
+	}
 
-		far_ptr table_ptr{emu->x86.R_DI, emu->x86.R_ES};
+	if(funcs->permissions_offset == 0)
+	{
+		return true;
+	}
 
-		uint8_t* func_table = (uint8_t*)translate_virtual_far_ptr(table_ptr);
+	size_t offset = funcs->permissions_offset;
 
-		vesa_pm_interface = new uint8_t[table_size];
+	//the ports, then the memory, each list ends with 0xFFFF
+	for(; offset + 2 <= table_size && *(const uint16_t*)(table + offset) != 0xFFFF; offset += 2);
 
-		memcpy(vesa_pm_interface, func_table, table_size);
+	offset += 2;
 
-		/*uint8_t* func_ptr = vesa_pm_interface +
-			((vesa_pm_funcs*)vesa_pm_interface)->set_display_offset;
+	return offset + 2 <= table_size && *(const uint16_t*)(table + offset) == 0xFFFF;
+}
 
-		printf("%X\n", table_size);
-		printf("%X\n", ((vesa_pm_funcs*)func_table)->set_display_offset);
+static bool vesa_get_pm_interface()
+{
+	auto emu = int10h_run(0x4f0A, 0, 0, 0, 0, 0);
 
-		for(size_t i = 0; func_ptr[i] != 0xc3; i++)
-		{
-			printf("%02X ", func_ptr[i]);
-		}
-		while(true);*/
+	if(emu->x86.R_AX != 0x4f)
+	{
+		return false;
+	}
+
+	size_t table_size = emu->x86.R_CX;
+
+	far_ptr table_ptr{emu->x86.R_DI, emu->x86.R_ES};
+
+	uint8_t* func_table = (uint8_t*)translate_virtual_far_ptr(table_ptr);
+
+	if(!vesa_pm_interface_usable(func_table, table_size))
+	{
+		return false;
 	}
 
-	int10h_cleanup(emu);
+	vesa_pm_interface = new uint8_t[table_size];
+
+	memcpy(vesa_pm_interface, func_table, table_size);
 
-	return success;
+	return true;
 }
 
 static bool vesa_populate_modes()
@@ -740,7 +724,8 @@ static bool vesa_populate_modes()
 		vesa_modes->push_back({
 			frame_buffer,
 			mode,
-			true
+			true,
+			!(mode_info->attributes & 0x20)
 		});
 
 
@@ -757,7 +742,7 @@ static bool vesa_populate_modes()
 	//add 1 vga text mode as a fallback
 	available_modes->push_back(
 		{80, 25, 80, 70, 16, FORMAT_TEXT_W_ATTRIBUTE, DISPLAY_TEXT_MODE, 25*80});
-	vesa_modes->push_back({0xB8000, 0x03, false});
+	vesa_modes->push_back({0xB8000, 0x03, false, true});
 
 	return true;
 }
@@ -816,6 +801,7 @@ static display_driver vesa_driver =
 	vesa_get_framebuffer,
 
 	vesa_set_diplay_offset,
+	vesa_in_vertical_retrace,
 
 	vesa_get_cursor_offset,
 	vesa_set_cursor_offset,
@@ -832,11 +818,20 @@ extern "C" void vesa_init()
 	virtual_bootsector = new uint8_t[low_page_end - low_page_begin];
 	virtual_stack = new uint8_t[virtual_stack_end - virtual_stack_begin];
 
+	low_memory_map = new uintptr_t[LOW_MEMORY_PAGES];
+	memset(low_memory_map, 0, LOW_MEMORY_PAGES * sizeof(uintptr_t));
+
+	vesa_emu = x86emu_new(X86EMU_PERM_RWX, X86EMU_PERM_RWX);
+	x86emu_set_memio_handler(vesa_emu, &memio_handler);
+
 	available_modes = new std::vector<display_mode>();
 	vesa_modes = new std::vector<vesa_mode>();
 
 	if(!vesa_populate_modes())
 	{
+		x86emu_done(vesa_emu);
+		vesa_emu = nullptr;
+		release_low_memory();
 		delete[] virtual_stack;
 		delete[] virtual_bootsector;
 		delete available_modes;
@@ -844,7 +839,10 @@ extern "C" void vesa_init()
 		return;
 	}
 
-	vesa_get_pm_interface();
+	if(vesa_get_pm_interface())
+	{
+		printf("\tprotected mode interface for display offsets\n");
+	}
 
 	vesa_driver.available_modes = available_modes->data();
 	vesa_driver.num_modes = available_modes->size();
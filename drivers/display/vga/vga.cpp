@@ -303,12 +303,18 @@ static void vga_set_display_offset(size_t offset, bool on_retrace)
 	outw(VGA_CRTC_INDEX, LOW_ADDRESS | (offset << 8));
 }
 
+static bool vga_in_vertical_retrace()
+{
+	return inb(INPUT_STATUS_1) & VRETRACE;
+}
+
 static display_driver vga_driver =
 {
 	vga_set_mode,
 	vga_get_framebuffer,
 
 	vga_set_display_offset,
+	vga_in_vertical_retrace,
 
 	vga_get_cursor_offset,
 	vga_set_cursor_offset,
@@ -6,6 +6,8 @@
 #include <kernel/interrupt.h>
 #include <kernel/locks.h>
 #include <kernel/sysclock.h>
+#include <kernel/timer.h>
+#include <kernel/softirq.h>
 #include <kernel/kassert.h>
 
 #include <drivers/portio.h>
@@ -71,6 +73,7 @@ enum floppy_commands
 #define MT_BIT 0x80
 
 static bool motor_is_ready[2] = {false, false};
+static kernel_timer motor_off_timer[2];
 static constinit sync::mutex irq6_mtx{};
 static constinit sync::condition_variable irq6_condition{};
 
@@ -86,10 +89,18 @@ static disk_driver floppy_driver = {
 	isa_dma_free_buffer
 };
 
+static void floppy_irq_softirq(void*)
+{
+	irq6_condition.notify_one();
+}
+
+static softirq floppy_softirq{floppy_irq_softirq, nullptr};
+
 static INTERRUPT_HANDLER void floppy_irq_handler(interrupt_frame* r)
 {
 	acknowledge_irq(6);
-	irq6_condition.notify_one();
+	softirq_raise(&floppy_softirq);
+	softirq_run_pending(r);
 }
 
 static void wait_for_irq6(void)
@@ -338,8 +349,19 @@ static uint8_t floppy_getbyte()
 	return -1; //read timeout 
 }
 
+static void floppy_motor_off_now(void* data)
+{
+	uint8_t driveNum = (uintptr_t)data;
+
+	outb(DIGITAL_OUTPUT_REGISTER, 0x0c | (driveNum & 0x03));
+	motor_is_ready[driveNum] = false;
+}
+
 static void floppy_motor_on(uint8_t driveNum)
 {
+	//it's still spinning if the countdown to turn it off hasn't run out
+	timer_cancel(&motor_off_timer[driveNum]);
+
 	if(!motor_is_ready[driveNum])
 	{
 		outb(DIGITAL_OUTPUT_REGISTER, (0x10 << driveNum) | 0x0c | (driveNum & 0x03));
@@ -352,9 +374,14 @@ static void floppy_motor_off(uint8_t driveNum)
 {
 	if(motor_is_ready[driveNum])
 	{
-		outb(DIGITAL_OUTPUT_REGISTER, 0x0c | (driveNum & 0x03));
-		sysclock_sleep(2000, MILLISECONDS);   // start motor kill countdown: 2s
-		motor_is_ready[driveNum] = false;
+		//start motor kill countdown: 2s, so it doesn't have to spin up again if it's needed soon
+		clock_t deadline = sysclock_get_ticks() + 2 * sysclock_get_rate();
+
+		timer_cancel(&motor_off_timer[driveNum]);
+		if(!timer_start(&motor_off_timer[driveNum], deadline, floppy_motor_off_now, (void*)(uintptr_t)driveNum))
+		{
+			floppy_motor_off_now((void*)(uintptr_t)driveNum);
+		}
 	}
 }
 
@@ -3,6 +3,7 @@
 #include <kernel/kassert.h>
 #include <kernel/rt_device.h>
 #include <kernel/locks.h>
+#include <kernel/softirq.h>
 #include <stdio.h>
 
 #define DATA_PORT 0x60
@@ -101,15 +102,63 @@ static void i8042_device_send(size_t channel, uint8_t data)
 	outb(DATA_PORT, data);
 }
 
+//the irq handlers only read the byte, the device drivers decode it in a softirq
+//a mouse packet can arrive while the softirq is still busy with the last one, so there's room for a few
+#define PORT_BUFFER_SIZE 16
+
+struct port_buffer
+{
+	uint8_t data[PORT_BUFFER_SIZE];
+	volatile size_t front;
+	volatile size_t back;
+};
+
+static port_buffer port_buffers[2];
+
+static void port_softirq(void* data)
+{
+	const size_t channel = (size_t)data;
+	port_buffer& buf = port_buffers[channel];
+
+	while(buf.back != buf.front)
+	{
+		const uint8_t byte = buf.data[buf.back];
+		buf.back = (buf.back + 1) % PORT_BUFFER_SIZE;
+
+		if(devices[channel] && devices[channel]->on_new_data)
+		{
+			devices[channel]->on_new_data(devices[channel], &byte, 1);
+		}
+	}
+}
+
+static softirq port_softirqs[2] = {
+	{port_softirq, (void*)0},
+	{port_softirq, (void*)1}
+};
+
+static void port_received(size_t channel, uint8_t data)
+{
+	port_buffer& buf = port_buffers[channel];
+	const size_t next = (buf.front + 1) % PORT_BUFFER_SIZE;
+
+	//drop it if the softirq is that far behind
+	if(next != buf.back)
+	{
+		buf.data[buf.front] = data;
+		buf.front = next;
+	}
+
+	softirq_raise(&port_softirqs[channel]);
+}
+
 static INTERRUPT_HANDLER void port0_handler(interrupt_frame* r)
 {
 	const uint8_t data = inb(DATA_PORT);
 	acknowledge_irq(1);
 
-	if(devices[0] && devices[0]->on_new_data)
-	{
-		devices[0]->on_new_data(devices[0], &data, 1);
-	}
+	port_received(0, data);
+	softirq_run_pending(r);
 }
 
 static INTERRUPT_HANDLER void port1_handler(interrupt_frame* r)
@@ -117,10 +166,8 @@ static INTERRUPT_HANDLER void port1_handler(interrupt_frame* r)
 	const uint8_t data = inb(DATA_PORT);
 	acknowledge_irq(12);
 
-	if(devices[1] && devices[1]->on_new_data)
-	{
-		devices[1]->on_new_data(devices[1], &data, 1);
-	}
+	port_received(1, data);
+	softirq_run_pending(r);
 }
 
 static bool i8042_wait_ack()
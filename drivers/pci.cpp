@@ -18,6 +18,15 @@
 #define PCI_ADDRESS_PORT 0xCF8
 #define PCI_VALUE_PORT   0xCFC
 
+#define PCI_MSI_CONTROL          0x02 // 2
+#define PCI_MSI_ADDRESS          0x04 // 4
+#define PCI_MSI_DATA_32          0x08 // 2
+#define PCI_MSI_DATA_64          0x0C // 2
+
+#define PCI_MSI_ENABLE           0x0001
+#define PCI_MSI_MULTIPLE_MASK    0x0070
+#define PCI_MSI_64BIT            0x0080
+
 static void pci_scan_bus(pci_func f, size_t d_class, size_t d_subclass, size_t bus, void* udata);
 
 static inline constexpr uint32_t pci_get_addr(pci_device device, size_t field)
@@ -158,3 +167,60 @@ void pci_device_by_class(pci_func f, size_t d_class, size_t d_subclass, void* ud
 		pci_scan_bus(f, d_class, d_subclass, 0, udata);
 	}
 }
+
+
+size_t pci_find_capability(pci_device device, uint8_t id)
+{
+	if(!(pci_read<uint16_t>(device, PCI_STATUS) & PCI_STATUS_CAPABILITIES))
+	{
+		return 0;
+	}
+
+	size_t offset = pci_read<uint8_t>(device, PCI_CAPABILITIES) & 0xFC;
+
+	//the list is limited to 48 entries so a broken device can't make us loop forever
+	for(size_t i = 0; offset != 0 && i < 48; i++)
+	{
+		if(pci_read<uint8_t>(device, offset) == id)
+		{
+			return offset;
+		}
+
+		offset = pci_read<uint8_t>(device, offset + 1) & 0xFC;
+	}
+
+	return 0;
+}
+
+bool pci_enable_msi(pci_device device, uint32_t address, uint32_t data)
+{
+	size_t msi = pci_find_capability(device, PCI_CAP_MSI);
+
+	if(!msi)
+	{
+		return false;
+	}
+
+	uint16_t control = pci_read<uint16_t>(device, msi + PCI_MSI_CONTROL);
+
+	pci_write<uint32_t>(device, msi + PCI_MSI_ADDRESS, address);
+
+	if(control & PCI_MSI_64BIT)
+	{
+		pci_write<uint32_t>(device, msi + PCI_MSI_ADDRESS + 4, 0);
+		pci_write<uint16_t>(device, msi + PCI_MSI_DATA_64, (uint16_t)data);
+	}
+	else
+	{
+		pci_write<uint16_t>(device, msi + PCI_MSI_DATA_32, (uint16_t)data);
+	}
+
+	//only one message, everything goes to the same vector
+	control &= ~PCI_MSI_MULTIPLE_MASK;
+	pci_write<uint16_t>(device, msi + PCI_MSI_CONTROL, control | PCI_MSI_ENABLE);
+
+	pci_write<uint16_t>(device, PCI_COMMAND,
+						pci_read<uint16_t>(device, PCI_COMMAND) | PCI_COMMAND_INTERRUPT_DISABLE);
+
+	return true;
+}
\ No newline at end of file
@@ -22,9 +22,16 @@
 #define PCI_SUBCLASS             0x0a // 1
 #define PCI_CLASS                0x0b // 1
 
+#define PCI_CAPABILITIES         0x34 // 1
+
 #define PCI_INTERRUPT_LINE       0x3C // 1
 #define PCI_INTERRUPT_PIN        0x3D
 
+#define PCI_COMMAND_INTERRUPT_DISABLE (1 << 10)
+#define PCI_STATUS_CAPABILITIES       (1 << 4)
+
+#define PCI_CAP_MSI              0x05
+
 struct pci_device
 {
 	uint8_t bus;
@@ -45,4 +52,11 @@ template<typename T> T pci_read(pci_device device, size_t field);
 
 template<typename T> void pci_write(pci_device device, size_t field, T value);
 
+//returns the offset of the capability in the config space, or 0 if the device doesn't have it
+size_t pci_find_capability(pci_device device, uint8_t id);
+
+//points the device's MSI at the address and data from irq_allocate_msi and turns off its interrupt pin
+//returns false if the device can't send MSIs
+bool pci_enable_msi(pci_device device, uint32_t address, uint32_t data);
+
 #endif
\ No newline at end of file
@@ -4,6 +4,9 @@
 #include <kernel/sysclock.h>
 #include <kernel/interrupt.h>
 #include <kernel/locks.h>
+#include <kernel/timer.h>
+#include <kernel/softirq.h>
+#include <kernel/profile.h>
 #include "pit.h"
 
 #define PIT_TICK_RATE 1193182
@@ -61,11 +64,39 @@ static void pit_set_irq_period(uint32_t divisor)
 	pit_timer_divisor = divisor - 1;
 }
 
+void pit_set_frequency(uint32_t hz)
+{
+	uint32_t divisor = hz ? PIT_TICK_RATE / hz : 0xFFFF;
+
+	if(divisor < 2) { divisor = 2; }
+	if(divisor > 0xFFFF) { divisor = 0xFFFF; }
+
+	int_lock l = lock_interrupts();
+
+	const uint16_t old_divisor = pit_timer_divisor;
+	const bool irq_pending = irq_is_requested(0);
+	const uint16_t pit_counter = read_pit_counter();
+
+	pit_set_irq_period(divisor);
+
+	//reprogramming restarts the count, so the part of the old period that has gone by is counted now
+	//an irq that's already waiting will add a whole new period, so that gets taken back off
+	pit_time_elapsed_count += old_divisor - (irq_pending ? pit_timer_divisor : pit_counter);
+
+	unlock_interrupts(l);
+}
+
 static INTERRUPT_HANDLER void pit_irq(interrupt_frame* r)
 {
 	pit_time_elapsed_count += pit_timer_divisor;
 
 	acknowledge_irq(0);
+
+	profile_tick(r, PROFILE_INTERRUPTED_FRAME());
+
+	//the only way timers expire without the APIC timer
+	timer_raise_softirq();
+	softirq_run_pending(r);
 }
 
 tick_t pit_get_tick_rate()
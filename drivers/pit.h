@@ -11,6 +11,9 @@ tick_t pit_get_tick_rate();
 tick_t pit_get_ticks();
 void pit_init();
 
+//how often irq 0 fires, 0 puts it back to the slowest rate it starts at
+void pit_set_frequency(uint32_t hz);
+
 #ifdef __cplusplus
 }
 #endif
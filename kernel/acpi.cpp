@@ -0,0 +1,149 @@
+#include <string.h>
+
+#include <kernel/acpi.h>
+#include <kernel/memorymanager.h>
+
+struct __attribute__((packed)) acpi_rsdp
+{
+	char signature[8];
+	uint8_t checksum;
+	char oem_id[6];
+	uint8_t revision;
+	uint32_t rsdt_address;
+};
+
+//where the BIOS keeps the segment of the extended BIOS data area
+#define BDA_EBDA_SEGMENT 0x40E
+#define BIOS_ROM_START 0xE0000
+#define BIOS_ROM_END 0x100000
+
+static const acpi_header* rsdt = nullptr;
+static bool rsdt_searched = false;
+
+static void* acpi_map(uintptr_t physical, size_t size)
+{
+	uintptr_t first_page = physical & ~(uintptr_t)(PAGE_SIZE - 1);
+	size_t num_pages = memmanager_minimum_pages(physical + size - first_page);
+
+	uint8_t* mapping = (uint8_t*)memmanager_map_to_new_pages(first_page, num_pages, PAGE_PRESENT);
+
+	return mapping ? mapping + (physical - first_page) : nullptr;
+}
+
+static void acpi_unmap(const void* address, size_t size)
+{
+	uintptr_t first_page = (uintptr_t)address & ~(uintptr_t)(PAGE_SIZE - 1);
+	memmanager_unmap_pages((void*)first_page, memmanager_minimum_pages((uintptr_t)address + size - first_page));
+}
+
+static bool acpi_checksum(const void* data, size_t size)
+{
+	uint8_t sum = 0;
+	for(size_t i = 0; i < size; i++)
+	{
+		sum += ((const uint8_t*)data)[i];
+	}
+	return sum == 0;
+}
+
+//the RSDP is on a 16 byte boundary in the first KiB of the EBDA or in the BIOS ROM
+static uintptr_t acpi_search_rsdp(uintptr_t physical, size_t size)
+{
+	const uint8_t* area = (const uint8_t*)acpi_map(physical, size);
+
+	if(!area) { return 0; }
+
+	uintptr_t rsdt_address = 0;
+
+	for(size_t offset = 0; offset + sizeof(acpi_rsdp) <= size; offset += 16)
+	{
+		auto rsdp = (const acpi_rsdp*)(area + offset);
+
+		if(memcmp(rsdp->signature, "RSD PTR ", 8) == 0 && acpi_checksum(rsdp, sizeof(acpi_rsdp)))
+		{
+			rsdt_address = rsdp->rsdt_address;
+			break;
+		}
+	}
+
+	acpi_unmap(area, size);
+	return rsdt_address;
+}
+
+static const acpi_header* acpi_map_table(uintptr_t physical)
+{
+	auto header = (const acpi_header*)acpi_map(physical, sizeof(acpi_header));
+
+	if(!header) { return nullptr; }
+
+	size_t length = header->length;
+	acpi_unmap(header, sizeof(acpi_header));
+
+	auto table = (const acpi_header*)acpi_map(physical, length);
+
+	if(table && !acpi_checksum(table, length))
+	{
+		acpi_unmap(table, length);
+		return nullptr;
+	}
+
+	return table;
+}
+
+static const acpi_header* acpi_find_rsdt()
+{
+	const uint16_t* bda = (const uint16_t*)acpi_map(BDA_EBDA_SEGMENT, sizeof(uint16_t));
+
+	uintptr_t ebda = 0;
+	if(bda)
+	{
+		ebda = (uintptr_t)*bda << 4;
+		acpi_unmap(bda, sizeof(uint16_t));
+	}
+
+	uintptr_t rsdt_address = 0;
+
+	if(ebda)
+	{
+		rsdt_address = acpi_search_rsdp(ebda, 1024);
+	}
+
+	if(!rsdt_address)
+	{
+		rsdt_address = acpi_search_rsdp(BIOS_ROM_START, BIOS_ROM_END - BIOS_ROM_START);
+	}
+
+	return rsdt_address ? acpi_map_table(rsdt_address) : nullptr;
+}
+
+const acpi_header* acpi_find_table(const char* signature)
+{
+	if(!rsdt_searched)
+	{
+		rsdt = acpi_find_rsdt();
+		rsdt_searched = true;
+	}
+
+	if(!rsdt) { return nullptr; }
+
+	//the RSDT is followed by the physical addresses of all the other tables
+	size_t num_tables = (rsdt->length - sizeof(acpi_header)) / sizeof(uint32_t);
+	const uint32_t* tables = (const uint32_t*)(rsdt + 1);
+
+	for(size_t i = 0; i < num_tables; i++)
+	{
+		auto header = (const acpi_header*)acpi_map(tables[i], sizeof(acpi_header));
+
+		if(!header) { continue; }
+
+		bool found = memcmp(header->signature, signature, 4) == 0;
+		acpi_unmap(header, sizeof(acpi_header));
+
+		if(found)
+		{
+			return acpi_map_table(tables[i]);
+		}
+	}
+
+	return nullptr;
+}
\ No newline at end of file
@@ -0,0 +1,30 @@
+#ifndef ACPI_H
+#define ACPI_H
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stdint.h>
+#include <stddef.h>
+
+typedef struct __attribute__((packed))
+{
+	char signature[4];
+	uint32_t length;
+	uint8_t revision;
+	uint8_t checksum;
+	char oem_id[6];
+	char oem_table_id[8];
+	uint32_t oem_revision;
+	uint32_t creator_id;
+	uint32_t creator_revision;
+} acpi_header;
+
+//finds a table by its 4 letter signature, like "APIC" for the MADT
+//the table stays mapped in kernel memory, returns null if there is no such table
+const acpi_header* acpi_find_table(const char* signature);
+
+#ifdef __cplusplus
+}
+#endif
+#endif
\ No newline at end of file
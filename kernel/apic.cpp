@@ -0,0 +1,478 @@
+#include <stdio.h>
+
+#include <kernel/apic.h>
+#include <kernel/acpi.h>
+#include <kernel/interrupt.h>
+#include <kernel/memorymanager.h>
+#include <kernel/sysclock.h>
+#include <kernel/locks.h>
+#include <common/cpuid.h>
+
+#define MSR_APIC_BASE 0x1B
+#define APIC_BASE_ENABLE 0x800
+#define APIC_BASE_ADDRESS_MASK 0xFFFFF000
+
+#define APIC_REG_ID			0x020
+#define APIC_REG_TPR		0x080
+#define APIC_REG_EOI		0x0B0
+#define APIC_REG_SPURIOUS	0x0F0
+#define APIC_REG_IRR		0x200
+#define APIC_REG_ICR_LOW	0x300
+#define APIC_REG_ICR_HIGH	0x310
+#define APIC_REG_LVT_TIMER	0x320
+#define APIC_REG_TIMER_INITIAL	0x380
+#define APIC_REG_TIMER_CURRENT	0x390
+#define APIC_REG_TIMER_DIVIDE	0x3E0
+
+#define APIC_SOFTWARE_ENABLE	0x100
+#define APIC_ICR_PENDING		0x1000
+#define APIC_ICR_ALL_BUT_SELF	0xC0000
+
+#define APIC_LVT_MASKED			0x10000
+#define APIC_TIMER_PERIODIC		0x20000
+#define APIC_TIMER_DIVIDE_16	0x3
+
+#define IOAPIC_REG_SELECT	0x00
+#define IOAPIC_REG_WINDOW	0x10
+
+#define IOAPIC_VERSION		0x01
+#define IOAPIC_REDIRECTION	0x10
+
+#define IOAPIC_ACTIVE_LOW		0x2000
+#define IOAPIC_LEVEL_TRIGGERED	0x8000
+#define IOAPIC_MASKED			0x10000
+
+#define MAX_IO_APICS 8
+#define NUM_ISA_IRQS 16
+
+#define MADT_LOCAL_APIC 0
+#define MADT_IO_APIC 1
+#define MADT_INTERRUPT_OVERRIDE 2
+
+#define MADT_LOCAL_APIC_ENABLED 0x01
+
+#define MADT_POLARITY_MASK	0x03
+#define MADT_POLARITY_LOW	0x03
+#define MADT_TRIGGER_MASK	0x0C
+#define MADT_TRIGGER_LEVEL	0x0C
+
+struct __attribute__((packed)) madt
+{
+	acpi_header header;
+	uint32_t local_apic_address;
+	uint32_t flags;
+};
+
+struct __attribute__((packed)) madt_entry
+{
+	uint8_t type;
+	uint8_t length;
+};
+
+struct __attribute__((packed)) madt_local_apic
+{
+	madt_entry entry;
+	uint8_t processor_id;
+	uint8_t apic_id;
+	uint32_t flags;
+};
+
+struct __attribute__((packed)) madt_io_apic
+{
+	madt_entry entry;
+	uint8_t io_apic_id;
+	uint8_t reserved;
+	uint32_t address;
+	uint32_t gsi_base;
+};
+
+struct __attribute__((packed)) madt_interrupt_override
+{
+	madt_entry entry;
+	uint8_t bus;
+	uint8_t source;
+	uint32_t gsi;
+	uint16_t flags;
+};
+
+struct io_apic
+{
+	volatile uint32_t* registers;
+	uint32_t gsi_base;
+	uint32_t num_pins;
+};
+
+//where an irq is connected and how, the flags are the ones in the redirection entry
+struct irq_line
+{
+	uint32_t gsi;
+	uint32_t flags;
+	bool has_polarity; //the madt gave a polarity instead of leaving it to the bus
+};
+
+static volatile uint32_t* apic_registers = nullptr;
+
+static uint32_t apic_timer_rate = 0;
+
+static io_apic io_apics[MAX_IO_APICS];
+static size_t num_io_apics = 0;
+
+static irq_line isa_irqs[NUM_ISA_IRQS];
+
+//the redirection entries are only reached through the select and window registers
+static constinit sync::spinlock ioapic_lock{};
+
+static inline uint64_t read_msr(uint32_t msr)
+{
+	uint32_t low, high;
+	__asm__ volatile("rdmsr" : "=a"(low), "=d"(high) : "c"(msr));
+	return ((uint64_t)high << 32) | low;
+}
+
+static inline void write_msr(uint32_t msr, uint64_t value)
+{
+	__asm__ volatile("wrmsr" :: "c"(msr), "a"((uint32_t)value), "d"((uint32_t)(value >> 32)));
+}
+
+static inline uint32_t apic_read(size_t reg)
+{
+	return apic_registers[reg / sizeof(uint32_t)];
+}
+
+static inline void apic_write(size_t reg, uint32_t value)
+{
+	apic_registers[reg / sizeof(uint32_t)] = value;
+}
+
+//nothing to acknowledge, it only shows up when an interrupt goes away before it's delivered
+static INTERRUPT_HANDLER void apic_spurious_irq(interrupt_frame* r)
+{
+}
+
+//calls func with every entry of the MADT, returns false if there isn't one
+template<typename Func>
+static bool madt_for_each(Func&& func)
+{
+	auto table = (const madt*)acpi_find_table("APIC");
+
+	if(!table)
+	{
+		return false;
+	}
+
+	const uint8_t* entries = (const uint8_t*)(table + 1);
+	const uint8_t* end = (const uint8_t*)table + table->header.length;
+
+	while(entries < end)
+	{
+		auto entry = (const madt_entry*)entries;
+
+		if(entry->length == 0) { break; }
+
+		func(entry);
+
+		entries += entry->length;
+	}
+
+	return true;
+}
+
+bool apic_init(void)
+{
+	if(apic_registers)
+	{
+		return true;
+	}
+
+	if(!(cpu_detect_features() & CPU_FEATURE_APIC))
+	{
+		return false;
+	}
+
+	uint64_t base = read_msr(MSR_APIC_BASE);
+	write_msr(MSR_APIC_BASE, base | APIC_BASE_ENABLE);
+
+	apic_registers = (volatile uint32_t*)memmanager_map_to_new_pages(base & APIC_BASE_ADDRESS_MASK, 1,
+																	 PAGE_PRESENT | PAGE_RW | PAGE_CACHE_DISABLE | PAGE_WRITE_THROUGH);
+
+	if(!apic_registers)
+	{
+		return false;
+	}
+
+	isr_install_handler(APIC_SPURIOUS_VECTOR, apic_spurious_irq, false);
+
+	apic_enable();
+
+	return true;
+}
+
+void apic_enable(void)
+{
+	apic_write(APIC_REG_TPR, 0);
+	apic_write(APIC_REG_SPURIOUS, APIC_SOFTWARE_ENABLE | APIC_SPURIOUS_VECTOR);
+}
+
+uint32_t apic_get_id(void)
+{
+	return apic_read(APIC_REG_ID) >> 24;
+}
+
+void apic_eoi(void)
+{
+	apic_write(APIC_REG_EOI, 0);
+}
+
+bool apic_is_requested(uint8_t vector)
+{
+	return apic_read(APIC_REG_IRR + (vector / 32) * 0x10) & (1 << (vector % 32));
+}
+
+static void apic_wait_for_delivery()
+{
+	while(apic_read(APIC_REG_ICR_LOW) & APIC_ICR_PENDING)
+	{
+		__asm__ volatile("rep; nop");
+	}
+}
+
+void apic_send_ipi(uint32_t apic_id, uint32_t command)
+{
+	apic_wait_for_delivery();
+
+	apic_write(APIC_REG_ICR_HIGH, apic_id << 24);
+	apic_write(APIC_REG_ICR_LOW, command); //writing the low half sends it
+}
+
+void apic_broadcast_ipi(uint8_t vector)
+{
+	apic_wait_for_delivery();
+
+	apic_write(APIC_REG_ICR_LOW, APIC_ICR_ALL_BUT_SELF | APIC_IPI_ASSERT | APIC_IPI_FIXED | vector);
+}
+
+size_t apic_find_processors(uint32_t* ids, size_t max_ids)
+{
+	size_t num_found = 0;
+
+	madt_for_each([&](const madt_entry* entry) {
+		if(entry->type != MADT_LOCAL_APIC || num_found == max_ids)
+			return;
+
+		auto local_apic = (const madt_local_apic*)entry;
+
+		if(local_apic->flags & MADT_LOCAL_APIC_ENABLED)
+		{
+			ids[num_found++] = local_apic->apic_id;
+		}
+	});
+
+	return num_found;
+}
+
+void apic_timer_calibrate(void)
+{
+	if(!apic_registers)
+	{
+		return;
+	}
+
+	apic_write(APIC_REG_TIMER_DIVIDE, APIC_TIMER_DIVIDE_16);
+	apic_write(APIC_REG_LVT_TIMER, APIC_LVT_MASKED | APIC_TIMER_VECTOR);
+
+	//the PIT is read right before and after so the time it takes to read it is counted too
+	clock_t start = sysclock_get_ticks();
+	apic_write(APIC_REG_TIMER_INITIAL, 0xFFFFFFFF);
+
+	sysclock_delay(10, MILLISECONDS);
+
+	uint32_t counted = 0xFFFFFFFF - apic_read(APIC_REG_TIMER_CURRENT);
+	clock_t elapsed = sysclock_get_ticks() - start;
+
+	apic_write(APIC_REG_TIMER_INITIAL, 0);
+
+	apic_timer_rate = (uint32_t)((uint64_t)counted * sysclock_get_rate() / elapsed);
+
+	printf("APIC timer runs at %d KHz\n", apic_timer_rate / 1000);
+}
+
+uint32_t apic_timer_get_rate(void)
+{
+	return apic_timer_rate;
+}
+
+void apic_timer_start_periodic(uint32_t hz)
+{
+	apic_write(APIC_REG_TIMER_DIVIDE, APIC_TIMER_DIVIDE_16);
+	apic_write(APIC_REG_LVT_TIMER, APIC_TIMER_PERIODIC | APIC_TIMER_VECTOR);
+	apic_write(APIC_REG_TIMER_INITIAL, apic_timer_rate / hz);
+}
+
+void apic_timer_start_oneshot(uint32_t microseconds)
+{
+	uint64_t count = (uint64_t)apic_timer_rate * microseconds / 1000000;
+
+	if(count == 0) { count = 1; } //0 would stop the timer
+	if(count > 0xFFFFFFFF) { count = 0xFFFFFFFF; }
+
+	apic_write(APIC_REG_TIMER_DIVIDE, APIC_TIMER_DIVIDE_16);
+	apic_write(APIC_REG_LVT_TIMER, APIC_TIMER_VECTOR);
+	apic_write(APIC_REG_TIMER_INITIAL, (uint32_t)count);
+}
+
+void apic_timer_stop(void)
+{
+	apic_write(APIC_REG_LVT_TIMER, APIC_LVT_MASKED | APIC_TIMER_VECTOR);
+	apic_write(APIC_REG_TIMER_INITIAL, 0);
+}
+
+static uint32_t ioapic_read(const io_apic& io, uint32_t reg)
+{
+	io.registers[IOAPIC_REG_SELECT / sizeof(uint32_t)] = reg;
+	return io.registers[IOAPIC_REG_WINDOW / sizeof(uint32_t)];
+}
+
+static void ioapic_write(const io_apic& io, uint32_t reg, uint32_t value)
+{
+	io.registers[IOAPIC_REG_SELECT / sizeof(uint32_t)] = reg;
+	io.registers[IOAPIC_REG_WINDOW / sizeof(uint32_t)] = value;
+}
+
+static irq_line ioapic_get_line(size_t irq)
+{
+	if(irq < NUM_ISA_IRQS)
+	{
+		return isa_irqs[irq];
+	}
+
+	return {(uint32_t)irq, IOAPIC_LEVEL_TRIGGERED | IOAPIC_ACTIVE_LOW, true};
+}
+
+static const io_apic* ioapic_for_gsi(uint32_t gsi)
+{
+	for(size_t i = 0; i < num_io_apics; i++)
+	{
+		if(gsi >= io_apics[i].gsi_base && gsi < io_apics[i].gsi_base + io_apics[i].num_pins)
+		{
+			return &io_apics[i];
+		}
+	}
+
+	return nullptr;
+}
+
+bool ioapic_init(void)
+{
+	for(size_t i = 0; i < NUM_ISA_IRQS; i++)
+	{
+		isa_irqs[i] = {(uint32_t)i, 0, false}; //ISA irqs are edge triggered and active high
+	}
+
+	bool found = madt_for_each([](const madt_entry* entry) {
+		if(entry->type == MADT_IO_APIC && num_io_apics < MAX_IO_APICS)
+		{
+			auto info = (const madt_io_apic*)entry;
+
+			auto registers = (volatile uint32_t*)memmanager_map_to_new_pages(info->address & APIC_BASE_ADDRESS_MASK, 1,
+																			 PAGE_PRESENT | PAGE_RW | PAGE_CACHE_DISABLE | PAGE_WRITE_THROUGH);
+			if(!registers)
+				return;
+
+			io_apic& io = io_apics[num_io_apics++];
+			io.registers = registers + (info->address & ~APIC_BASE_ADDRESS_MASK) / sizeof(uint32_t);
+			io.gsi_base = info->gsi_base;
+			io.num_pins = ((ioapic_read(io, IOAPIC_VERSION) >> 16) & 0xFF) + 1;
+		}
+		else if(entry->type == MADT_INTERRUPT_OVERRIDE)
+		{
+			auto info = (const madt_interrupt_override*)entry;
+
+			if(info->source >= NUM_ISA_IRQS)
+				return;
+
+			uint32_t flags = 0;
+
+			if((info->flags & MADT_POLARITY_MASK) == MADT_POLARITY_LOW)
+				flags |= IOAPIC_ACTIVE_LOW;
+
+			if((info->flags & MADT_TRIGGER_MASK) == MADT_TRIGGER_LEVEL)
+				flags |= IOAPIC_LEVEL_TRIGGERED;
+
+			isa_irqs[info->source] = {info->gsi, flags, (info->flags & MADT_POLARITY_MASK) != 0};
+		}
+	});
+
+	if(!found || num_io_apics == 0)
+	{
+		return false;
+	}
+
+	for(size_t i = 0; i < num_io_apics; i++)
+	{
+		for(size_t pin = 0; pin < io_apics[i].num_pins; pin++)
+		{
+			ioapic_write(io_apics[i], IOAPIC_REDIRECTION + pin * 2, IOAPIC_MASKED);
+		}
+	}
+
+	return true;
+}
+
+void ioapic_route_irq(size_t irq, uint8_t vector, uint32_t apic_id, bool masked)
+{
+	irq_line line = ioapic_get_line(irq);
+	const io_apic* io = ioapic_for_gsi(line.gsi);
+
+	if(!io)
+		return;
+
+	uint32_t reg = IOAPIC_REDIRECTION + (line.gsi - io->gsi_base) * 2;
+
+	sync::lock_guard l{ioapic_lock};
+
+	ioapic_write(*io, reg, IOAPIC_MASKED);
+	ioapic_write(*io, reg + 1, apic_id << 24);
+	ioapic_write(*io, reg, line.flags | vector | (masked ? IOAPIC_MASKED : 0));
+}
+
+void ioapic_set_masked(size_t irq, bool masked)
+{
+	irq_line line = ioapic_get_line(irq);
+	const io_apic* io = ioapic_for_gsi(line.gsi);
+
+	if(!io)
+		return;
+
+	uint32_t reg = IOAPIC_REDIRECTION + (line.gsi - io->gsi_base) * 2;
+
+	sync::lock_guard l{ioapic_lock};
+
+	uint32_t entry = ioapic_read(*io, reg);
+	ioapic_write(*io, reg, masked ? (entry | IOAPIC_MASKED) : (entry & ~IOAPIC_MASKED));
+}
+
+void ioapic_set_level_triggered(size_t irq)
+{
+	if(irq >= NUM_ISA_IRQS)
+		return;
+
+	irq_line& line = isa_irqs[irq];
+	line.flags |= IOAPIC_LEVEL_TRIGGERED;
+
+	//a polarity from the madt wins, otherwise level triggered lines are active low like the pci ones
+	if(!line.has_polarity)
+		line.flags |= IOAPIC_ACTIVE_LOW;
+
+	const io_apic* io = ioapic_for_gsi(line.gsi);
+
+	if(!io)
+		return;
+
+	uint32_t reg = IOAPIC_REDIRECTION + (line.gsi - io->gsi_base) * 2;
+
+	sync::lock_guard l{ioapic_lock};
+
+	uint32_t entry = ioapic_read(*io, reg);
+	entry &= ~(IOAPIC_LEVEL_TRIGGERED | IOAPIC_ACTIVE_LOW);
+	ioapic_write(*io, reg, entry | line.flags);
+}
\ No newline at end of file
@@ -0,0 +1,72 @@
+#ifndef APIC_H
+#define APIC_H
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdbool.h>
+
+#define APIC_SPURIOUS_VECTOR 0xFF
+#define APIC_TIMER_VECTOR 0xEF
+
+//delivery modes for apic_send_ipi
+#define APIC_IPI_FIXED		0x00000000
+#define APIC_IPI_INIT		0x00000500
+#define APIC_IPI_STARTUP	0x00000600
+#define APIC_IPI_ASSERT		0x00004000
+
+//maps the local APIC, returns false if this cpu doesn't have one
+//it can be called again, it only does anything the first time
+bool apic_init(void);
+
+//turns on the local APIC of the cpu we are running on
+void apic_enable(void);
+
+uint32_t apic_get_id(void);
+
+//acknowledges the highest priority interrupt being serviced
+//for level triggered interrupts the IO-APIC is told too, so there's nothing else to do
+void apic_eoi(void);
+
+//true if the vector is waiting to be delivered to this cpu
+bool apic_is_requested(uint8_t vector);
+
+//sends an interrupt to the cpu with the given APIC id, command is a delivery mode and a vector
+void apic_send_ipi(uint32_t apic_id, uint32_t command);
+
+//sends a fixed interrupt to every cpu except this one
+void apic_broadcast_ipi(uint8_t vector);
+
+//finds the APIC ids of all the enabled cpus in the ACPI MADT
+//returns the number of cpus found, or 0 if there is no MADT
+size_t apic_find_processors(uint32_t* ids, size_t max_ids);
+
+//measures the local APIC timer against the PIT, the PIT has to be running already
+//every cpu is assumed to run its timer at the same rate
+void apic_timer_calibrate(void);
+
+//counts per second, 0 if the timer isn't calibrated
+uint32_t apic_timer_get_rate(void);
+
+//the timer interrupt comes in on APIC_TIMER_VECTOR, the handler has to call apic_eoi
+void apic_timer_start_periodic(uint32_t hz);
+void apic_timer_start_oneshot(uint32_t microseconds);
+void apic_timer_stop(void);
+
+//finds the IO-APICs and the ISA interrupt overrides in the MADT, everything starts out masked
+//returns false if there are none
+bool ioapic_init(void);
+
+//irqs under 16 are ISA irqs, which might be connected to a different pin than their number
+void ioapic_route_irq(size_t irq, uint8_t vector, uint32_t apic_id, bool masked);
+void ioapic_set_masked(size_t irq, bool masked);
+
+//PCI interrupt lines are level triggered and active low, unlike ISA ones
+void ioapic_set_level_triggered(size_t irq);
+
+#ifdef __cplusplus
+}
+#endif
+#endif
\ No newline at end of file
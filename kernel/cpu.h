@@ -0,0 +1,80 @@
+#ifndef CPU_H
+#define CPU_H
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stdint.h>
+#include <stddef.h>
+
+#define MAX_CPUS 16
+#define NO_CPU (~(size_t)0)
+
+struct __attribute__((packed)) gdt_entry
+{
+	uint16_t limit_low;
+	uint16_t base_low;
+	uint8_t  base_middle;
+	uint8_t  access;
+	uint8_t  granularity;
+	uint8_t  base_high;
+};
+
+struct __attribute__((packed)) tss
+{
+	uint16_t lin;
+	uint16_t reserved0;
+	uint32_t esp0;
+	uint16_t stack_seg;
+	uint16_t reserved1;
+	uint32_t r[23];
+};
+
+//null, kernel code, kernel data, user code, user data, tss, user tls
+#define GDT_NUM_ENTRIES 7
+#define GDT_TSS_INDEX 5
+#define GDT_TLS_INDEX 6
+
+struct TCB;
+
+//everything that's different for each cpu
+//every cpu has its own GDT inside of this, so sgdt tells us which cpu we are on
+typedef struct cpu_state
+{
+	struct TCB* current_task;	//switch_task in kernel.asm uses these two, keep them first
+	struct tss* task_state;
+	struct TCB* idle_task;
+	size_t index;
+	uint32_t apic_id;
+	volatile uint32_t started;
+	volatile uint32_t idle;		//halted until someone sends it a wake up ipi
+	volatile uint32_t wake_pending;	//something might be ready to run, don't halt
+	volatile uint32_t tlb_flush_pending;
+	struct gdt_entry gdt[GDT_NUM_ENTRIES] __attribute__((aligned(8)));
+	struct tss task_state_segment;
+} cpu_state;
+
+#define CPU_STATE_GDT_OFFSET 40 //kernel.asm needs this too
+
+static inline cpu_state* this_cpu(void)
+{
+	struct __attribute__((packed))
+	{
+		uint16_t limit;
+		uintptr_t base;
+	} gdtr;
+
+	__asm__ volatile("sgdt %0" : "=m"(gdtr));
+	return (cpu_state*)(gdtr.base - CPU_STATE_GDT_OFFSET);
+}
+
+//for spin loops, pause on anything that has it and a nop on everything else
+static inline void cpu_relax(void)
+{
+	__asm__ volatile("rep; nop" ::: "memory");
+}
+
+#ifdef __cplusplus
+}
+#endif
+#endif
\ No newline at end of file
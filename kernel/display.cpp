@@ -7,6 +7,8 @@
 
 #include <kernel/memorymanager.h>
 #include <kernel/physical_manager.h>
+#include <kernel/memtype.h>
+#include <kernel/display_flip.h>
 
 #include <kernel/locks.h>
 #include <kernel/task.h>
@@ -295,6 +297,7 @@ SYSCALL_HANDLER int set_display_mode(const display_mode* requested, display_mode
 					if(success)
 					{
 						current_mode = mode;
+						display_flip_reset(default_driver, &current_mode);
 						break;
 					}
 				}
@@ -329,6 +332,15 @@ SYSCALL_HANDLER uint8_t* map_display_memory(void)
 	auto num_pages = memmanager_minimum_pages(current_mode.buffer_size);
 	auto buf = default_driver->get_framebuffer();
 
+	//programs only ever write to the framebuffer, so writes can be combined
+	//text mode is left alone, the kernel's terminal reads it back when it scrolls
+	page_flags_t cache_flags = 0;
+
+	if(!(current_mode.flags & DISPLAY_TEXT_MODE))
+	{
+		cache_flags = memtype_write_combining((uintptr_t)buf, num_pages * PAGE_SIZE);
+	}
+
 	return (uint8_t*)memmanager_map_to_new_pages((uintptr_t)buf, num_pages,
-												PAGE_USER | PAGE_PRESENT | PAGE_RW);
+												PAGE_USER | PAGE_PRESENT | PAGE_RW | cache_flags);
 }
\ No newline at end of file
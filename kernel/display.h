@@ -25,6 +25,9 @@ struct display_driver
 
 	void (*set_display_offset)(size_t offset, bool on_retrace);
 
+	//true while the vertical retrace is going on, null if the driver can't tell
+	bool (*in_vertical_retrace)();
+
 	//text mode funcs
 	size_t(*get_cursor_offset)();
 	void (*set_cursor_offset)(size_t offset);
@@ -0,0 +1,246 @@
+#include <kernel/display_flip.h>
+#include <kernel/task.h>
+#include <kernel/sysclock.h>
+#include <kernel/locks.h>
+#include <kernel/cpu.h>
+
+//flips are handed to the driver by a kernel thread at the start of the vertical retrace, so programs never wait on it
+//there's no retrace interrupt to go by, VGA's irq 2 was never wired up on most cards and VESA doesn't have one,
+//so the thread sleeps until just before the next retrace is due and polls the driver the rest of the way
+//the time between retraces is measured as it goes, the mode's refresh rate is only the first guess
+//everything here runs with the big kernel lock
+
+struct pending_flip
+{
+	size_t offset;
+	uint32_t sequence;
+};
+
+static const display_driver* flip_driver = nullptr;
+static size_t flip_buffer_size = 0;
+
+static pending_flip pending[DISPLAY_FLIP_QUEUE_SIZE];
+static size_t num_pending = 0;
+
+static uint32_t last_queued = 0;
+static uint32_t last_shown = 0;
+static uint32_t num_skipped = 0;
+static size_t shown_offset = 0;
+static clock_t shown_time = 0;
+
+static clock_t refresh_period = 0;
+static clock_t last_retrace = 0;
+static bool retrace_synced = false;
+
+//bumped by a mode switch, so a flip the thread was about to do for the old mode is dropped
+static uint32_t flip_generation = 0;
+
+static wait_queue flip_waiters{};
+static TCB* flip_task = nullptr;
+
+//far enough from what was measured that it's probably wrong
+static bool plausible_period(clock_t period)
+{
+	const clock_t rate = sysclock_get_rate();
+	return period >= rate / 240 && period <= rate / 20;
+}
+
+//a mode switch can change the driver while we poll, so it's looked up every time
+static bool in_retrace()
+{
+	return flip_driver->in_vertical_retrace && flip_driver->in_vertical_retrace();
+}
+
+static void sleep_until(clock_t deadline)
+{
+	//a queued flip wakes the thread, which doesn't mean it's time yet
+	while(sysclock_get_ticks() < deadline)
+	{
+		task_sleep_until(deadline);
+	}
+}
+
+//returns when the retrace started, or when it's assumed to have if the driver can't tell us
+static clock_t wait_for_retrace()
+{
+	const clock_t now = sysclock_get_ticks();
+
+	//the first retrace after now, going by the last one we saw
+	clock_t next = last_retrace + refresh_period;
+
+	if(next <= now)
+	{
+		next += ((now - next) / refresh_period + 1) * refresh_period;
+	}
+
+	if(!retrace_synced)
+	{
+		sleep_until(next);
+		last_retrace = next;
+		return next;
+	}
+
+	sleep_until(next - refresh_period / 4);
+
+	//we woke up too late and it's already going, it's still safe to flip but the time is only a guess
+	if(in_retrace())
+	{
+		last_retrace = next;
+		return sysclock_get_ticks();
+	}
+
+	const clock_t give_up = sysclock_get_ticks() + refresh_period * 2;
+
+	while(!in_retrace())
+	{
+		if(!retrace_synced || sysclock_get_ticks() > give_up)
+		{
+			//the status bit never changes on some cards in VESA modes, the timer is all we have then
+			retrace_synced = false;
+			last_retrace = sysclock_get_ticks();
+			return last_retrace;
+		}
+
+		big_kernel_relax();
+		cpu_relax();
+	}
+
+	const clock_t start = sysclock_get_ticks();
+	const clock_t elapsed = start - last_retrace;
+	const clock_t periods = (elapsed + refresh_period / 2) / refresh_period;
+
+	if(periods >= 1 && periods <= 8 && plausible_period(elapsed / periods))
+	{
+		refresh_period = (refresh_period * 7 + elapsed / periods) / 8;
+	}
+
+	last_retrace = start;
+	return start;
+}
+
+static void flip_main(void*)
+{
+	for(;;)
+	{
+		if(num_pending == 0)
+		{
+			task_prepare_to_block();
+			task_block();
+			continue;
+		}
+
+		const uint32_t generation = flip_generation;
+		const clock_t when = wait_for_retrace();
+
+		//the mode changed while we were waiting, or it was all replaced and then dropped
+		if(generation != flip_generation || num_pending == 0)
+		{
+			continue;
+		}
+
+		const pending_flip flip = pending[0];
+
+		for(size_t i = 1; i < num_pending; i++)
+		{
+			pending[i - 1] = pending[i];
+		}
+
+		num_pending--;
+
+		flip_driver->set_display_offset(flip.offset, false);
+
+		last_shown = flip.sequence;
+		shown_offset = flip.offset;
+		shown_time = when;
+
+		wait_queue_wake_all(&flip_waiters);
+	}
+}
+
+void display_flip_reset(const display_driver* driver, const display_mode* mode)
+{
+	flip_driver = driver;
+	flip_buffer_size = mode->buffer_size;
+	flip_generation++;
+
+	//whatever was waiting is dropped, anybody waiting on it is let go
+	num_pending = 0;
+	last_shown = last_queued;
+	shown_offset = 0;
+
+	const size_t refresh = mode->refresh ? mode->refresh : 60;
+	refresh_period = sysclock_get_rate() / refresh;
+	last_retrace = sysclock_get_ticks();
+	shown_time = last_retrace;
+	retrace_synced = driver->in_vertical_retrace != nullptr;
+
+	wait_queue_wake_all(&flip_waiters);
+}
+
+SYSCALL_HANDLER int queue_display_flip(size_t offset, int flags)
+{
+	if(!this_task_is_active() || !flip_driver || offset >= flip_buffer_size)
+	{
+		return -1;
+	}
+
+	if(!flip_task)
+	{
+		flip_task = task_create_kernel_thread(flip_main, nullptr);
+
+		if(!flip_task)
+		{
+			return -1;
+		}
+	}
+
+	if((flags & DISPLAY_FLIP_REPLACE) && num_pending)
+	{
+		num_skipped++;
+		num_pending--;
+	}
+	else if(num_pending == DISPLAY_FLIP_QUEUE_SIZE)
+	{
+		return -1;
+	}
+
+	pending[num_pending++] = {offset, ++last_queued};
+
+	task_wake(flip_task);
+
+	return (int)last_queued;
+}
+
+SYSCALL_HANDLER int get_display_flip_status(display_flip_status* status, uint32_t wait_for)
+{
+	wait_queue_entry entry;
+
+	//shown catches up with queued when a mode switch drops the rest, so this can't wait forever
+	while(wait_for && (int32_t)(last_shown - wait_for) < 0 && (int32_t)(last_queued - wait_for) >= 0)
+	{
+		if(!wait_queue_prepare(&flip_waiters, &entry))
+		{
+			return -1;
+		}
+
+		task_block();
+		wait_queue_finish(&flip_waiters, &entry);
+	}
+
+	status->queued = last_queued;
+	status->shown = last_shown;
+	status->skipped = num_skipped;
+	status->num_pending = num_pending;
+	status->flags = retrace_synced ? DISPLAY_FLIP_SYNCED : 0;
+	status->shown_offset = shown_offset;
+
+	for(size_t i = 0; i < DISPLAY_FLIP_QUEUE_SIZE; i++)
+	{
+		status->pending_offsets[i] = (i < num_pending) ? pending[i].offset : 0;
+	}
+
+	status->shown_time = shown_time;
+	status->refresh_period = refresh_period;
+
+	return 0;
+}
\ No newline at end of file
@@ -0,0 +1,27 @@
+#ifndef DISPLAY_FLIP_QUEUE_H
+#define DISPLAY_FLIP_QUEUE_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+#include <kernel/syscall.h>
+#include <kernel/display.h>
+#include <common/display_flip.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+//called after the driver sets a mode, the flips that were waiting are dropped and the timing starts over
+void display_flip_reset(const display_driver* driver, const display_mode* mode);
+
+//returns the flip's sequence number, or -1 if the queue is full or this isn't the active process
+SYSCALL_HANDLER int queue_display_flip(size_t offset, int flags);
+
+//with wait_for set it blocks until that flip has been shown, or dropped by a mode switch
+SYSCALL_HANDLER int get_display_flip_status(display_flip_status* status, uint32_t wait_for);
+
+#ifdef __cplusplus
+}
+#endif
+#endif
\ No newline at end of file
@@ -14,6 +14,10 @@
 #include <kernel/locks.h>
 #include <kernel/display.h>
 #include <kernel/sysclock.h>
+#include <kernel/timer.h>
+#include <kernel/worker.h>
+#include <kernel/softirq.h>
+#include <kernel/trace.h>
 #include <kernel/rt_device.h>
 #include <kernel/kassert.h>
 #include <kernel/input.h>
@@ -29,9 +33,11 @@ struct func_info {
 	const void* address;
 };
 
+extern "C" uint8_t _IMAGE_END_;
+
 static dynamic_object::sym_map driver_lib_set{32};
 static dynamic_object::sym_map driver_symbol_map{32};
-static dynamic_object::sym_map driver_glob_data_symbol_map{};
+static dynamic_object::object_list driver_objects;
 
 static void load_driver(fs::dir_stream_ref cwd, const std::string_view filename, const std::string_view func_name)
 {
@@ -40,7 +46,7 @@ static void load_driver(fs::dir_stream_ref cwd, const std::string_view filename,
 	dynamic_object ob {	
 		&driver_lib_set, 
 		&driver_symbol_map, 
-		&driver_glob_data_symbol_map
+		&driver_objects
 	};
 
 	auto f = cwd.find_file_by_path(filename);
@@ -60,8 +66,7 @@ static void load_driver(fs::dir_stream_ref cwd, const std::string_view filename,
 
 	if(load_elf(&(*f), &ob, false, lib_dir ? lib_dir.get_ptr() : cwd.get_ptr()))
 	{
-		uint32_t func_address;
-		if(ob.symbol_map->lookup(func_name, &func_address))
+		if(uintptr_t func_address = elf_lookup_symbol(&ob, std::string{func_name}.c_str()))
 		{
 			((driver_init_func)func_address)(cwd.get_ptr());
 		}
@@ -90,6 +95,8 @@ static constexpr std::array func_list
 	func_info{"memset"sv,						(void*)&memset},
 	func_info{"memmove"sv,						(void*)&memmove},
 	func_info{"memcpy"sv,						(void*)&memcpy},
+	func_info{"__memcpy"sv,						(void*)&__memcpy},
+	func_info{"__memset"sv,						(void*)&__memset},
 	func_info{"filesystem_add_virtual_drive"sv,	(void*)&filesystem_add_virtual_drive},
 	func_info{"filesystem_add_partitioner"sv,	(void*)&filesystem_add_partitioner},
 	func_info{"filesystem_add_drive"sv,			(void*)&filesystem_add_drive},
@@ -105,7 +112,16 @@ static constexpr std::array func_list
 	func_info{"filesystem_write_file"sv,		(void*)&filesystem_write_file},
 	func_info{"irq_install_handler"sv,			(void*)&irq_install_handler},
 	func_info{"sysclock_sleep"sv,				(void*)&sysclock_sleep},
+	func_info{"sysclock_delay"sv,				(void*)&sysclock_delay},
+	func_info{"timer_start"sv,					(void*)&timer_start},
+	func_info{"timer_cancel"sv,					(void*)&timer_cancel},
+	func_info{"softirq_raise"sv,				(void*)&softirq_raise},
+	func_info{"softirq_run_pending"sv,			(void*)&softirq_run_pending},
+	func_info{"trace_event"sv,					(void*)&trace_event},
+	func_info{"work_schedule"sv,				(void*)&work_schedule},
+	func_info{"task_create_kernel_thread"sv,	(void*)&task_create_kernel_thread},
 	func_info{"sysclock_get_ticks"sv,			(void*)&sysclock_get_ticks},
+	func_info{"sysclock_get_rate"sv,			(void*)&sysclock_get_rate},
 	func_info{"physical_memory_allocate_in_range"sv, (void*)&physical_memory_allocate_in_range},
 	func_info{"physical_memory_allocate"sv,		(void*)&physical_memory_allocate},
 	func_info{"memmanager_virtual_alloc"sv,		(void*)&memmanager_virtual_alloc},
@@ -120,6 +136,9 @@ static constexpr std::array func_list
 	func_info{"display_add_driver"sv,			(void*)&display_add_driver},
 	func_info{"acknowledge_irq"sv,				(void*)&acknowledge_irq},
 	func_info{"irq_enable"sv,					(void*)&irq_enable},
+	func_info{"irq_is_spurious"sv,				(void*)&irq_is_spurious},
+	func_info{"irq_set_level_triggered"sv,		(void*)&irq_set_level_triggered},
+	func_info{"irq_allocate_msi"sv,				(void*)&irq_allocate_msi},
 	func_info{"add_realtime_device"sv,			(void*)&add_realtime_device},
 	func_info{"find_realtime_device"sv,			(void*)&find_realtime_device},
 	func_info{"handle_input_event"sv,			(void*)&handle_input_event},
@@ -197,6 +216,9 @@ static void execute_line(std::string_view line, fs::dir_stream_ref cwd)
 		{
 			print_strings("Executing ", filename, '\n');
 
+			//how long booting took, up to the first program
+			printf("%d ms since boot\n", (int)((uint64_t)sysclock_get_ticks() * 1000 / sysclock_get_rate()));
+
 			spawn_process(&(*f), cwd.get_ptr(), WAIT_FOR_PROCESS);
 		}
 	}
@@ -230,6 +252,44 @@ static void process_init_file(fs::dir_stream_ref cwd, fs::stream_ref f)
 	}
 }
 
+extern "C" const char* driver_find_symbol(uintptr_t address, uintptr_t* symbol_address)
+{
+	dynamic_object ob {	
+		&driver_lib_set, 
+		&driver_symbol_map, 
+		&driver_objects
+	};
+
+	//a driver's own symbols are only searched when the address is inside of it
+	if(const char* name = elf_find_symbol_by_address(&ob, address, symbol_address))
+	{
+		return name;
+	}
+
+	//the kernel only has the functions it exports to drivers
+	const char* best_name = nullptr;
+	uintptr_t best_address = 0;
+
+	if(address >= (uintptr_t)&_IMAGE_END_)
+	{
+		return nullptr;
+	}
+
+	for(auto&& func : func_list)
+	{
+		const uintptr_t start = (uintptr_t)func.address;
+
+		if(start <= address && start >= best_address)
+		{
+			best_address = start;
+			best_name = func.name.data();
+		}
+	}
+
+	*symbol_address = best_address;
+	return best_name;
+}
+
 extern "C" void load_drivers()
 {
 	print_string("Loading drivers\n"sv);
@@ -262,6 +322,7 @@ extern "C" void load_drivers()
 #include <stddef.h>
 #include <stdlib.h>
 
+//small objects are served by the slab size classes behind malloc, see clib/slab.cpp
 void* operator new (size_t size)
 {
 	return malloc(size);
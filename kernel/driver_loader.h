@@ -5,8 +5,14 @@
 extern "C" {
 #endif
 
+#include <stdint.h>
+
 void load_drivers();
 
+//the nearest kernel function exported to drivers, or driver symbol, at or below address
+//returns null if there isn't one
+const char* driver_find_symbol(uintptr_t address, uintptr_t* symbol_address);
+
 #ifdef __cplusplus
 }
 #endif
@@ -16,6 +16,7 @@ typedef struct
 struct dynamic_object
 {
 	using sym_map = hash_map<std::string, uintptr_t>;
+	using object_list = std::vector<void*>;
 
 	void* entry_point = nullptr;
 	std::vector<segment> segments;
@@ -23,13 +24,18 @@ struct dynamic_object
 	void* linker_data = nullptr;
 
 	sym_map* lib_set = nullptr;
+
+	//symbols that don't come from a loaded object, like the kernel functions exported to drivers
+	//searched before any object, can be null
 	sym_map* symbol_map = nullptr;
-	sym_map* glob_data_symbol_map = nullptr;
+
+	//linker data of every object loaded into the same namespace, in the order their symbols are searched
+	object_list* loaded_objects = nullptr;
 	
-	constexpr dynamic_object(sym_map* libs, sym_map* symbols, sym_map* glob_data)
+	constexpr dynamic_object(sym_map* libs, sym_map* symbols, object_list* objects)
 		: lib_set(libs)
 		, symbol_map(symbols)
-		, glob_data_symbol_map(glob_data) {}
+		, loaded_objects(objects) {}
 };
 
 #endif
@@ -8,8 +8,30 @@
 #include <kernel/util/hash.h>
 #include <kernel/dynamic_object.h>
 #include <kernel/kassert.h>
+#include <kernel/locks.h>
 
 #include <string_view>
+#include <string>
+#include <vector>
+
+//identifies one version of a file, if it changes on disk so does this
+typedef struct elf_file_key
+{
+	size_t disk_id;
+	fs_index location_on_disk;
+	size_t size;
+	time_t time_modified;
+} elf_file_key;
+
+#define ELF_MAX_LOAD_SEGMENTS 8
+
+//page flags applied to part of a loaded image
+typedef struct elf_protection
+{
+	size_t first_page;
+	size_t num_pages;
+	page_flags_t flags;
+} elf_protection;
 
 typedef struct ELF_linker_data
 {
@@ -21,18 +43,34 @@ typedef struct ELF_linker_data
 	size_t num_array_init_funcs;
 
 	uint32_t* hash_table;
+	uint32_t* gnu_hash_table;
 	ELF_sym32* symbol_table;
-	size_t symbol_table_size;
 	char* string_table;
 	size_t string_table_size;
 
-	ELF_rel32* relocation_addr;
-	size_t relocation_entries;
+	uintptr_t* plt_got;
+	ELF_rel32* plt_relocation_addr;
+	size_t plt_relocation_entries;
+	bool lazy_plt; //the jump slots still point back into the PLT and get bound on first call
+
+	//the process can change anything in its own image, so binding a jump slot later
+	//only goes by what was copied out while the image was still the kernel's
+	std::vector<ELF_rel32> plt_relocations;
+	uint32_t num_symbols;
 
 	dynamic_object::sym_map* lib_set;
 	dynamic_object::sym_map* symbol_map;
-	dynamic_object::sym_map* glob_data_symbol_map;
+	dynamic_object::object_list* loaded_objects;
 	bool userspace;
+
+	//what's needed to put the relocated image back without loading it again
+	std::string name;
+	elf_file_key file_key;
+	void* image;
+	size_t image_pages;
+	elf_protection protections[ELF_MAX_LOAD_SEGMENTS];
+	size_t num_protections;
+	bool cacheable;
 } ELF_linker_data;
 
 
@@ -115,12 +153,52 @@ static span elf_get_size(ELF_header32* file_header, fs::stream_ref f)
 	return retval;
 }
 
-static int elf_read_symbols(ELF_linker_data* object);
 static void elf_process_relocation_section(ELF_linker_data* object, ELF_rel32* table, size_t rel_entries);
 static int elf_process_dynamic_section(dynamic_object* dyn_obj, directory_stream* lib_dir);
-int load_elf(const file_handle* file, dynamic_object* object, bool user, directory_stream* lib_dir);
+static bool elf_prepare_lazy_plt(ELF_linker_data* object, size_t object_index);
+static void elf_bind_lazy_plt(dynamic_object* object);
+static int elf_load_object(const file_handle* file, dynamic_object* object, bool user, directory_stream* lib_dir);
+static bool elf_cache_restore(const file_handle* file, dynamic_object* object, directory_stream* lib_dir);
+static void elf_cache_store(const file_handle* file, dynamic_object* object);
 
 int load_elf(const file_handle* file, dynamic_object* object, bool user, directory_stream* lib_dir)
+{
+	//drivers are only loaded once, so only programs are worth caching
+	if(user && elf_cache_restore(file, object, lib_dir))
+	{
+		return 1;
+	}
+
+	if(!elf_load_object(file, object, user, lib_dir))
+	{
+		return 0;
+	}
+
+	//now that every library is loaded the resolver can be found
+	elf_bind_lazy_plt(object);
+
+	if(user)
+	{
+		elf_cache_store(file, object);
+	}
+
+	return 1;
+}
+
+static elf_file_key elf_get_file_key(const file_handle* file)
+{
+	return {file->data.disk_id, file->data.location_on_disk, file->data.size, file->time_modified};
+}
+
+static bool elf_same_file(const elf_file_key& a, const elf_file_key& b)
+{
+	return a.disk_id == b.disk_id &&
+		   a.location_on_disk == b.location_on_disk &&
+		   a.size == b.size &&
+		   a.time_modified == b.time_modified;
+}
+
+static int elf_load_object(const file_handle* file, dynamic_object* object, bool user, directory_stream* lib_dir)
 {
 	k_assert(file);
 	k_assert(object);
@@ -161,6 +239,11 @@ int load_elf(const file_handle* file, dynamic_object* object, bool user, directo
 			object->segments.emplace_back((void*)base_adress, num_pages);
 			object->linker_data = nullptr;
 
+			const uintptr_t image_base = base_adress;
+			elf_protection protections[ELF_MAX_LOAD_SEGMENTS];
+			size_t num_protections = 0;
+			bool cacheable = true;
+
 			if(s.base != nullptr) //if the elf cares where its loaded then don't add the base adress
 			{
 				k_assert((uintptr_t)s.base == base_adress);
@@ -179,14 +262,12 @@ int load_elf(const file_handle* file, dynamic_object* object, bool user, directo
 				{
 				case ELF_PTYPE_DYNAMIC:
 				{
-					auto linker_data = new ELF_linker_data();
-
-					memset(linker_data, 0, sizeof(ELF_linker_data));
+					auto linker_data = new ELF_linker_data{};
 
 					linker_data->base_address = (void*)base_adress;
 					linker_data->dynamic_section = (ELF_dyn32*)(base_adress + pg_header.virtual_address);
 					linker_data->symbol_map = object->symbol_map;
-					linker_data->glob_data_symbol_map = object->glob_data_symbol_map;
+					linker_data->loaded_objects = object->loaded_objects;
 					linker_data->lib_set = object->lib_set;
 					linker_data->userspace = user;
 
@@ -208,6 +289,15 @@ int load_elf(const file_handle* file, dynamic_object* object, bool user, directo
 
 					memmanager_set_page_flags((void*)aligned_address, num_pages, flags);
 
+					if(num_protections < ELF_MAX_LOAD_SEGMENTS)
+					{
+						protections[num_protections++] = {(aligned_address - image_base) / PAGE_SIZE, num_pages, flags};
+					}
+					else
+					{
+						cacheable = false;
+					}
+
 					/*
 					printf("loaded section at %X from %X, size %X\n",
 						   virtual_address, pg_header.offset, pg_header.file_size);
@@ -227,6 +317,16 @@ int load_elf(const file_handle* file, dynamic_object* object, bool user, directo
 
 			object->entry_point = (void*)(base_adress + file_header.entry_point);
 
+			if(auto linker_data = (ELF_linker_data*)object->linker_data)
+			{
+				linker_data->file_key = elf_get_file_key(file);
+				linker_data->image = (void*)image_base;
+				linker_data->image_pages = num_pages;
+				memcpy(linker_data->protections, protections, sizeof(protections));
+				linker_data->num_protections = num_protections;
+				linker_data->cacheable = cacheable;
+			}
+
 			elf_process_dynamic_section(object, lib_dir);
 		}
 	}
@@ -236,7 +336,18 @@ int load_elf(const file_handle* file, dynamic_object* object, bool user, directo
 
 void cleanup_elf(dynamic_object* object)
 {
-	delete static_cast<ELF_linker_data*>(object->linker_data);
+	//the linker data of every object in the namespace is freed together
+	if(object->loaded_objects)
+	{
+		for(void* linker_data : *object->loaded_objects)
+		{
+			delete static_cast<ELF_linker_data*>(linker_data);
+		}
+
+		object->loaded_objects->clear();
+	}
+
+	object->linker_data = nullptr;
 }
 
 static int elf_process_dynamic_section(dynamic_object* dyn_obj, directory_stream* lib_dir)
@@ -277,13 +388,14 @@ static int elf_process_dynamic_section(dynamic_object* dyn_obj, directory_stream
 			case DT_RELSZ:
 				relocation_entries = entry->d_un.d_val / sizeof(ELF_rel32);
 				break;
+			case DT_PLTGOT:
+				object->plt_got = (uintptr_t*)((uintptr_t)object->base_address + entry->d_un.d_ptr);
+				break;
 			case DT_HASH:
 				object->hash_table = (uint32_t*)((uintptr_t)object->base_address + entry->d_un.d_ptr);
-				if(object->hash_table == NULL)
-				{
-					printf("NULL ptr access\n");
-				}
-				object->symbol_table_size = object->hash_table[1];
+				break;
+			case DT_GNU_HASH:
+				object->gnu_hash_table = (uint32_t*)((uintptr_t)object->base_address + entry->d_un.d_ptr);
 				break;
 			case DT_STRTAB:
 				object->string_table = (char*)((uintptr_t)object->base_address + entry->d_un.d_ptr);
@@ -323,15 +435,20 @@ static int elf_process_dynamic_section(dynamic_object* dyn_obj, directory_stream
 					dynamic_object lib {
 						object->lib_set, 
 						object->symbol_map, 
-						object->glob_data_symbol_map
+						object->loaded_objects
 					};
 
 					if(auto lib_handle = find_file_by_path(lib_dir, lib_name, 0, 0))
 					{
-						if(load_elf(&(*lib_handle), &lib, object->userspace, lib_dir))
+						if(elf_load_object(&(*lib_handle), &lib, object->userspace, lib_dir))
 						{
 							lib.lib_set->insert(lib_name, 1);
 
+							if(auto lib_data = (ELF_linker_data*)lib.linker_data)
+							{
+								lib_data->name = lib_name;
+							}
+
 							for(auto&& seg : lib.segments)
 							{
 								dyn_obj->segments.push_back(seg);
@@ -342,17 +459,25 @@ static int elf_process_dynamic_section(dynamic_object* dyn_obj, directory_stream
 			}
 		}
 
-		elf_read_symbols(object);
+		//our libraries are searched before us
+		object->loaded_objects->push_back(object);
 
 		if(relocation_addr)
 		{
 			elf_process_relocation_section(object, relocation_addr, relocation_entries);
 		}
 
-		//this should wait till runtime, but I'll get lazy linking done later
 		if(plt_relocation_addr)
 		{
-			elf_process_relocation_section(object, plt_relocation_addr, plt_relocation_entries);
+			object->plt_relocation_addr = plt_relocation_addr;
+			object->plt_relocation_entries = plt_relocation_entries;
+
+			//user functions are bound the first time they're called, drivers are bound now
+			//since their first call might come from an interrupt handler
+			if(!elf_prepare_lazy_plt(object, object->loaded_objects->size() - 1))
+			{
+				elf_process_relocation_section(object, plt_relocation_addr, plt_relocation_entries);
+			}
 		}
 	}
 
@@ -362,27 +487,241 @@ static int elf_process_dynamic_section(dynamic_object* dyn_obj, directory_stream
 #define ELF32_R_SYM(i) ((i) >> 8)
 #define ELF32_R_TYPE(i) ((uint8_t)(i))
 
-static int elf_read_symbols(ELF_linker_data* object)
+static uint32_t elf_sysv_hash(const char* name)
+{
+	uint32_t h = 0;
+	for(; *name; name++)
+	{
+		h = (h << 4) + *(const uint8_t*)name;
+		const uint32_t g = h & 0xf0000000;
+		if(g)
+		{
+			h ^= g >> 24;
+		}
+		h &= ~g;
+	}
+	return h;
+}
+
+static uint32_t elf_gnu_hash(const char* name)
+{
+	uint32_t h = 5381;
+	for(; *name; name++)
+	{
+		h = h * 33 + *(const uint8_t*)name;
+	}
+	return h;
+}
+
+typedef struct elf_symbol_name
+{
+	const char* name;
+	uint32_t sysv_hash;
+	uint32_t gnu_hash;
+} elf_symbol_name;
+
+static inline bool elf_symbol_matches(const ELF_linker_data* object, const ELF_sym32* symbol, const char* name)
+{
+	return symbol->section_index != 0 && 
+		   ELF32_ST_BIND(symbol->info) != STB_LOCAL &&
+		   strcmp(object->string_table + symbol->name, name) == 0;
+}
+
+//looks a symbol up through the object's own hash table, without copying anything
+static const ELF_sym32* elf_find_symbol_in_object(const ELF_linker_data* object, const elf_symbol_name* sym)
 {
-	if(object->symbol_table && object->string_table)
+	if(!object->symbol_table || !object->string_table)
 	{
-		for(size_t i = 0; i < object->symbol_table_size; i++)
+		return nullptr;
+	}
+
+	if(const uint32_t* table = object->gnu_hash_table)
+	{
+		const uint32_t num_buckets = table[0];
+		const uint32_t sym_offset = table[1];
+		const uint32_t bloom_size = table[2];
+		const uint32_t bloom_shift = table[3];
+		const uint32_t* bloom = &table[4];
+		const uint32_t* buckets = &bloom[bloom_size];
+		const uint32_t* chain = &buckets[num_buckets];
+
+		const uint32_t h = sym->gnu_hash;
+
+		//the bloom filter rules out most objects without touching the buckets
+		const uint32_t mask = (1u << (h % 32)) | (1u << ((h >> bloom_shift) % 32));
+		if((bloom[(h / 32) % bloom_size] & mask) != mask)
+		{
+			return nullptr;
+		}
+
+		uint32_t i = buckets[h % num_buckets];
+		if(i < sym_offset)
 		{
-			ELF_sym32* symbol = &object->symbol_table[i];
+			return nullptr;
+		}
+
+		for(;; i++)
+		{
+			const uint32_t h2 = chain[i - sym_offset];
+
+			if((h | 1) == (h2 | 1) && elf_symbol_matches(object, &object->symbol_table[i], sym->name))
+			{
+				return &object->symbol_table[i];
+			}
 
-			if(symbol->section_index)
+			if(h2 & 1) //end of the chain
 			{
-				std::string_view symbol_name{object->string_table + symbol->name};
+				return nullptr;
+			}
+		}
+	}
 
-				object->symbol_map->insert(symbol_name, 
-										   (uintptr_t)object->base_address + symbol->value);
+	if(const uint32_t* table = object->hash_table)
+	{
+		const uint32_t num_buckets = table[0];
+		const uint32_t* buckets = &table[2];
+		const uint32_t* chain = &buckets[num_buckets];
+
+		for(uint32_t i = buckets[sym->sysv_hash % num_buckets]; i != 0; i = chain[i])
+		{
+			if(elf_symbol_matches(object, &object->symbol_table[i], sym->name))
+			{
+				return &object->symbol_table[i];
 			}
 		}
 	}
 
+	return nullptr;
+}
+
+static bool elf_lookup_in_namespace(dynamic_object::sym_map* symbol_map, 
+									dynamic_object::object_list* objects, 
+									const char* name, uintptr_t* value)
+{
+	if(symbol_map && symbol_map->lookup(std::string_view{name}, value))
+	{
+		return true;
+	}
+
+	if(!objects)
+	{
+		return false;
+	}
+
+	const elf_symbol_name sym = {name, elf_sysv_hash(name), elf_gnu_hash(name)};
+
+	for(void* linker_data : *objects)
+	{
+		auto object = (const ELF_linker_data*)linker_data;
+
+		if(auto symbol = elf_find_symbol_in_object(object, &sym))
+		{
+			*value = (uintptr_t)object->base_address + symbol->value;
+			return true;
+		}
+	}
+
+	return false;
+}
+
+uintptr_t elf_lookup_symbol(dynamic_object* object, const char* name)
+{
+	uintptr_t value = 0;
+
+	if(!elf_lookup_in_namespace(object->symbol_map, object->loaded_objects, name, &value))
+	{
+		return 0;
+	}
+
+	return value;
+}
+
+//how many entries the dynamic symbol table has, which only the hash tables say
+static uint32_t elf_num_symbols(const ELF_linker_data* object)
+{
+	if(const uint32_t* table = object->hash_table)
+	{
+		return table[1]; //nchain
+	}
+
+	if(const uint32_t* table = object->gnu_hash_table)
+	{
+		const uint32_t num_buckets = table[0];
+		const uint32_t sym_offset = table[1];
+		const uint32_t* buckets = &table[4 + table[2]];
+		const uint32_t* chain = &buckets[num_buckets];
+
+		//the last chain starts at the biggest bucket and ends at the first entry with the low bit set
+		uint32_t last = 0;
+		for(uint32_t i = 0; i < num_buckets; i++)
+		{
+			if(buckets[i] > last) { last = buckets[i]; }
+		}
+
+		if(last < sym_offset)
+		{
+			return sym_offset;
+		}
+
+		while(!(chain[last - sym_offset] & 1))
+		{
+			last++;
+		}
+
+		return last + 1;
+	}
+
 	return 0;
 }
 
+const char* elf_find_symbol_by_address(dynamic_object* dyn_obj, uintptr_t address, uintptr_t* symbol_address)
+{
+	const char* best_name = nullptr;
+	uintptr_t best_address = 0;
+
+	if(!dyn_obj->loaded_objects)
+	{
+		return nullptr;
+	}
+
+	for(void* linker_data : *dyn_obj->loaded_objects)
+	{
+		auto object = (const ELF_linker_data*)linker_data;
+		const uintptr_t image_start = (uintptr_t)object->image;
+
+		if(!object->symbol_table || !object->string_table || 
+		   address < image_start || address >= image_start + object->image_pages * PAGE_SIZE)
+		{
+			continue;
+		}
+
+		const uint32_t num_symbols = elf_num_symbols(object);
+
+		for(uint32_t i = 1; i < num_symbols; i++)
+		{
+			const ELF_sym32& symbol = object->symbol_table[i];
+
+			if(symbol.section_index == 0)
+			{
+				continue;
+			}
+
+			const uintptr_t start = (uintptr_t)object->base_address + symbol.value;
+
+			if(start > address || start < best_address || (symbol.size && address >= start + symbol.size))
+			{
+				continue;
+			}
+
+			best_address = start;
+			best_name = object->string_table + symbol.name;
+		}
+	}
+
+	*symbol_address = best_address;
+	return best_name;
+}
+
 static inline bool elf_relocation_uses_symbol(uint8_t type)
 {
 	switch(type)
@@ -420,7 +759,6 @@ static void elf_process_relocation_section(ELF_linker_data* object, ELF_rel32* t
 
 		ELF_sym32* symbol = &object->symbol_table[symbol_index];
 		uintptr_t symbol_val = (uintptr_t)object->base_address + symbol->value;
-		std::string_view symbol_name;
 
 		if(elf_relocation_uses_symbol(relocation_type))
 		{
@@ -431,14 +769,14 @@ static void elf_process_relocation_section(ELF_linker_data* object, ELF_rel32* t
 				printf("Unable to locate symbol %u, NULL symbol\n", symbol_index);
 				symbol_val = 0;
 			}
-			else 		
+			else if(!elf_lookup_in_namespace(object->symbol_map, object->loaded_objects, s_name, &symbol_val))
 			{
-				symbol_name = s_name;
-				if(!object->symbol_map->lookup(symbol_name, &symbol_val))
+				symbol_val = 0;
+
+				if(ELF32_ST_BIND(symbol->info) != STB_WEAK)
 				{
 					printf("Unable to locate symbol %u \"%s\"\n", symbol_index, s_name);
 					while(true);
-					symbol_val = 0;
 				}
 			}
 		}
@@ -448,12 +786,6 @@ static void elf_process_relocation_section(ELF_linker_data* object, ELF_rel32* t
 		switch(relocation_type)
 		{
 		case R_386_GLOB_DAT:
-			if(!symbol_name.empty())
-			{
-				object->glob_data_symbol_map->lookup(symbol_name, &symbol_val);
-			}
-			*(uintptr_t*)(address) = symbol_val;
-			break;
 		case R_386_JMP_SLOT:
 			*(uintptr_t*)(address) = symbol_val;
 			break;
@@ -477,4 +809,400 @@ static void elf_process_relocation_section(ELF_linker_data* object, ELF_rel32* t
 			printf("Unsupported relocation type: %d\n", relocation_type);
 		}
 	}
+}
+
+//the first three GOT entries are reserved, PLT0 pushes GOT[1] and jumps to GOT[2]
+#define PLT_GOT_OBJECT_ID 1
+#define PLT_GOT_RESOLVER 2
+
+//true if the whole range is inside one of the object's writable segments, in user space
+static bool elf_in_writable_segment(const ELF_linker_data* object, uintptr_t address, size_t size)
+{
+	if(address >= KERNEL_SPLIT || size > KERNEL_SPLIT - address)
+	{
+		return false;
+	}
+
+	for(size_t i = 0; i < object->num_protections; i++)
+	{
+		const elf_protection& prot = object->protections[i];
+
+		if(!(prot.flags & PAGE_RW))
+		{
+			continue;
+		}
+
+		const uintptr_t start = (uintptr_t)object->image + prot.first_page * PAGE_SIZE;
+		const uintptr_t end = start + prot.num_pages * PAGE_SIZE;
+
+		if(address >= start && address + size <= end)
+		{
+			return true;
+		}
+	}
+
+	return false;
+}
+
+//the process might have unmapped or replaced the pages since it was loaded
+static bool elf_user_pages_ok(uintptr_t address, size_t size, page_flags_t needed)
+{
+	if(address >= KERNEL_SPLIT || size > KERNEL_SPLIT - address)
+	{
+		return false;
+	}
+
+	for(uintptr_t page = address & ~(PAGE_SIZE - 1); page < address + size; page += PAGE_SIZE)
+	{
+		const uintptr_t flags = memmanager_get_page_flags(page);
+
+		if(!(flags & (PAGE_PRESENT | PAGE_MAP_ON_ACCESS)) || (flags & (PAGE_USER | needed)) != (PAGE_USER | needed))
+		{
+			return false;
+		}
+	}
+
+	return true;
+}
+
+static bool elf_prepare_lazy_plt(ELF_linker_data* object, size_t object_index)
+{
+	if(!object->userspace || !object->plt_got || !object->symbol_table || !object->string_table)
+	{
+		return false;
+	}
+
+	//without the symbol count from a hash table the slots can't be checked later, so they're bound now
+	object->num_symbols = elf_num_symbols(object);
+
+	for(size_t entry = 0; entry < object->plt_relocation_entries; entry++)
+	{
+		const ELF_rel32& relocation = object->plt_relocation_addr[entry];
+
+		if(ELF32_R_TYPE(relocation.info) != R_386_JMP_SLOT ||
+		   ELF32_R_SYM(relocation.info) >= object->num_symbols ||
+		   !elf_in_writable_segment(object, (uintptr_t)object->base_address + relocation.offset, sizeof(uintptr_t)))
+		{
+			return false;
+		}
+	}
+
+	object->plt_relocations = std::vector<ELF_rel32>(object->plt_relocation_addr, object->plt_relocation_entries);
+
+	//each jump slot starts out pointing at the push right after the jump in its PLT entry
+	for(size_t entry = 0; entry < object->plt_relocation_entries; entry++)
+	{
+		uintptr_t address = (uintptr_t)object->base_address + object->plt_relocation_addr[entry].offset;
+		*(uintptr_t*)(address) += (uintptr_t)object->base_address;
+	}
+
+	object->plt_got[PLT_GOT_OBJECT_ID] = object_index;
+	object->plt_got[PLT_GOT_RESOLVER] = 0; //filled in once every object is loaded
+	object->lazy_plt = true;
+
+	return true;
+}
+
+static void elf_bind_lazy_plt(dynamic_object* dyn_obj)
+{
+	if(!dyn_obj->loaded_objects)
+	{
+		return;
+	}
+
+	uintptr_t resolver = elf_lookup_symbol(dyn_obj, ELF_LAZY_RESOLVER_NAME);
+
+	for(void* linker_data : *dyn_obj->loaded_objects)
+	{
+		auto object = (ELF_linker_data*)linker_data;
+
+		if(!object->lazy_plt || object->plt_got[PLT_GOT_RESOLVER])
+		{
+			continue;
+		}
+
+		if(resolver)
+		{
+			object->plt_got[PLT_GOT_RESOLVER] = resolver;
+		}
+		else
+		{
+			//the program doesn't have a resolver, so bind everything now
+			for(size_t entry = 0; entry < object->plt_relocation_entries; entry++)
+			{
+				uintptr_t address = (uintptr_t)object->base_address + object->plt_relocation_addr[entry].offset;
+				*(uintptr_t*)(address) -= (uintptr_t)object->base_address;
+			}
+
+			object->lazy_plt = false;
+			elf_process_relocation_section(object, object->plt_relocation_addr, object->plt_relocation_entries);
+		}
+	}
+}
+
+uintptr_t elf_resolve_lazy_symbol(dynamic_object* dyn_obj, size_t object_index, size_t relocation_offset)
+{
+	if(!dyn_obj->loaded_objects || object_index >= dyn_obj->loaded_objects->size())
+	{
+		return 0;
+	}
+
+	auto object = (ELF_linker_data*)(*dyn_obj->loaded_objects)[object_index];
+
+	if(!object->lazy_plt || 
+	   relocation_offset % sizeof(ELF_rel32) != 0 ||
+	   relocation_offset / sizeof(ELF_rel32) >= object->plt_relocations.size())
+	{
+		return 0;
+	}
+
+	//the relocation is our copy, the symbol and its name are still in the process's pages
+	const ELF_rel32& relocation = object->plt_relocations[relocation_offset / sizeof(ELF_rel32)];
+	const uint32_t symbol_index = ELF32_R_SYM(relocation.info);
+
+	if(symbol_index >= object->num_symbols ||
+	   !elf_user_pages_ok((uintptr_t)&object->symbol_table[symbol_index], sizeof(ELF_sym32), 0))
+	{
+		return 0;
+	}
+
+	const uint32_t name_offset = object->symbol_table[symbol_index].name;
+
+	if(name_offset >= object->string_table_size ||
+	   !elf_user_pages_ok((uintptr_t)object->string_table + name_offset, object->string_table_size - name_offset, 0))
+	{
+		return 0;
+	}
+
+	const char* name = object->string_table + name_offset;
+
+	if(!memchr(name, '\0', object->string_table_size - name_offset))
+	{
+		return 0; //not terminated inside the string table
+	}
+
+	const uintptr_t slot = (uintptr_t)object->base_address + relocation.offset;
+
+	if(!elf_in_writable_segment(object, slot, sizeof(uintptr_t)) ||
+	   !elf_user_pages_ok(slot, sizeof(uintptr_t), PAGE_RW))
+	{
+		return 0;
+	}
+
+	uintptr_t value;
+	if(!elf_lookup_in_namespace(object->symbol_map, object->loaded_objects, name, &value))
+	{
+		printf("Unable to locate symbol \"%s\"\n", name);
+		return 0;
+	}
+
+	//later calls jump straight to the function
+	*(uintptr_t*)slot = value;
+
+	return value;
+}
+
+//programs and their libraries are kept as they were right after relocation
+//starting the same program again just copies the images back to the same addresses
+//entries are keyed by the file and its modification time, so changed files get reloaded
+
+#define ELF_CACHE_MAX_BYTES (4 * 1024 * 1024)
+
+typedef struct elf_cache_entry
+{
+	std::vector<ELF_linker_data> objects; //in load order, the program itself is last
+	std::vector<uint8_t*> images;
+	void* entry_point;
+	size_t size;
+} elf_cache_entry;
+
+static std::vector<elf_cache_entry*> elf_cache; //most recently used first
+static size_t elf_cache_size = 0;
+static sync::mutex elf_cache_lock;
+
+static void elf_cache_free_entry(elf_cache_entry* entry)
+{
+	for(uint8_t* image : entry->images)
+	{
+		free(image);
+	}
+
+	elf_cache_size -= entry->size;
+	delete entry;
+}
+
+//checks that every library would still be loaded from the same file
+static bool elf_cache_libraries_unchanged(const elf_cache_entry* entry, directory_stream* lib_dir)
+{
+	for(size_t i = 0; i + 1 < entry->objects.size(); i++)
+	{
+		const ELF_linker_data& lib = entry->objects[i];
+
+		auto lib_handle = find_file_by_path(lib_dir, lib.name, 0, 0);
+
+		if(!lib_handle || !elf_same_file(elf_get_file_key(&(*lib_handle)), lib.file_key))
+		{
+			return false;
+		}
+	}
+
+	return true;
+}
+
+static bool elf_cache_restore(const file_handle* file, dynamic_object* object, directory_stream* lib_dir)
+{
+	sync::lock_guard l{elf_cache_lock};
+
+	const elf_file_key key = elf_get_file_key(file);
+
+	for(size_t i = 0; i < elf_cache.size(); i++)
+	{
+		elf_cache_entry* entry = elf_cache[i];
+
+		if(!elf_same_file(entry->objects.back().file_key, key))
+		{
+			continue;
+		}
+
+		elf_cache.erase(elf_cache.begin() + i);
+
+		if(!elf_cache_libraries_unchanged(entry, lib_dir))
+		{
+			elf_cache_free_entry(entry);
+			return false;
+		}
+
+		//the images are only valid at the addresses they were relocated for
+		size_t mapped = 0;
+		for(; mapped < entry->objects.size(); mapped++)
+		{
+			const ELF_linker_data& cached = entry->objects[mapped];
+
+			if(!memmanager_virtual_alloc(cached.image, cached.image_pages, PAGE_RW | PAGE_USER))
+			{
+				break;
+			}
+		}
+
+		if(mapped != entry->objects.size())
+		{
+			while(mapped--)
+			{
+				memmanager_free_pages(entry->objects[mapped].image, entry->objects[mapped].image_pages);
+			}
+
+			elf_cache.insert(elf_cache.begin(), entry);
+			return false;
+		}
+
+		for(size_t n = 0; n < entry->objects.size(); n++)
+		{
+			const ELF_linker_data& cached = entry->objects[n];
+
+			memcpy(cached.image, entry->images[n], cached.image_pages * PAGE_SIZE);
+
+			for(size_t p = 0; p < cached.num_protections; p++)
+			{
+				const elf_protection& prot = cached.protections[p];
+				memmanager_set_page_flags((uint8_t*)cached.image + prot.first_page * PAGE_SIZE, prot.num_pages, prot.flags);
+			}
+
+			auto linker_data = new ELF_linker_data{cached};
+			linker_data->lib_set = object->lib_set;
+			linker_data->symbol_map = object->symbol_map;
+			linker_data->loaded_objects = object->loaded_objects;
+
+			object->loaded_objects->push_back(linker_data);
+			object->segments.emplace_back(cached.image, cached.image_pages);
+
+			if(!cached.name.empty())
+			{
+				object->lib_set->insert(cached.name, 1);
+			}
+		}
+
+		object->linker_data = object->loaded_objects->back();
+		object->entry_point = entry->entry_point;
+
+		elf_cache.insert(elf_cache.begin(), entry);
+		return true;
+	}
+
+	return false;
+}
+
+static void elf_cache_store(const file_handle* file, dynamic_object* object)
+{
+	if(!object->loaded_objects || object->loaded_objects->empty() ||
+	   object->linker_data != object->loaded_objects->back() ||
+	   object->segments.size() != object->loaded_objects->size())
+	{
+		return; //something was loaded without a dynamic section
+	}
+
+	size_t size = 0;
+
+	for(void* linker_data : *object->loaded_objects)
+	{
+		auto data = (const ELF_linker_data*)linker_data;
+
+		if(!data->cacheable)
+		{
+			return;
+		}
+
+		size += data->image_pages * PAGE_SIZE;
+	}
+
+	if(size > ELF_CACHE_MAX_BYTES)
+	{
+		return;
+	}
+
+	sync::lock_guard l{elf_cache_lock};
+
+	for(elf_cache_entry* entry : elf_cache)
+	{
+		if(elf_same_file(entry->objects.back().file_key, elf_get_file_key(file)))
+		{
+			return; //someone else got here first
+		}
+	}
+
+	while(elf_cache_size + size > ELF_CACHE_MAX_BYTES)
+	{
+		elf_cache_free_entry(elf_cache.back());
+		elf_cache.pop_back();
+	}
+
+	auto entry = new elf_cache_entry{};
+	entry->entry_point = object->entry_point;
+	entry->size = size;
+
+	for(void* linker_data : *object->loaded_objects)
+	{
+		auto data = (const ELF_linker_data*)linker_data;
+		size_t image_size = data->image_pages * PAGE_SIZE;
+
+		uint8_t* image = (uint8_t*)malloc(image_size);
+
+		if(!image)
+		{
+			for(uint8_t* copied : entry->images)
+			{
+				free(copied);
+			}
+
+			delete entry;
+			return;
+		}
+
+		memcpy(image, data->image, image_size);
+
+		entry->images.push_back(image);
+		entry->objects.push_back(*data);
+	}
+
+	elf_cache_size += size;
+	elf_cache.insert(elf_cache.begin(), entry);
 }
\ No newline at end of file
@@ -188,6 +188,7 @@ enum ELF_dyn_section_tags
 	DT_NULL = 0,
 	DT_NEEDED = 1,
 	DT_PLTRELSZ = 2,
+	DT_PLTGOT = 3,
 	DT_HASH = 4,
 	DT_STRTAB = 5, // Dynamic String Table
 	DT_SYMTAB = 6, // Dynamic Symbol Table
@@ -201,7 +202,17 @@ enum ELF_dyn_section_tags
 	DT_RELENT = 19,
 	DT_JMPREL = 23,
 	DT_INIT_ARRAY = 25, // array of constructors
-	DT_INIT_ARRAYSZ = 26 // size of the table of constructors
+	DT_INIT_ARRAYSZ = 26, // size of the table of constructors
+	DT_GNU_HASH = 0x6ffffef5
+};
+
+#define ELF32_ST_BIND(i) ((i) >> 4)
+
+enum ELF_symbol_binding
+{
+	STB_LOCAL = 0,
+	STB_GLOBAL = 1,
+	STB_WEAK = 2
 };
 
 enum ELF_reloc_types
@@ -237,6 +248,20 @@ int load_elf(const file_handle* file, dynamic_object* object, bool user, directo
 
 void cleanup_elf(dynamic_object* object);
 
+//searches the namespace of object for a symbol, returns 0 if it can't be found
+uintptr_t elf_lookup_symbol(dynamic_object* object, const char* name);
+
+//finds the closest symbol at or below address in the objects loaded into object's namespace
+//returns its name and sets symbol_address, or returns null if none of the objects contain address
+const char* elf_find_symbol_by_address(dynamic_object* object, uintptr_t address, uintptr_t* symbol_address);
+
+//called through the PLT the first time a lazily bound function is used
+//binds the jump slot and returns the address of the function, or 0 if it can't be found
+uintptr_t elf_resolve_lazy_symbol(dynamic_object* object, size_t object_index, size_t relocation_offset);
+
+//user programs export this, lazily bound PLT entries jump to it
+#define ELF_LAZY_RESOLVER_NAME "_dl_runtime_resolve"
+
 
 #ifdef __cplusplus
 }
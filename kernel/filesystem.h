@@ -85,6 +85,7 @@ typedef enum {
 
 #include <optional>
 #include <string>
+#include <slab.h>
 
 //information about a file on disk
 struct file_handle
@@ -95,6 +96,8 @@ struct file_handle
 
 	time_t time_created;
 	time_t time_modified;
+
+	SLAB_CACHED(file_handle)
 };
 
 std::optional<file_handle> find_file_by_path(directory_stream* d, std::string_view path, int mode, int flags);
@@ -3,6 +3,7 @@
 #include <kernel/filesystem/util.h>
 #include <kernel/kassert.h>
 #include <kernel/locks.h>
+#include <kernel/trace.h>
 #include <stdlib.h>
 #include <bit>
 #include "drives.h"
@@ -85,13 +86,17 @@ struct filesystem_drive
 	void write_blocks(size_t lba, const uint8_t* buf, size_t num_sectors) const
 	{
 		k_assert(m_driver.write_blocks);
+		TRACE(TRACE_DISK_SUBMIT, m_index | TRACE_DISK_WRITE, lba);
 		m_driver.write_blocks(m_drv_impl_data, lba, buf, num_sectors);
+		TRACE(TRACE_DISK_COMPLETE, m_index | TRACE_DISK_WRITE, num_sectors);
 	}
 
 	void read_blocks(size_t lba, uint8_t* buf, size_t num_sectors) const
 	{
 		k_assert(m_driver.read_blocks);
+		TRACE(TRACE_DISK_SUBMIT, m_index, lba);
 		m_driver.read_blocks(m_drv_impl_data, lba, buf, num_sectors);
+		TRACE(TRACE_DISK_COMPLETE, m_index, num_sectors);
 	}
 
 	uint8_t* allocate_buffer(size_t size) const
@@ -385,6 +390,8 @@ T filesystem_drive::block_rw(size_t index, bool write_all) const
 
 	if(it == block_cache.buf_end())
 	{
+		TRACE(TRACE_BLOCK_CACHE_MISS, m_index, block);
+
 		cache_write_mutex.upgrade();
 
 		auto& item = block_cache.refresh_oldest_item();
@@ -425,6 +432,8 @@ T filesystem_drive::block_rw(size_t index, bool write_all) const
 		}
 	}
 
+	TRACE(TRACE_BLOCK_CACHE_HIT, m_index, block);
+
 	typename T::lock_t lock{*it->mtx};
 
 	cache_write_mutex.unlock_shared();
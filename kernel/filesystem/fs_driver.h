@@ -64,6 +64,8 @@ struct directory_stream
 {
 	file_data_block data;
 	std::vector<file_handle> file_list;
+
+	SLAB_CACHED(directory_stream)
 };
 
 //represents a partition on a drive
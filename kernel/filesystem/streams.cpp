@@ -9,6 +9,8 @@ struct file_stream
 	file_data_block file;
 	size_t seekpos;
 	bool modified;
+
+	SLAB_CACHED(file_stream)
 };
 
 file_stream* filesystem_create_stream(const file_data_block* f)
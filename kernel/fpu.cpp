@@ -0,0 +1,178 @@
+#include <kernel/fpu.h>
+#include <kernel/task.h>
+#include <common/cpuid.h>
+
+#define CR0_MP 0x02	//wait and fwait trap on TS too
+#define CR0_EM 0x04	//no fpu, every fpu instruction faults
+#define CR0_TS 0x08	//the fpu holds another task's registers
+#define CR0_NE 0x20	//fpu errors are exceptions instead of an irq, 486 and up
+
+#define CR4_OSFXSR 0x200		//fxsave saves the SSE registers, the SSE instructions work
+#define CR4_OSXMMEXCPT 0x400	//SSE errors are exceptions
+
+#define MXCSR_DEFAULT 0x1F80	//every SSE exception masked, round to nearest
+
+static bool fpu_present = false;
+static uint32_t cpu_features = 0;
+
+static inline uintptr_t read_cr0()
+{
+	uintptr_t cr0;
+	__asm__ volatile("mov %%cr0, %0" : "=r"(cr0));
+	return cr0;
+}
+
+static inline void write_cr0(uintptr_t cr0)
+{
+	__asm__ volatile("mov %0, %%cr0" :: "r"(cr0) : "memory");
+}
+
+static inline uint8_t* fpu_state_area(fpu_context* ctx)
+{
+	return (uint8_t*)(((uintptr_t)ctx->state + 15) & ~(uintptr_t)15);
+}
+
+static bool fpu_probe()
+{
+	uint16_t status = 0xFFFF;
+
+	__asm__ volatile("fninit\n"
+					 "fnstsw %0"
+					 : "=m"(status));
+
+	//fninit clears the status word, without an fpu nothing writes it
+	return status == 0;
+}
+
+static void fpu_setup_cpu()
+{
+	uintptr_t cr0 = read_cr0() & ~(CR0_EM | CR0_TS);
+
+	if(!fpu_present)
+	{
+		write_cr0(cr0 | CR0_EM);
+		return;
+	}
+
+	cr0 |= CR0_MP;
+
+	if(cpu_features & CPU_FEATURE_486)
+	{
+		cr0 |= CR0_NE;
+	}
+
+	write_cr0(cr0);
+
+	if(cpu_features & CPU_FEATURE_FXSR)
+	{
+		uintptr_t cr4;
+		__asm__ volatile("mov %%cr4, %0" : "=r"(cr4));
+
+		cr4 |= CR4_OSFXSR;
+
+		if(cpu_features & CPU_FEATURE_SSE)
+		{
+			cr4 |= CR4_OSXMMEXCPT;
+		}
+
+		__asm__ volatile("mov %0, %%cr4" :: "r"(cr4));
+	}
+
+	__asm__ volatile("fninit");
+
+	//whoever is running now gets a clean fpu when it first uses it, like every task after it
+	write_cr0(cr0 | CR0_TS);
+}
+
+void fpu_init(void)
+{
+	cpu_features = cpu_detect_features();
+
+	//CR0.EM might be left set by the bios, the probe needs it clear
+	write_cr0(read_cr0() & ~(CR0_EM | CR0_TS));
+	fpu_present = fpu_probe();
+
+	fpu_setup_cpu();
+}
+
+void fpu_init_ap(void)
+{
+	fpu_setup_cpu();
+}
+
+uint32_t fpu_features(void)
+{
+	if(!fpu_present)
+	{
+		return 0;
+	}
+
+	uint32_t features = cpu_features & CPU_FEATURE_MMX;
+
+	//the SSE registers are only kept across task switches by fxsave
+	if(cpu_features & CPU_FEATURE_FXSR)
+	{
+		features |= cpu_features & (CPU_FEATURE_FXSR | CPU_FEATURE_SSE | CPU_FEATURE_SSE2);
+	}
+
+	return features;
+}
+
+void fpu_save(fpu_context* ctx)
+{
+	if(!fpu_present || (read_cr0() & CR0_TS))
+	{
+		return; //it hasn't used the fpu since it was switched in, what was saved is still right
+	}
+
+	uint8_t* area = fpu_state_area(ctx);
+
+	if(cpu_features & CPU_FEATURE_FXSR)
+	{
+		__asm__ volatile("fxsave %0" : "=m"(*(uint8_t(*)[FPU_STATE_SIZE])area));
+	}
+	else
+	{
+		__asm__ volatile("fnsave %0" : "=m"(*(uint8_t(*)[FPU_STATE_SIZE])area));
+	}
+
+	ctx->saved = true;
+}
+
+bool fpu_handle_unavailable(void)
+{
+	if(!fpu_present)
+	{
+		return false;
+	}
+
+	__asm__ volatile("clts");
+
+	fpu_context* ctx = task_current_fpu_context();
+
+	if(ctx->saved)
+	{
+		uint8_t* area = fpu_state_area(ctx);
+
+		if(cpu_features & CPU_FEATURE_FXSR)
+		{
+			__asm__ volatile("fxrstor %0" :: "m"(*(const uint8_t(*)[FPU_STATE_SIZE])area));
+		}
+		else
+		{
+			__asm__ volatile("frstor %0" :: "m"(*(const uint8_t(*)[FPU_STATE_SIZE])area));
+		}
+	}
+	else
+	{
+		__asm__ volatile("fninit");
+
+		if(cpu_features & CPU_FEATURE_SSE)
+		{
+			const uint32_t mxcsr = MXCSR_DEFAULT;
+			__asm__ volatile("ldmxcsr %0" :: "m"(mxcsr));
+		}
+	}
+
+	return true;
+}
\ No newline at end of file
@@ -0,0 +1,40 @@
+#ifndef FPU_H
+#define FPU_H
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdbool.h>
+
+//fxsave writes 512 bytes, fnsave only 108
+#define FPU_STATE_SIZE 512
+
+//the x87, MMX and SSE registers of a task
+//the kernel never uses them, so they're only saved when a task that used them is switched out
+typedef struct fpu_context
+{
+	bool saved;		//state holds the task's registers, otherwise it gets a clean fpu the first time it uses one
+	uint8_t state[FPU_STATE_SIZE + 15];	//fxsave needs 16 byte alignment and the TCB is packed
+} fpu_context;
+
+//finds out what the fpu can do and sets up the boot cpu, fpu_init_ap does the same for the others
+void fpu_init(void);
+void fpu_init_ap(void);
+
+//the CPU_FEATURE flags for the MMX and SSE instructions that programs can use
+uint32_t fpu_features(void);
+
+//for the task switch, saves the registers if the running task used them since it was switched in
+//switch_task sets CR0.TS after that, so the next task traps the first time it touches the fpu
+void fpu_save(fpu_context* ctx);
+
+//the device not available fault, gives the running task its registers back
+//returns false if there's no fpu, then it's a real fault
+bool fpu_handle_unavailable(void);
+
+#ifdef __cplusplus
+}
+#endif
+#endif
\ No newline at end of file
@@ -1,18 +1,8 @@
 #include <stdint.h>
-#include <kernel/memorymanager.h>
-#include <kernel/locks.h>
+#include <stddef.h>
+#include <string.h>
 #include <kernel/tss.h>
-#include <stdio.h>
-
-struct __attribute__((packed)) gdt_entry
-{
-	uint16_t limit_low; 
-	uint16_t base_low;  
-	uint8_t  base_middle;
-	uint8_t  access;
-	uint8_t  granularity;
-	uint8_t  base_high; 
-};
+#include <kernel/syscall.h>
 
 struct __attribute__((packed)) gdt_descriptor
 {
@@ -20,52 +10,63 @@ struct __attribute__((packed)) gdt_descriptor
 	uint32_t offset;
 };
 
-struct __attribute__((packed)) tss
-{
-	uint16_t lin;
-	uint16_t reserved0;
-	uint32_t esp0;
-	uint16_t stack_seg;
-	uint16_t reserved1;
-	uint32_t r[23];
-};
+static_assert(offsetof(cpu_state, gdt) == CPU_STATE_GDT_OFFSET);
 
 extern "C" 
 {
-	extern gdt_descriptor gdt_descriptor_location;
 	extern gdt_entry gdt_location;
 	extern gdt_entry gdt_data_location;
-	extern gdt_entry gdt_tss_location;
 }
 
-static constinit sync::mutex tss_mtx{};
-
 extern "C" void load_TSS(uint16_t tss_seg);
 
-tss* create_TSS(uintptr_t stack_addr)
+void cpu_load_gdt(cpu_state* cpu)
 {
-	//lock modifications to the TSS
-	sync::lock_guard l{tss_mtx};
+	memcpy(cpu->gdt, &gdt_location, sizeof(cpu->gdt));
 
-	auto n_tss = new tss{};
+	gdt_descriptor descriptor = {
+		.size = sizeof(cpu->gdt) - 1,
+		.offset = (uint32_t)cpu->gdt
+	};
+
+	//the selectors and descriptors are the same as the ones already loaded,
+	//so the segment registers don't need to be reloaded
+	__asm__ volatile("lgdt %0" :: "m"(descriptor) : "memory");
+}
+
+void cpu_load_tss(cpu_state* cpu, uintptr_t stack_addr)
+{
+	tss* n_tss = &cpu->task_state_segment;
 
 	memset(n_tss, 0, sizeof(tss));
 
 	n_tss->stack_seg = ((uintptr_t)&gdt_data_location - (uintptr_t)&gdt_location);
 	n_tss->esp0 = stack_addr;
 
+	cpu->task_state = n_tss;
+
 	auto tss_addr = (uintptr_t)n_tss;
+	gdt_entry& tss_entry = cpu->gdt[GDT_TSS_INDEX];
 
-	gdt_tss_location.limit_low = sizeof(tss) & 0x0000FFFF;
-	gdt_tss_location.base_low = tss_addr & 0x0000FFFF;
-	gdt_tss_location.base_middle = (tss_addr >> 16) & 0xFF;
-	gdt_tss_location.access = 0x89;
-	gdt_tss_location.base_high = (tss_addr >> 24) & 0xFF;
-	gdt_tss_location.granularity = ((sizeof(tss) >> 16) & 0x0F) | 0x40;
+	tss_entry.limit_low = sizeof(tss) & 0x0000FFFF;
+	tss_entry.base_low = tss_addr & 0x0000FFFF;
+	tss_entry.base_middle = (tss_addr >> 16) & 0xFF;
+	tss_entry.access = 0x89;
+	tss_entry.base_high = (tss_addr >> 24) & 0xFF;
+	tss_entry.granularity = ((sizeof(tss) >> 16) & 0x0F) | 0x40;
 
-	uint16_t tss_seg = ((uintptr_t)&gdt_tss_location - (uintptr_t)&gdt_location) | 3;
+	uint16_t tss_seg = (GDT_TSS_INDEX * sizeof(gdt_entry)) | 3;
 	
 	load_TSS(tss_seg);
 
-	return n_tss;
+	setup_fast_syscalls((uintptr_t)n_tss + offsetof(tss, esp0));
+}
+
+void cpu_set_tls_base(cpu_state* cpu, uintptr_t base)
+{
+	gdt_entry& tls_entry = cpu->gdt[GDT_TLS_INDEX];
+
+	tls_entry.base_low = base & 0x0000FFFF;
+	tls_entry.base_middle = (base >> 16) & 0xFF;
+	tls_entry.base_high = (base >> 24) & 0xFF;
 }
\ No newline at end of file
@@ -1,18 +1,107 @@
 #include <kernel/locks.h>
 #include <kernel/task.h>
+#include <kernel/softirq.h>
+#include <kernel/memorymanager.h>
+#include <kernel/physical_manager.h>
 
 #include "input.h"
 
 static bool virtual_keystates[NUM_VIRTUAL_KEYS];
 
-#define INPUT_BUFFER_SIZE 64
+//every process that reads input gets its own ring, an event goes to whichever one is active when it happens
+#define MAX_INPUT_CLIENTS 32
 
-static volatile size_t input_buf_front = 0;
-static size_t input_buf_back = 0;
-static input_event input_buf[INPUT_BUFFER_SIZE];
+//past this, mouse motion is added up in the kernel instead of taking more slots
+#define INPUT_RING_NEARLY_FULL (INPUT_RING_SIZE - INPUT_RING_SIZE / 4)
 
-static constinit sync::mutex input_waiting_mtx{};
-static constinit sync::condition_variable input_waiting_cv{};
+#define NUM_MOTION_AXES 2
+
+struct input_client
+{
+	int pid;
+	input_ring* ring;		//the kernel's mapping, nullptr if the slot is free
+	input_ring* user_ring;	//where the process has it
+	input_event held_motion[NUM_MOTION_AXES];
+	bool motion_held[NUM_MOTION_AXES];
+	wait_queue waiters;
+};
+
+//events are delivered from the keyboard and mouse softirqs without the big kernel lock
+static input_client clients[MAX_INPUT_CLIENTS];
+static constinit sync::spinlock clients_lock;
+
+static input_client* find_client(int pid)
+{
+	for(input_client& c : clients)
+	{
+		if(c.ring && c.pid == pid)
+			return &c;
+	}
+
+	return nullptr;
+}
+
+static bool ring_push(input_ring* ring, const input_event& e)
+{
+	uint32_t head = ring->head;
+
+	if(head - __atomic_load_n(&ring->tail, __ATOMIC_ACQUIRE) >= INPUT_RING_SIZE)
+	{
+		ring->dropped = ring->dropped + 1;
+		return false;
+	}
+
+	ring->events[head % INPUT_RING_SIZE] = e;
+
+	//the process can't see the slot until the event is all there
+	__atomic_store_n(&ring->head, head + 1, __ATOMIC_RELEASE);
+	return true;
+}
+
+//sends on the motion that was held back, while the ring is under limit
+static void release_motion(input_client& c, uint32_t limit)
+{
+	for(size_t axis = 0; axis < NUM_MOTION_AXES; axis++)
+	{
+		if(!c.motion_held[axis])
+			continue;
+
+		if(input_ring_count(c.ring) >= limit)
+			return;
+
+		ring_push(c.ring, c.held_motion[axis]);
+		c.motion_held[axis] = false;
+	}
+}
+
+static void deliver(input_client& c, const input_event& e)
+{
+	release_motion(c, INPUT_RING_NEARLY_FULL);
+
+	if(e.type == AXIS_MOTION && e.control_index < NUM_MOTION_AXES)
+	{
+		input_event& held = c.held_motion[e.control_index];
+
+		if(c.motion_held[e.control_index])
+		{
+			held.data += e.data;
+			held.time_stamp = e.time_stamp;
+			c.ring->coalesced = c.ring->coalesced + 1;
+			return;
+		}
+
+		if(input_ring_count(c.ring) >= INPUT_RING_NEARLY_FULL)
+		{
+			held = e;
+			c.motion_held[e.control_index] = true;
+			return;
+		}
+	}
+
+	//anything else has to come after the motion before it
+	release_motion(c, INPUT_RING_SIZE);
+	ring_push(c.ring, e);
+}
 
 void handle_input_event(input_event e)
 {
@@ -30,45 +119,176 @@ void handle_input_event(input_event e)
 		}
 	}
 
-	input_buf[input_buf_front] = e;
-	input_buf_front = (input_buf_front + 1) % INPUT_BUFFER_SIZE;
+	{
+		sync::lock_guard l{clients_lock};
+
+		//nobody is listening, the event is lost like it would be with no window focused
+		input_client* c = find_client(get_active_process());
+
+		if(!c)
+			return;
 
-	input_waiting_cv.notify_one();
+		deliver(*c, e);
+		wait_queue_wake_all(&c->waiters);
+	}
+
+	//give the cpu to the process we just woke up
+	if(softirq_active())
+	{
+		softirq_request_task_switch();
+	}
 }
 
-static int do_get_input_event(input_event* e)
+//the calling process's client, the ring is made the first time it asks for one
+static input_client* get_client()
 {
-	if(this_task_is_active())
+	const int pid = get_running_process();
+
 	{
-		if(input_buf_back != input_buf_front)
-		{
-			*e = input_buf[input_buf_back];
-			input_buf_back = (input_buf_back + 1) % INPUT_BUFFER_SIZE;
+		sync::lock_guard l{clients_lock};
+
+		if(input_client* c = find_client(pid))
+			return c;
+	}
+
+	//the memory manager can block, so this can't be done with the lock held
+	uintptr_t physical = physical_memory_allocate(PAGE_SIZE, PAGE_SIZE);
 
-			return 0;
+	if(!physical)
+		return nullptr;
+
+	auto ring = (input_ring*)memmanager_map_to_new_pages(physical, 1, PAGE_PRESENT | PAGE_RW);
+
+	if(!ring)
+	{
+		physical_memory_free(physical, PAGE_SIZE);
+		return nullptr;
+	}
+
+	auto user_ring = (input_ring*)memmanager_map_to_new_pages(physical, 1, PAGE_PRESENT | PAGE_RW | PAGE_USER);
+
+	if(!user_ring)
+	{
+		memmanager_free_pages(ring, 1);
+		return nullptr;
+	}
+
+	memset(ring, 0, sizeof(input_ring));
+
+	input_client* result = nullptr;
+	bool taken = false;
+
+	{
+		sync::lock_guard l{clients_lock};
+
+		//another thread of the process might have made one while we weren't holding the lock
+		if((result = find_client(pid)))
+		{
+			taken = true;
 		}
+		else
+		{
+			for(input_client& c : clients)
+			{
+				if(!c.ring)
+				{
+					c = input_client{};
+					c.pid = pid;
+					c.ring = ring;
+					c.user_ring = user_ring;
+					result = &c;
+					break;
+				}
+			}
+		}
+	}
 
-		return 1;
+	if(taken || !result)
+	{
+		memmanager_unmap_pages(user_ring, 1);
+		memmanager_free_pages(ring, 1);
 	}
 
-	return -1;
+	return result;
 }
 
-SYSCALL_HANDLER int get_input_event(input_event* e, bool wait)
+//returns how many events are waiting, after blocking until there's at least one if wait is set
+static uint32_t wait_for_events(input_client& c, bool wait)
 {
-	if(wait)
 	{
-		while(do_get_input_event(e) != 0)
+		sync::lock_guard l{clients_lock};
+		release_motion(c, INPUT_RING_SIZE);
+	}
+
+	wait_queue_entry entry;
+
+	for(;;)
+	{
+		uint32_t count = input_ring_count(c.ring);
+
+		if(count || !wait || !wait_queue_prepare(&c.waiters, &entry))
+			return count;
+
+		//checked again once we're queued, so an event that came in just now isn't missed
+		if(input_ring_count(c.ring) == 0)
 		{
-			sync::unique_lock l{input_waiting_mtx};
-			input_waiting_cv.wait(l);
+			task_block();
 		}
-		return 0;
+
+		wait_queue_finish(&c.waiters, &entry);
 	}
-	else
+}
+
+void input_process_exited(int pid)
+{
+	input_ring* ring;
+	input_ring* user_ring;
+
 	{
-		return do_get_input_event(e);
+		sync::lock_guard l{clients_lock};
+
+		input_client* c = find_client(pid);
+
+		if(!c)
+			return;
+
+		ring = c->ring;
+		user_ring = c->user_ring;
+		c->ring = nullptr;
 	}
+
+	memmanager_unmap_pages(user_ring, 1);
+	memmanager_free_pages(ring, 1);
+}
+
+SYSCALL_HANDLER input_ring* open_input_ring(void)
+{
+	input_client* c = get_client();
+	return c ? c->user_ring : nullptr;
+}
+
+SYSCALL_HANDLER int wait_input_ring(bool wait)
+{
+	input_client* c = get_client();
+
+	if(!c)
+		return -1;
+
+	return (int)wait_for_events(*c, wait);
+}
+
+SYSCALL_HANDLER int get_input_event(input_event* e, bool wait)
+{
+	input_client* c = get_client();
+
+	if(!c)
+		return -1;
+
+	if(wait_for_events(*c, wait) == 0)
+		return 1;
+
+	input_ring_read(c->ring, e, 1);
+	return 0;
 };
 
 SYSCALL_HANDLER int get_keystate(key_type key)
@@ -78,4 +298,4 @@ SYSCALL_HANDLER int get_keystate(key_type key)
 		return 0;
 	}
 	return virtual_keystates[key];
-}
+}
\ No newline at end of file
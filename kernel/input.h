@@ -8,11 +8,22 @@ extern "C" {
 
 #include <api/virtual_keys.h>
 #include <common/input_event.h>
+#include <common/input_ring.h>
 #include <kernel/syscall.h>
 
 void handle_input_event(input_event e);
 SYSCALL_HANDLER int get_input_event(input_event* e, bool wait);
 
+//maps the calling process's ring into it, events go to the ring while the process is active
+SYSCALL_HANDLER input_ring* open_input_ring(void);
+
+//sends on motion the kernel held back, then returns how many events are in the ring
+//with wait set it blocks until there's at least one
+SYSCALL_HANDLER int wait_input_ring(bool wait);
+
+//frees the process's ring
+void input_process_exited(int pid);
+
 SYSCALL_HANDLER int get_keystate(key_type key);
 
 
@@ -6,8 +6,12 @@
 
 #include <kernel/memorymanager.h>
 #include <kernel/task.h>
+#include <kernel/locks.h>
 #include <kernel/interrupt.h>
 #include <kernel/display.h>
+#include <kernel/apic.h>
+#include <kernel/trace.h>
+#include <kernel/fpu.h>
 #include <drivers/portio.h>
 
 enum {
@@ -19,6 +23,21 @@ enum {
 	PIC_GET_ISR_CMD = 0x0B
 };
 
+#define PIC_CASCADE_IRQ 2
+#define NUM_PIC_IRQS 16
+
+//vectors past the PIC's that are handed out to devices sending MSIs
+#define FIRST_MSI_VECTOR (32 + NUM_PIC_IRQS)
+#define LAST_MSI_VECTOR (APIC_TIMER_VECTOR - 1)
+
+#define MSI_ADDRESS_BASE 0xFEE00000
+
+//once the IO-APIC takes over the PIC is masked and every irq is acknowledged through the local APIC
+static bool using_apic = false;
+
+//an MSI vector is taken while its gate is present, the lock keeps two drivers off the same one
+static constinit sync::spinlock msi_lock{};
+
 struct __attribute__((packed)) idt_entry
 {
 	uint16_t 	address_low = 0;
@@ -225,6 +244,16 @@ void irq_uninstall_handler(size_t irq)
 
 void irq_enable(size_t irq, bool enabled)
 {
+	if(using_apic)
+	{
+		//MSIs can't be masked here, the device has to stop sending them
+		if(irq < NUM_PIC_IRQS)
+		{
+			ioapic_set_masked(irq, !enabled);
+		}
+		return;
+	}
+
 	auto port = PIC1_COMMAND_PORT;
 	if(irq >= 8)
 	{
@@ -244,6 +273,11 @@ void irq_enable(size_t irq, bool enabled)
 
 bool irq_is_requested(size_t irq)
 {
+	if(using_apic)
+	{
+		return apic_is_requested(32 + irq);
+	}
+
 	auto port = PIC1_COMMAND_PORT;
 	if(irq >= 8)
 	{
@@ -259,6 +293,12 @@ bool irq_is_requested(size_t irq)
 
 INT_CALLABLE void acknowledge_irq(size_t irq)
 {
+	if(using_apic)
+	{
+		apic_eoi();
+		return;
+	}
+
 	if(irq >= 8)
 	{
 		outb(PIC2_COMMAND_PORT, PIC_EOI_CMD);
@@ -266,6 +306,76 @@ INT_CALLABLE void acknowledge_irq(size_t irq)
 	outb(PIC1_COMMAND_PORT, PIC_EOI_CMD);
 }
 
+INT_CALLABLE bool irq_is_spurious(size_t irq)
+{
+	//the local APIC has its own vector for these
+	if(using_apic || (irq != 7 && irq != 15))
+	{
+		return false;
+	}
+
+	auto port = (irq == 15) ? PIC2_COMMAND_PORT : PIC1_COMMAND_PORT;
+
+	outb(port, PIC_GET_ISR_CMD);
+	if(inb(port) & (1 << 7))
+	{
+		return false;
+	}
+
+	if(irq == 15)
+	{
+		//the first PIC did see an interrupt from the second one
+		outb(PIC1_COMMAND_PORT, PIC_EOI_CMD);
+	}
+
+	return true;
+}
+
+void irq_set_level_triggered(size_t irq)
+{
+	//the PIC was already set up by the BIOS
+	if(using_apic)
+	{
+		ioapic_set_level_triggered(irq);
+	}
+}
+
+int irq_allocate_msi(irq_func handler, uint32_t* address, uint32_t* data)
+{
+	if(!using_apic)
+	{
+		return -1;
+	}
+
+	sync::lock_guard l{msi_lock};
+
+	size_t vector = FIRST_MSI_VECTOR;
+
+	//skip the syscall gate even before it's installed, and anything else already in use
+	while(vector == SYSCALL_VECTOR || (idt[vector].flags & IDT_INT_PRESENT))
+	{
+		if(++vector > LAST_MSI_VECTOR)
+		{
+			return -1;
+		}
+	}
+
+	irq_install_handler(vector - 32, handler);
+
+	//fixed delivery, edge triggered, to the cpu that takes all the other irqs too
+	*address = MSI_ADDRESS_BASE | (apic_get_id() << 12);
+	*data = vector;
+
+	return vector - 32;
+}
+
+void irq_free_msi(int irq)
+{
+	sync::lock_guard l{msi_lock};
+
+	idt_install_handler(32 + irq, nullptr, IDT_SEGMENT_KERNEL, 0);
+}
+
 void irq_remap(void)
 {
 	outb(PIC1_COMMAND_PORT, 0x11); //Init PIC#1
@@ -291,9 +401,31 @@ extern "C" void fault_handler(interrupt_info * r)
 {
 	if(r->int_no < 32)
 	{
+		//a task using the fpu for the first time since it was switched in
+		if(r->int_no == 7 && fpu_handle_unavailable())
+		{
+			return;
+		}
+
+		//faults from user mode come in without the big kernel lock
+		bool lock_taken = !big_kernel_lock_held();
+		if(lock_taken)
+		{
+			big_kernel_lock();
+		}
+
+		if(r->int_no == 14)
+		{
+			TRACE(TRACE_PAGE_FAULT, getcr2reg(), r->err_code);
+		}
+
 		if(r->int_no == 14 &&
 		   memmanager_handle_page_fault(r->err_code, getcr2reg())) //page fault
 		{
+			if(lock_taken)
+			{
+				big_kernel_unlock();
+			}
 			return; //page fault handled, we can resume execution
 		}
 
@@ -377,4 +509,36 @@ void interrupts_init()
 
 	// Points the processor's internal register to the new IDT
 	idt_load();
+}
+
+void interrupts_enable_apic()
+{
+	if(!apic_init() || !ioapic_init())
+	{
+		return;
+	}
+
+	int_lock l = lock_interrupts();
+
+	uint16_t pic_mask = inb(PIC1_COMMAND_PORT + 1) | (inb(PIC2_COMMAND_PORT + 1) << 8);
+
+	for(size_t irq = 0; irq < NUM_PIC_IRQS; irq++)
+	{
+		if(irq != PIC_CASCADE_IRQ)
+		{
+			ioapic_route_irq(irq, 32 + irq, apic_get_id(), pic_mask & (1 << irq));
+		}
+	}
+
+	outb(PIC1_COMMAND_PORT + 1, 0xFF);
+	outb(PIC2_COMMAND_PORT + 1, 0xFF);
+
+	using_apic = true;
+
+	unlock_interrupts(l);
+}
+
+void interrupts_init_ap()
+{
+	idt_load();
 }
\ No newline at end of file
@@ -26,6 +26,8 @@ typedef struct
 #define IDT_SEGMENT_KERNEL 0x08
 #define IDT_SEGMENT_USER 0x18
 
+#define SYSCALL_VECTOR 0x80
+
 typedef struct
 {
     uint32_t ip;
@@ -41,6 +43,10 @@ typedef INTERRUPT_HANDLER void (irq_func)(interrupt_frame* r);
 
 INT_CALLABLE void acknowledge_irq(size_t irq);
 void interrupts_init();
+void interrupts_init_ap(); //loads the IDT on the other cpus, interrupts are on afterwards
+
+//moves the irqs from the PIC to the IO-APIC if there is one, the PIC is left masked
+void interrupts_enable_apic();
 void isr_install_handler(size_t vector, irq_func r, bool user);
 void isr_uninstall_handler(size_t irq);
 void irq_install_handler(size_t irq, irq_func r);
@@ -49,6 +55,19 @@ void irq_enable(size_t irq, bool enabled);
 
 bool irq_is_requested(size_t irq);
 
+//the PIC raises irq 7 or 15 when an interrupt goes away before it's serviced
+//a handler for those should return without acknowledging when this is true
+INT_CALLABLE bool irq_is_spurious(size_t irq);
+
+//for PCI interrupt lines, which are level triggered and active low
+void irq_set_level_triggered(size_t irq);
+
+//installs handler on a free vector and fills in what the device has to write to raise it
+//returns the irq to acknowledge, or -1 if MSIs can't be used
+int irq_allocate_msi(irq_func handler, uint32_t* address, uint32_t* data);
+//gives back a vector from irq_allocate_msi when the device couldn't be set up to use it
+void irq_free_msi(int irq);
+
 #ifdef __cplusplus
 }
 #endif
@@ -249,6 +249,13 @@ gdt_tss:
 	db 0	
 	db 0	;= ((limit & 0xF0000) >> 16) | 0x40
 	db 0				
+gdt_usr_tls :	;user data, but the base is moved to the running thread's TLS block
+	dw 0xffff 	
+	dw 0x0000 		
+	db 0x00		
+	db 0xF2
+	db 0xCF ;flags and top nibble of limit
+	db 0x00
 gdt_end :
 
 gdt_descriptor_location:
@@ -260,6 +267,7 @@ GDT_CODE_SEG equ gdt_code - gdt_start
 GDT_DATA_SEG equ gdt_data - gdt_start
 GDT_USER_CODE_SEG equ gdt_usr_code - gdt_start
 GDT_USER_DATA_SEG equ gdt_usr_data - gdt_start
+GDT_USER_TLS_SEG equ gdt_usr_tls - gdt_start
 GDT_TSS_SEG equ gdt_tss - gdt_start
 
 global run_user_code
@@ -271,6 +279,7 @@ run_user_code:
 	mov ds,	ax
 	mov es,	ax 
 	mov fs,	ax 
+	mov ax,	GDT_USER_TLS_SEG | 3
 	mov gs,	ax ;we don't need to worry about SS. it's handled by iret
 	
 	push GDT_USER_DATA_SEG | 3 	;user data segment with bottom 2 bits set for ring 3
@@ -280,20 +289,40 @@ run_user_code:
 	push ebx 					;address of the user function
 	iret
 
-global current_task_TCB
-current_task_TCB dd 0
+NO_CPU equ 0xFFFFFFFF
+CR0_TS equ 0x08
 
 struc TCB
     .esp:		resd 1
     .esp0:		resd 1
     .cr3:		resd 1
-	.tss_ptr:	resd 1
+	.cpu:		resd 1
+endstruc
+
+;see cpu_state in cpu.h, every cpu's GDT is inside of its cpu_state
+struc CPU_STATE
+	.current_task:	resd 1
+	.task_state:	resd 1
 endstruc
 
+CPU_STATE_GDT_OFFSET equ 40
+
+;%1 = the cpu_state of the cpu we are running on
+%macro GET_CPU_STATE 1
+	sub esp, 8
+	sgdt [esp]
+	mov %1, [esp + 2]
+	add esp, 8
+	sub %1, CPU_STATE_GDT_OFFSET
+%endmacro
+
 global switch_task_no_return
 switch_task_no_return:
 	cli
 	mov esi, [esp + 4]
+	GET_CPU_STATE edx
+	mov [edx + CPU_STATE.current_task], esi
+	mov esp, [esi + TCB.esp]
 	jmp load_new_task
 	
 global switch_task
@@ -305,7 +334,8 @@ switch_task:
     push edi
     push ebp
 
-    mov edi, [current_task_TCB]		;edi = address of the previous task's "thread control block"
+	GET_CPU_STATE edx				;edx = this cpu's state
+    mov edi, [edx + CPU_STATE.current_task]	;edi = address of the previous task's "thread control block"
    	mov eax, cr3
 	mov [edi + TCB.esp], esp		;Save ESP for previous task's kernel stack in the thread's TCB
 	mov [edi + TCB.cr3], eax
@@ -313,19 +343,26 @@ switch_task:
 	;Load next task's state
     mov esi, [esp + (5+1)*4]		;esi = address of the next task's "thread control block" (parameter passed on stack)
 
+    mov [edx + CPU_STATE.current_task], esi	;Current task's TCB is the next task TCB
+    mov esp, [esi + TCB.esp]		;Load ESP for next task's kernel stack from the thread's TCB
+
+	;we are off the previous task's stack, another cpu can pick it up now
+	mov dword [edi + TCB.cpu], NO_CPU
+
 load_new_task:
-    mov [current_task_TCB], esi		;Current task's TCB is the next task TCB
+	mov eax, cr0
+	or eax, CR0_TS					;the next task gets its fpu registers back the first time it uses them, see fpu.cpp
+	mov cr0, eax
 
-    mov esp, [esi + TCB.esp]		;Load ESP for next task's kernel stack from the thread's TCB
     mov eax, [esi + TCB.cr3]		;eax = address of page directory for next task
     mov ebx, [esi + TCB.esp0]		;ebx = address for the top of the next task's kernel stack
-	mov edi, [esi + TCB.tss_ptr]
+	mov edi, [edx + CPU_STATE.task_state]
 	mov [edi+4], ebx					;Adjust the ESP0 field in the TSS (used by CPU for for CPL=3 -> CPL=0 privilege level changes)
     mov ecx, cr3					;ecx = previous task's virtual address space
 
     cmp eax, ecx					;Does the virtual address space need to being changed?
     je .doneVAS						;no, virtual address space is the same, so don't reload it and cause TLB flushes
-    mov cr3, eax					;yes, load the next task's virtual address space
+    mov cr3, eax					;yes, load the next task's virtual address space (global kernel pages stay cached)
 .doneVAS:
     pop ebp
     pop edi
@@ -13,6 +13,14 @@
 #include <kernel/elf.h>
 #include <kernel/display.h>
 #include <kernel/sysclock.h>
+#include <kernel/smp.h>
+#include <kernel/apic.h>
+#include <kernel/timer.h>
+#include <kernel/worker.h>
+#include <kernel/trace.h>
+#include <kernel/fpu.h>
+#include <kernel/memtype.h>
+#include <kernel/profile.h>
 #include <kernel/kassert.h>
 
 #include <drivers/ramdisk.h>
@@ -33,16 +41,22 @@ extern void memmanager_print_free_map();
 
 void kernel_main()
 {
+	smp_early_init(); //the boot cpu gets its own GDT like the others, before anything uses it
+
 	parse_boot_info();
 
 	interrupts_init();
 
+	fpu_init();
+
 	physical_memory_init();
 
 	reserve_boot_mem();
 
 	memmanager_init();
 
+	memtype_init();
+
 	basic_text_init();
 
 	//call global constructors
@@ -56,12 +70,26 @@ void kernel_main()
 			boot_information.ramdisk_location, 
 			boot_information.ramdisk_location + boot_information.ramdisk_size);
 
+	interrupts_enable_apic(); //before the PIT starts, so none of its ticks get lost in the switch
+
 	sysclock_init();
 
+	apic_timer_calibrate();
+
+	timer_init();
+
 	setup_syscalls();
 
 	setup_first_task(); //we are now running as a kernel level task
 
+	work_init();
+
+	smp_init();
+
+	trace_init();
+
+	profile_init();
+
 	ramdisk_init();
 
 	rdfs_init();
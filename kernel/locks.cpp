@@ -1,5 +1,10 @@
 #include "locks.h"
 #include "task.h"
+#include "cpu.h"
+#include "smp.h"
+#include "timer.h"
+#include "softirq.h"
+#include "sysclock.h"
 
 #include <stdio.h>
 
@@ -82,6 +87,8 @@ void kernel_lock_mutex(kernel_mutex* m)
 	while(!do_try_lock_mutex(m, &pid))
 	{
 		switch_to_task(pid);
+		//the owner might be running on another cpu, waiting to get into the kernel
+		big_kernel_relax();
 	}
 }
 
@@ -94,7 +101,18 @@ void kernel_unlock_mutex(kernel_mutex* m)
 void kernel_signal_cv(kernel_cv* m)
 {
 	tas_release(&m->unavailable);
-	switch_to_active_task();
+	//the waiter might have halted its cpu
+	smp_wake_all();
+
+	//irq handlers signal from their softirqs, which can't switch tasks themselves
+	if(softirq_active())
+	{
+		softirq_request_task_switch();
+	}
+	else
+	{
+		switch_to_active_task();
+	}
 }
 
 void kernel_wait_cv(kernel_mutex* locked_mutex, kernel_cv* m)
@@ -108,4 +126,84 @@ void kernel_wait_cv(kernel_mutex* locked_mutex, kernel_cv* m)
 		}
 		run_background_tasks();
 	}
+}
+
+//only there to wake up a cpu that halted while waiting
+static void wait_timeout_expired(void* data)
+{
+	smp_wake_all();
+}
+
+bool kernel_wait_cv_until(kernel_mutex* locked_mutex, kernel_cv* m, clock_t deadline)
+{
+	kernel_timer timer;
+	timer_start(&timer, deadline, wait_timeout_expired, nullptr);
+
+	bool signaled;
+
+	while(true)
+	{
+		if(tas_aquire(&m->unavailable) == 0)
+		{
+			signaled = true;
+			break;
+		}
+		if(sysclock_get_ticks() >= deadline)
+		{
+			signaled = false;
+			break;
+		}
+		run_background_tasks();
+	}
+
+	timer_cancel(&timer);
+	kernel_unlock_mutex(locked_mutex);
+	return signaled;
+}
+
+//a ticket lock, so a cpu that keeps relaxing the lock can't starve the others
+//it uses xadd which the 386 doesn't have, but it only runs on machines with more than one cpu
+static uint32_t big_lock_next_ticket = 0;
+static volatile uint32_t big_lock_now_serving = 0;
+static volatile size_t big_lock_owner = NO_CPU;
+
+void big_kernel_lock()
+{
+	if(!smp_enabled)
+		return;
+
+	uint32_t ticket = __atomic_fetch_add(&big_lock_next_ticket, 1, __ATOMIC_ACQUIRE);
+
+	while(__atomic_load_n(&big_lock_now_serving, __ATOMIC_ACQUIRE) != ticket)
+	{
+		//this can be called with interrupts off, so the cpu holding the lock
+		//might be waiting on us to flush our TLB
+		smp_service_tlb_flush();
+		cpu_relax();
+	}
+
+	big_lock_owner = this_cpu()->index;
+}
+
+void big_kernel_unlock()
+{
+	if(!smp_enabled)
+		return;
+
+	big_lock_owner = NO_CPU;
+	__atomic_store_n(&big_lock_now_serving, big_lock_now_serving + 1, __ATOMIC_RELEASE);
+}
+
+bool big_kernel_lock_held()
+{
+	return !smp_enabled || big_lock_owner == this_cpu()->index;
+}
+
+void big_kernel_relax()
+{
+	if(!smp_enabled)
+		return;
+
+	big_kernel_unlock();
+	big_kernel_lock();
 }
\ No newline at end of file
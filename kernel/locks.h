@@ -7,6 +7,7 @@ extern "C" {
 #include <stdlib.h>
 #include <stdbool.h>
 #include <stdio.h>
+#include <time.h>
 
 #ifndef __I386_ONLY
 #define SYNC_HAS_CAS_FUNC 1
@@ -57,6 +58,20 @@ extern "C" {
 	void kernel_signal_cv(kernel_cv* m);
 	void kernel_wait_cv(kernel_mutex* locked_mutex, kernel_cv* m);
 
+	//gives up at the deadline, in sysclock ticks, returns false if it did
+	bool kernel_wait_cv_until(kernel_mutex* locked_mutex, kernel_cv* m, clock_t deadline);
+
+	//only one cpu at a time runs kernel code, the others can run user code or sit idle
+	//it's taken when entering the kernel from user mode and released on the way out,
+	//a task switch hands it to the next task along with the cpu
+	//until the other cpus are started it does nothing
+	void big_kernel_lock(void);
+	void big_kernel_unlock(void);
+	bool big_kernel_lock_held(void);
+
+	//lets another cpu into the kernel for a moment, for when we are waiting on something
+	void big_kernel_relax(void);
+
 #ifdef __cplusplus
 }
 
@@ -114,6 +129,61 @@ private:
 	kernel_mutex m_mtx = init_mutex();
 };
 
+//for data shared between cpus that is only held for a few instructions
+//interrupts are off while it's held so an interrupt handler on the same cpu can't deadlock on it
+//never allocate memory or switch tasks while holding one
+class spinlock
+{
+public:
+	constexpr spinlock() = default;
+	~spinlock() = default;
+	spinlock(const spinlock&) = delete;
+	spinlock& operator=(const spinlock&) = delete;
+
+	void lock()
+	{
+		int_lock l = lock_interrupts();
+
+		while(__sync_lock_test_and_set(&m_locked, 1))
+		{
+			//wait with interrupts back on, and without hammering the bus with locked writes
+			unlock_interrupts(l);
+			while(__atomic_load_n(&m_locked, __ATOMIC_RELAXED))
+			{
+				__asm__ volatile("rep; nop" ::: "memory");
+			}
+			l = lock_interrupts();
+		}
+
+		m_saved_flags = l;
+	}
+
+	bool try_lock()
+	{
+		int_lock l = lock_interrupts();
+
+		if(__sync_lock_test_and_set(&m_locked, 1))
+		{
+			unlock_interrupts(l);
+			return false;
+		}
+
+		m_saved_flags = l;
+		return true;
+	}
+
+	void unlock()
+	{
+		int_lock l = m_saved_flags;
+		__sync_lock_release(&m_locked);
+		unlock_interrupts(l);
+	}
+
+private:
+	uint8_t m_locked = 0;
+	int_lock m_saved_flags = 0;
+};
+
 template<typename T>
 void atomic_store(T* ptr, T newval)
 {
@@ -211,6 +281,11 @@ public:
 	{
 		return kernel_wait_cv(m.mutex()->native_handle(), &m_cv);
 	}
+
+	bool wait_until(unique_lock<mutex>& m, clock_t deadline)
+	{
+		return kernel_wait_cv_until(m.mutex()->native_handle(), &m_cv, deadline);
+	}
 private:
 	kernel_cv m_cv = init_cv();
 };
@@ -6,6 +6,26 @@
 #include <kernel/physical_manager.h>
 #include <kernel/locks.h>
 #include <kernel/kassert.h>
+#include <kernel/smp.h>
+#include <common/cpuid.h>
+
+#include <algorithm>
+
+#define CR4_PGE 0x80
+
+//set during init, if the cpu has global pages kernel mappings get PAGE_GLOBAL
+//so that they stay in the TLB when a task switch reloads CR3
+static page_flags_t global_page_flag = 0;
+
+#ifndef __I386_ONLY
+static constexpr bool tlb_has_invlpg = true;
+#else
+static bool tlb_has_invlpg = false; //the 386 has no invlpg
+#endif
+
+//invalidating more pages than this one at a time costs more than just
+//throwing away the whole TLB and taking the misses
+#define TLB_INVLPG_THRESHOLD 32
 
 static inline void __flush_tlb()
 {
@@ -16,29 +36,170 @@ static inline void __flush_tlb()
 		: "%eax", "memory");
 }
 
+//reloading CR3 does not flush global pages, toggling CR4.PGE does
+static inline void __flush_tlb_global()
+{
+	if(!global_page_flag)
+	{
+		__flush_tlb();
+		return;
+	}
+
+	__asm__ volatile("mov %%cr4, %%eax\n"
+					 "xor %0, %%eax\n"
+					 "mov %%eax, %%cr4\n"
+					 "xor %0, %%eax\n"
+					 "mov %%eax, %%cr4"
+					 :
+	: "i"(CR4_PGE)
+		: "%eax", "memory");
+}
+
 static inline void __flush_tlb_page(uintptr_t addr)
 {
-#ifndef __I386_ONLY
-	__asm__ volatile("invlpg (%0)" ::"r" (addr) : "memory");
-#else
-	__flush_tlb();
-#endif
+	if(tlb_has_invlpg)
+	{
+		__asm__ volatile("invlpg (%0)" ::"r" (addr) : "memory");
+	}
+	else
+	{
+		__flush_tlb();
+	}
 }
 
+#define MAXIMUM_ADDRESS (~(uintptr_t)0)
+
+//collects the pages whose mappings were changed so the TLB can be flushed once
+//for the whole range instead of once for every page
+class tlb_batch
+{
+public:
+	constexpr tlb_batch() = default;
+	tlb_batch(const tlb_batch&) = delete;
+	tlb_batch& operator=(const tlb_batch&) = delete;
+
+	~tlb_batch()
+	{
+		flush();
+	}
+
+	void add(uintptr_t v_address, uintptr_t old_entry)
+	{
+		//entries that were not present are never cached, no need to flush
+		if(!(old_entry & PAGE_PRESENT))
+			return;
+
+		m_first = std::min(m_first, v_address);
+		m_last = std::max(m_last, v_address);
+		m_global = m_global || (old_entry & PAGE_GLOBAL);
+	}
+
+	void flush()
+	{
+		if(m_first > m_last)
+			return;
+
+		size_t num_pages = (m_last - m_first) / PAGE_SIZE + 1;
+
+		if(tlb_has_invlpg && num_pages <= TLB_INVLPG_THRESHOLD)
+		{
+			for(uintptr_t v = m_first; num_pages--; v += PAGE_SIZE)
+			{
+				__flush_tlb_page(v);
+			}
+		}
+		else if(m_global)
+		{
+			__flush_tlb_global();
+		}
+		else
+		{
+			__flush_tlb();
+		}
+
+		//the kernel's half is the same in every address space, so the other cpus might have it cached
+		//user mappings can only be cached by the cpus running another thread of this process
+		if(m_global || m_last >= KERNEL_SPLIT)
+		{
+			smp_flush_tlb();
+		}
+		else
+		{
+			smp_flush_tlb_address_space();
+		}
+
+		m_first = ~(uintptr_t)0;
+		m_last = 0;
+		m_global = false;
+	}
+
+private:
+	uintptr_t m_first = ~(uintptr_t)0;
+	uintptr_t m_last = 0;
+	bool m_global = false;
+};
+
+//a physical page that was unmapped can't be reused until every cpu has flushed it out of its TLB
+//the pages are held here and freed after the batch is flushed, declare it after the batch
+class tlb_deferred_free
+{
+public:
+	explicit tlb_deferred_free(tlb_batch& batch) : m_batch(batch) {}
+	tlb_deferred_free(const tlb_deferred_free&) = delete;
+	tlb_deferred_free& operator=(const tlb_deferred_free&) = delete;
+
+	~tlb_deferred_free()
+	{
+		flush();
+	}
+
+	void add(uintptr_t physical_address)
+	{
+		if(m_count == MAX_PAGES)
+		{
+			flush();
+		}
+
+		m_pages[m_count++] = physical_address;
+	}
+
+	void flush()
+	{
+		if(m_count == 0)
+			return;
+
+		m_batch.flush();
+
+		for(size_t i = 0; i < m_count; i++)
+		{
+			physical_memory_free(m_pages[i], PAGE_SIZE);
+		}
+
+		m_count = 0;
+	}
+
+private:
+	static constexpr size_t MAX_PAGES = 32;
+
+	tlb_batch& m_batch;
+	uintptr_t m_pages[MAX_PAGES];
+	size_t m_count = 0;
+};
+
 //this mutex must be locked when accessing/modfying kernel address space mappings
 static constinit sync::mutex kernel_addr_mutex{};
 static uintptr_t* kernel_page_directory;
 
+//the kernel page directory mapped into the kernel address space
+//every kernel page table is entered here, other address spaces pick them up on demand
+static uintptr_t* kernel_pd_mapping = nullptr;
+
 extern "C" void memmanager_print_all_mappings_to_physical_DEBUG();
 
 #define PT_INDEX_MASK (PAGE_TABLE_SIZE - 1)
 #define PAGE_FLAGS_MASK (PAGE_SIZE - 1)
 #define PAGE_ADDRESS_MASK (~PAGE_FLAGS_MASK)
 
-#define MAXIMUM_ADDRESS (~(uintptr_t)0)
-
-#define KERNEL_SPLIT (MAXIMUM_ADDRESS - MAXIMUM_ADDRESS/8)
-
 uintptr_t* const last_pde_address = (uintptr_t*)((uintptr_t)(PAGE_TABLE_SIZE - 1) * (uintptr_t)PAGE_TABLE_SIZE * (uintptr_t)PAGE_SIZE);
 uintptr_t* const current_page_directory = (uintptr_t*)((uintptr_t)MAXIMUM_ADDRESS - (uintptr_t)~PAGE_ADDRESS_MASK);
 
@@ -66,14 +227,39 @@ static uintptr_t& memmanager_get_pt_entry(uintptr_t virtual_address, size_t pd_i
 	return page_table[get_page_tbl_index(virtual_address)];
 }
 
+//copies in a kernel page table that was created while another address space was active
+static bool memmanager_sync_kernel_pd_entry(size_t pd_index)
+{
+	if(kernel_pd_mapping == nullptr)
+	{
+		return false;
+	}
+
+	uintptr_t kernel_entry = kernel_pd_mapping[pd_index];
+
+	if((kernel_entry & PAGE_PRESENT) && !(kernel_entry & PAGE_USER) &&
+	   !(current_page_directory[pd_index] & PAGE_PRESENT))
+	{
+		current_page_directory[pd_index] = kernel_entry;
+		return true;
+	}
+
+	return false;
+}
+
+static bool memmanager_page_table_present(size_t pd_index)
+{
+	return (current_page_directory[pd_index] & PAGE_PRESENT) ||
+		memmanager_sync_kernel_pd_entry(pd_index);
+}
+
 static uintptr_t memmanager_get_pt_entry(uintptr_t virtual_address)
 {
 	size_t pd_index = get_page_dir_index(virtual_address);
-	uintptr_t pd_entry = current_page_directory[pd_index];
 
-	if(!(pd_entry & PAGE_PRESENT)) //page table is not present
+	if(!memmanager_page_table_present(pd_index)) //page table is not present
 	{
-		return pd_entry;
+		return current_page_directory[pd_index];
 	}
 
 	return memmanager_get_pt_entry(virtual_address, pd_index);
@@ -85,19 +271,34 @@ uintptr_t memmanager_get_physical(uintptr_t virtual_address)
 		(virtual_address & ~PAGE_ADDRESS_MASK);
 }
 
-void memmanager_update_pt(uintptr_t* pt_ptr, uintptr_t new_value, uintptr_t v_address)
+static void memmanager_update_pt(uintptr_t* pt_ptr, uintptr_t new_value, uintptr_t v_address, tlb_batch& batch)
 {
+	uintptr_t old_value = *pt_ptr;
 	__atomic_store(pt_ptr, &new_value, __ATOMIC_RELAXED);
-	__flush_tlb_page(v_address);
+	batch.add(v_address, old_value);
+}
+
+void memmanager_update_pt(uintptr_t* pt_ptr, uintptr_t new_value, uintptr_t v_address)
+{
+	tlb_batch batch;
+	memmanager_update_pt(pt_ptr, new_value, v_address, batch);
 }
 
 static void memmanager_create_new_page_table(size_t pd_index, page_flags_t flags)
 {
-	flags &= ~(PAGE_RESERVED | PAGE_MAP_ON_ACCESS);
+	flags &= ~(PAGE_RESERVED | PAGE_MAP_ON_ACCESS | PAGE_GLOBAL);
+
+	uintptr_t pd_entry = memmanager_allocate_physical_page() | PAGE_PRESENT | PAGE_RW | flags;
 
-	current_page_directory[pd_index] = memmanager_allocate_physical_page() | PAGE_PRESENT | PAGE_RW | flags;
+	current_page_directory[pd_index] = pd_entry;
+
+	//kernel page tables are shared by every address space
+	if(!(flags & PAGE_USER) && kernel_pd_mapping != nullptr)
+	{
+		kernel_pd_mapping[pd_index] = pd_entry;
+	}
 
-	__flush_tlb();
+	//the entry was not present before so it can't be in the TLB, no flush needed
 
 	//printf("added new page table, %X\n", current_page_directory[pd_index]);
 
@@ -115,7 +316,7 @@ static uintptr_t memmanager_get_unmapped_pages(const size_t num_pages, page_flag
 
 	for(size_t pd_index = first_pt; pd_index < last_pt; pd_index++)
 	{
-		if(!(current_page_directory[pd_index] & PAGE_PRESENT))
+		if(!memmanager_page_table_present(pd_index))
 		{
 			memmanager_create_new_page_table(pd_index, flags);
 
@@ -158,20 +359,20 @@ static uintptr_t memmanager_get_unmapped_pages(const size_t num_pages, page_flag
 	return (uintptr_t)nullptr;
 }
 
-void memmanager_unmap_page_with_flags(uintptr_t virtual_address, page_flags_t flags)
+//returns the old page table entry if the page was unmapped, 0 otherwise
+static uintptr_t memmanager_unmap_page_with_flags(uintptr_t virtual_address, page_flags_t flags, tlb_batch& batch)
 {
-	sync::lock_guard l{kernel_addr_mutex};
-
 	size_t pd_index = get_page_dir_index(virtual_address);
-	uintptr_t pd_entry = current_page_directory[pd_index];
 
-	if(pd_entry & PAGE_PRESENT)
+	if(memmanager_page_table_present(pd_index))
 	{
 		auto& pt_entry = memmanager_get_pt_entry(virtual_address, pd_index);
-		if(pt_entry & flags)
+		uintptr_t old_entry = pt_entry;
+		if(old_entry & flags)
 		{
 			//unmap the page
-			memmanager_update_pt(&pt_entry, 0, virtual_address);
+			memmanager_update_pt(&pt_entry, 0, virtual_address, batch);
+			return old_entry;
 		}
 	}
 	else
@@ -179,20 +380,22 @@ void memmanager_unmap_page_with_flags(uintptr_t virtual_address, page_flags_t fl
 		printf("warning pdir not exists for %X!\n", virtual_address);
 		k_assert(false);
 	}
+
+	return 0;
 }
 
-static bool memmanager_map_page(uintptr_t virtual_address, uintptr_t physical_address, page_flags_t flags)
+static bool memmanager_map_page(uintptr_t virtual_address, uintptr_t physical_address, page_flags_t flags, tlb_batch& batch)
 {
 	size_t pd_index = get_page_dir_index(virtual_address);
-	uintptr_t pd_entry = current_page_directory[pd_index];
 
-	if(!(pd_entry & PAGE_PRESENT)) //page table is not present
+	if(!memmanager_page_table_present(pd_index)) //page table is not present
 	{
 		memmanager_create_new_page_table(pd_index, flags);
 	}
-	else if((flags & PAGE_USER) && !(pd_entry & PAGE_USER))
+	else if((flags & PAGE_USER) && !(current_page_directory[pd_index] & PAGE_USER))
 	{
-		printf("Page at %X does not match requested flags %X\n", virtual_address, pd_entry & PAGE_FLAGS_MASK);
+		printf("Page at %X does not match requested flags %X\n", virtual_address, 
+			   current_page_directory[pd_index] & PAGE_FLAGS_MASK);
 		return false;
 	}
 
@@ -204,24 +407,52 @@ static bool memmanager_map_page(uintptr_t virtual_address, uintptr_t physical_ad
 		return false;
 	}
 
+	if(!(flags & PAGE_USER))
+	{
+		flags |= global_page_flag;
+	}
+
 	memmanager_update_pt(&pt_entry,
 						 (physical_address & PAGE_ADDRESS_MASK) | flags,
-						 virtual_address);
+						 virtual_address, batch);
 
 	return true;
 }
 
+static bool memmanager_map_range(uintptr_t virtual_address, uintptr_t physical_address, size_t n, page_flags_t flags, tlb_batch& batch)
+{
+	for(size_t i = 0; i < n; i++)
+	{
+		if(!memmanager_map_page(virtual_address + i * PAGE_SIZE, physical_address + i * PAGE_SIZE, flags, batch))
+			return false;
+	}
+
+	return true;
+}
+
+bool memmanager_map_pages(void* virtual_address, uintptr_t physical_address, size_t n, page_flags_t flags)
+{
+	if((uintptr_t)virtual_address & PAGE_FLAGS_MASK)
+	{
+		printf("unaligned address %X\n", virtual_address);
+		return false;
+	}
+
+	sync::lock_guard l{kernel_addr_mutex};
+	tlb_batch batch;
+
+	return memmanager_map_range((uintptr_t)virtual_address, physical_address, n, flags, batch);
+}
+
 void* memmanager_map_to_new_pages(uintptr_t physical_address, size_t n, page_flags_t flags)
 {
 	sync::lock_guard l{kernel_addr_mutex};
+	tlb_batch batch;
 
 	uintptr_t virtual_address = memmanager_get_unmapped_pages(n, flags);
 
-	for(size_t i = 0; i < n; i++)
-	{
-		if(!memmanager_map_page(virtual_address + i * PAGE_SIZE, physical_address + i * PAGE_SIZE, flags))
-			return NULL;
-	}
+	if(!memmanager_map_range(virtual_address, physical_address, n, flags, batch))
+		return NULL;
 
 	return (void*)virtual_address;
 }
@@ -235,14 +466,20 @@ void memmanager_set_page_flags(void* virtual_address, size_t num_pages, page_fla
 {
 	uintptr_t preserved = PAGE_PRESENT | PAGE_RESERVED | PAGE_MAP_ON_ACCESS;
 
+	if(!(flags & PAGE_USER))
+	{
+		flags |= global_page_flag;
+	}
+
+	tlb_batch batch;
+
 	for(size_t i = 0; i < num_pages; i++)
 	{
 		const uintptr_t v_address = (uintptr_t)virtual_address + i * PAGE_SIZE;
 
 		const size_t pd_index = get_page_dir_index(v_address);
-		const uintptr_t pd_entry = current_page_directory[pd_index];
 
-		if(!(pd_entry & PAGE_PRESENT)) //page table is not present
+		if(!memmanager_page_table_present(pd_index)) //page table is not present
 		{
 			puts("page table not present, while attempting to set flags");
 			return;
@@ -252,7 +489,7 @@ void memmanager_set_page_flags(void* virtual_address, size_t num_pages, page_fla
 
 		memmanager_update_pt(&page_entry,
 							 (page_entry & (PAGE_ADDRESS_MASK | preserved)) | flags,
-							 v_address);
+							 v_address, batch);
 	}
 }
 
@@ -261,10 +498,11 @@ static void* memmanager_alloc_page(page_flags_t flags)
 	uintptr_t physical_address = memmanager_allocate_physical_page();
 
 	sync::lock_guard l{kernel_addr_mutex};
+	tlb_batch batch;
 
 	uintptr_t virtual_address = memmanager_get_unmapped_pages(1, flags);
 
-	if(!memmanager_map_page(virtual_address, physical_address, flags | PAGE_PRESENT))
+	if(!memmanager_map_page(virtual_address, physical_address, flags | PAGE_PRESENT, batch))
 		return NULL;
 
 	return (void*)virtual_address;
@@ -273,8 +511,9 @@ static void* memmanager_alloc_page(page_flags_t flags)
 void* memmanager_virtual_alloc(void* v_address, size_t n, page_flags_t flags)
 {
 	sync::lock_guard l{kernel_addr_mutex};
+	tlb_batch batch;
 
-	uintptr_t illegal = PAGE_RESERVED | PAGE_MAP_ON_ACCESS;
+	uintptr_t illegal = PAGE_RESERVED | PAGE_MAP_ON_ACCESS | PAGE_GLOBAL;
 
 	flags &= (PAGE_FLAGS_MASK & ~illegal);
 
@@ -296,6 +535,20 @@ void* memmanager_virtual_alloc(void* v_address, size_t n, page_flags_t flags)
 		printf("unaligned address %X\n", virtual_address);
 		return nullptr;
 	}
+	else
+	{
+		//a requested address is only a hint, fail if any of it is taken
+		for(size_t i = 0; i < n; i++)
+		{
+			const uintptr_t v = virtual_address + i * PAGE_SIZE;
+
+			if(memmanager_page_table_present(get_page_dir_index(v)) &&
+			   (memmanager_get_pt_entry(v) & PAGE_ALLOCATED))
+			{
+				return nullptr;
+			}
+		}
+	}
 
 	uintptr_t page_virtual_address = (uintptr_t)virtual_address;
 
@@ -305,8 +558,9 @@ void* memmanager_virtual_alloc(void* v_address, size_t n, page_flags_t flags)
 		for(size_t i = 0; i < n; i++)
 		{
 			auto r = memmanager_map_page(page_virtual_address,
-										 memmanager_allocate_physical_page(), pf);
+										 memmanager_allocate_physical_page(), pf, batch);
 			k_assert(r);
+			page_virtual_address += PAGE_SIZE;
 		}
 	}
 	else
@@ -314,7 +568,7 @@ void* memmanager_virtual_alloc(void* v_address, size_t n, page_flags_t flags)
 		page_flags_t pf = flags | PAGE_RESERVED | PAGE_MAP_ON_ACCESS;
 		for(size_t i = 0; i < n; i++)
 		{
-			auto r = memmanager_map_page(page_virtual_address, 0, pf);
+			auto r = memmanager_map_page(page_virtual_address, 0, pf, batch);
 			k_assert(r);
 
 			k_assert(memmanager_get_page_flags(page_virtual_address) & PAGE_RESERVED);
@@ -328,15 +582,23 @@ void* memmanager_virtual_alloc(void* v_address, size_t n, page_flags_t flags)
 
 SYSCALL_HANDLER void* syscall_virtual_alloc(void* v_address, size_t n, page_flags_t flags)
 {
+	if(v_address && (n > KERNEL_SPLIT / PAGE_SIZE || (uintptr_t)v_address > KERNEL_SPLIT - n * PAGE_SIZE))
+	{
+		return nullptr;
+	}
+
 	return memmanager_virtual_alloc(v_address, n, flags);
 }
 
 static int memmanager_unmap_pages_with_flags(void* addr, size_t num_pages, page_flags_t flags)
 {
+	sync::lock_guard l{kernel_addr_mutex};
+	tlb_batch batch;
+
 	uintptr_t v_addr = (uintptr_t)addr;
 	while(num_pages--)
 	{
-		memmanager_unmap_page_with_flags(v_addr, flags); //unmap the page
+		memmanager_unmap_page_with_flags(v_addr, flags, batch); //unmap the page
 		v_addr += PAGE_SIZE; //next page
 	}
 	return 0;
@@ -354,13 +616,15 @@ int memmanager_unmap_pages(void* addr, size_t num_pages)
 
 int memmanager_free_pages_with_flags(void* page, size_t num_pages, page_flags_t flags)
 {
+	sync::lock_guard l{kernel_addr_mutex};
+	tlb_batch batch;
+	tlb_deferred_free deferred{batch};
+
 	uintptr_t virtual_address = (uintptr_t)page;
 
 	while(num_pages--)
 	{
-		uintptr_t physical_address = memmanager_get_pt_entry(virtual_address);
-
-		memmanager_unmap_page_with_flags(virtual_address, flags); //unmap the page
+		uintptr_t physical_address = memmanager_unmap_page_with_flags(virtual_address, flags, batch);
 
 		virtual_address += PAGE_SIZE; //next page
 
@@ -371,7 +635,7 @@ int memmanager_free_pages_with_flags(void* page, size_t num_pages, page_flags_t
 
 		if(physical_address & PAGE_PRESENT)
 		{
-			physical_memory_free(physical_address & PAGE_ADDRESS_MASK, PAGE_SIZE);
+			deferred.add(physical_address & PAGE_ADDRESS_MASK);
 		}
 	}
 
@@ -391,6 +655,51 @@ SYSCALL_HANDLER int syscall_free_pages(void* page, size_t num_pages)
 	return memmanager_free_pages_with_flags(page, num_pages, PAGE_USER);
 }
 
+//releases the physical memory behind the pages but keeps them reserved, like madvise(MADV_DONTNEED)
+static int memmanager_discard_pages_with_flags(void* page, size_t num_pages, page_flags_t flags)
+{
+	sync::lock_guard l{kernel_addr_mutex};
+	tlb_batch batch;
+	tlb_deferred_free deferred{batch};
+
+	uintptr_t virtual_address = (uintptr_t)page;
+
+	for(; num_pages--; virtual_address += PAGE_SIZE)
+	{
+		const size_t pd_index = get_page_dir_index(virtual_address);
+
+		if(!memmanager_page_table_present(pd_index))
+		{
+			continue;
+		}
+
+		uintptr_t& pt_entry = memmanager_get_pt_entry(virtual_address, pd_index);
+
+		if((pt_entry & (PAGE_PRESENT | flags)) != (PAGE_PRESENT | flags))
+		{
+			continue; //never touched, already discarded, or not ours
+		}
+
+		const uintptr_t physical_address = pt_entry & PAGE_ADDRESS_MASK;
+
+		//keep the address reserved, the next access gets a fresh zeroed page
+		page_flags_t new_flags = (pt_entry & (PAGE_FLAGS_MASK & ~PAGE_PRESENT)) | PAGE_RESERVED | PAGE_MAP_ON_ACCESS;
+		memmanager_update_pt(&pt_entry, new_flags, virtual_address, batch);
+
+		deferred.add(physical_address);
+	}
+
+	return 0;
+}
+
+SYSCALL_HANDLER int syscall_discard_pages(void* page, size_t num_pages)
+{
+	if(!page || ((uintptr_t)page & PAGE_FLAGS_MASK))
+		return -1;
+
+	return memmanager_discard_pages_with_flags(page, num_pages, PAGE_USER);
+}
+
 void memmanager_init_page_dir(__attribute__((nonnull)) uintptr_t* page_dir, uintptr_t physaddr)
 {
 	//Mark pages not present
@@ -411,12 +720,14 @@ uintptr_t memmanager_new_memory_space()
 
 	memmanager_init_page_dir(process_page_dir, memmanager_get_physical((uintptr_t)process_page_dir));
 
+	const uintptr_t* kernel_pd = kernel_pd_mapping ? kernel_pd_mapping : current_page_directory;
+
 	for(size_t i = 0; i < PAGE_TABLE_SIZE - 1; i++)
 	{
 		//copy only the kernel page directories
-		if(!(current_page_directory[i] & PAGE_USER))
+		if(!(kernel_pd[i] & PAGE_USER))
 		{
-			process_page_dir[i] = current_page_directory[i];
+			process_page_dir[i] = kernel_pd[i];
 		}
 	}
 
@@ -455,6 +766,11 @@ bool memmanager_handle_page_fault(page_flags_t err, uintptr_t virtual_address)
 	}
 	size_t pd_index = get_page_dir_index(virtual_address);
 
+	if(memmanager_sync_kernel_pd_entry(pd_index))
+	{
+		return true; //the kernel page table just wasn't in this address space yet
+	}
+
 	if(current_page_directory[pd_index] & PAGE_PRESENT)
 	{
 		uintptr_t& pt_entry = memmanager_get_pt_entry(virtual_address, pd_index);
@@ -533,6 +849,17 @@ static uintptr_t* allocate_low_page()
 
 void memmanager_init(void)
 {
+	const uint32_t cpu_features = cpu_detect_features();
+
+#ifdef __I386_ONLY
+	tlb_has_invlpg = !!(cpu_features & CPU_FEATURE_486);
+#endif
+
+	if(cpu_features & CPU_FEATURE_PGE)
+	{
+		global_page_flag = PAGE_GLOBAL;
+	}
+
 	kernel_page_directory = (uintptr_t*)allocate_low_page();
 	uintptr_t* first_page_table = (uintptr_t*)allocate_low_page();
 
@@ -579,7 +906,7 @@ void memmanager_init(void)
 
 		size_t pt_index = get_page_tbl_index(k_pg_start);
 
-		current_pt[pt_index] = kernel_addr | PAGE_PRESENT | PAGE_RW;
+		current_pt[pt_index] = kernel_addr | PAGE_PRESENT | PAGE_RW | global_page_flag;
 
 		kernel_addr += PAGE_SIZE;
 		k_pg_start += PAGE_SIZE;
@@ -588,5 +915,18 @@ void memmanager_init(void)
 
 	enable_paging();
 
+	if(global_page_flag)
+	{
+		__asm__ volatile("mov %%cr4, %%eax\n"
+						 "or %0, %%eax\n"
+						 "mov %%eax, %%cr4"
+						 :
+		: "i"(CR4_PGE)
+			: "%eax", "memory");
+	}
+
+	kernel_pd_mapping = (uintptr_t*)memmanager_map_to_new_pages((uintptr_t)kernel_page_directory, 1,
+																PAGE_PRESENT | PAGE_RW);
+
 	printf("paging enabled\n");
 }
\ No newline at end of file
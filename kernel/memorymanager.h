@@ -11,6 +11,7 @@ extern "C" {
 
 void memmanager_init(void);
 uintptr_t memmanager_get_physical(uintptr_t virtual_address);
+uintptr_t memmanager_get_page_flags(uintptr_t virtual_address);
 
 typedef uintptr_t page_flags_t;
 int memmanager_free_pages(void* page, size_t num_pages);
@@ -18,9 +19,11 @@ void* memmanager_virtual_alloc(void* virtual_address, size_t n, page_flags_t fla
 
 SYSCALL_HANDLER int syscall_free_pages(void* page, size_t num_pages);
 SYSCALL_HANDLER int syscall_unmap_user_pages(void* addr, size_t num_pages);
+SYSCALL_HANDLER int syscall_discard_pages(void* page, size_t num_pages);
 SYSCALL_HANDLER void* syscall_virtual_alloc(void* virtual_address, size_t n, page_flags_t flags);
 
 int memmanager_unmap_pages(void* page, size_t num_pages);
+bool memmanager_map_pages(void* virtual_address, uintptr_t physical_address, size_t n, page_flags_t flags);
 
 void memmanager_set_page_flags(void* virtual_address, size_t num_pages, page_flags_t flags);
 void* memmanager_map_to_new_pages(uintptr_t physical_address, size_t n, page_flags_t flags);
@@ -41,6 +44,9 @@ enum page_flags
     PAGE_PRESENT = 0x01,
     PAGE_RW = 0x02,
     PAGE_USER = 0x04,
+    PAGE_WRITE_THROUGH = 0x08,
+    PAGE_CACHE_DISABLE = 0x10, //for memory mapped registers
+    PAGE_GLOBAL = 0x100, //only honored for kernel pages, when the cpu supports it
 
     // OS specific
 
@@ -54,6 +60,9 @@ enum page_flags
 #define PAGE_SIZE 4096
 #define PAGE_TABLE_SIZE 1024
 
+//user addresses are below this, above it is the kernel's half that's the same in every address space
+#define KERNEL_SPLIT (~(uintptr_t)0 - ~(uintptr_t)0 / 8)
+
 inline size_t memmanager_minimum_pages(size_t bytes)
 {
     return (bytes + (PAGE_SIZE - 1)) / PAGE_SIZE;
@@ -0,0 +1,209 @@
+#include <kernel/memtype.h>
+#include <kernel/locks.h>
+#include <kernel/smp.h>
+#include <common/cpuid.h>
+
+#define MSR_MTRR_CAP 0xFE
+#define MSR_PAT 0x277
+#define MSR_MTRR_PHYS_BASE(n) (0x200 + 2 * (n))
+#define MSR_MTRR_PHYS_MASK(n) (0x201 + 2 * (n))
+#define MSR_MTRR_DEF_TYPE 0x2FF
+
+#define MTRR_CAP_COUNT 0xFF
+#define MTRR_CAP_WC 0x400
+#define MTRR_DEF_TYPE_ENABLE 0x800
+#define MTRR_MASK_VALID 0x800
+#define MTRR_TYPE_MASK 0xFF
+
+#define MEMTYPE_UC 0x00
+#define MEMTYPE_WC 0x01
+#define MEMTYPE_WT 0x04
+#define MEMTYPE_WB 0x06
+#define MEMTYPE_UC_MINUS 0x07
+
+//entry n is byte n, the index of a page is PAT * 4 + PCD * 2 + PWT
+//the reset value makes PWT and PCD mean what they did without a PAT: WB, WT, UC-, UC twice over
+#define PAT_ENTRY(n, type) ((uint64_t)(type) << ((n) * 8))
+
+//entries 1 and 5, PWT alone, become write combining
+//the PAT bit is left alone, some P6 cpus ignore it in 4KiB pages
+#define PAT_VALUE (PAT_ENTRY(0, MEMTYPE_WB) | PAT_ENTRY(1, MEMTYPE_WC) | \
+				   PAT_ENTRY(2, MEMTYPE_UC_MINUS) | PAT_ENTRY(3, MEMTYPE_UC) | \
+				   PAT_ENTRY(4, MEMTYPE_WB) | PAT_ENTRY(5, MEMTYPE_WC) | \
+				   PAT_ENTRY(6, MEMTYPE_UC_MINUS) | PAT_ENTRY(7, MEMTYPE_UC))
+
+//the physical address width of every cpu that has MTRRs but no PAT
+#define MTRR_PHYSICAL_BITS 36
+
+#define CR0_NW 0x20000000
+#define CR0_CD 0x40000000
+#define CR4_PGE 0x80
+
+static uint32_t cpu_features = 0;
+static bool pat_enabled = false;
+
+static inline uint64_t read_msr(uint32_t msr)
+{
+	uint32_t low, high;
+	__asm__ volatile("rdmsr" : "=a"(low), "=d"(high) : "c"(msr));
+	return ((uint64_t)high << 32) | low;
+}
+
+static inline void write_msr(uint32_t msr, uint64_t value)
+{
+	__asm__ volatile("wrmsr" :: "c"(msr), "a"((uint32_t)value), "d"((uint32_t)(value >> 32)));
+}
+
+static inline uintptr_t read_cr0()
+{
+	uintptr_t cr0;
+	__asm__ volatile("mov %%cr0, %0" : "=r"(cr0));
+	return cr0;
+}
+
+static inline void write_cr0(uintptr_t cr0)
+{
+	__asm__ volatile("mov %0, %%cr0" :: "r"(cr0) : "memory");
+}
+
+static inline uintptr_t read_cr4()
+{
+	uintptr_t cr4;
+	__asm__ volatile("mov %%cr4, %0" : "=r"(cr4));
+	return cr4;
+}
+
+static inline void write_cr4(uintptr_t cr4)
+{
+	__asm__ volatile("mov %0, %%cr4" :: "r"(cr4) : "memory");
+}
+
+static inline void flush_caches()
+{
+	__asm__ volatile("wbinvd\n"
+					 "mov %%cr3, %%eax\n"
+					 "mov %%eax, %%cr3"
+					 ::: "%eax", "memory");
+}
+
+void memtype_init(void)
+{
+	cpu_features = cpu_detect_features();
+
+	//nothing maps pages with PWT alone yet, so there's nothing cached under the old type to flush
+	if(cpu_features & CPU_FEATURE_PAT)
+	{
+		write_msr(MSR_PAT, PAT_VALUE);
+		pat_enabled = true;
+	}
+}
+
+void memtype_init_ap(void)
+{
+	if(pat_enabled)
+	{
+		write_msr(MSR_PAT, PAT_VALUE);
+	}
+}
+
+//the sequence from the Intel manual, with caching off while the ranges change
+static void mtrr_set_range(size_t index, uint64_t base, uint64_t mask)
+{
+	const uintptr_t cr0 = read_cr0();
+	const uintptr_t cr4 = read_cr4();
+
+	write_cr0((cr0 | CR0_CD) & ~CR0_NW);
+	flush_caches();
+	write_cr4(cr4 & ~CR4_PGE);
+
+	const uint64_t def_type = read_msr(MSR_MTRR_DEF_TYPE);
+	write_msr(MSR_MTRR_DEF_TYPE, def_type & ~(uint64_t)MTRR_DEF_TYPE_ENABLE);
+
+	write_msr(MSR_MTRR_PHYS_BASE(index), base);
+	write_msr(MSR_MTRR_PHYS_MASK(index), mask | MTRR_MASK_VALID);
+
+	flush_caches();
+	write_msr(MSR_MTRR_DEF_TYPE, def_type);
+
+	write_cr0(cr0);
+	write_cr4(cr4);
+}
+
+static void mtrr_write_combining(uintptr_t physical, size_t size)
+{
+	//the other cpus would have to change theirs at the same time, and every SMP board with MTRRs has a PAT
+	if(!(cpu_features & CPU_FEATURE_MTRR) || smp_num_cpus() > 1)
+	{
+		return;
+	}
+
+	const uint64_t cap = read_msr(MSR_MTRR_CAP);
+
+	if(!(cap & MTRR_CAP_WC))
+	{
+		return;
+	}
+
+	//a variable range is a power of two long, and aligned to its length
+	uint64_t length = PAGE_SIZE;
+
+	while(length < size)
+	{
+		length <<= 1;
+	}
+
+	if(physical & (length - 1))
+	{
+		return;
+	}
+
+	const uint64_t address_mask = ((1ULL << MTRR_PHYSICAL_BITS) - 1) & ~(uint64_t)(PAGE_SIZE - 1);
+	const uint64_t our_mask = ~(length - 1) & address_mask;
+
+	const size_t count = cap & MTRR_CAP_COUNT;
+	size_t free_index = count;
+
+	for(size_t i = 0; i < count; i++)
+	{
+		const uint64_t mask = read_msr(MSR_MTRR_PHYS_MASK(i));
+
+		if(!(mask & MTRR_MASK_VALID))
+		{
+			if(free_index == count)
+			{
+				free_index = i;
+			}
+			continue;
+		}
+
+		//two aligned power of two ranges only overlap if one holds the other's base
+		//if the firmware covered it already there's nothing to do, anything else wins over WC
+		const uint64_t base = read_msr(MSR_MTRR_PHYS_BASE(i));
+		const uint64_t their_mask = mask & address_mask;
+
+		if((physical & their_mask) == (base & their_mask) || (base & our_mask) == (physical & our_mask))
+		{
+			return;
+		}
+	}
+
+	if(free_index == count)
+	{
+		return;
+	}
+
+	int_lock l = lock_interrupts();
+	mtrr_set_range(free_index, (physical & address_mask) | MEMTYPE_WC, our_mask);
+	unlock_interrupts(l);
+}
+
+page_flags_t memtype_write_combining(uintptr_t physical, size_t size)
+{
+	if(pat_enabled)
+	{
+		return PAGE_WRITE_THROUGH;
+	}
+
+	mtrr_write_combining(physical, size);
+	return 0;
+}
\ No newline at end of file
@@ -0,0 +1,25 @@
+#ifndef MEMTYPE_H
+#define MEMTYPE_H
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stdint.h>
+#include <stddef.h>
+
+#include <kernel/memorymanager.h>
+
+//sets up the page attribute table on the boot cpu, memtype_init_ap does the same for the others
+//every cpu has to agree on what the PAT entries mean
+void memtype_init(void);
+void memtype_init_ap(void);
+
+//makes writes to a physical range get combined into bursts, which is what a framebuffer wants
+//returns the page flags to map it with, the PAT makes PAGE_WRITE_THROUGH on its own mean write combining
+//without a PAT it tries to cover the range with an MTRR instead and returns 0
+page_flags_t memtype_write_combining(uintptr_t physical, size_t size);
+
+#ifdef __cplusplus
+}
+#endif
+#endif
\ No newline at end of file
@@ -0,0 +1,204 @@
+#include <kernel/profile.h>
+#include <kernel/cpu.h>
+#include <kernel/smp.h>
+#include <kernel/apic.h>
+#include <kernel/task.h>
+#include <kernel/locks.h>
+#include <kernel/memorymanager.h>
+#include <kernel/driver_loader.h>
+#include <drivers/pit.h>
+
+//like the trace buffers, only its own cpu writes to a buffer and it's always from an interrupt handler
+struct profile_buffer
+{
+	uint32_t head;	//counts up forever, once it's full the oldest sample gets written over
+	profile_sample samples[PROFILE_SAMPLES_PER_CPU];
+};
+
+static profile_buffer* buffers[MAX_CPUS];
+static size_t num_buffers = 0;
+
+static volatile bool profile_enabled = false;
+
+//the stack is walked from inside an interrupt handler, so every frame has to be checked before it's read
+//once the walk gets into user memory, user code decides where ebp points, so it can't lead back into the kernel
+static bool frame_readable(uintptr_t frame, bool& user)
+{
+	if(frame == 0 || (frame & (sizeof(uintptr_t) - 1)) ||
+	   (frame & (PAGE_SIZE - 1)) > PAGE_SIZE - 2 * sizeof(uintptr_t))
+	{
+		return false;
+	}
+
+	const uintptr_t flags = memmanager_get_page_flags(frame);
+
+	if(!(flags & PAGE_PRESENT) || (user && !(flags & PAGE_USER)))
+	{
+		return false;
+	}
+
+	user = user || (flags & PAGE_USER);
+	return true;
+}
+
+static void profile_record(interrupt_frame* r, uintptr_t frame)
+{
+	cpu_state* cpu = this_cpu();
+
+	if(cpu->index >= num_buffers)
+		return;
+
+	profile_buffer* buf = buffers[cpu->index];
+	profile_sample& s = buf->samples[buf->head % PROFILE_SAMPLES_PER_CPU];
+
+	bool user = (r->cs & 3) != 0;
+
+	s.pid = get_running_process();
+	s.cpu = (uint8_t)cpu->index;
+	s.flags = user ? PROFILE_SAMPLE_USER : 0;
+	s.reserved = 0;
+	s.pc[0] = r->ip;
+
+	size_t depth = 1;
+
+	//each frame is the caller's ebp followed by the return address
+	while(depth < PROFILE_MAX_DEPTH && frame_readable(frame, user))
+	{
+		const uintptr_t* f = (const uintptr_t*)frame;
+
+		s.pc[depth++] = f[1];
+		frame = f[0];
+	}
+
+	s.depth = (uint8_t)depth;
+
+	buf->head++;
+}
+
+static INTERRUPT_HANDLER void profile_irq(interrupt_frame* r)
+{
+	profile_record(r, PROFILE_INTERRUPTED_FRAME());
+	apic_eoi();
+}
+
+void profile_init(void)
+{
+	if(smp_enabled)
+	{
+		isr_install_handler(SMP_PROFILE_VECTOR, profile_irq, false);
+	}
+}
+
+void profile_tick(interrupt_frame* r, uintptr_t frame)
+{
+	if(!profile_enabled)
+		return;
+
+	profile_record(r, frame);
+
+	//only the boot cpu gets the PIT, the others are sampled at the same moment
+	if(smp_enabled)
+	{
+		apic_broadcast_ipi(SMP_PROFILE_VECTOR);
+	}
+}
+
+bool profile_running(void)
+{
+	return profile_enabled;
+}
+
+//the buffers are only needed once someone profiles, so they aren't made at boot like the trace buffers
+static bool profile_alloc_buffers(void)
+{
+	const size_t pages = memmanager_minimum_pages(sizeof(profile_buffer));
+
+	for(size_t i = num_buffers; i < smp_num_cpus(); i++)
+	{
+		buffers[i] = (profile_buffer*)memmanager_virtual_alloc(nullptr, pages, PAGE_PRESENT | PAGE_RW);
+
+		if(!buffers[i])
+			break;
+
+		num_buffers = i + 1;
+	}
+
+	return num_buffers != 0;
+}
+
+static void profile_symbolize(profile_symbol* symbols, size_t count)
+{
+	for(size_t i = 0; i < count; i++)
+	{
+		profile_symbol& sym = symbols[i];
+		const char* name = driver_find_symbol(sym.address, &sym.symbol_address);
+
+		size_t len = 0;
+
+		if(name)
+		{
+			while(name[len] && len < sizeof(sym.name) - 1)
+			{
+				sym.name[len] = name[len];
+				len++;
+			}
+		}
+		else
+		{
+			sym.symbol_address = 0;
+		}
+
+		sym.name[len] = '\0';
+	}
+}
+
+SYSCALL_HANDLER int syscall_profile(int command, void* buffer, size_t count)
+{
+	switch(command)
+	{
+	case PROFILE_CMD_START:
+		if(!profile_alloc_buffers())
+			return -1;
+
+		profile_enabled = false;
+
+		for(size_t i = 0; i < num_buffers; i++)
+		{
+			buffers[i]->head = 0;
+		}
+
+		profile_enabled = true;
+		pit_set_frequency(PROFILE_SAMPLE_RATE);
+		return 0;
+	case PROFILE_CMD_STOP:
+		profile_enabled = false;
+		pit_set_frequency(0);
+		return 0;
+	case PROFILE_CMD_STATUS:
+		return profile_enabled;
+	case PROFILE_CMD_READ:
+	{
+		//the other cpus could be halfway through a sample, so it should be stopped first
+		profile_sample* samples = (profile_sample*)buffer;
+		size_t copied = 0;
+
+		for(size_t i = 0; i < num_buffers && copied < count; i++)
+		{
+			const profile_buffer* buf = buffers[i];
+			uint32_t n_samples = (buf->head < PROFILE_SAMPLES_PER_CPU) ? buf->head : PROFILE_SAMPLES_PER_CPU;
+
+			for(uint32_t n = buf->head - n_samples; n != buf->head && copied < count; n++)
+			{
+				samples[copied++] = buf->samples[n % PROFILE_SAMPLES_PER_CPU];
+			}
+		}
+
+		return (int)copied;
+	}
+	case PROFILE_CMD_SYMBOLIZE:
+		profile_symbolize((profile_symbol*)buffer, count);
+		return (int)count;
+	default:
+		return -1;
+	}
+}
\ No newline at end of file
@@ -0,0 +1,36 @@
+#ifndef PROFILE_H
+#define PROFILE_H
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdbool.h>
+#include <common/profile_sample.h>
+#include <kernel/interrupt.h>
+#include <kernel/syscall.h>
+
+//only a profiling build keeps ebp as a frame pointer everywhere, build.pl --profile defines KERNEL_PROFILE
+//an interrupt handler pushes the interrupted ebp first thing, so that's where its own frame points
+#ifdef KERNEL_PROFILE
+#define PROFILE_INTERRUPTED_FRAME() (*(uintptr_t*)__builtin_frame_address(0))
+#else
+#define PROFILE_INTERRUPTED_FRAME() ((uintptr_t)0)
+#endif
+
+//installs the ipi that samples the other cpus, after they're started
+void profile_init(void);
+
+//the PIT irq calls this, it samples this cpu and asks the others to sample themselves
+//frame is PROFILE_INTERRUPTED_FRAME() from the handler
+void profile_tick(interrupt_frame* r, uintptr_t frame);
+
+bool profile_running(void);
+
+SYSCALL_HANDLER int syscall_profile(int command, void* buffer, size_t count);
+
+#ifdef __cplusplus
+}
+#endif
+#endif
\ No newline at end of file
@@ -0,0 +1,84 @@
+[bits 16]
+global smp_trampoline_start
+global smp_trampoline_jump
+global smp_trampoline_protected
+global smp_trampoline_gdt
+global smp_trampoline_data
+global smp_trampoline_end
+
+TRAMPOLINE_CODE_SEG equ 0x08
+TRAMPOLINE_DATA_SEG equ 0x10
+
+CR0_PE equ 0x00000001
+CR0_CACHE_OFF equ 0x60000000 ;CD and NW, INIT leaves them set
+CR0_PG equ 0x80000000
+
+; smp.cpp copies this to a page under 1MiB that is mapped at the same virtual address
+; the other cpus start here in real mode at page:0 after the startup IPI
+; nothing in here can use absolute addresses, everything is relative to the start
+smp_trampoline_start:
+	cli
+	cld
+	mov ax, cs
+	mov ds, ax
+	xor ebx, ebx
+	mov bx, ax
+	shl ebx, 4			;ebx = address of the trampoline, the same physical and virtual
+
+	lgdt [smp_trampoline_data.gdt_limit - smp_trampoline_start]
+
+	mov eax, cr0
+	and eax, ~CR0_CACHE_OFF
+	or eax, CR0_PE
+	mov cr0, eax
+
+	db 0x66, 0xEA			;jmp dword TRAMPOLINE_CODE_SEG:smp_trampoline_protected
+smp_trampoline_jump:
+	dd 0					;filled in with the address of the copy of smp_trampoline_protected
+	dw TRAMPOLINE_CODE_SEG
+
+[bits 32]
+smp_trampoline_protected:
+	mov ax, TRAMPOLINE_DATA_SEG
+	mov ds, ax
+	mov es, ax
+	mov fs, ax
+	mov gs, ax
+	mov ss, ax
+
+	lea esi, [ebx + smp_trampoline_data - smp_trampoline_start]
+
+	mov eax, [esi + smp_trampoline_data.cr4 - smp_trampoline_data]
+	mov cr4, eax
+	mov eax, [esi + smp_trampoline_data.cr3 - smp_trampoline_data]
+	mov cr3, eax
+
+	mov eax, cr0
+	or eax, CR0_PG
+	mov cr0, eax
+
+	mov esp, [esi + smp_trampoline_data.stack - smp_trampoline_data]
+	push dword [esi + smp_trampoline_data.cpu - smp_trampoline_data]
+	call [esi + smp_trampoline_data.entry - smp_trampoline_data]
+.hang:
+	cli
+	hlt
+	jmp .hang
+
+align 8
+smp_trampoline_gdt:
+	dq 0x0000000000000000
+	dq 0x00CF9A000000FFFF	;kernel code
+	dq 0x00CF92000000FFFF	;kernel data
+smp_trampoline_gdt_end:
+
+;filled in by smp.cpp, see trampoline_data
+smp_trampoline_data:
+.gdt_limit:	dw smp_trampoline_gdt_end - smp_trampoline_gdt - 1
+.gdt_base:	dd 0
+.cr3:		dd 0
+.cr4:		dd 0
+.stack:		dd 0
+.entry:		dd 0
+.cpu:		dd 0
+smp_trampoline_end:
\ No newline at end of file
@@ -0,0 +1,374 @@
+#include <stdio.h>
+#include <string.h>
+
+#include <kernel/smp.h>
+#include <kernel/apic.h>
+#include <kernel/tss.h>
+#include <kernel/task.h>
+#include <kernel/locks.h>
+#include <kernel/interrupt.h>
+#include <kernel/memorymanager.h>
+#include <kernel/physical_manager.h>
+#include <kernel/sysclock.h>
+#include <kernel/fpu.h>
+#include <kernel/memtype.h>
+
+#define CR4_PGE 0x80
+
+//the startup IPI can only point at a page under 1MiB,
+//and it has to stay clear of the kernel, which is linked at 0xF000
+#define TRAMPOLINE_LOWEST 0x1000
+#define TRAMPOLINE_HIGHEST 0xF000
+
+struct __attribute__((packed)) trampoline_data
+{
+	uint16_t gdt_limit;
+	uint32_t gdt_base;
+	uint32_t cr3;
+	uint32_t cr4;
+	uint32_t stack;
+	uint32_t entry;
+	cpu_state* cpu;
+};
+
+extern "C"
+{
+	extern uint8_t smp_trampoline_start[];
+	extern uint8_t smp_trampoline_jump[];
+	extern uint8_t smp_trampoline_protected[];
+	extern uint8_t smp_trampoline_gdt[];
+	extern uint8_t smp_trampoline_data[];
+	extern uint8_t smp_trampoline_end[];
+}
+
+bool smp_enabled = false;
+
+static cpu_state cpus[MAX_CPUS];
+static volatile size_t num_cpus = 1;
+
+static uintptr_t idle_stacks[MAX_CPUS];
+
+//only one cpu can ask for a flush at a time
+static uint8_t tlb_flush_lock = 0;
+
+static inline uintptr_t read_cr4()
+{
+	uintptr_t cr4;
+	__asm__ volatile("mov %%cr4, %0" : "=r"(cr4));
+	return cr4;
+}
+
+static inline void flush_tlb_global()
+{
+	uintptr_t cr4 = read_cr4();
+
+	if(cr4 & CR4_PGE)
+	{
+		__asm__ volatile("mov %0, %%cr4\n"
+						 "mov %1, %%cr4"
+						 :: "r"(cr4 & ~CR4_PGE), "r"(cr4) : "memory");
+	}
+	else
+	{
+		__asm__ volatile("mov %%cr3, %%eax\n"
+						 "mov %%eax, %%cr3"
+						 ::: "%eax", "memory");
+	}
+}
+
+static INTERRUPT_HANDLER void smp_wake_irq(interrupt_frame* r)
+{
+	//the idle task checks the run queues once the hlt is over
+	apic_eoi();
+
+	//a thread whose process is exiting doesn't get back to its user code
+	if(r->cs & 3)
+	{
+		task_exit_if_killed();
+	}
+}
+
+static INTERRUPT_HANDLER void smp_tlb_flush_irq(interrupt_frame* r)
+{
+	smp_service_tlb_flush();
+	apic_eoi();
+}
+
+void smp_service_tlb_flush(void)
+{
+	cpu_state* cpu = this_cpu();
+
+	if(!cpu->tlb_flush_pending)
+		return;
+
+	flush_tlb_global();
+	cpu->tlb_flush_pending = 0;
+}
+
+//cpu_mask has a bit for every cpu that has to flush, ours is never in it
+//interrupts have to be off already so we stay on the same cpu
+static void smp_flush_tlb_on(uint32_t cpu_mask)
+{
+	const uint32_t others = ((1u << num_cpus) - 1) & ~(1u << this_cpu()->index);
+
+	while(__sync_lock_test_and_set(&tlb_flush_lock, 1))
+	{
+		smp_service_tlb_flush();
+		cpu_relax();
+	}
+
+	for(size_t i = 0; i < num_cpus; i++)
+	{
+		if(cpu_mask & (1u << i))
+		{
+			cpus[i].tlb_flush_pending = 1;
+		}
+	}
+
+	if(cpu_mask == others)
+	{
+		apic_broadcast_ipi(SMP_TLB_FLUSH_VECTOR);
+	}
+	else
+	{
+		for(size_t i = 0; i < num_cpus; i++)
+		{
+			if(cpu_mask & (1u << i))
+			{
+				apic_send_ipi(cpus[i].apic_id, APIC_IPI_ASSERT | APIC_IPI_FIXED | SMP_TLB_FLUSH_VECTOR);
+			}
+		}
+	}
+
+	for(size_t i = 0; i < num_cpus; i++)
+	{
+		while(cpus[i].tlb_flush_pending)
+		{
+			cpu_relax();
+		}
+	}
+
+	__sync_lock_release(&tlb_flush_lock);
+}
+
+void smp_flush_tlb(void)
+{
+	if(!smp_enabled)
+		return;
+
+	int_lock l = lock_interrupts();
+
+	smp_flush_tlb_on(((1u << num_cpus) - 1) & ~(1u << this_cpu()->index));
+
+	unlock_interrupts(l);
+}
+
+void smp_flush_tlb_address_space(void)
+{
+	if(!smp_enabled)
+		return;
+
+	int_lock l = lock_interrupts();
+
+	//the page table changes have to be visible before we look at what the others are running
+	__sync_synchronize();
+
+	const size_t self = this_cpu()->index;
+	uint32_t cpu_mask = 0;
+
+	for(size_t i = 0; i < num_cpus; i++)
+	{
+		if(i != self && task_in_current_address_space(__atomic_load_n(&cpus[i].current_task, __ATOMIC_RELAXED)))
+		{
+			cpu_mask |= 1u << i;
+		}
+	}
+
+	//a process with one thread never needs an ipi
+	if(cpu_mask)
+	{
+		smp_flush_tlb_on(cpu_mask);
+	}
+
+	unlock_interrupts(l);
+}
+
+void smp_wake_cpu(size_t index)
+{
+	cpus[index].wake_pending = 1;
+
+	//make sure the caller's writes to the run queue are seen before we look at the flag
+	__sync_synchronize();
+
+	if(index != this_cpu()->index && cpus[index].idle)
+	{
+		apic_send_ipi(cpus[index].apic_id, APIC_IPI_ASSERT | APIC_IPI_FIXED | SMP_WAKE_VECTOR);
+	}
+}
+
+void smp_wake_all(void)
+{
+	for(size_t i = 0; i < num_cpus; i++)
+	{
+		smp_wake_cpu(i);
+	}
+}
+
+void smp_interrupt_cpu(size_t index)
+{
+	if(index != this_cpu()->index)
+	{
+		apic_send_ipi(cpus[index].apic_id, APIC_IPI_ASSERT | APIC_IPI_FIXED | SMP_WAKE_VECTOR);
+	}
+}
+
+size_t smp_num_cpus(void)
+{
+	return num_cpus;
+}
+
+cpu_state* smp_get_cpu(size_t index)
+{
+	return &cpus[index];
+}
+
+void smp_early_init(void)
+{
+	cpus[0].index = 0;
+	cpus[0].started = 1;
+	cpu_load_gdt(&cpus[0]);
+}
+
+//the trampoline calls this with paging on, on the stack we gave it
+extern "C" [[noreturn]] void smp_ap_main(cpu_state* cpu)
+{
+	cpu_load_gdt(cpu);
+
+	fpu_init_ap();
+
+	memtype_init_ap();
+
+	cpu->started = 1;
+
+	//the boot cpu makes our idle task once it knows we're alive
+	while(!__atomic_load_n(&cpu->idle_task, __ATOMIC_ACQUIRE))
+	{
+		cpu_relax();
+	}
+
+	cpu->current_task = cpu->idle_task;
+
+	cpu_load_tss(cpu, idle_stacks[cpu->index]);
+
+	apic_enable();
+
+	interrupts_init_ap();
+
+	run_idle_task();
+}
+
+static bool smp_start_cpu(cpu_state* cpu, uintptr_t trampoline)
+{
+	apic_send_ipi(cpu->apic_id, APIC_IPI_INIT | APIC_IPI_ASSERT);
+	sysclock_delay(10, MILLISECONDS);
+
+	//the second startup IPI is only needed if the first one got lost
+	for(size_t i = 0; i < 2 && !cpu->started; i++)
+	{
+		apic_send_ipi(cpu->apic_id, APIC_IPI_STARTUP | (trampoline / PAGE_SIZE));
+		sysclock_delay(200, MICROSECONDS);
+	}
+
+	clock_t timeout = sysclock_get_ticks() + sysclock_get_rate() / 10;
+
+	while(!cpu->started && sysclock_get_ticks() < timeout)
+	{
+		cpu_relax();
+	}
+
+	return cpu->started;
+}
+
+void smp_init(void)
+{
+	if(!apic_init())
+	{
+		return;
+	}
+
+	cpus[0].apic_id = apic_get_id();
+
+	uint32_t apic_ids[MAX_CPUS];
+	size_t num_ids = apic_find_processors(apic_ids, MAX_CPUS);
+
+	if(num_ids < 2)
+	{
+		return;
+	}
+
+	uintptr_t trampoline = physical_memory_allocate_in_range(TRAMPOLINE_LOWEST, TRAMPOLINE_HIGHEST,
+															 PAGE_SIZE, PAGE_SIZE);
+
+	//the trampoline turns on paging while running from it, so it needs to be identity mapped
+	if(!trampoline || !memmanager_map_pages((void*)trampoline, trampoline, 1, PAGE_PRESENT | PAGE_RW))
+	{
+		puts("No memory below 64KiB to start the other cpus");
+		return;
+	}
+
+	uint8_t* code = (uint8_t*)trampoline;
+	memcpy(code, smp_trampoline_start, smp_trampoline_end - smp_trampoline_start);
+
+	*(uint32_t*)(code + (smp_trampoline_jump - smp_trampoline_start)) =
+		trampoline + (smp_trampoline_protected - smp_trampoline_start);
+
+	auto data = (trampoline_data*)(code + (smp_trampoline_data - smp_trampoline_start));
+	data->gdt_base = trampoline + (smp_trampoline_gdt - smp_trampoline_start);
+	data->cr3 = (uintptr_t)get_page_directory(); //we're the kernel task, so this is the kernel's
+	data->cr4 = read_cr4();
+	data->entry = (uintptr_t)smp_ap_main;
+
+	isr_install_handler(SMP_WAKE_VECTOR, smp_wake_irq, false);
+	isr_install_handler(SMP_TLB_FLUSH_VECTOR, smp_tlb_flush_irq, false);
+
+	//from here on only one cpu at a time is in the kernel
+	smp_enabled = true;
+	big_kernel_lock();
+
+	for(size_t i = 0; i < num_ids && num_cpus < MAX_CPUS; i++)
+	{
+		if(apic_ids[i] == cpus[0].apic_id)
+		{
+			continue;
+		}
+
+		void* stack = memmanager_virtual_alloc(nullptr, 1, PAGE_RW | PAGE_PRESENT);
+
+		if(!stack)
+		{
+			break;
+		}
+
+		cpu_state* cpu = &cpus[num_cpus];
+		cpu->index = num_cpus;
+		cpu->apic_id = apic_ids[i];
+
+		idle_stacks[cpu->index] = (uintptr_t)stack + PAGE_SIZE;
+
+		data->stack = idle_stacks[cpu->index];
+		data->cpu = cpu;
+
+		if(!smp_start_cpu(cpu, trampoline))
+		{
+			printf("cpu with APIC id %d did not start\n", cpu->apic_id);
+			memmanager_free_pages(stack, 1);
+			continue;
+		}
+
+		__atomic_store_n(&cpu->idle_task, task_create_idle(cpu, idle_stacks[cpu->index]), __ATOMIC_RELEASE);
+
+		num_cpus = num_cpus + 1;
+	}
+
+	printf("%d cpus running\n", num_cpus);
+}
\ No newline at end of file
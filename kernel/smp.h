@@ -0,0 +1,52 @@
+#ifndef SMP_H
+#define SMP_H
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdbool.h>
+
+#include <kernel/cpu.h>
+
+//vectors for the interrupts the cpus send each other
+#define SMP_WAKE_VECTOR 0xF0
+#define SMP_TLB_FLUSH_VECTOR 0xF1
+#define SMP_PROFILE_VECTOR 0xF2
+
+//set just before the other cpus are started, until then the big kernel lock does nothing
+extern bool smp_enabled;
+
+//gives the boot cpu its own GDT, this has to happen before anything calls this_cpu()
+void smp_early_init(void);
+
+//finds the other cpus through the local APIC and ACPI and starts them
+//they run background processes, everything else stays on the boot cpu
+void smp_init(void);
+
+size_t smp_num_cpus(void);
+cpu_state* smp_get_cpu(size_t index);
+
+//sends a wake up to a cpu that's halted in its idle task
+//if it isn't halted yet it won't halt until it has looked for something to do again
+void smp_wake_cpu(size_t index);
+void smp_wake_all(void);
+
+//sends the same interrupt even if the cpu is busy, it's how a thread running user code gets stopped
+void smp_interrupt_cpu(size_t index);
+
+//makes the other cpus throw away their TLBs, including global pages
+//it waits until they have all done it
+void smp_flush_tlb(void);
+
+//the same, but only for the cpus running a thread of our address space, for changes to user mappings
+void smp_flush_tlb_address_space(void);
+
+//flushes our TLB if another cpu asked us to, for loops that spin with interrupts off
+void smp_service_tlb_flush(void);
+
+#ifdef __cplusplus
+}
+#endif
+#endif
\ No newline at end of file
@@ -0,0 +1,110 @@
+#include <kernel/softirq.h>
+#include <kernel/cpu.h>
+#include <kernel/task.h>
+#include <kernel/locks.h>
+
+struct softirq_queue
+{
+	softirq* head;
+	softirq* tail;
+	bool running;
+	bool switch_requested;
+};
+
+//only the cpu a queue belongs to touches it, and only with interrupts off
+static softirq_queue queues[MAX_CPUS];
+
+void softirq_raise(softirq* s)
+{
+	if(__sync_lock_test_and_set(&s->pending, 1))
+		return;
+
+	int_lock l = lock_interrupts();
+	softirq_queue& q = queues[this_cpu()->index];
+
+	s->next = nullptr;
+
+	if(q.tail) { q.tail->next = s; }
+	else { q.head = s; }
+
+	q.tail = s;
+
+	unlock_interrupts(l);
+}
+
+void softirq_run_pending(interrupt_frame* r)
+{
+	int_lock l = lock_interrupts();
+	cpu_state* cpu = this_cpu();
+	softirq_queue& q = queues[cpu->index];
+
+	if(q.running)
+	{
+		unlock_interrupts(l);
+		return;
+	}
+
+	q.running = true;
+
+	while(q.head)
+	{
+		softirq* s = q.head;
+		q.head = q.tail = nullptr;
+
+		__asm__ volatile("sti");
+
+		while(s)
+		{
+			//once pending is cleared it can be raised again, even by another cpu, and that changes next
+			softirq* next = s->next;
+			__sync_lock_release(&s->pending);
+			s->func(s->data);
+			s = next;
+		}
+
+		__asm__ volatile("cli");
+	}
+
+	q.running = false;
+
+	//the kernel code we interrupted might be in the middle of something, it'll switch on its own soon enough
+	//but user code or a halted cpu can be switched away from like the timer would
+	bool do_switch = q.switch_requested && ((r->cs & 3) || cpu->idle);
+
+	if(do_switch)
+	{
+		q.switch_requested = false;
+		cpu->idle = 0;
+
+		bool lock_taken = !big_kernel_lock_held();
+		if(lock_taken)
+		{
+			big_kernel_lock();
+		}
+
+		switch_to_active_task();
+
+		if(lock_taken)
+		{
+			big_kernel_unlock();
+		}
+	}
+
+	unlock_interrupts(l);
+}
+
+bool softirq_active(void)
+{
+	int_lock l = lock_interrupts();
+	bool running = queues[this_cpu()->index].running;
+	unlock_interrupts(l);
+
+	return running;
+}
+
+void softirq_request_task_switch(void)
+{
+	int_lock l = lock_interrupts();
+	queues[this_cpu()->index].switch_requested = true;
+	unlock_interrupts(l);
+}
\ No newline at end of file
@@ -0,0 +1,44 @@
+#ifndef SOFTIRQ_H
+#define SOFTIRQ_H
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdbool.h>
+
+#include <kernel/interrupt.h>
+
+//the part of an irq handler that doesn't have to run with interrupts off
+//it runs on the interrupted task's stack without the big kernel lock, so it can't block or switch tasks
+typedef void (*softirq_func)(void* data);
+
+//owned by the driver, usually a static next to its irq handler
+typedef struct softirq
+{
+	softirq_func func;
+	void* data;
+	struct softirq* next;
+	volatile uint8_t pending;
+} softirq;
+
+//queues s on this cpu, raising it again before it runs does nothing
+//meant for irq handlers, which then call softirq_run_pending as the last thing they do
+void softirq_raise(softirq* s);
+
+//runs what was raised on this cpu with interrupts on, the irq has to be acknowledged already
+//an irq that comes in meanwhile only raises its softirqs, they get run by the loop that's already going
+//if one of them asked for a task switch it happens afterwards, when r says we interrupted user code
+void softirq_run_pending(interrupt_frame* r);
+
+//true while this cpu is running softirqs
+bool softirq_active(void);
+
+//switch to the active task once the softirqs are done, instead of from the middle of them
+void softirq_request_task_switch(void);
+
+#ifdef __cplusplus
+}
+#endif
+#endif
\ No newline at end of file
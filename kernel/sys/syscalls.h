@@ -20,6 +20,7 @@
 #define master_time sysclock_get_master_time
 #define clock_ticks sysclock_get_ticks
 #define get_utc_offset sysclock_get_utc_offset
+#define sys_sleep syscall_sleep
 #define alloc_pages memmanager_virtual_alloc
 #define free_pages memmanager_free_pages
 #define getkey get_keypress
@@ -1,17 +1,57 @@
 [bits 32]
 [extern num_syscalls] 
 [extern syscall_table] 
+[extern __regcall3__exit_process]
+[extern big_kernel_lock]
+[extern big_kernel_unlock]
+[extern task_exit_if_killed]
+[extern trace_syscall_enter]
+[extern trace_syscall_exit]
 global handle_syscall
+global handle_sysenter
+
+;the arguments are in eax, ecx, edx, edi and esi, big_kernel_lock only touches the first three
+%macro ENTER_KERNEL 0
+	push eax
+	push ecx
+	push edx
+	call big_kernel_lock
+%ifdef KERNEL_TRACE
+	push ebx
+	call trace_syscall_enter
+	add esp, 4
+%endif
+	pop edx
+	pop ecx
+	pop eax
+%endmacro
+
+;edx is kept too, it's the high half of a 64 bit result
+%macro LEAVE_KERNEL 0
+	push eax
+	push edx
+%ifdef KERNEL_TRACE
+	push eax
+	call trace_syscall_exit
+	add esp, 4
+%endif
+	call task_exit_if_killed	;a thread of a process that's exiting doesn't go back to user mode
+	call big_kernel_unlock
+	pop edx
+	pop eax
+%endmacro
 
 handle_syscall:
 	sti
-	cmp ebx, num_syscalls
-	ja .invalid_call
+	cmp ebx, [num_syscalls]
+	jae .invalid_call
 	push ds
 	push es
 	push fs
 	push gs
+	ENTER_KERNEL
 	call [syscall_table+4*ebx]
+	LEAVE_KERNEL
 	pop gs
 	pop fs
 	pop es
@@ -21,6 +61,39 @@ handle_syscall:
 	mov eax, 0xFFFFFFFF
 	o32 iret
 
+SYSCALL_IOPL equ 25			;needs the iret frame, so it only works through int 0x80
+USER_STACK_LIMIT equ 0xE0000000 - 8
+
+;the user stub does "push ebp; mov ebp, esp; sysenter"
+;we return straight to whoever called the stub, with the stub's stack frame popped
+;ecx and edx don't survive the call, they hold the return esp and eip for sysexit
+handle_sysenter:
+	mov esp, [esp - 4]		;the sysenter esp msr points just past esp0 in the TSS
+	sti
+	cmp ebp, USER_STACK_LIMIT
+	jae .bad_stack
+	cmp ebx, [num_syscalls]
+	jae .invalid_call
+	cmp ebx, SYSCALL_IOPL
+	je .invalid_call
+	push ebp
+	ENTER_KERNEL
+	call [syscall_table+4*ebx]
+	LEAVE_KERNEL
+	pop ebp
+.return:
+	mov edx, [ebp + 4]		;return address of the stub
+	lea ecx, [ebp + 8]
+	mov ebp, [ebp]
+	sysexit
+.invalid_call:
+	mov eax, 0xFFFFFFFF
+	jmp .return
+.bad_stack:
+	ENTER_KERNEL
+	mov eax, 0xFFFFFFFF
+	call __regcall3__exit_process
+
 struc FRAME
 	.eip0:	resd 1
     .gs:	resd 1 
@@ -1,3 +1,6 @@
+#include <stddef.h>
+#include <string.h>
+
 #include <kernel/interrupt.h>
 #include <kernel/syscall.h>
 #include <kernel/filesystem.h>
@@ -6,8 +9,14 @@
 #include <kernel/physical_manager.h>
 #include <kernel/sysclock.h>
 #include <kernel/display.h>
+#include <kernel/display_flip.h>
 #include <kernel/shared_mem.h>
 #include <kernel/input.h>
+#include <kernel/smp.h>
+#include <kernel/trace.h>
+#include <kernel/profile.h>
+#include <kernel/fpu.h>
+#include <common/cpuid.h>
 
 //A syscall is accomplished by
 //putting the arguments into EAX, ECX, EDX, EDI, ESI
@@ -23,6 +32,7 @@ SYSCALL_HANDLER int _empty()
 extern SYSCALL_HANDLER int iopl(int val);
 
 extern void handle_syscall();
+extern void handle_sysenter();
 
 const void* syscall_table[] =
 {
@@ -59,12 +69,99 @@ const void* syscall_table[] =
 	create_shared_buffer,
 	open_shared_buffer,
 	close_shared_buffer,
-	map_shared_buffer
+	map_shared_buffer,
+	syscall_discard_pages,
+	syscall_resolve_plt,
+	_empty,
+	syscall_sleep,
+	syscall_create_thread,
+	syscall_join_thread,
+	syscall_exit_thread,
+	syscall_set_tls_base,
+	open_input_ring,
+	wait_input_ring,
+	syscall_trace,
+	syscall_profile,
+	queue_display_flip,
+	get_display_flip_status
 };
 
 const size_t num_syscalls = sizeof(syscall_table) / sizeof(void*);
 
 void setup_syscalls()
 {
-	isr_install_handler(0x80, handle_syscall, false);
+	isr_install_handler(SYSCALL_VECTOR, handle_syscall, false);
+}
+
+#define MSR_SYSENTER_CS 0x174
+#define MSR_SYSENTER_ESP 0x175
+#define MSR_SYSENTER_EIP 0x176
+
+//sysenter loads ss from the next entry and sysexit uses the two after that for user code and data
+//so the GDT has to have kernel code, kernel data, user code and user data in that order
+#define KERNEL_CODE_SEGMENT 0x08
+
+static bool sysenter_enabled = false;
+
+static inline void write_msr(uint32_t msr, uint64_t value)
+{
+	__asm__ volatile("wrmsr" :: "c"(msr), "a"((uint32_t)value), "d"((uint32_t)(value >> 32)));
+}
+
+void setup_fast_syscalls(uintptr_t kernel_stack_slot)
+{
+	if(!(cpu_detect_features() & CPU_FEATURE_SEP))
+	{
+		return; //int 0x80 is all we have
+	}
+
+	//there isn't a kernel stack for each task that sysenter could use directly,
+	//so it gets a pointer just past the esp0 field of the TSS and loads the real one from there
+	write_msr(MSR_SYSENTER_CS, KERNEL_CODE_SEGMENT);
+	write_msr(MSR_SYSENTER_ESP, kernel_stack_slot + sizeof(uintptr_t));
+	write_msr(MSR_SYSENTER_EIP, (uintptr_t)handle_sysenter);
+
+	sysenter_enabled = true;
+}
+
+void setup_system_page(system_page* page)
+{
+	static const uint8_t int_0x80_stub[] = {0xCD, 0x80, 0xC3}; //int 0x80, ret
+
+	memset(page, 0, sizeof(system_page));
+	memcpy(page->int_0x80_stub, int_0x80_stub, sizeof(int_0x80_stub));
+
+	page->syscall_entry = (void*)(SYSTEM_PAGE_ADDRESS + offsetof(system_page, int_0x80_stub));
+
+	if(sysenter_enabled)
+	{
+		page->features |= SYSTEM_FEATURE_SYSENTER;
+	}
+
+	page->num_cpus = smp_num_cpus();
+
+	const uint32_t fpu = fpu_features();
+
+	if(fpu & CPU_FEATURE_MMX)
+	{
+		page->features |= SYSTEM_FEATURE_MMX;
+	}
+
+	if(fpu & CPU_FEATURE_SSE2)
+	{
+		page->features |= SYSTEM_FEATURE_SSE2;
+	}
+
+	if(cpu_detect_features() & CPU_FEATURE_ERMS)
+	{
+		page->features |= SYSTEM_FEATURE_ERMS;
+	}
+
+	const tsc_clock* clock = sysclock_get_tsc_clock();
+
+	if(clock)
+	{
+		page->clock = *clock;
+		page->features |= SYSTEM_FEATURE_TSC_CLOCK;
+	}
 }
\ No newline at end of file
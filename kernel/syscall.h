@@ -1,8 +1,25 @@
 #ifndef SYSCALL_H
 #define SYSCALL_H
 
+#include <stdint.h>
+#include <common/system_page.h>
+
 #define SYSCALL_HANDLER __attribute__((regcall))
 
+#ifdef __cplusplus
+extern "C" {
+#endif
+
 void setup_syscalls();
 
+//turns on sysenter if the cpu has it, kernel_stack_slot is the address of esp0 in the TSS
+void setup_fast_syscalls(uintptr_t kernel_stack_slot);
+
+//fills in the system page of a new process
+void setup_system_page(system_page* page);
+
+#ifdef __cplusplus
+}
+#endif
+
 #endif
\ No newline at end of file
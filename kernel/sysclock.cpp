@@ -3,6 +3,8 @@
 
 #include <kernel/interrupt.h>
 #include <kernel/locks.h>
+#include <kernel/task.h>
+#include <common/cpuid.h>
 #include <drivers/pit.h>
 #include <drivers/cmos.h>
 
@@ -21,19 +23,37 @@ static int utc_offset = -5 * 3600; //5 hours in seconds
 
 struct tm sysclock_time;
 
+#define NANOSECONDS_PER_SECOND 1000000000ull
+
+//once the time stamp counter is calibrated the ticks are nanoseconds, read from it
+//reading the PIT takes three port reads with interrupts off, this is just rdtsc and a multiply
+//the other cpus are assumed to have counters that started with ours, they all come out of reset together
+static tsc_clock sysclock_tsc{};
+static bool sysclock_tsc_ready = false;
+
 size_t sysclock_get_rate()
 {
-	return pit_get_tick_rate();
+	return sysclock_tsc_ready ? NANOSECONDS_PER_SECOND : pit_get_tick_rate();
 }
 
 clock_t sysclock_get_ticks()
 {
+	if(sysclock_tsc_ready)
+	{
+		return tsc_clock_read(&sysclock_tsc);
+	}
+
 	return pit_get_ticks();
 }
 
+const tsc_clock* sysclock_get_tsc_clock(void)
+{
+	return sysclock_tsc_ready ? &sysclock_tsc : nullptr;
+}
+
 SYSCALL_HANDLER time_t sysclock_get_master_time(void)
 {
-	return sysclock_begin_time + (pit_get_ticks() / pit_get_tick_rate());
+	return sysclock_begin_time + (sysclock_get_ticks() / sysclock_get_rate());
 }
 
 SYSCALL_HANDLER clock_t syscall_get_ticks(size_t* rate)
@@ -56,6 +76,56 @@ int sysclock_get_utc_offset(void)
 	return utc_offset;
 }
 
+//counts how fast the time stamp counter goes while the PIT ticks off 50ms
+//if the counter speeds up and slows down with the cpu the clock will drift, but there's no other fast clock before the HPET
+static void sysclock_calibrate_tsc()
+{
+	if(!(cpu_detect_features() & CPU_FEATURE_TSC))
+	{
+		return;
+	}
+
+	const tick_t pit_rate = pit_get_tick_rate();
+
+	tick_t pit_start = pit_get_ticks();
+	uint64_t tsc_start = rdtsc();
+
+	tick_t pit_end;
+	do
+	{
+		pit_end = pit_get_ticks();
+	} while(pit_end - pit_start < pit_rate / 20);
+
+	uint64_t tsc_end = rdtsc();
+
+	uint64_t tsc_rate = (tsc_end - tsc_start) * pit_rate / (pit_end - pit_start);
+
+	if(tsc_rate == 0)
+	{
+		return;
+	}
+
+	//as many fractional bits as still fit in 32, slow counters have more than a nanosecond per count
+	uint32_t shift = 32;
+	uint64_t mult = (NANOSECONDS_PER_SECOND << shift) / tsc_rate;
+
+	while(mult > 0xFFFFFFFF)
+	{
+		shift--;
+		mult = (NANOSECONDS_PER_SECOND << shift) / tsc_rate;
+	}
+
+	//carries on from where the PIT was, so the ticks never go backward
+	sysclock_tsc.base_tsc = tsc_end;
+	sysclock_tsc.base_ns = pit_end * NANOSECONDS_PER_SECOND / pit_rate;
+	sysclock_tsc.mult = (uint32_t)mult;
+	sysclock_tsc.shift = shift;
+
+	sysclock_tsc_ready = true;
+
+	printf("TSC runs at %d MHz\n", (int)(tsc_rate / 1000000));
+}
+
 // Sets up the system clock
 void sysclock_init()
 {
@@ -63,7 +133,9 @@ void sysclock_init()
 
 	pit_init();
 
-	const auto tick_rate = pit_get_tick_rate();
+	sysclock_calibrate_tsc();
+
+	const auto tick_rate = sysclock_get_rate();
 
 	const clock_t sample = cmos_get_date_time(&sysclock_time); //read time values from the RTC
 
@@ -75,7 +147,22 @@ void sysclock_init()
 void sysclock_sleep(size_t time, clock_unit unit)
 {
 	clock_t begin = sysclock_get_ticks();
-	clock_t timer_end = begin + (time * pit_get_tick_rate()) / unit;
+	task_sleep_until(begin + ((clock_t)time * sysclock_get_rate()) / unit);
+}
+
+void sysclock_delay(size_t time, clock_unit unit)
+{
+	clock_t begin = sysclock_get_ticks();
+	clock_t timer_end = begin + ((clock_t)time * sysclock_get_rate()) / unit;
 	while(sysclock_get_ticks() < timer_end);
 }
 
+SYSCALL_HANDLER int syscall_sleep(uint32_t seconds, uint32_t nanoseconds)
+{
+	clock_t rate = sysclock_get_rate();
+	clock_t ticks = (clock_t)seconds * rate + ((clock_t)nanoseconds * rate + 999999999) / 1000000000;
+
+	task_sleep_until(sysclock_get_ticks() + ticks);
+	return 0;
+}
+
@@ -6,6 +6,7 @@ extern "C" {
 #include <time.h>
 
 #include <kernel/syscall.h>
+#include <common/tsc_clock.h>
 
 void sysclock_set_utc_offset(int offset);
 void sysclock_init();
@@ -18,14 +19,23 @@ typedef enum {
 
 typedef uint64_t tick_t;
 
+//lets other tasks run until the time is up
 void sysclock_sleep(size_t time, clock_unit unit);
 
+//spins, for hardware that needs an exact delay or before there are timers
+void sysclock_delay(size_t time, clock_unit unit);
+
+//nanoseconds when the cpu has a time stamp counter, PIT ticks otherwise
 clock_t sysclock_get_ticks();
 size_t sysclock_get_rate();
+
+//null if the time stamp counter isn't used
+const tsc_clock* sysclock_get_tsc_clock(void);
 SYSCALL_HANDLER time_t sysclock_get_master_time(void);
 
 SYSCALL_HANDLER clock_t syscall_get_ticks(size_t* rate); //return the ticks since the system booted
 SYSCALL_HANDLER int sysclock_get_utc_offset(void); //returns the UTC offset in seconds
+SYSCALL_HANDLER int syscall_sleep(uint32_t seconds, uint32_t nanoseconds);
 
 #ifdef __cplusplus
 }
@@ -9,22 +9,75 @@
 #include <kernel/filesystem.h>
 #include <kernel/dynamic_object.h>
 #include <kernel/tss.h>
+#include <kernel/cpu.h>
+#include <kernel/smp.h>
+#include <kernel/timer.h>
+#include <kernel/softirq.h>
+#include <kernel/sysclock.h>
 #include <kernel/kassert.h>
+#include <kernel/input.h>
+#include <kernel/trace.h>
+#include <kernel/fpu.h>
+
+#include <slab.h>
 
 #include <vector>
 #include <memory>
 
 using dynamic_object_ptr = std::unique_ptr<dynamic_object>;
 
+enum task_flags : uint8_t
+{
+	TASK_IDLE		= 0x01, //runs when a cpu has nothing else to do, never leaves its cpu
+	TASK_BACKGROUND	= 0x02, //started without waiting on it, it can run on any cpu
+};
+
 //Thread control block
 struct __attribute__((packed)) TCB //tcb man, tcb...
 {
 	uintptr_t esp;
 	uintptr_t esp0;
 	uintptr_t cr3;
-	tss* tss_ptr;
+	size_t cpu;			//the cpu running this task, switch_task sets it to NO_CPU once it's off the stack
 	size_t pid;
 	process* p_data;
+	TCB* next_queued;
+	uint8_t flags;
+	volatile bool sleeping;	//blocked until task_wake, which can be called from an interrupt
+	bool parked;			//a sleeping background task that's off the run queues until it wakes up
+	volatile bool killed;	//its process is exiting, it stops the next time it would go back to user mode
+	uintptr_t tls_base;		//where gs points in user mode
+	bool in_wait_queue;		//blocked in a wait queue, so it gets woken if its process is exiting
+	fpu_context fpu;
+
+	SLAB_CACHED(TCB)
+};
+
+static_assert(offsetof(TCB, cpu) == 12, "kernel.asm depends on the layout of TCB");
+
+//background tasks that are ready to run, each cpu takes from its own queue first
+//and steals from the longest one when it runs dry
+struct run_queue
+{
+	sync::spinlock lock;
+	TCB* head = nullptr;
+	TCB* tail = nullptr;
+	size_t length = 0;
+};
+
+#define THREAD_USER_STACK_PAGES 4
+
+//every thread in a process after the first one, they share its pid and address space
+struct thread
+{
+	void* kernel_stack_top = nullptr;
+	void* user_stack_top = nullptr;
+	uintptr_t start_eip = 0;
+	uintptr_t start_esp = 0;
+	int exit_value = 0;
+	bool finished = false;
+	TCB* joiner = nullptr;
+	TCB tc_block;
 };
 
 struct process
@@ -33,7 +86,18 @@ struct process
 	void* user_stack_top = nullptr;
 	uintptr_t address_space = 0;
 	std::vector<dynamic_object_ptr> objects;
+	std::vector<thread*> threads; //a thread's id is its index + 1, the slot is emptied when it's joined
 	int parent_pid = INVALID_PID;
+	bool main_finished = false; //the first thread was stopped by another one exiting the process
+	TCB tc_block;
+};
+
+//runs kernel code on its own stack, for work that shouldn't hold up whoever asked for it
+struct kernel_thread
+{
+	kernel_thread_func func;
+	void* data;
+	void* stack;
 	TCB tc_block;
 };
 
@@ -41,27 +105,233 @@ extern "C" [[noreturn]] void run_user_code(void* address, void* stack);
 extern "C" [[noreturn]] void switch_task_no_return(TCB* t);
 extern "C" void switch_task(TCB* t);
 
-extern TCB* current_task_TCB;
-
+//running_tasks and active_process belong to the big kernel lock
 static std::vector<TCB*> running_tasks;
 
 static size_t active_process = 0;
 
-[[noreturn]] void switch_to_task_no_return(int pid)
+static run_queue run_queues[MAX_CPUS];
+
+//kernel threads don't belong to a process, they run in the address space the kernel started with
+static uintptr_t kernel_cr3 = 0;
+
+//guards TCB::cpu, so only one cpu can pick up a task
+static sync::spinlock claim_lock;
+
+static inline TCB* current_task()
 {
-	k_assert(running_tasks[pid]->pid != INVALID_PID);
+	return this_cpu()->current_task;
+}
 
-	switch_task_no_return(running_tasks[pid]);
-	__builtin_unreachable();
+static bool task_is_thread(TCB* t)
+{
+	return t->p_data && t != &t->p_data->tc_block;
+}
+
+bool task_in_current_address_space(TCB* t)
+{
+	//switch_task changes current_task before CR3, so a cpu leaving us can be missed
+	//that's fine, it reloads CR3 before it runs any user code again
+	return t && t->cr3 == (uintptr_t)get_page_directory();
+}
+
+static thread* thread_of(TCB* t)
+{
+	return (thread*)((uintptr_t)t - offsetof(thread, tc_block));
+}
+
+//the TLS entry in the GDT belongs to whichever thread is running on the cpu
+static void task_load_tls(TCB* t)
+{
+	cpu_set_tls_base(this_cpu(), t->tls_base);
+
+	//gs holds the TLS selector in user mode, loading it again picks up the new base
+	__asm__ volatile("mov %%gs, %%ax\n"
+					 "mov %%ax, %%gs"
+					 ::: "%eax");
+}
+
+//marks t as running on this cpu, fails if it's already running somewhere or has to stay elsewhere
+static bool task_claim(TCB* t)
+{
+	cpu_state* cpu = this_cpu();
+
+	if(t->flags & TASK_IDLE)
+	{
+		if(t != cpu->idle_task)
+			return false;
+	}
+	else if(t->sleeping)
+	{
+		//it would only find out it has to keep waiting
+		return false;
+	}
+	else if(!(t->flags & TASK_BACKGROUND) && cpu->index != 0)
+	{
+		//the irqs all go to the boot cpu, so interactive tasks stay there with them
+		return false;
+	}
+
+	sync::lock_guard l{claim_lock};
+
+	if(t->pid == INVALID_PID || t->cpu != NO_CPU)
+		return false;
+
+	t->cpu = cpu->index;
+	return true;
+}
+
+static void run_queue_push(size_t index, TCB* t)
+{
+	run_queue& q = run_queues[index];
+
+	{
+		sync::lock_guard l{q.lock};
+
+		t->next_queued = nullptr;
+
+		if(q.tail) { q.tail->next_queued = t; }
+		else { q.head = t; }
+
+		q.tail = t;
+		q.length++;
+	}
+
+	smp_wake_cpu(index);
+}
+
+//takes the first task in the queue that can be claimed
+//a task that was just put back might still be finishing its switch on another cpu, those are skipped
+static TCB* run_queue_take(size_t index)
+{
+	run_queue& q = run_queues[index];
+
+	sync::lock_guard l{q.lock};
+
+	TCB* prev = nullptr;
+
+	for(TCB* t = q.head; t; prev = t, t = t->next_queued)
+	{
+		if(!task_claim(t))
+			continue;
+
+		if(prev) { prev->next_queued = t->next_queued; }
+		else { q.head = t->next_queued; }
+
+		if(q.tail == t) { q.tail = prev; }
+
+		q.length--;
+		return t;
+	}
+
+	return nullptr;
+}
+
+static bool queued_work_available()
+{
+	for(size_t i = 0; i < smp_num_cpus(); i++)
+	{
+		if(__atomic_load_n(&run_queues[i].length, __ATOMIC_RELAXED))
+			return true;
+	}
+
+	return false;
+}
+
+//our own queue first, otherwise steal from whoever has the most waiting
+static TCB* take_queued_task()
+{
+	const size_t self = this_cpu()->index;
+
+	if(TCB* t = run_queue_take(self))
+		return t;
+
+	size_t busiest = self;
+	size_t longest = 0;
+
+	for(size_t i = 0; i < smp_num_cpus(); i++)
+	{
+		size_t length = __atomic_load_n(&run_queues[i].length, __ATOMIC_RELAXED);
+
+		if(i != self && length > longest)
+		{
+			busiest = i;
+			longest = length;
+		}
+	}
+
+	return longest ? run_queue_take(busiest) : nullptr;
+}
+
+//background tasks that are new or just woke up go to an idle cpu if there is one, otherwise to the shortest queue
+static void queue_task(TCB* t)
+{
+	size_t best = 0;
+
+	for(size_t i = 0; i < smp_num_cpus(); i++)
+	{
+		if(smp_get_cpu(i)->idle)
+		{
+			best = i;
+			break;
+		}
+
+		if(run_queues[i].length < run_queues[best].length)
+		{
+			best = i;
+		}
+	}
+
+	run_queue_push(best, t);
+}
+
+//the next task must already be claimed
+static void task_switch(TCB* next)
+{
+	cpu_state* cpu = this_cpu();
+	TCB* current = cpu->current_task;
+
+	if((current->flags & TASK_BACKGROUND) && current->pid != INVALID_PID)
+	{
+		bool parked;
+
+		{
+			sync::lock_guard l{claim_lock};
+			parked = current->parked = current->sleeping;
+		}
+
+		//if it can still run it goes back on a queue, otherwise waking it up does that
+		//nobody can take it until switch_task is done with its stack
+		if(!parked)
+		{
+			run_queue_push(cpu->index, current);
+		}
+	}
+
+	TRACE(TRACE_TASK_SWITCH, current->pid, next->pid);
+
+	fpu_save(&current->fpu);
+
+	switch_task(next);
+
+	//we're back, maybe on another cpu, and other threads might have had the TLS entry since
+	task_load_tls(current_task());
+}
+
+fpu_context* task_current_fpu_context()
+{
+	return &current_task()->fpu;
 }
 
 int get_running_process()
 {
-	if (current_task_TCB == nullptr)
+	TCB* current = current_task();
+
+	if (current == nullptr)
 	{
 		return 0;
 	}
-	return current_task_TCB->pid;
+	return current->pid;
 }
 
 int get_active_process()
@@ -81,72 +351,332 @@ int this_task_is_active()
 
 void run_next_task()
 {
-	int_lock l = lock_interrupts();
-	//lock tasks
+	//this comes from the keyboard softirq, which might have interrupted anything
+	//the big kernel lock could be what it interrupted was waiting on, so it only picks the task and leaves the switch for later
+	if(softirq_active())
+	{
+		active_process = (active_process + 1) % running_tasks.size();
+		softirq_request_task_switch();
+		return;
+	}
+
+	bool lock_taken = !big_kernel_lock_held();
+	if(lock_taken)
+	{
+		big_kernel_lock();
+	}
+
 	active_process = (active_process + 1) % running_tasks.size();
-	int next = active_process;
-	//unlock tasks
-	unlock_interrupts(l);
 	
-	switch_to_task(next);
+	switch_to_task(active_process);
+
+	if(lock_taken)
+	{
+		big_kernel_unlock();
+	}
 }
 
-void run_background_tasks()
+//round robin through the tasks that live on the boot cpu
+static TCB* next_boot_cpu_task()
 {
+	size_t pid = get_running_process();
+
+	for(size_t i = 1; i < running_tasks.size(); i++)
+	{
+		TCB* t = running_tasks[(pid + i) % running_tasks.size()];
+
+		if(!(t->flags & TASK_BACKGROUND) && task_claim(t))
+			return t;
+	}
+
+	return nullptr;
+}
+
+//halts until an interrupt comes in or another cpu wakes us because there might be something to do
+static void cpu_wait_for_work(cpu_state* cpu)
+{
+	big_kernel_unlock();
+
+	//the flag has to be set before we look for work, then anything that shows up after that
+	//sends us a wake up, which can't get lost because sti only takes effect after hlt
 	int_lock l = lock_interrupts();
-	//lock tasks
+	__sync_lock_test_and_set(&cpu->idle, 1);
+
+	if(!cpu->wake_pending && !queued_work_available())
+	{
+		__asm__ volatile("sti; hlt");
+	}
+
+	cpu->idle = 0;
+	cpu->wake_pending = 0;
+	unlock_interrupts(l);
+
+	big_kernel_lock();
+}
+
+void run_background_tasks()
+{
+	TCB* next = nullptr;
+
+	if(this_cpu()->index == 0 && (current_task()->flags & TASK_BACKGROUND))
+	{
+		//give the interactive tasks a turn before the next background task
+		next = next_boot_cpu_task();
+	}
+
+	if(!next)
+	{
+		next = take_queued_task();
+	}
 
-	int pid = get_running_process();
-	int next = pid;
+	if(!next && this_cpu()->index == 0)
+	{
+		next = next_boot_cpu_task();
+	}
 
-	size_t i = running_tasks.size() - 1;
-	while(i--)
+	if(next)
+	{
+		task_switch(next);
+	}
+	else
 	{
-		next = (next + 1) % running_tasks.size();
-		if(running_tasks[next]->pid != INVALID_PID)
+		//everything is waiting on something, so there's no point spinning
+		cpu_wait_for_work(this_cpu());
+	}
+}
+
+void task_prepare_to_block()
+{
+	current_task()->sleeping = true;
+}
+
+void task_block()
+{
+	TCB* self = current_task();
+
+	while(self->sleeping)
+	{
+		run_background_tasks();
+	}
+}
+
+void task_wake(TCB* t)
+{
+	bool was_parked;
+
+	{
+		sync::lock_guard l{claim_lock};
+		t->sleeping = false;
+		was_parked = t->parked;
+		t->parked = false;
+	}
+
+	//it might be parked, halted on its cpu, or waiting for the boot cpu to get back to it
+	if(was_parked) { queue_task(t); }
+	else if(t->cpu != NO_CPU) { smp_wake_cpu(t->cpu); }
+	else { smp_wake_cpu(0); }
+}
+
+//one lock for every wait queue, it's only held long enough to link and unlink entries
+static constinit sync::spinlock wait_queue_lock;
+
+bool wait_queue_prepare(wait_queue* q, wait_queue_entry* e)
+{
+	sync::lock_guard l{wait_queue_lock};
+
+	TCB* self = current_task();
+
+	if(self->killed)
+		return false;
+
+	e->task = self;
+	e->next = q->head;
+	e->queued = true;
+	q->head = e;
+
+	self->in_wait_queue = true;
+	task_prepare_to_block();
+	return true;
+}
+
+void wait_queue_finish(wait_queue* q, wait_queue_entry* e)
+{
+	sync::lock_guard l{wait_queue_lock};
+
+	//it didn't block because what it waited for was already there
+	TCB* self = current_task();
+	self->sleeping = false;
+	self->in_wait_queue = false;
+
+	if(!e->queued)
+		return;
+
+	for(wait_queue_entry** it = &q->head; *it; it = &(*it)->next)
+	{
+		if(*it == e)
 		{
-			unlock_interrupts(l);
-			switch_task(running_tasks[next]);
-			return;
+			*it = e->next;
+			break;
 		}
 	}
 
-	//unlock tasks
-	unlock_interrupts(l);
+	e->queued = false;
 }
 
-extern uint8_t* init_stack;
+void wait_queue_wake_all(wait_queue* q)
+{
+	sync::lock_guard l{wait_queue_lock};
+
+	for(wait_queue_entry* e = q->head; e;)
+	{
+		//the entry is on the waiter's stack, it's gone once the waiter gets the lock
+		wait_queue_entry* next = e->next;
+		e->queued = false;
+		task_wake(e->task);
+		e = next;
+	}
+
+	q->head = nullptr;
+}
+
+static void task_wake_up(void* data)
+{
+	task_wake((TCB*)data);
+}
 
-tss* current_TSS = nullptr;
+void task_sleep_until(clock_t deadline)
+{
+	if(sysclock_get_ticks() >= deadline)
+		return;
+
+	TCB* self = current_task();
+	kernel_timer timer;
+
+	if(!self)
+	{
+		//too early to sleep, there's nothing else to run anyway
+		while(sysclock_get_ticks() < deadline);
+		return;
+	}
+
+	//set first, so the timer can't go off before it
+	task_prepare_to_block();
+
+	if(!timer_start(&timer, deadline, task_wake_up, self))
+	{
+		self->sleeping = false;
+		while(sysclock_get_ticks() < deadline)
+		{
+			run_background_tasks();
+		}
+		return;
+	}
 
+	task_block();
+
+	//something else might have woken us early, the timer is on our stack so it can't be left running
+	timer_cancel(&timer);
+}
+
+extern uint8_t* init_stack;
+
+//only used while the big kernel lock is held, so the cpus can share it
 uint8_t* spare_stack = nullptr;
 
 void setup_first_task()
 {	
 	uintptr_t esp0 = (uintptr_t)init_stack + PAGE_SIZE;
 
-	current_TSS = create_TSS(esp0);
+	cpu_state* cpu = this_cpu();
+
+	cpu_load_tss(cpu, esp0);
+
+	kernel_cr3 = (uintptr_t)get_page_directory();
 
 	running_tasks.push_back(new TCB{
 		.esp = 0,
 		.esp0 = (uint32_t)esp0,
-		.cr3 = (uint32_t)get_page_directory(),
-		.tss_ptr = current_TSS,
-		.pid = 0
+		.cr3 = kernel_cr3,
+		.cpu = cpu->index,
+		.pid = 0,
+		.flags = TASK_IDLE
 	});
 	active_process = 0;
-	current_task_TCB = running_tasks[0];
+	cpu->current_task = cpu->idle_task = running_tasks[0];
 
 	//force page to be resident
 	spare_stack = (uint8_t*)memmanager_virtual_alloc(nullptr, 1, PAGE_PRESENT | PAGE_RW); 
 }
 
+TCB* task_create_idle(cpu_state* cpu, uintptr_t esp0)
+{
+	TCB* t = new TCB{
+		.esp = 0,
+		.esp0 = esp0,
+		.cr3 = (uint32_t)get_page_directory(),
+		.cpu = cpu->index,
+		.pid = running_tasks.size(),
+		.flags = TASK_IDLE
+	};
+
+	running_tasks.push_back(t);
+	return t;
+}
+
+[[noreturn]] void run_idle_task()
+{
+	cpu_state* cpu = this_cpu();
+
+	big_kernel_lock();
+
+	for(;;)
+	{
+		if(TCB* next = take_queued_task())
+		{
+			task_switch(next);
+			continue;
+		}
+
+		cpu_wait_for_work(cpu);
+	}
+}
+
 [[noreturn]] void start_user_process(process* t)
 {
+	task_load_tls(&t->tc_block);
+
+	//a new task starts out in the kernel with the lock handed to it by switch_task
+	big_kernel_unlock();
 	run_user_code(t->objects[0]->entry_point, (void*)((uintptr_t)t->user_stack_top + PAGE_SIZE));
 	__builtin_unreachable();
 }
 
+[[noreturn]] static void task_exit_killed();
+
+[[noreturn]] static void start_user_thread(thread* t)
+{
+	//the process might have exited before we got to run
+	if(t->tc_block.killed)
+	{
+		task_exit_killed();
+	}
+
+	task_load_tls(&t->tc_block);
+
+	big_kernel_unlock();
+	run_user_code((void*)t->start_eip, (void*)t->start_esp);
+	__builtin_unreachable();
+}
+
+[[noreturn]] static void start_kernel_thread(kernel_thread* t)
+{
+	t->func(t->data);
+
+	printf("kernel thread %X returned\n", (uintptr_t)t->func);
+	k_assert(false);
+	__builtin_unreachable();
+}
+
 struct __attribute__((packed)) stack_items
 {
 	uint32_t ebp;
@@ -156,9 +686,22 @@ struct __attribute__((packed)) stack_items
 	uint32_t flags;
 	uint32_t eip;
 	uint32_t cs;
-	process* process_ptr;
+	void* start_data;
 };
 
+//sets up the stack the way switch_task leaves it, so the first switch to t "returns" into start(data)
+template<typename T>
+static void task_prepare_stack(TCB* t, void* kernel_stack_top, void (*start)(T*), T* data)
+{
+	t->esp = (uintptr_t)kernel_stack_top + PAGE_SIZE - sizeof(stack_items);
+	t->esp0 = (uintptr_t)kernel_stack_top + PAGE_SIZE;
+
+	auto* stack_ptr = (stack_items*)t->esp;
+	stack_ptr->start_data = data;
+	stack_ptr->eip = (uintptr_t)start;
+	stack_ptr->flags = (uintptr_t)0x0200; //flags are all off, except interrupt
+}
+
 template<typename Functor>
 [[noreturn]] void run_on_new_stack_no_return(Functor lambda, void* stack_addr)
 {
@@ -175,11 +718,167 @@ template<typename Functor>
 	__builtin_unreachable();
 }
 
+//for a task that's going away, whatever can run next on this cpu, or the idle task if nothing can
+static TCB* claim_next_task()
+{
+	TCB* next = take_queued_task();
+
+	if(!next && this_cpu()->index == 0)
+	{
+		next = next_boot_cpu_task();
+	}
+
+	if(!next)
+	{
+		next = this_cpu()->idle_task;
+
+		[[maybe_unused]] bool claimed = task_claim(next);
+		k_assert(claimed);
+	}
+
+	return next;
+}
+
+[[noreturn]] static void thread_exit(thread* t, int value)
+{
+	memmanager_free_pages(t->user_stack_top, THREAD_USER_STACK_PAGES);
+
+	run_on_new_stack_no_return([t, value] ()
+	{
+		memmanager_free_pages(t->kernel_stack_top, 1);
+
+		{
+			sync::lock_guard claim{claim_lock};
+			t->tc_block.pid = INVALID_PID;
+		}
+
+		t->exit_value = value;
+		t->finished = true;
+
+		//the joiner frees t, but it can't run before we've switched away and let go of the big kernel lock
+		if(t->joiner)
+		{
+			task_wake(t->joiner);
+		}
+
+		switch_task_no_return(claim_next_task());
+		__builtin_unreachable();
+
+	}, spare_stack + PAGE_SIZE);
+}
+
+[[noreturn]] static void task_exit_killed()
+{
+	TCB* self = current_task();
+
+	if(task_is_thread(self))
+	{
+		thread_exit(thread_of(self), -1);
+	}
+
+	//the first thread's stacks belong to the process, whoever is exiting it frees them
+	{
+		sync::lock_guard claim{claim_lock};
+		self->pid = INVALID_PID;
+	}
+
+	self->p_data->main_finished = true;
+
+	switch_task_no_return(claim_next_task());
+	__builtin_unreachable();
+}
+
+void task_exit_if_killed()
+{
+	if(!current_task()->killed)
+		return;
+
+	//from the wake up irq the lock isn't ours yet
+	if(!big_kernel_lock_held())
+	{
+		big_kernel_lock();
+	}
+
+	task_exit_killed();
+}
+
+//the address space can't go away while any other thread could still be using it
+//they're stopped on their way back to user mode, or by an irq if they're running user code on another cpu
+static void stop_other_threads(process* p, TCB* self)
+{
+	auto for_each_other = [p, self](auto&& func)
+	{
+		if(!p->main_finished && &p->tc_block != self)
+		{
+			func(&p->tc_block);
+		}
+
+		for(thread* t : p->threads)
+		{
+			if(t && !t->finished && &t->tc_block != self)
+			{
+				func(&t->tc_block);
+			}
+		}
+	};
+
+	for_each_other([](TCB* t) { t->killed = true; });
+
+	for(;;)
+	{
+		bool any_left = false;
+
+		for_each_other([&any_left](TCB* t)
+		{
+			any_left = true;
+
+			if(t->cpu != NO_CPU)
+			{
+				smp_interrupt_cpu(t->cpu);
+			}
+		});
+
+		if(!any_left)
+			break;
+
+		//a thread blocked in a join or a wait queue would wait forever, the ones that are sleeping wake up on their own
+		for(thread* t : p->threads)
+		{
+			if(t && t->joiner && t->joiner->killed)
+			{
+				task_wake(t->joiner);
+			}
+		}
+
+		for_each_other([](TCB* t)
+		{
+			if(t->in_wait_queue)
+			{
+				task_wake(t);
+			}
+		});
+
+		task_sleep_until(sysclock_get_ticks() + sysclock_get_rate() / 1000);
+	}
+}
+
 SYSCALL_HANDLER void exit_process(int val)
 {
-	int current_pid = current_task_TCB->pid;
+	TCB* self = current_task();
+
+	//another thread got here first and is already cleaning up
+	if(self->killed)
+	{
+		task_exit_killed();
+	}
+
+	int current_pid = self->pid;
 
-	process* current_process = running_tasks[current_pid]->p_data;
+	process* current_process = self->p_data;
+
+	stop_other_threads(current_process, self);
+
+	thread* self_thread = task_is_thread(self) ? thread_of(self) : nullptr;
 
 	for(auto&& object : current_process->objects)
 	{
@@ -189,17 +888,38 @@ SYSCALL_HANDLER void exit_process(int val)
 		}
 
 		delete object->lib_set;
-		delete object->glob_data_symbol_map;
 		delete object->symbol_map;
 
 		cleanup_elf(object.get());
+
+		delete object->loaded_objects;
 	}
 
 	memmanager_free_pages(current_process->user_stack_top, 1);
+	memmanager_free_pages(SYSTEM_PAGE, 1);
+	input_process_exited(current_pid);
 
-	run_on_new_stack_no_return([current_process, current_pid] ()
+	if(self_thread)
+	{
+		memmanager_free_pages(self_thread->user_stack_top, THREAD_USER_STACK_PAGES);
+	}
+
+	run_on_new_stack_no_return([current_process, current_pid, self_thread] ()
 	{
 		memmanager_free_pages(current_process->kernel_stack_top, 1);
+
+		if(self_thread)
+		{
+			memmanager_free_pages(self_thread->kernel_stack_top, 1);
+		}
+
+		//the other threads have freed their own stacks
+		for(thread* t : current_process->threads)
+		{
+			delete t;
+		}
+
+		current_process->threads.clear();
 	
 		int_lock l = lock_interrupts();
 	
@@ -210,18 +930,50 @@ SYSCALL_HANDLER void exit_process(int val)
 		unlock_interrupts(l);
 	
 		int next_pid = current_process->parent_pid;
-		running_tasks[current_pid]->pid = INVALID_PID;
+
+		{
+			sync::lock_guard claim{claim_lock};
+			running_tasks[current_pid]->pid = INVALID_PID;
+		}
 
 		if(active_process == current_pid)
 		{
 			active_process = next_pid;
 		}
 
-		switch_to_task_no_return(next_pid);
+		//the parent might be running on another cpu already or not be allowed on this one
+		TCB* next = running_tasks[next_pid];
+
+		if(!task_claim(next))
+		{
+			next = this_cpu()->idle_task;
+
+			[[maybe_unused]] bool claimed = task_claim(next);
+			k_assert(claimed);
+		}
+
+		switch_task_no_return(next);
+		__builtin_unreachable();
 	
 	}, spare_stack + PAGE_SIZE);
 }
 
+//called by the PLT resolver stub the first time a function is called
+SYSCALL_HANDLER uintptr_t syscall_resolve_plt(size_t object_index, size_t relocation_offset)
+{
+	process* current_process = current_task()->p_data;
+
+	uintptr_t address = elf_resolve_lazy_symbol(current_process->objects[0].get(), object_index, relocation_offset);
+
+	if(!address)
+	{
+		printf("Could not bind PLT entry %X of object %d\n", relocation_offset, object_index);
+		exit_process(-1);
+	}
+
+	return address;
+}
+
 extern "C" SYSCALL_HANDLER void spawn_process(const file_handle* file, 
 											  directory_stream* cwd, int flags)
 {
@@ -230,24 +982,30 @@ extern "C" SYSCALL_HANDLER void spawn_process(const file_handle* file,
 
 	uintptr_t oldcr3 = (uintptr_t)get_page_directory();
 	
-	auto parent_pid = current_task_TCB->pid;
+	auto parent_pid = current_task()->pid;
+	bool parent_background = current_task()->flags & TASK_BACKGROUND;
 	auto address_space = memmanager_new_memory_space();
 
 	memmanager_enter_memory_space(address_space);
 
+	//mapped first, so nothing else can end up there
+	memmanager_virtual_alloc(SYSTEM_PAGE, 1, PAGE_RW | PAGE_USER);
+	setup_system_page(SYSTEM_PAGE);
+
 	process* newTask = new process{};
 
 	newTask->parent_pid = parent_pid;
 	newTask->address_space = address_space;
 	newTask->objects.emplace_back(std::make_unique<dynamic_object>(
 			new dynamic_object::sym_map(),
-			new dynamic_object::sym_map(),
-			new dynamic_object::sym_map()
+			nullptr,
+			new dynamic_object::object_list()
 		));
 
 	if(!load_elf(file, newTask->objects[0].get(), true, cwd))
 	{
 		delete newTask;
+		memmanager_free_pages(SYSTEM_PAGE, 1);
 		set_page_directory((uintptr_t*)oldcr3);
 		memmanager_destroy_memory_space(address_space);
 		return;
@@ -257,20 +1015,20 @@ extern "C" SYSCALL_HANDLER void spawn_process(const file_handle* file,
 	newTask->kernel_stack_top = memmanager_virtual_alloc(nullptr, 1, PAGE_RW | PAGE_PRESENT);
 
 	newTask->tc_block = {
-		.esp	 = (uintptr_t)newTask->kernel_stack_top + PAGE_SIZE - sizeof(stack_items),
-		.esp0	 = (uintptr_t)newTask->kernel_stack_top + PAGE_SIZE,
 		.cr3	 = (uintptr_t)get_page_directory(),
-		.tss_ptr = current_TSS,
+		.cpu	 = NO_CPU,
 		.pid	 = running_tasks.size(),
 		.p_data	 = newTask,
 	};
 
-	//we are setting up the stack of the new process
-	//these will be pop'ed into registers later
-	auto* stack_ptr = ((stack_items*)newTask->tc_block.esp);
-	stack_ptr->process_ptr = newTask;
-	stack_ptr->eip = (uintptr_t)start_user_process; //this is where the new process will start executing
-	stack_ptr->flags = (uintptr_t)0x0200; //flags are all off, except interrupt
+	//this is where the new process will start executing
+	task_prepare_stack(&newTask->tc_block, newTask->kernel_stack_top, start_user_process, newTask);
+
+	//children of background tasks are in the background too, so they can run next to their parent
+	if(!(flags & WAIT_FOR_PROCESS) || parent_background)
+	{
+		newTask->tc_block.flags = TASK_BACKGROUND;
+	}
 
 	size_t new_process = newTask->tc_block.pid;
 
@@ -282,25 +1040,26 @@ extern "C" SYSCALL_HANDLER void spawn_process(const file_handle* file,
 
 	if(flags & WAIT_FOR_PROCESS)
 	{
-		int_lock l = lock_interrupts();
-		
 		if(this_task_is_active())
 		{
 			active_process = new_process;
 		}
 		
-		//unlock tasks
-		unlock_interrupts(l);
-		
 		switch_to_task(new_process);
 	}
+	else
+	{
+		queue_task(&newTask->tc_block);
+	}
 }
 
 void switch_to_task(int pid)
 {
-	if (running_tasks[pid]->pid != INVALID_PID && !task_is_running(pid))
+	TCB* t = running_tasks[pid];
+
+	if(task_claim(t))
 	{
-		switch_task(running_tasks[pid]);
+		task_switch(t);
 	}
 }
 
@@ -311,3 +1070,150 @@ void switch_to_active_task()
 		switch_to_task(get_active_process());
 	}
 }
+
+
+//entry is a function in the program that calls func(arg) and exits the thread with what it returns
+//they're passed on the new stack as if entry had been called, tls is where the thread's gs starts out pointing
+SYSCALL_HANDLER size_t syscall_create_thread(uintptr_t entry, uintptr_t func, uintptr_t arg, uintptr_t tls)
+{
+	TCB* self = current_task();
+	process* p = self->p_data;
+
+	if(!p)
+		return 0;
+
+	thread* t = new thread{};
+
+	t->user_stack_top = memmanager_virtual_alloc(nullptr, THREAD_USER_STACK_PAGES, PAGE_RW | PAGE_USER | PAGE_PRESENT);
+	t->kernel_stack_top = memmanager_virtual_alloc(nullptr, 1, PAGE_RW | PAGE_PRESENT);
+
+	if(!t->user_stack_top || !t->kernel_stack_top)
+	{
+		if(t->user_stack_top) { memmanager_free_pages(t->user_stack_top, THREAD_USER_STACK_PAGES); }
+		if(t->kernel_stack_top) { memmanager_free_pages(t->kernel_stack_top, 1); }
+		delete t;
+		return 0;
+	}
+
+	uint32_t* user_stack = (uint32_t*)((uintptr_t)t->user_stack_top + THREAD_USER_STACK_PAGES * PAGE_SIZE) - 3;
+	user_stack[0] = 0; //entry never returns
+	user_stack[1] = func;
+	user_stack[2] = arg;
+
+	t->start_eip = entry;
+	t->start_esp = (uintptr_t)user_stack;
+
+	//threads can run on any cpu, next to the one that started them
+	t->tc_block = {
+		.cr3	 = (uintptr_t)get_page_directory(),
+		.cpu	 = NO_CPU,
+		.pid	 = self->pid,
+		.p_data	 = p,
+		.flags	 = TASK_BACKGROUND,
+		.tls_base = tls
+	};
+
+	task_prepare_stack(&t->tc_block, t->kernel_stack_top, start_user_thread, t);
+
+	size_t index = 0;
+	while(index < p->threads.size() && p->threads[index])
+	{
+		index++;
+	}
+
+	if(index == p->threads.size()) { p->threads.push_back(t); }
+	else { p->threads[index] = t; }
+
+	queue_task(&t->tc_block);
+
+	return index + 1;
+}
+
+SYSCALL_HANDLER int syscall_join_thread(size_t id, int* exit_value)
+{
+	TCB* self = current_task();
+	process* p = self->p_data;
+
+	if(!p || id == 0 || id > p->threads.size())
+		return -1;
+
+	thread* t = p->threads[id - 1];
+
+	if(!t || &t->tc_block == self || t->joiner)
+		return -1;
+
+	//it can only finish while we let go of the big kernel lock, so there's no race with the check
+	if(!t->finished)
+	{
+		t->joiner = self;
+		task_prepare_to_block();
+		task_block();
+		t->joiner = nullptr;
+
+		//woken up because the process is exiting
+		if(!t->finished)
+			return -1;
+	}
+
+	if(exit_value)
+	{
+		*exit_value = t->exit_value;
+	}
+
+	p->threads[id - 1] = nullptr;
+	delete t;
+
+	return 0;
+}
+
+SYSCALL_HANDLER void syscall_exit_thread(int value)
+{
+	TCB* self = current_task();
+
+	//the first thread returning from main ends the process anyway
+	if(!task_is_thread(self))
+	{
+		exit_process(value);
+	}
+
+	thread_exit(thread_of(self), value);
+}
+
+SYSCALL_HANDLER int syscall_set_tls_base(uintptr_t base)
+{
+	TCB* self = current_task();
+
+	self->tls_base = base;
+	task_load_tls(self);
+
+	return 0;
+}
+
+TCB* task_create_kernel_thread(kernel_thread_func func, void* data)
+{
+	kernel_thread* t = new kernel_thread{
+		.func = func,
+		.data = data,
+		.stack = memmanager_virtual_alloc(nullptr, 1, PAGE_RW | PAGE_PRESENT)
+	};
+
+	if(!t->stack)
+	{
+		delete t;
+		return nullptr;
+	}
+
+	//pid 0 is the kernel's, like the idle tasks
+	t->tc_block = {
+		.cr3	 = kernel_cr3,
+		.cpu	 = NO_CPU,
+		.pid	 = 0,
+		.flags	 = TASK_BACKGROUND
+	};
+
+	task_prepare_stack(&t->tc_block, t->stack, start_kernel_thread, t);
+
+	queue_task(&t->tc_block);
+
+	return &t->tc_block;
+}
\ No newline at end of file
@@ -3,8 +3,11 @@
 
 #include <stddef.h>
 #include <stdint.h>
+#include <stdbool.h>
+#include <time.h>
 #include <kernel/syscall.h>
 #include <kernel/filesystem.h>
+#include <kernel/cpu.h>
 
 #ifdef __cplusplus
 extern "C" {
@@ -20,9 +23,62 @@ typedef struct dynamic_object dynamic_object;
 
 SYSCALL_HANDLER void spawn_process(const file_handle* file, directory_stream* cwd, int flags);
 SYSCALL_HANDLER void exit_process(int val);
+SYSCALL_HANDLER uintptr_t syscall_resolve_plt(size_t object_index, size_t relocation_offset);
 void run_next_task();
 void run_background_tasks();
+
+//lets other tasks run, or halts the cpu, until the deadline in sysclock ticks
+void task_sleep_until(clock_t deadline);
+
+//to wait for something, mark the task as blocked first, then check if it already happened,
+//then block, so a task_wake in between isn't lost
+void task_prepare_to_block();
+void task_block();
+
+//safe to call from an interrupt handler
+void task_wake(struct TCB* t);
+
+//the tasks waiting for something, a task adds itself with an entry on its own stack
+typedef struct wait_queue_entry
+{
+	struct TCB* task;
+	struct wait_queue_entry* next;
+	bool queued;
+} wait_queue_entry;
+
+typedef struct wait_queue
+{
+	wait_queue_entry* head;
+} wait_queue;
+
+//queues the running task and marks it blocked, then the caller checks for what it's waiting on and calls task_block if it's not there
+//returns false without queueing if the task's process is exiting, then it should stop waiting
+//wait_queue_finish takes it back out once it's done waiting, whether it blocked or not
+bool wait_queue_prepare(wait_queue* q, wait_queue_entry* e);
+void wait_queue_finish(wait_queue* q, wait_queue_entry* e);
+
+//wakes and dequeues every waiting task, safe to call from a softirq
+void wait_queue_wake_all(wait_queue* q);
+
+typedef void (*kernel_thread_func)(void* data);
+
+//runs func on its own stack on any cpu, with the big kernel lock like any other kernel code
+//it must never return
+struct TCB* task_create_kernel_thread(kernel_thread_func func, void* data);
+
+//stops the running thread if its process is exiting, for when it's about to go back to user mode
+void task_exit_if_killed();
+
+//for finding the cpus that might have our user mappings cached, t is another cpu's current task
+bool task_in_current_address_space(struct TCB* t);
+
+SYSCALL_HANDLER size_t syscall_create_thread(uintptr_t entry, uintptr_t func, uintptr_t arg, uintptr_t tls);
+SYSCALL_HANDLER int syscall_join_thread(size_t id, int* exit_value);
+SYSCALL_HANDLER void syscall_exit_thread(int value);
+SYSCALL_HANDLER int syscall_set_tls_base(uintptr_t base);
 void setup_first_task();
+struct TCB* task_create_idle(cpu_state* cpu, uintptr_t esp0);
+__attribute__((noreturn)) void run_idle_task();
 int task_is_running(int pid);
 int this_task_is_active();
 void switch_to_task(int pid);
@@ -30,6 +86,9 @@ void switch_to_active_task();
 int get_active_process();
 int get_running_process();
 
+struct fpu_context;
+struct fpu_context* task_current_fpu_context();
+
 #ifdef __cplusplus
 }
 #endif
@@ -0,0 +1,201 @@
+#include <kernel/timer.h>
+#include <kernel/sysclock.h>
+#include <kernel/interrupt.h>
+#include <kernel/apic.h>
+#include <kernel/locks.h>
+#include <kernel/softirq.h>
+
+#define MAX_TIMERS 256
+
+//a binary min-heap on the deadline, so the next one to expire is always first
+//it's fixed size so nothing is allocated with the lock held or from an interrupt
+static kernel_timer* timer_heap[MAX_TIMERS];
+static size_t num_timers = 0;
+
+static constinit sync::spinlock timer_lock{};
+
+static void heap_place(kernel_timer* t, size_t index)
+{
+	timer_heap[index] = t;
+	t->heap_index = index;
+}
+
+static void heap_sift_up(size_t index)
+{
+	kernel_timer* t = timer_heap[index];
+
+	while(index > 0)
+	{
+		size_t parent = (index - 1) / 2;
+
+		if(timer_heap[parent]->deadline <= t->deadline)
+			break;
+
+		heap_place(timer_heap[parent], index);
+		index = parent;
+	}
+
+	heap_place(t, index);
+}
+
+static void heap_sift_down(size_t index)
+{
+	kernel_timer* t = timer_heap[index];
+
+	for(;;)
+	{
+		size_t child = index * 2 + 1;
+
+		if(child >= num_timers)
+			break;
+
+		if(child + 1 < num_timers && timer_heap[child + 1]->deadline < timer_heap[child]->deadline)
+			child++;
+
+		if(t->deadline <= timer_heap[child]->deadline)
+			break;
+
+		heap_place(timer_heap[child], index);
+		index = child;
+	}
+
+	heap_place(t, index);
+}
+
+static void heap_remove(kernel_timer* t)
+{
+	size_t index = t->heap_index;
+	kernel_timer* last = timer_heap[--num_timers];
+
+	t->heap_index = TIMER_INACTIVE;
+
+	if(last == t)
+		return;
+
+	heap_place(last, index);
+
+	if(index > 0 && timer_heap[(index - 1) / 2]->deadline > last->deadline)
+	{
+		heap_sift_up(index);
+	}
+	else
+	{
+		heap_sift_down(index);
+	}
+}
+
+//with the lock held, points this cpu's APIC timer at the first deadline
+//without the APIC timer the PIT tick is all we get, so timers are only as good as 55ms
+static void timer_program()
+{
+	if(!apic_timer_get_rate())
+		return;
+
+	if(num_timers == 0)
+	{
+		apic_timer_stop();
+		return;
+	}
+
+	clock_t now = sysclock_get_ticks();
+	clock_t deadline = timer_heap[0]->deadline;
+
+	//the APIC timer can't count much past an hour anyway, and this keeps the multiply from overflowing
+	uint64_t delta = (deadline > now) ? (uint64_t)(deadline - now) : 0;
+	uint64_t longest = (uint64_t)sysclock_get_rate() * 3600;
+
+	if(delta > longest) { delta = longest; }
+
+	uint64_t microseconds = delta * 1000000 / sysclock_get_rate();
+
+	apic_timer_start_oneshot((uint32_t)microseconds);
+}
+
+static void timer_softirq_func(void*)
+{
+	timer_run_expired();
+}
+
+static softirq timer_softirq{timer_softirq_func, nullptr};
+
+void timer_raise_softirq(void)
+{
+	softirq_raise(&timer_softirq);
+}
+
+static INTERRUPT_HANDLER void timer_irq(interrupt_frame* r)
+{
+	apic_eoi();
+	timer_raise_softirq();
+	softirq_run_pending(r);
+}
+
+void timer_init(void)
+{
+	isr_install_handler(APIC_TIMER_VECTOR, timer_irq, false);
+}
+
+bool timer_start(kernel_timer* t, clock_t deadline, timer_func func, void* data)
+{
+	t->deadline = deadline;
+	t->func = func;
+	t->data = data;
+
+	sync::lock_guard l{timer_lock};
+
+	if(num_timers == MAX_TIMERS)
+	{
+		t->heap_index = TIMER_INACTIVE;
+		return false;
+	}
+
+	heap_place(t, num_timers++);
+	heap_sift_up(t->heap_index);
+
+	if(timer_heap[0] == t)
+	{
+		timer_program();
+	}
+
+	return true;
+}
+
+bool timer_cancel(kernel_timer* t)
+{
+	sync::lock_guard l{timer_lock};
+
+	//a timer that was never started can be all zeros, so the index alone isn't enough
+	if(t->heap_index >= num_timers || timer_heap[t->heap_index] != t)
+		return false;
+
+	heap_remove(t);
+
+	//the interrupt for it might still come, it will just find nothing to do
+	return true;
+}
+
+void timer_run_expired(void)
+{
+	timer_lock.lock();
+
+	clock_t now = sysclock_get_ticks();
+
+	while(num_timers && timer_heap[0]->deadline <= now)
+	{
+		kernel_timer* t = timer_heap[0];
+		heap_remove(t);
+
+		//once the lock is dropped the timer can go away with the stack of whoever was waiting on it
+		timer_func func = t->func;
+		void* data = t->data;
+
+		//the function might start the timer again
+		timer_lock.unlock();
+		func(data);
+		timer_lock.lock();
+	}
+
+	timer_program();
+
+	timer_lock.unlock();
+}
\ No newline at end of file
@@ -0,0 +1,46 @@
+#ifndef TIMER_H
+#define TIMER_H
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdbool.h>
+#include <time.h>
+
+#define TIMER_INACTIVE (~(size_t)0)
+
+//called from the timer softirq when the timer expires, without the big kernel lock
+//interrupts are on, but it should still only set flags and wake cpus up, then return
+typedef void (*timer_func)(void* data);
+
+//owned by whoever starts it, it has to stay around until it expires or is cancelled
+typedef struct kernel_timer
+{
+	clock_t deadline;	//in sysclock ticks
+	timer_func func;
+	void* data;
+	size_t heap_index;	//where it is in the queue, TIMER_INACTIVE if it isn't queued
+} kernel_timer;
+
+//the queue expires on the PIT tick, and on one-shot APIC timer interrupts if the APIC timer is calibrated
+void timer_init(void);
+
+//returns false if there are too many timers waiting already
+//a timer that's already waiting has to be cancelled before it's started again
+bool timer_start(kernel_timer* t, clock_t deadline, timer_func func, void* data);
+
+//returns false if it expired or was never started, a zeroed timer is fine to pass in
+bool timer_cancel(kernel_timer* t);
+
+//runs the functions of every timer that is past its deadline and sets up the next interrupt
+void timer_run_expired(void);
+
+//for the timer irq handlers, timer_run_expired runs once they call softirq_run_pending
+void timer_raise_softirq(void);
+
+#ifdef __cplusplus
+}
+#endif
+#endif
\ No newline at end of file
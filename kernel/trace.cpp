@@ -0,0 +1,121 @@
+#include <kernel/trace.h>
+#include <kernel/cpu.h>
+#include <kernel/smp.h>
+#include <kernel/task.h>
+#include <kernel/locks.h>
+#include <kernel/sysclock.h>
+#include <kernel/memorymanager.h>
+
+#define TRACE_RECORDS_PER_CPU 1024
+
+//only its own cpu writes to a buffer, with interrupts off so an irq's tracepoint can't land in the middle of a record
+struct trace_buffer
+{
+	uint32_t head;	//counts up forever, once it's full the oldest record gets written over
+	trace_record records[TRACE_RECORDS_PER_CPU];
+};
+
+static trace_buffer* buffers[MAX_CPUS];
+static size_t num_buffers = 0;
+
+static volatile bool trace_enabled = false;
+
+void trace_init(void)
+{
+	const size_t pages = memmanager_minimum_pages(sizeof(trace_buffer));
+
+	for(size_t i = 0; i < smp_num_cpus(); i++)
+	{
+		buffers[i] = (trace_buffer*)memmanager_virtual_alloc(nullptr, pages, PAGE_PRESENT | PAGE_RW);
+
+		if(!buffers[i])
+			break;
+
+		buffers[i]->head = 0;
+		num_buffers = i + 1;
+	}
+}
+
+void trace_event(uint16_t event, uint32_t arg0, uint32_t arg1)
+{
+	if(!trace_enabled)
+		return;
+
+	int_lock l = lock_interrupts();
+
+	cpu_state* cpu = this_cpu();
+
+	if(cpu->index < num_buffers)
+	{
+		trace_buffer* buf = buffers[cpu->index];
+		trace_record& r = buf->records[buf->head % TRACE_RECORDS_PER_CPU];
+
+		r.timestamp = sysclock_get_ticks();
+		r.event = event;
+		r.cpu = (uint8_t)cpu->index;
+		r.reserved = 0;
+		r.pid = get_running_process();
+		r.args[0] = arg0;
+		r.args[1] = arg1;
+
+		buf->head++;
+	}
+
+	unlock_interrupts(l);
+}
+
+void trace_syscall_enter(uint32_t index)
+{
+	trace_event(TRACE_SYSCALL_ENTER, index, 0);
+}
+
+void trace_syscall_exit(uint32_t result)
+{
+	trace_event(TRACE_SYSCALL_EXIT, result, 0);
+}
+
+SYSCALL_HANDLER int syscall_trace(int command, trace_record* records, size_t max_records)
+{
+#ifndef KERNEL_TRACE
+	return -1;
+#else
+	switch(command)
+	{
+	case TRACE_CMD_START:
+		trace_enabled = false;
+
+		for(size_t i = 0; i < num_buffers; i++)
+		{
+			buffers[i]->head = 0;
+		}
+
+		trace_enabled = true;
+		return 0;
+	case TRACE_CMD_STOP:
+		trace_enabled = false;
+		return 0;
+	case TRACE_CMD_STATUS:
+		return trace_enabled;
+	case TRACE_CMD_READ:
+	{
+		//the other cpus could be halfway through a record, so it should be stopped first
+		size_t copied = 0;
+
+		for(size_t i = 0; i < num_buffers && copied < max_records; i++)
+		{
+			const trace_buffer* buf = buffers[i];
+			uint32_t count = (buf->head < TRACE_RECORDS_PER_CPU) ? buf->head : TRACE_RECORDS_PER_CPU;
+
+			for(uint32_t n = buf->head - count; n != buf->head && copied < max_records; n++)
+			{
+				records[copied++] = buf->records[n % TRACE_RECORDS_PER_CPU];
+			}
+		}
+
+		return (int)copied;
+	}
+	default:
+		return -1;
+	}
+#endif
+}
\ No newline at end of file
@@ -0,0 +1,36 @@
+#ifndef TRACE_H
+#define TRACE_H
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stdint.h>
+#include <stddef.h>
+#include <common/trace_event.h>
+#include <kernel/syscall.h>
+
+//tracepoints are only compiled in when build.pl defines KERNEL_TRACE,
+//and even then they do nothing but test a flag until someone starts recording
+#ifdef KERNEL_TRACE
+#define TRACE(event, arg0, arg1) trace_event((event), (uint32_t)(arg0), (uint32_t)(arg1))
+#else
+#define TRACE(event, arg0, arg1) ((void)0)
+#endif
+
+//gives every cpu its buffer, after the other cpus are started
+void trace_init(void);
+
+//adds a record to this cpu's buffer, safe to call from anywhere including an irq handler
+void trace_event(uint16_t event, uint32_t arg0, uint32_t arg1);
+
+//for syscall.asm
+void trace_syscall_enter(uint32_t index);
+void trace_syscall_exit(uint32_t result);
+
+//returns -1 if the kernel was built without tracepoints
+SYSCALL_HANDLER int syscall_trace(int command, trace_record* records, size_t max_records);
+
+#ifdef __cplusplus
+}
+#endif
+#endif
\ No newline at end of file
@@ -2,9 +2,17 @@
 #define TSS_H
 
 #include <stdint.h>
+#include <kernel/cpu.h>
 
-struct tss;
+//copies the boot GDT into the cpu's own one and loads it
+void cpu_load_gdt(cpu_state* cpu);
 
-tss* create_TSS(uintptr_t stack_addr);
+//sets up the TSS of the cpu we are running on, stack_addr is the kernel stack
+//used when an interrupt comes in from user mode until the first task switch changes it
+void cpu_load_tss(cpu_state* cpu, uintptr_t stack_addr);
+
+//points the user gs segment at the running thread's TLS block
+//gs only picks up the new base when it's loaded again
+void cpu_set_tls_base(cpu_state* cpu, uintptr_t base);
 
 #endif
\ No newline at end of file
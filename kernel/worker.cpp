@@ -0,0 +1,77 @@
+#include <kernel/worker.h>
+#include <kernel/task.h>
+#include <kernel/locks.h>
+#include <kernel/kassert.h>
+
+//a single thread is plenty while only one cpu at a time can be in the kernel
+static kernel_work* work_head = nullptr;
+static kernel_work* work_tail = nullptr;
+
+static constinit sync::spinlock work_lock{};
+
+static TCB* worker_task = nullptr;
+
+static void worker_main(void*)
+{
+	for(;;)
+	{
+		work_lock.lock();
+
+		kernel_work* w = work_head;
+		work_func func = nullptr;
+		void* data = nullptr;
+
+		if(w)
+		{
+			work_head = w->next;
+			if(!work_head) { work_tail = nullptr; }
+
+			func = w->func;
+			data = w->data;
+			w->queued = false;
+		}
+		else
+		{
+			//before the lock is let go, so work that comes in right after wakes us
+			task_prepare_to_block();
+		}
+
+		work_lock.unlock();
+
+		if(func)
+		{
+			func(data);
+		}
+		else
+		{
+			task_block();
+		}
+	}
+}
+
+void work_init(void)
+{
+	worker_task = task_create_kernel_thread(worker_main, nullptr);
+	k_assert(worker_task);
+}
+
+bool work_schedule(kernel_work* w, work_func func, void* data)
+{
+	sync::lock_guard l{work_lock};
+
+	if(w->queued)
+		return false;
+
+	w->func = func;
+	w->data = data;
+	w->next = nullptr;
+	w->queued = true;
+
+	if(work_tail) { work_tail->next = w; }
+	else { work_head = w; }
+
+	work_tail = w;
+
+	task_wake(worker_task);
+	return true;
+}
\ No newline at end of file
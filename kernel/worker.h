@@ -0,0 +1,33 @@
+#ifndef WORKER_H
+#define WORKER_H
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdbool.h>
+
+//runs in the worker thread with the big kernel lock, so unlike a timer or an irq handler it can block
+typedef void (*work_func)(void* data);
+
+//owned by whoever schedules it, it has to stay around until it has run
+typedef struct kernel_work
+{
+	work_func func;
+	void* data;
+	struct kernel_work* next;
+	volatile bool queued;
+} kernel_work;
+
+//starts the kernel thread that runs the work, needs the scheduler to be set up
+void work_init(void);
+
+//queues the work to run as soon as the worker gets a cpu, safe to call from an interrupt handler
+//returns false if it's already queued, it can be scheduled again once it has started running
+bool work_schedule(kernel_work* w, work_func func, void* data);
+
+#ifdef __cplusplus
+}
+#endif
+#endif
\ No newline at end of file
@@ -126,6 +126,136 @@ static void list_directory(const file_handle* dir_handle)
 	print_strings(" Bytes\n\n");
 }
 
+struct profile_count
+{
+	size_t symbol;
+	size_t count;
+};
+
+//sorts to add up the duplicates, then by count
+static std::vector<profile_count> tally(std::vector<size_t>& keys)
+{
+	std::sort(keys.begin(), keys.end(), [](auto a, auto b) { return a < b; });
+
+	std::vector<profile_count> counts;
+	for(auto key : keys)
+	{
+		if(counts.empty() || counts.back().symbol != key)
+		{
+			counts.push_back({key, 0});
+		}
+		counts.back().count++;
+	}
+
+	std::sort(counts.begin(), counts.end(),
+			  [](auto&& a, auto&& b) { return a.count > b.count; });
+	return counts;
+}
+
+static void print_counts(const char* title, const std::vector<profile_count>& counts,
+						 const std::vector<profile_symbol>& symbols, size_t total)
+{
+	printf("\n %s\n", title);
+
+	for(size_t i = 0; i < counts.size() && i < 12; i++)
+	{
+		const profile_symbol& sym = symbols[counts[i].symbol];
+
+		printf(" %6d %3d%%  ", counts[i].count, counts[i].count * 100 / total);
+
+		if(sym.name[0]) { printf("%s\n", sym.name); }
+		else { printf("%08X\n", sym.address); }
+	}
+}
+
+//kernel and driver addresses get a name from the kernel's symbol tables
+//user programs are gone by the time this runs, so their samples are only shown by address
+static int profile_report()
+{
+	profile_control(PROFILE_CMD_STOP, nullptr, 0);
+
+	std::vector<profile_sample> samples(PROFILE_SAMPLES_PER_CPU * SYSTEM_PAGE->num_cpus);
+	const int num_samples = profile_control(PROFILE_CMD_READ, samples.data(), samples.size());
+
+	if(num_samples <= 0)
+	{
+		print_strings("No samples\n");
+		return -1;
+	}
+
+	std::vector<uintptr_t> addresses;
+	for(int i = 0; i < num_samples; i++)
+	{
+		for(size_t d = 0; d < samples[i].depth; d++)
+		{
+			addresses.push_back(samples[i].pc[d]);
+		}
+	}
+
+	std::sort(addresses.begin(), addresses.end(), [](auto a, auto b) { return a < b; });
+
+	//the kernel is asked about each address once
+	std::vector<profile_symbol> symbols;
+	for(auto address : addresses)
+	{
+		if(symbols.empty() || symbols.back().address != address)
+		{
+			symbols.push_back({address, 0, {}});
+		}
+	}
+
+	profile_control(PROFILE_CMD_SYMBOLIZE, symbols.data(), symbols.size());
+
+	//the addresses are sorted, so all the ones in a function are next to each other
+	//and the first of them stands for the function
+	std::vector<size_t> function_of(symbols.size());
+	for(size_t i = 0; i < symbols.size(); i++)
+	{
+		const bool same = i > 0 && symbols[i].name[0] && 
+						  symbols[i].symbol_address == symbols[i - 1].symbol_address;
+		function_of[i] = same ? function_of[i - 1] : i;
+	}
+
+	auto function_at = [&](uintptr_t address)
+	{
+		auto it = std::lower_bound(symbols.begin(), symbols.end(), address,
+								   [](auto&& s, auto val) { return s.address < val; });
+		return function_of[it - symbols.begin()];
+	};
+
+	std::vector<size_t> self_keys;
+	std::vector<size_t> stack_keys;
+	size_t user_samples = 0;
+
+	for(int i = 0; i < num_samples; i++)
+	{
+		const profile_sample& s = samples[i];
+
+		if(s.flags & PROFILE_SAMPLE_USER) { user_samples++; }
+
+		self_keys.push_back(function_at(s.pc[0]));
+
+		//a function that recursed is only counted once per sample
+		const size_t first_key = stack_keys.size();
+		for(size_t d = 0; d < s.depth; d++)
+		{
+			const size_t f = function_at(s.pc[d]);
+
+			if(symbols[f].name[0] && std::find(stack_keys.begin() + first_key, stack_keys.end(), f) == stack_keys.end())
+			{
+				stack_keys.push_back(f);
+			}
+		}
+	}
+
+	printf("%d samples, %d%% in user code\n", num_samples, user_samples * 100 / num_samples);
+
+	print_counts("Where the cpus were:", tally(self_keys), symbols, num_samples);
+	print_counts("Kernel functions on the stack:", tally(stack_keys), symbols, num_samples);
+
+	return 0;
+}
+
 struct command
 {
 	std::string_view name;
@@ -362,6 +492,27 @@ constexpr std::array builtin_commands = []()
 					}
 					return 0;
 				}},
+		command{"profile", "start|stop",
+				"Samples what the cpus are doing, stop shows where the time went", 2,
+				[](const auto& keywords)
+				{
+					if(keywords[1] == "start"sv)
+					{
+						if(profile_control(PROFILE_CMD_START, nullptr, 0) != 0)
+						{
+							print_strings("Unable to start the profiler\n");
+							return -1;
+						}
+						return 0;
+					}
+					if(keywords[1] == "stop"sv)
+					{
+						return profile_report();
+					}
+
+					print_strings("Usage: profile start|stop\n");
+					return -1;
+				}},
 		command{"help", "", "Displays the help for the shell", 1,
 				[](const auto& keywords)
 				{
@@ -316,6 +316,9 @@ int main(int argc, char** argv)
 					s_term.print(buf, size);
 			   });
 
+	//typed characters are echoed with putchar, they have to show up straight away
+	setvbuf(stdout, nullptr, _IONBF, 0);
+
 	s_term.clear();
 	splash_text(s_term.width());
 